@@ -1,4 +1,5 @@
 #include "containers.h"
+#include "ccl_internal.h"
 
 struct _StreamBuffer {
 	size_t Size;
@@ -233,6 +234,150 @@ Resize,
 ReadFromFile,
 WriteToFile,
 };
+/* --------------------------------------------------------------------------
+                     Block buffered files (see ccl_internal.h)
+   ------------------------------------------------------------------------- */
+int BlockFileInit(struct BlockFile *bf,FILE *f,uint64_t ReadLimit,const ContainerAllocator *m)
+{
+	bf->f = f;
+	bf->pos = bf->len = 0;
+	bf->left = ReadLimit;
+	bf->Allocator = m;
+	bf->buf = m->malloc(BLOCKFILE_SIZE);
+	if (bf->buf == NULL)
+		return CONTAINER_ERROR_NOMEMORY;
+	return 1;
+}
+
+int BlockFileFlush(struct BlockFile *bf)
+{
+	if (bf->len && fwrite(bf->buf,1,bf->len,bf->f) != bf->len)
+		return EOF;
+	bf->len = 0;
+	return 1;
+}
+
+int BlockFileWrite(struct BlockFile *bf,const void *data,size_t n)
+{
+	const unsigned char *p = data;
+	size_t chunk;
+
+	if (n >= BLOCKFILE_SIZE) {
+		/* Large data goes directly to the file */
+		if (BlockFileFlush(bf) < 0 || fwrite(p,1,n,bf->f) != n)
+			return EOF;
+		return 1;
+	}
+	while (n) {
+		if (bf->len == BLOCKFILE_SIZE && BlockFileFlush(bf) < 0)
+			return EOF;
+		chunk = BLOCKFILE_SIZE - bf->len;
+		if (chunk > n)
+			chunk = n;
+		memcpy(bf->buf+bf->len,p,chunk);
+		bf->len += chunk;
+		p += chunk;
+		n -= chunk;
+	}
+	return 1;
+}
+
+int BlockFileWriteULE128(struct BlockFile *bf,size_t val)
+{
+	unsigned char tmp[2*sizeof(size_t)];
+	int i = 0;
+
+	do {
+		tmp[i] = val & 0x7f;
+		val >>= 7;
+		if (val)
+			tmp[i] |= 0x80;
+		i++;
+	} while (val);
+	return BlockFileWrite(bf,tmp,i);
+}
+
+size_t ULE128Size(size_t val)
+{
+	size_t n = 1;
+
+	while (val >>= 7)
+		n++;
+	return n;
+}
+
+/* Reads the next block, keeping the bytes not yet consumed */
+static int FillBlock(struct BlockFile *bf)
+{
+	size_t n,rest = bf->len - bf->pos;
+
+	memmove(bf->buf,bf->buf+bf->pos,rest);
+	bf->pos = 0;
+	bf->len = rest;
+	n = BLOCKFILE_SIZE - rest;
+	if (n > bf->left)
+		n = (size_t)bf->left;
+	if (n == 0)
+		return EOF;
+	n = fread(bf->buf+rest,1,n,bf->f);
+	if (n == 0)
+		return EOF;
+	bf->len += n;
+	bf->left -= n;
+	return 1;
+}
+
+int BlockFileRead(struct BlockFile *bf,void *data,size_t n)
+{
+	unsigned char *p = data;
+	size_t chunk;
+
+	while (n) {
+		if (bf->pos == bf->len) {
+			if (n >= BLOCKFILE_SIZE) {
+				/* Large data is read directly */
+				if (n > bf->left || fread(p,1,n,bf->f) != n)
+					return EOF;
+				bf->left -= n;
+				return 1;
+			}
+			if (FillBlock(bf) < 0)
+				return EOF;
+		}
+		chunk = bf->len - bf->pos;
+		if (chunk > n)
+			chunk = n;
+		memcpy(p,bf->buf+bf->pos,chunk);
+		bf->pos += chunk;
+		p += chunk;
+		n -= chunk;
+	}
+	return 1;
+}
+
+int BlockFileReadULE128(struct BlockFile *bf,size_t *val)
+{
+	size_t i = 0;
+	unsigned c;
+
+	*val = 0;
+	do {
+		if (bf->pos == bf->len && FillBlock(bf) < 0)
+			return EOF;
+		c = bf->buf[bf->pos++];
+		*val |= (size_t)(c & 0x7f) << (i * 7);
+		i++;
+	} while ((c & 0x80) && i*7 < 8*sizeof(size_t));
+	return (int)i;
+}
+
+/* A writer must call BlockFileFlush first */
+void BlockFileFinalize(struct BlockFile *bf)
+{
+	bf->Allocator->free(bf->buf);
+	bf->buf = NULL;
+}
+
 /* --------------------------------------------------------------------------
                                Circular buffers
    ------------------------------------------------------------------------- */
@@ -14,6 +14,13 @@ int snprintf(char *restrict s, size_t n, const char *restrict format, ...);
 /* This macro supposes that n is a power of two */
 #define roundupTo(x,n) (((x)+((n)-1))&(~((n)-1)))
 #define roundup(x) roundupTo(x,sizeof(void *))
+/* Hint to bring the memory at p into the cache before it is read. Used
+   by the batched lookups to overlap the cache misses of several keys */
+#ifdef __GNUC__
+#define CCL_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define CCL_PREFETCH(p) ((void)0)
+#endif
 /* This function is needed to read a line from a file.
    The resulting line is allocated with the given memory manager
 */
@@ -27,6 +34,100 @@ typedef struct {
     unsigned char Data4[8];
 } guid;
 
+/* Append only storage for strings, taken in chunks from a pool (see
+   pool.c). The dictionaries use it to store their keys without one
+   allocation per key. Everything is released at once. */
+struct StringArena {
+    Pool *pool;             /* NULL if the arena isn't used */
+    char *next;             /* Free space in the current chunk */
+    size_t left;
+};
+int StringArenaInit(struct StringArena *a,const ContainerAllocator *m);
+void *StringArenaAlloc(struct StringArena *a,size_t size,size_t align);
+void StringArenaClear(struct StringArena *a);
+void StringArenaFinalize(struct StringArena *a);
+
+/* Reading and writing a file in large blocks (buffer.c), for the Save and
+   Load functions that would otherwise make one stdio call per field.
+   Lengths are ULE128 encoded: 7 bits per byte, the high bit set in all
+   bytes but the last. A reader is given the number of bytes it may
+   read, so it never reads past the data of its container. */
+#define BLOCKFILE_SIZE (256*1024)
+/* Byte count of the hash table files whose values were written by a
+   save function */
+#define SAVED_WITH_FUNCTION ((uint64_t)-1)
+struct BlockFile {
+    FILE *f;
+    unsigned char *buf;
+    size_t pos;             /* Next byte of buf */
+    size_t len;             /* Bytes in buf */
+    uint64_t left;          /* Bytes of the file still to be read */
+    const ContainerAllocator *Allocator;
+};
+int BlockFileInit(struct BlockFile *bf,FILE *f,uint64_t ReadLimit,const ContainerAllocator *m);
+int BlockFileWrite(struct BlockFile *bf,const void *data,size_t n);
+int BlockFileWriteULE128(struct BlockFile *bf,size_t val);
+int BlockFileFlush(struct BlockFile *bf);
+int BlockFileRead(struct BlockFile *bf,void *data,size_t n);
+int BlockFileReadULE128(struct BlockFile *bf,size_t *val);
+void BlockFileFinalize(struct BlockFile *bf);
+size_t ULE128Size(size_t val);
+
+/* Filling a HashStatistics (hashfunctions.c). A chained table gives the
+   length of each chain, an open addressing table the probe length of
+   each entry, and HashStatsEntry counts the entries kept out of the
+   slots. HashStatsFinish computes the averages and the counts of empty
+   slots. */
+void HashStatsInit(HashStatistics *s,size_t Slots);
+void HashStatsChain(HashStatistics *s,size_t length);
+void HashStatsProbe(HashStatistics *s,size_t probes);
+void HashStatsEntry(HashStatistics *s,size_t probes);
+void HashStatsFinish(HashStatistics *s,size_t ElementSize,size_t Sizeof);
+
+/* The bucket visited after the bucket cursor by the Scan function of the
+   chained and flat hash tables (hashfunctions.c). The buckets are visited
+   in reverse binary order, zero is the first and the end of the scan. A
+   slice visits at most HASH_SCAN_BUCKETS buckets per entry asked for, so
+   that a slice of a sparse table stays short. */
+#define HASH_SCAN_BUCKETS 10
+size_t HashScanNext(size_t cursor,size_t mask);
+
+/* Running a job in several threads (parallel.c). Work(arg,i) is called
+   once for each i below n, in n-1 new threads and in the caller's; the
+   function returns when all calls are done. If a thread can't be
+   started its part runs in the caller's thread. ParallelThreads is the
+   number of threads worth starting: the number of processors, or the
+   value of the environment variable CCL_THREADS. ParallelEnter and
+   ParallelLeave delimit the code that only one thread may run at a
+   time, like the callbacks of the user that aren't thread safe. */
+#define PARALLEL_MAX_THREADS 64
+unsigned ParallelThreads(void);
+void ParallelRun(unsigned n,void (*Work)(void *arg,unsigned i),void *arg);
+void ParallelEnter(void);
+void ParallelLeave(void);
+
+/* Sorting in several threads (qsortex.c): each thread sorts a run with
+   qsortEx, then the runs are merged in pairs, each merge split among
+   the threads. The comparison function is called by several threads at
+   once. Small arrays, or an array for which the buffer of the merges
+   can't be allocated, are sorted by qsortEx in the caller's thread. */
+void ParallelSort(void *base,size_t num,size_t width,CompareFunction cmp,CompareInfo *ci,const ContainerAllocator *mm);
+
+/* Sorting records of width bytes by the integer or floating point key
+   of KeyWidth bytes (1, 2, 4 or 8; 4 or 8 for CCL_KEY_FLOAT) at offset
+   (qsortex.c). From RADIX_SORT_MIN records on an LSD radix sort is used,
+   below it, or without memory for its buffer, qsortEx. Returns 1, or
+   BADARG if the key doesn't fit these sizes or the records. */
+#define RADIX_SORT_MIN 256
+int KeySort(void *base,size_t num,size_t width,size_t offset,size_t KeyWidth,int KeyType,const ContainerAllocator *mm);
+
+/* Stable sorts (qsortex.c): an adaptive natural merge sort, linear on
+   sorted input. MergeSort needs a buffer of half the array and returns
+   1 or NOMEMORY; MergeSortLinked relinks the nodes of a list, whose
+   first field is the Next pointer, and returns the first one. */
+int MergeSort(void *base,size_t num,size_t width,CompareFunction cmp,CompareInfo *ci,const ContainerAllocator *mm);
+void *MergeSortLinked(void *First,size_t count,size_t DataOffset,CompareFunction cmp,CompareInfo *ci,void **pLast);
+
 /*----------------------------------------------------------------------------*/
 /* Definition of the Mask type                                                */
 /*----------------------------------------------------------------------------*/
@@ -174,6 +275,16 @@ struct DListIterator {
 /*----------------------------------------------------------------------------*/
 /* Dictionary                                                                 */
 /*----------------------------------------------------------------------------*/
+/* A chain that grows over CHAIN_GUARD_LENGTH entries is moved to a balanced  */
+/* tree ordered by hash and key, so lookups stay logarithmic even when many   */
+/* keys collide. The entries of the tree are also linked in key order, and    */
+/* this list is seen as one more slot after the slot tables.                  */
+#define CHAIN_GUARD_LENGTH 32
+struct GuardNode {
+	struct GuardNode *down[2];
+	void *Entry;                    /* struct DataList or struct WDataList */
+	int height;
+};
 struct _Dictionary {
 	DictionaryInterface *VTable;
 	size_t count;
@@ -187,9 +298,21 @@ struct _Dictionary {
 	HashFunction hash;
 	struct DataList {
 		struct DataList *Next;
+		size_t Hash;            /* Full hash of Key */
 		char *Key;
 		void *Value;
 	} **buckets;
+	struct DataList **OldBuckets;   /* Slot table being drained during a resize */
+	size_t OldSize;                 /* Number of slots in OldBuckets */
+	size_t RehashIndex;             /* Next slot of OldBuckets to migrate */
+	double MaxLoadFactor;           /* Grow when count/size exceeds this */
+	struct StringArena Arena;       /* Storage of the keys if Arena.pool */
+	Dictionary *InternTable;        /* Shared table of interned keys or NULL */
+	uint64_t Seed;                  /* If not zero keys are hashed with Hash64 */
+	struct GuardNode *GuardRoot;    /* Entries of the chains that grew too long */
+	struct DataList *GuardList;     /* The same entries, in key order */
+	size_t GuardCount;
+	size_t Resizes;                 /* Slot tables allocated by Grow */
 };
 
 #define DICTIONARY_MAGIC_NUMBER	89098765432123456LL
@@ -203,6 +326,150 @@ struct DictionaryIterator {
 	unsigned long Flags;
 };
 
+/*----------------------------------------------------------------------------*/
+/* Open addressing dictionary. The header fields up to "hash" are the same    */
+/* as in the Dictionary. The table is made of slots holding the hash, the key */
+/* pointer and the value, and of one control byte per slot that holds 7 bits  */
+/* of the hash or a marker for empty/deleted slots. The first GROUP_WIDTH     */
+/* control bytes are repeated after the last one so that a group of control  */
+/* bytes can be read at any slot position without wrapping.                   */
+/*----------------------------------------------------------------------------*/
+#define FLATDICT_GROUP_WIDTH 8
+struct FlatSlot {
+	size_t Hash;
+	char *Key;
+	/* The value (ElementSize bytes) follows, aligned to a pointer */
+};
+
+struct FlatDictionary {
+	DictionaryInterface *VTable;
+	size_t count;
+	unsigned Flags;
+	size_t size;                   /* Number of slots. Always a power of two */
+	ErrorFunction RaiseError;
+	unsigned timestamp;
+	size_t ElementSize;
+	const ContainerAllocator *Allocator;
+	DestructorFunction DestructorFn;
+	HashFunction hash;
+	unsigned char *Control;        /* size+FLATDICT_GROUP_WIDTH control bytes */
+	char *Slots;                   /* size slots of SlotSize bytes each */
+	size_t SlotSize;
+	size_t Deleted;                /* Number of slots marked as deleted */
+	double MaxLoadFactor;
+	struct StringArena Arena;      /* Storage of the keys if Arena.pool */
+	Dictionary *InternTable;       /* Shared table of interned keys or NULL */
+	uint64_t Seed;                 /* If not zero keys are hashed with Hash64 */
+	size_t Resizes;                /* Rehashes into a table of another size */
+};
+
+#define FLATDICTIONARY_MAGIC_NUMBER	45678909876543212LL
+struct FlatDictionaryIterator {
+	Iterator it;
+	long long Magic;
+	struct FlatDictionary *Dict;
+	size_t index;
+	unsigned timestamp;
+	unsigned long Flags;
+};
+
+/*----------------------------------------------------------------------------*/
+/* Frozen dictionary: an immutable table built with a minimal perfect hash.   */
+/* The keys are distributed in buckets; each bucket has a displacement pair   */
+/* chosen so that all its keys land in distinct entries. A lookup reads the   */
+/* displacement of the key's bucket and then exactly one entry. The header,   */
+/* the displacements, the entries (hash, key offset and value) and the key    */
+/* characters are allocated as one block.                                     */
+/*----------------------------------------------------------------------------*/
+struct FrozenEntry {
+	uint64_t Hash;
+	size_t KeyOffset;              /* Offset of the key in the Keys area */
+	/* The value (ElementSize bytes) follows, aligned to a pointer */
+};
+
+struct FrozenDictionary {
+	DictionaryInterface *VTable;
+	size_t count;
+	unsigned Flags;
+	size_t size;                   /* Number of entries, equal to count */
+	ErrorFunction RaiseError;
+	unsigned timestamp;
+	size_t ElementSize;
+	const ContainerAllocator *Allocator;
+	DestructorFunction DestructorFn;
+	HashFunction hash;             /* Not used: kept for the common header */
+	uint64_t Seed;
+	size_t NBuckets;
+	uint32_t *Displacement;        /* Two values per bucket */
+	char *Entries;                 /* size entries of EntrySize bytes */
+	size_t EntrySize;
+	char *Keys;                    /* The zero terminated keys */
+	size_t KeysSize;
+	size_t BlockSize;              /* Size of the whole allocation */
+	char *Mapping;                 /* Snapshot file mapped in memory, or NULL */
+	size_t MappingSize;
+};
+
+#define FROZENDICTIONARY_MAGIC_NUMBER	45678909876543213LL
+struct FrozenDictionaryIterator {
+	Iterator it;
+	long long Magic;
+	struct FrozenDictionary *Dict;
+	size_t index;
+	unsigned timestamp;
+	unsigned long Flags;
+};
+/* Builds a frozen dictionary from n keys. Values[i] points to the data of
+   Keys[i] or is NULL. Duplicated keys keep the first value. */
+Dictionary *FreezeDictionary(size_t n,const char **Keys,const void **Values,size_t ElementSize,const ContainerAllocator *allocator);
+Dictionary *FreezeStrCollection(const strCollection *Keys,size_t ElementSize,const void *Values);
+/* Snapshot files: a header followed by the data of a frozen dictionary */
+int SaveFrozenSnapshot(const struct FrozenDictionary *Dict,FILE *stream);
+Dictionary *OpenDictionarySnapshot(const char *FileName,int VerifyData);
+
+/*----------------------------------------------------------------------------*/
+/* Concurrent dictionary. The keys are spread by their hash over a fixed      */
+/* number of stripes. Each stripe is a chained table with its own lock, so    */
+/* threads working on different stripes never wait for each other. The       */
+/* stripes, with their locks, are defined in concurrentdictionary.c           */
+/*----------------------------------------------------------------------------*/
+#define CONCURRENT_STRIPE_BITS 6
+#define CONCURRENT_STRIPES     (1 << CONCURRENT_STRIPE_BITS)
+struct ConcurrentEntry {
+	struct ConcurrentEntry *Next;
+	size_t Hash;                   /* Full hash of Key */
+	char *Key;                     /* Stored after the value, same block */
+	/* The value (ElementSize bytes) follows, aligned to a pointer */
+};
+
+struct ConcurrentDictionary {
+	DictionaryInterface *VTable;
+	unsigned Flags;
+	ErrorFunction RaiseError;
+	size_t ElementSize;
+	const ContainerAllocator *Allocator;
+	DestructorFunction DestructorFn;
+	HashFunction hash;
+	double MaxLoadFactor;
+	struct ConcurrentStripe *Stripes; /* Aligned to a cache line */
+	void *StripeBlock;             /* Allocation that holds the stripes */
+	uint64_t Seed;                 /* If not zero keys are hashed with Hash64 */
+};
+
+#define CONCURRENTDICTIONARY_MAGIC_NUMBER	45678909876543214LL
+struct ConcurrentDictionaryIterator {
+	Iterator it;
+	long long Magic;
+	struct ConcurrentDictionary *Dict;
+	size_t Stripe;                 /* Position of the next element */
+	size_t Bucket;
+	size_t Depth;
+	size_t index;
+	char *Key;                     /* Copy of the key of the current element */
+	size_t KeySize;
+	/* A copy of the value of the current element follows */
+};
+
 /*----------------------------------------------------------------------------*/
 /* Wide character dictionary (key is wchar_t)                                 */
 /*----------------------------------------------------------------------------*/
@@ -219,9 +486,21 @@ struct _WDictionary {
 	WHashFunction hash;
 	struct WDataList {
 		struct WDataList *Next;
+		size_t Hash;            /* Full hash of Key */
 		wchar_t *Key;
 		void *Value;
 	} **buckets;
+	struct WDataList **OldBuckets;  /* Slot table being drained during a resize */
+	size_t OldSize;                 /* Number of slots in OldBuckets */
+	size_t RehashIndex;             /* Next slot of OldBuckets to migrate */
+	double MaxLoadFactor;           /* Grow when count/size exceeds this */
+	struct StringArena Arena;       /* Storage of the keys if Arena.pool */
+	WDictionary *InternTable;       /* Shared table of interned keys or NULL */
+	uint64_t Seed;                  /* If not zero keys are hashed with Hash64 */
+	struct GuardNode *GuardRoot;    /* Entries of the chains that grew too long */
+	struct WDataList *GuardList;    /* The same entries, in key order */
+	size_t GuardCount;
+	size_t Resizes;                 /* Slot tables allocated by Grow */
 };
 
 #define WDICTIONARY_MAGIC_NUMBER	78909876543212345LL
@@ -240,7 +519,7 @@ struct WDictionaryIterator {
 /*----------------------------------------------------------------------------*/
 typedef struct _HashEntry {
     struct _HashEntry *next;
-    unsigned int       hash;
+    uint64_t           hash;
     const void        *key;
     size_t             klen;
     char              val[1];
@@ -255,7 +534,7 @@ typedef struct _HashEntry {
 typedef struct _HashIndex {
     HashTable     *ht;
     HashEntry     *This, *next;
-    unsigned int   index;
+    size_t         index;
 } HashIndex;
 /*
  * The size of the array is always a power of two. We use the maximum
@@ -269,7 +548,8 @@ struct _HashTable {
     Pool          *pool;
     HashEntry   **array;
     HashIndex     iterator;  /* For hash_first(NULL, ...) */
-    unsigned int   count, max;
+    unsigned int   count;
+    size_t         max;
     GeneralHashFunction   Hash;
     HashEntry     *free;  /* List of recycled entries */
     unsigned       Flags;
@@ -278,6 +558,12 @@ struct _HashTable {
     size_t         ElementSize;
     const ContainerAllocator *Allocator;
     DestructorFunction DestructorFn;
+    uint64_t       Seed;  /* If not zero keys are hashed with Hash64 */
+    size_t         Reserved; /* Reserve argument, the table won't shrink below it */
+    int            OwnPool;  /* The pool belongs to the table, that can replace it */
+    Pool          *KeyPool;  /* Keys read by Load, or NULL */
+    size_t         Resizes;  /* Arrays allocated with another number of slots */
+    int            IntegerKeys; /* Made by CreateIntegerKeys: the uint64_t keys are in the entries */
 };
 
 #define HASHTABLE_MAGIC_NUMBER	654321234567890LL
@@ -291,6 +577,87 @@ struct HashTableIterator {
 	HashIndex *Current;
 };
 
+/*----------------------------------------------------------------------------*/
+/* Read-mostly hash table: the HashTable interface for tables read by many    */
+/* threads and seldom changed. The chains are made of HashEntry as in         */
+/* iHashTable. Readers take no lock: writers never change an entry or an      */
+/* array that a reader can reach, they publish a new one and retire the old   */
+/* one, that is freed once no reader can still see it (rcuhashtable.c).       */
+/*----------------------------------------------------------------------------*/
+struct RCUBuckets {
+    GeneralHashFunction Hash;      /* The hashing goes with the array, so a */
+    uint64_t Seed;                 /* reader always uses the right one */
+    size_t max;                    /* Number of buckets - 1, a 2^n - 1 mask */
+    HashEntry *slot[1];
+};
+
+struct RCUHashTable {
+    HashTableInterface *VTable;
+    struct RCUBuckets *Buckets;    /* Current array, replaced as a whole */
+    size_t count;
+    unsigned Flags;
+    ErrorFunction RaiseError;
+    unsigned timestamp;
+    size_t ElementSize;
+    const ContainerAllocator *Allocator;
+    DestructorFunction DestructorFn;
+    size_t Reserved;               /* The table won't shrink below it */
+    struct RCUWriter *Writer;      /* Lock of the writers and retired memory */
+    size_t Resizes;                /* Arrays published with another size */
+};
+
+struct RCUHashTableIterator {
+    Iterator it;
+    struct RCUHashTable *ht;
+    struct RCUBuckets *Buckets;    /* Array seen by the iteration */
+    size_t index;                  /* Next bucket */
+    HashEntry *Current,*Next;
+    struct RCUReader *Reader;      /* Not NULL during the iteration */
+};
+
+/*----------------------------------------------------------------------------*/
+/* Flat hash table: the HashTable interface with a Robin Hood open addressing */
+/* table. Each slot holds the mixed hash, the key pointer and length and the  */
+/* value; an empty slot has a NULL key. The distance of an entry from its     */
+/* home slot is computed from its hash, so it is not stored.                  */
+/*----------------------------------------------------------------------------*/
+struct FlatHashSlot {
+	uint64_t hash;
+	const void *key;
+	size_t klen;
+	/* The value (ElementSize bytes) follows, aligned to a pointer */
+};
+
+struct FlatHashTable {
+	HashTableInterface *VTable;
+	size_t count;
+	unsigned Flags;
+	size_t size;                   /* Number of slots. Always a power of two */
+	ErrorFunction RaiseError;
+	unsigned timestamp;
+	size_t ElementSize;
+	const ContainerAllocator *Allocator;
+	DestructorFunction DestructorFn;
+	GeneralHashFunction Hash;
+	uint64_t Seed;                 /* If not zero keys are hashed with Hash64 */
+	char *Slots;                   /* size slots of SlotSize bytes each */
+	size_t SlotSize;
+	char *Spare;                   /* Two slots used to move entries */
+	size_t MaxProbe;               /* Longest distance from a home slot */
+	Pool *KeyPool;                 /* Keys read by Load, or NULL */
+	size_t Reserved;               /* Reserve argument, the table won't shrink below it */
+	size_t Resizes;                /* Rehashes into a table of another size */
+};
+
+struct FlatHashTableIterator {
+	Iterator it;
+	struct FlatHashTable *ht;
+	size_t start;                  /* The iteration begins after an empty slot */
+	size_t pos;                    /* Slots visited */
+	unsigned timestamp;
+	unsigned long Flags;
+};
+
 /*----------------------------------------------------------------------------*/
 /* Tree map                                                                   */
 /*----------------------------------------------------------------------------*/
@@ -0,0 +1,1337 @@
+/*------------------------------------------------------------------------
+ Module:        concurrentdictionary.c
+ Author:        jacob
+ Project:       Containers
+ State:
+ Creation Date:
+ Description:   This file implements the Dictionary interface for
+                tables shared by several threads. The keys are spread
+                over CONCURRENT_STRIPES stripes by their hash. Each
+                stripe is a chained hash table protected by its own
+                read/write lock, and grows on its own, so threads
+                that work on different stripes never wait for each
+                other. The stripes are aligned to a cache line to
+                avoid false sharing between their locks.
+                Add, Insert, Replace, Erase, Contains and CopyElement
+                can be called at any time from any thread. GetElement
+                returns a pointer into the table: it stays valid only
+                while no other thread erases or replaces that key, so
+                the safe way to read a value is CopyElement.
+                Functions that see the whole table (Apply, Copy,
+                Save, GetKeys, the iterators) lock one stripe at a
+                time: they see each stripe in a consistent state but
+                not the whole table at one instant.
+                Finalize, SetHashFunction, SetMaxLoadFactor and the
+                Set* functions must not run concurrently with other
+                calls. Observers are not supported.
+------------------------------------------------------------------------*/
+#include <limits.h>
+#include <stddef.h>
+#include "containers.h"
+#include "ccl_internal.h"
+#ifdef UNIX
+#include <pthread.h>
+typedef pthread_rwlock_t RWLock;
+#define LOCK_INIT(l)     pthread_rwlock_init(l,NULL)
+#define LOCK_DESTROY(l)  pthread_rwlock_destroy(l)
+#define READ_LOCK(l)     pthread_rwlock_rdlock(l)
+#define WRITE_LOCK(l)    pthread_rwlock_wrlock(l)
+#define UNLOCK(l)        pthread_rwlock_unlock(l)
+#else
+#include <windows.h>
+/* Critical sections exist in all versions of windows. They don't let
+   readers run in parallel but the stripes still spread the load */
+typedef CRITICAL_SECTION RWLock;
+#define LOCK_INIT(l)     InitializeCriticalSection(l)
+#define LOCK_DESTROY(l)  DeleteCriticalSection(l)
+#define READ_LOCK(l)     EnterCriticalSection(l)
+#define WRITE_LOCK(l)    EnterCriticalSection(l)
+#define UNLOCK(l)        LeaveCriticalSection(l)
+#endif
+
+typedef struct ConcurrentDictionary ConcurrentDictionary;
+
+struct ConcurrentStripe {
+    RWLock Lock;
+    struct ConcurrentEntry **buckets;
+    size_t size;                /* Number of buckets, a power of two */
+    size_t count;
+    unsigned timestamp;
+    size_t Resizes;             /* Times the buckets were doubled */
+};
+
+#define CACHE_LINE      64
+#define STRIPE_SIZE     roundupTo(sizeof(struct ConcurrentStripe),CACHE_LINE)
+#define STRIPE(d,i)     ((struct ConcurrentStripe *)((char *)(d)->Stripes + (i)*STRIPE_SIZE))
+#define MIN_BUCKETS     8
+#define DEFAULT_MAX_LOAD_FACTOR 1.0
+#define VALUE_OFFSET    roundup(sizeof(struct ConcurrentEntry))
+#define VALUE(e)        ((char *)(e) + VALUE_OFFSET)
+#define ITVALUE(it)     ((char *)(it) + roundup(sizeof(struct ConcurrentDictionaryIterator)))
+
+/* Same guid as the other dictionaries: they all read and write the same
+   file format */
+static const guid DictionaryGuid = {0xa334a9d, 0x897c, 0x4bed,
+{0x92,0xa3,0x2,0xbf,0x86,0xd5,0x2e,0xcf}
+};
+
+static ConcurrentDictionary *Create(size_t elementsize,size_t hint);
+
+static int doerrorCall(ErrorFunction err,const char *fnName,int code)
+{
+    char buf[256];
+
+    snprintf(buf,sizeof(buf),"iConcurrentDictionary.%s",fnName);
+    err(buf,code);
+    return code;
+}
+static int ReadOnlyError(const ConcurrentDictionary *SC,const char *fnName)
+{
+    return doerrorCall(SC->RaiseError,fnName,CONTAINER_ERROR_READONLY);
+}
+static int NullPtrError(const char *fnName)
+{
+    return doerrorCall(iError.RaiseError,fnName,CONTAINER_ERROR_BADARG);
+}
+
+static int BadArgError(const ConcurrentDictionary *SC,const char *fnName)
+{
+    return doerrorCall(SC->RaiseError,fnName,CONTAINER_ERROR_BADARG);
+}
+
+static int NoMemoryError(const ConcurrentDictionary *SC,const char *fnName)
+{
+    return doerrorCall(SC->RaiseError,fnName,CONTAINER_ERROR_NOMEMORY);
+}
+
+static size_t hash(const char *key)
+{
+    size_t Hash = 0;
+    const unsigned char *p;
+
+    for (p = (const unsigned char *)key; *p; p++) {
+        Hash = Hash * 33 + *p;
+    }
+    return Hash;
+}
+
+/* See HashKey in dictionarygen.c. The seed and the function change only
+   with all the stripes locked. */
+static size_t HashKey(const ConcurrentDictionary *Dict,const char *Key)
+{
+    if (Dict->Seed)
+        return (size_t)iHashFunctions.Hash64(Key,strlen(Key),Dict->Seed);
+    return (*Dict->hash)(Key);
+}
+
+/* The stripe is taken from the low bits of a mixed copy of the hash and
+   the bucket from the bits above them, so both use well spread bits
+   whatever the quality of the user hash function. */
+static size_t Mix(size_t h)
+{
+#if SIZE_MAX > 0xffffffffu
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+#else
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+#endif
+    return h;
+}
+
+static struct ConcurrentStripe *StripeOf(const ConcurrentDictionary *d,size_t h)
+{
+    return STRIPE(d,Mix(h) & (CONCURRENT_STRIPES-1));
+}
+
+static size_t BucketOf(const struct ConcurrentStripe *s,size_t h)
+{
+    return (Mix(h) >> CONCURRENT_STRIPE_BITS) & (s->size-1);
+}
+
+/* The caller holds the lock of the stripe */
+static struct ConcurrentEntry **FindEntry(struct ConcurrentStripe *s,const char *Key,size_t h)
+{
+    struct ConcurrentEntry **pp = &s->buckets[BucketOf(s,h)];
+
+    for (; *pp; pp = &(*pp)->Next) {
+        if ((*pp)->Hash == h && strcmp(Key,(*pp)->Key) == 0)
+            break;
+    }
+    return pp;
+}
+
+/* Doubles the buckets of a stripe. The caller holds the write lock. If
+   there is no memory the stripe keeps its buckets, only slower. */
+static void GrowStripe(const ConcurrentDictionary *d,struct ConcurrentStripe *s)
+{
+    struct ConcurrentEntry **newBuckets,*e,*next;
+    size_t i,oldSize = s->size;
+
+    newBuckets = d->Allocator->malloc(2*oldSize*sizeof(newBuckets[0]));
+    if (newBuckets == NULL)
+        return;
+    memset(newBuckets,0,2*oldSize*sizeof(newBuckets[0]));
+    s->size = 2*oldSize;
+    for (i = 0; i < oldSize; i++) {
+        for (e = s->buckets[i]; e; e = next) {
+            size_t b = BucketOf(s,e->Hash);
+            next = e->Next;
+            e->Next = newBuckets[b];
+            newBuckets[b] = e;
+        }
+    }
+    d->Allocator->free(s->buckets);
+    s->buckets = newBuckets;
+    s->Resizes++;
+}
+
+/* Links an entry in its stripe. The caller holds the write lock. */
+static void LinkEntry(const ConcurrentDictionary *d,struct ConcurrentStripe *s,struct ConcurrentEntry *e)
+{
+    size_t b = BucketOf(s,e->Hash);
+
+    e->Next = s->buckets[b];
+    s->buckets[b] = e;
+    s->count++;
+    s->timestamp++;
+    if (d->MaxLoadFactor > 0 && s->count > d->MaxLoadFactor*s->size)
+        GrowStripe(d,s);
+}
+
+/* The entry, its value and its key are allocated in one block, before
+   taking the lock to keep the critical section short. */
+static struct ConcurrentEntry *NewEntry(const ConcurrentDictionary *d,const char *Key,size_t h,const void *Value)
+{
+    size_t len = strlen(Key)+1;
+    struct ConcurrentEntry *e;
+
+    e = d->Allocator->malloc(VALUE_OFFSET+d->ElementSize+len);
+    if (e == NULL)
+        return NULL;
+    e->Next = NULL;
+    e->Hash = h;
+    e->Key = VALUE(e) + d->ElementSize;
+    memcpy(e->Key,Key,len);
+    if (d->ElementSize) {
+        if (Value)
+            memcpy(VALUE(e),Value,d->ElementSize);
+        else memset(VALUE(e),0,d->ElementSize);
+    }
+    return e;
+}
+
+static int add_nd(ConcurrentDictionary *Dict,const char *Key,const void *Value,int is_insert)
+{
+    size_t h = HashKey(Dict,Key);
+    struct ConcurrentStripe *s = StripeOf(Dict,h);
+    struct ConcurrentEntry *e,**pp;
+
+    e = NewEntry(Dict,Key,h,Value);
+    if (e == NULL)
+        return NoMemoryError(Dict,"Add");
+    WRITE_LOCK(&s->Lock);
+    pp = FindEntry(s,Key,h);
+    if (*pp == NULL) {
+        LinkEntry(Dict,s,e);
+        UNLOCK(&s->Lock);
+        return 1;
+    }
+    if (!is_insert && Dict->ElementSize) {
+        /* Overwrite the data for an existing element */
+        memcpy(VALUE(*pp),VALUE(e),Dict->ElementSize);
+        s->timestamp++;
+    }
+    UNLOCK(&s->Lock);
+    Dict->Allocator->free(e);
+    return 0;
+}
+
+static int Add(ConcurrentDictionary *Dict,const char *Key,const void *Value)
+{
+    if (Dict == NULL)
+        return NullPtrError("Add");
+    if (Dict->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(Dict,"Add");
+    if (Key == NULL)
+        return BadArgError(Dict,"Add");
+    return add_nd(Dict,Key,Value,0);
+}
+
+static int Insert(ConcurrentDictionary *Dict,const char *Key,const void *Value)
+{
+    if (Dict == NULL)
+        return NullPtrError("Insert");
+    if (Dict->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(Dict,"Insert");
+    if (Key == NULL || (Value == NULL && Dict->ElementSize > 0))
+        return BadArgError(Dict,"Insert");
+    return add_nd(Dict,Key,Value,1);
+}
+
+static int Replace(ConcurrentDictionary *Dict,const char *Key,const void *Value)
+{
+    size_t h;
+    struct ConcurrentStripe *s;
+    struct ConcurrentEntry **pp;
+
+    if (Dict == NULL) {
+        return NullPtrError("Replace");
+    }
+    if (Dict->Flags & CONTAINER_READONLY) {
+        return ReadOnlyError(Dict,"Replace");
+    }
+    if (Key == NULL || Value == NULL) {
+        return BadArgError(Dict,"Replace");
+    }
+    h = HashKey(Dict,Key);
+    s = StripeOf(Dict,h);
+    WRITE_LOCK(&s->Lock);
+    pp = FindEntry(s,Key,h);
+    if (*pp == NULL) {
+        UNLOCK(&s->Lock);
+        return CONTAINER_ERROR_NOTFOUND;
+    }
+    if (Dict->ElementSize) {
+        if (Dict->DestructorFn)
+            Dict->DestructorFn(VALUE(*pp));
+        memcpy(VALUE(*pp),Value,Dict->ElementSize);
+        s->timestamp++;
+    }
+    UNLOCK(&s->Lock);
+    return 1;
+}
+
+static int erase_nd(ConcurrentDictionary *Dict,const char *Key)
+{
+    size_t h = HashKey(Dict,Key);
+    struct ConcurrentStripe *s = StripeOf(Dict,h);
+    struct ConcurrentEntry **pp,*e;
+
+    WRITE_LOCK(&s->Lock);
+    pp = FindEntry(s,Key,h);
+    e = *pp;
+    if (e) {
+        *pp = e->Next;
+        s->count--;
+        s->timestamp++;
+    }
+    UNLOCK(&s->Lock);
+    if (e == NULL)
+        return CONTAINER_ERROR_NOTFOUND;
+    /* No other thread can reach the entry any more */
+    if (Dict->DestructorFn && Dict->ElementSize)
+        Dict->DestructorFn(VALUE(e));
+    Dict->Allocator->free(e);
+    return 1;
+}
+
+static int Erase(ConcurrentDictionary *Dict,const char *Key)
+{
+    if (Dict == NULL)
+        return NullPtrError("Erase");
+    if (Key == NULL)
+        return BadArgError(Dict,"Erase");
+    if (Dict->Flags & CONTAINER_READONLY) {
+        return ReadOnlyError(Dict,"Erase");
+    }
+    return erase_nd(Dict,Key);
+}
+
+/* The pointer is valid only while no other thread erases or replaces
+   the key. Use CopyElement when other threads modify the table. */
+static void *GetElement(const ConcurrentDictionary *Dict,const char *Key)
+{
+    size_t h;
+    struct ConcurrentStripe *s;
+    struct ConcurrentEntry *e;
+
+    if (Dict == NULL || Key == NULL) {
+        NullPtrError("GetElement");
+        return NULL;
+    }
+    h = HashKey(Dict,Key);
+    s = StripeOf(Dict,h);
+    READ_LOCK(&s->Lock);
+    e = *FindEntry(s,Key,h);
+    UNLOCK(&s->Lock);
+    if (e == NULL)
+        return NULL;
+    return Dict->ElementSize ? VALUE(e) : e->Key;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     CopyElement ID:1
+ Purpose:       Copies the value of a key while holding the lock of its
+                stripe. This is the safe way to read a value that other
+                threads can replace or erase.
+ Input:         The dictionary, the key and a buffer of ElementSize
+                bytes, or NULL to only test if the key is present
+ Output:        1 if the key was found, zero otherwise
+ Errors:        BADARG if the dictionary or the key are NULL
+------------------------------------------------------------------------*/
+static int CopyElement(const ConcurrentDictionary *Dict,const char *Key,void *outbuf)
+{
+    size_t h;
+    struct ConcurrentStripe *s;
+    struct ConcurrentEntry *e;
+
+    if (Dict == NULL) {
+        return NullPtrError("CopyElement");
+    }
+    if (Key == NULL)
+        return BadArgError(Dict,"CopyElement");
+    if (Dict->ElementSize == 0) return 0;
+    h = HashKey(Dict,Key);
+    s = StripeOf(Dict,h);
+    READ_LOCK(&s->Lock);
+    e = *FindEntry(s,Key,h);
+    if (e && outbuf)
+        memcpy(outbuf,VALUE(e),Dict->ElementSize);
+    UNLOCK(&s->Lock);
+    return e != NULL;
+}
+
+static int Contains(const ConcurrentDictionary *Dict,const char *Key)
+{
+    size_t h;
+    struct ConcurrentStripe *s;
+    struct ConcurrentEntry *e;
+
+    if (Dict == NULL)  {
+        return NullPtrError("Contains");
+    }
+    if (Key == NULL)
+        return BadArgError(Dict,"Contains");
+    h = HashKey(Dict,Key);
+    s = StripeOf(Dict,h);
+    READ_LOCK(&s->Lock);
+    e = *FindEntry(s,Key,h);
+    UNLOCK(&s->Lock);
+    return e != NULL;
+}
+
+static size_t Size(const ConcurrentDictionary *Dict)
+{
+    size_t i,n = 0;
+
+    if (Dict == NULL) {
+        NullPtrError("Size");
+        return 0;
+    }
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(Dict,i);
+        READ_LOCK(&s->Lock);
+        n += s->count;
+        UNLOCK(&s->Lock);
+    }
+    return n;
+}
+
+static unsigned GetFlags(const ConcurrentDictionary *Dict)
+{
+    if (Dict == NULL) {
+        NullPtrError("GetFlags");
+        return 0;
+    }
+    return Dict->Flags;
+}
+
+static unsigned SetFlags(ConcurrentDictionary *Dict,unsigned Flags)
+{
+    unsigned oldFlags;
+    if (Dict == NULL) {
+        NullPtrError("SetFlags");
+        return 0;
+    }
+    oldFlags = Dict->Flags;
+    Dict->Flags = Flags & ~CONTAINER_HAS_OBSERVER;
+    return oldFlags;
+}
+
+static size_t Sizeof(const ConcurrentDictionary *Dict)
+{
+    size_t i,result;
+
+    if (Dict == NULL) {
+        return sizeof(ConcurrentDictionary);
+    }
+    result = sizeof(*Dict) + CONCURRENT_STRIPES*STRIPE_SIZE;
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(Dict,i);
+        READ_LOCK(&s->Lock);
+        /* The keys are not counted, as in the other dictionaries */
+        result += s->size*sizeof(s->buckets[0]) +
+                  s->count*(VALUE_OFFSET+Dict->ElementSize);
+        UNLOCK(&s->Lock);
+    }
+    return result;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Apply ID:1
+ Purpose:       Calls the given function for each entry. Each stripe is
+                locked for reading while its entries are visited, so
+                the function must not modify the dictionary.
+ Input:         The dictionary, the function and its extra argument
+ Output:        1
+ Errors:        BADARG if the dictionary or the function are NULL
+------------------------------------------------------------------------*/
+static int Apply(ConcurrentDictionary *Dict,int (*apply)(const char *Key,const void *Value, void *ExtraArgs),
+    void *ExtraArgs)
+{
+    size_t i,j;
+    struct ConcurrentEntry *e;
+
+    if (Dict == NULL) {
+        return	NullPtrError("Apply");
+    }
+    if (apply == NULL)
+        return BadArgError(Dict,"Apply");
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(Dict,i);
+        READ_LOCK(&s->Lock);
+        for (j = 0; j < s->size; j++) {
+            for (e = s->buckets[j]; e; e = e->Next)
+                apply(e->Key,Dict->ElementSize ? VALUE(e) : NULL,ExtraArgs);
+        }
+        UNLOCK(&s->Lock);
+    }
+    return 1;
+}
+
+/* Looks up each key of d1 in d2 through the interface of d2, so any
+   implementation of the Dictionary interface can be compared */
+static int Equal(const ConcurrentDictionary *d1,const Dictionary *d2)
+{
+    size_t i,j;
+    int result = 1;
+    struct ConcurrentEntry *e;
+    DictionaryInterface *intf;
+
+    if ((const void *)d1 == (const void *)d2) return 1;
+    if (d1 == NULL || d2 == NULL)
+        return 0;
+    intf = *(DictionaryInterface **)d2;
+    if (intf->Size(d2) != Size(d1) || intf->GetElementSize(d2) != d1->ElementSize)
+        return 0;
+    for (i = 0; result && i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(d1,i);
+        READ_LOCK(&s->Lock);
+        for (j = 0; result && j < s->size; j++) {
+            for (e = s->buckets[j]; e; e = e->Next) {
+                void *p = intf->GetElement(d2,e->Key);
+                if (p == NULL ||
+                    (d1->ElementSize && memcmp(p,VALUE(e),d1->ElementSize))) {
+                    result = 0;
+                    break;
+                }
+            }
+        }
+        UNLOCK(&s->Lock);
+    }
+    return result;
+}
+
+static int Clear(ConcurrentDictionary *Dict)
+{
+    size_t i,j;
+    struct ConcurrentEntry *e,*next;
+
+    if (Dict == NULL) {
+        return NullPtrError("Clear");
+    }
+    if (Dict->Flags & CONTAINER_READONLY) {
+        return ReadOnlyError(Dict,"Clear");
+    }
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(Dict,i);
+        WRITE_LOCK(&s->Lock);
+        for (j = 0; s->count && j < s->size; j++) {
+            for (e = s->buckets[j]; e; e = next) {
+                next = e->Next;
+                if (Dict->DestructorFn && Dict->ElementSize)
+                    Dict->DestructorFn(VALUE(e));
+                Dict->Allocator->free(e);
+            }
+            s->buckets[j] = NULL;
+        }
+        s->count = 0;
+        s->timestamp++;
+        UNLOCK(&s->Lock);
+    }
+    return 1;
+}
+
+static void FreeStripes(ConcurrentDictionary *Dict)
+{
+    size_t i;
+
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(Dict,i);
+        if (s->buckets) {
+            LOCK_DESTROY(&s->Lock);
+            Dict->Allocator->free(s->buckets);
+        }
+    }
+    Dict->Allocator->free(Dict->StripeBlock);
+}
+
+/* No other thread may use the dictionary when it is finalized */
+static int Finalize(ConcurrentDictionary *Dict)
+{
+    int r = Clear(Dict);
+    if (0 > r)
+        return r;
+    if (Dict->VTable != &iConcurrentDictionary)
+        Dict->Allocator->free(Dict->VTable);
+    FreeStripes(Dict);
+    Dict->Allocator->free(Dict);
+    return 1;
+}
+
+static ErrorFunction SetErrorFunction(ConcurrentDictionary *Dict,ErrorFunction fn)
+{
+    ErrorFunction old;
+    if (Dict == NULL) { return iError.RaiseError; }
+    old = Dict->RaiseError;
+    if (fn) Dict->RaiseError = fn;
+    return old;
+}
+
+/* Copies the keys and the values of each stripe under its lock, so
+   that both collections describe the same entries */
+static int Snapshot(const ConcurrentDictionary *Dict,strCollection **pKeys,Vector **pValues)
+{
+    size_t i,j,n = Size(Dict);
+    struct ConcurrentEntry *e;
+    strCollection *sc;
+    Vector *al = NULL;
+
+    sc = istrCollection.Create(n ? n : 1);
+    if (sc && Dict->ElementSize)
+        al = iVector.Create(Dict->ElementSize,n ? n : 1);
+    if (sc == NULL || (Dict->ElementSize && al == NULL)) {
+        if (sc) istrCollection.Finalize(sc);
+        return NoMemoryError(Dict,"Snapshot");
+    }
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(Dict,i);
+        READ_LOCK(&s->Lock);
+        for (j = 0; j < s->size; j++) {
+            for (e = s->buckets[j]; e; e = e->Next) {
+                istrCollection.Add(sc,e->Key);
+                if (al)
+                    iVector.Add(al,VALUE(e));
+            }
+        }
+        UNLOCK(&s->Lock);
+    }
+    *pKeys = sc;
+    *pValues = al;
+    return 1;
+}
+
+static strCollection *GetKeys(const ConcurrentDictionary *Dict)
+{
+    strCollection *sc;
+    Vector *al;
+
+    if (Dict == NULL) {
+        NullPtrError("GetKeys");
+        return 0;
+    }
+    if (Snapshot(Dict,&sc,&al) < 0)
+        return NULL;
+    if (al)
+        iVector.Finalize(al);
+    return sc;
+}
+
+static Vector *CastToArray(const ConcurrentDictionary *Dict)
+{
+    strCollection *sc;
+    Vector *al;
+
+    if (Dict == NULL) {
+        NullPtrError("CastToArray");
+        return NULL;
+    }
+    if (Dict->ElementSize == 0)
+        return NULL;
+    if (Snapshot(Dict,&sc,&al) < 0)
+        return NULL;
+    istrCollection.Finalize(sc);
+    return al;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                                Iterators                                       */
+/* ------------------------------------------------------------------------------ */
+/* The iterator returns a copy of each element, so the returned pointer
+   stays valid whatever the other threads do. It remembers the position
+   of the next element (stripe, bucket and depth in the chain): elements
+   added or erased by other threads during the iteration may be seen or
+   not, and if a stripe grows some elements can be missed or seen twice. */
+static size_t GetPosition(Iterator *it)
+{
+    struct ConcurrentDictionaryIterator *d = (struct ConcurrentDictionaryIterator *)it;
+    return d->index;
+}
+
+static void *GetNext(Iterator *it)
+{
+    struct ConcurrentDictionaryIterator *d = (struct ConcurrentDictionaryIterator *)it;
+    ConcurrentDictionary *Dict;
+    struct ConcurrentEntry *e;
+    size_t n;
+
+    if (it == NULL) {
+        NullPtrError("GetNext");
+        return NULL;
+    }
+    Dict = d->Dict;
+    for (; d->Stripe < CONCURRENT_STRIPES; d->Stripe++, d->Bucket = 0) {
+        struct ConcurrentStripe *s = STRIPE(Dict,d->Stripe);
+        READ_LOCK(&s->Lock);
+        for (; d->Bucket < s->size; d->Bucket++, d->Depth = 0) {
+            for (e = s->buckets[d->Bucket], n = 0; e && n < d->Depth; e = e->Next)
+                n++;
+            if (e == NULL)
+                continue;
+            n = strlen(e->Key)+1;
+            if (n > d->KeySize) {
+                char *k = Dict->Allocator->malloc(n);
+                if (k == NULL) {
+                    UNLOCK(&s->Lock);
+                    NoMemoryError(Dict,"GetNext");
+                    return NULL;
+                }
+                if (d->Key)
+                    Dict->Allocator->free(d->Key);
+                d->Key = k;
+                d->KeySize = n;
+            }
+            memcpy(d->Key,e->Key,n);
+            if (Dict->ElementSize)
+                memcpy(ITVALUE(d),VALUE(e),Dict->ElementSize);
+            UNLOCK(&s->Lock);
+            d->Depth++;
+            d->index++;
+            return Dict->ElementSize ? ITVALUE(d) : d->Key;
+        }
+        UNLOCK(&s->Lock);
+    }
+    /* Iterators built with InitIterator are never deleted: the copy of
+       the key is released at the end of the iteration */
+    if (d->Key) {
+        Dict->Allocator->free(d->Key);
+        d->Key = NULL;
+        d->KeySize = 0;
+    }
+    return NULL;
+}
+
+static void *GetFirst(Iterator *it)
+{
+    struct ConcurrentDictionaryIterator *d = (struct ConcurrentDictionaryIterator *)it;
+
+    if (it == NULL) {
+        NullPtrError("GetFirst");
+        return NULL;
+    }
+    d->Stripe = d->Bucket = d->Depth = d->index = 0;
+    return GetNext(it);
+}
+
+/* Replaces or erases (if data is NULL) the element returned by the last
+   call to GetNext. */
+static int ReplaceWithIterator(Iterator *it, void *data,int direction)
+{
+    struct ConcurrentDictionaryIterator *li = (struct ConcurrentDictionaryIterator *)it;
+    ConcurrentDictionary *Dict;
+    int r;
+
+    if (it == NULL) {
+        return NullPtrError("Replace");
+    }
+    Dict = li->Dict;
+    if (Dict->Flags & CONTAINER_READONLY) {
+        return ReadOnlyError(Dict,"Replace");
+    }
+    if (li->Key == NULL || li->Depth == 0)
+        return 0;
+    if (data)
+        return Replace(Dict,li->Key,data);
+    r = erase_nd(Dict,li->Key);
+    if (r > 0)
+        li->Depth--;
+    return r;
+}
+
+static void *Seek(Iterator *it, size_t idx)
+{
+    return NULL;
+}
+
+static int InitIterator(ConcurrentDictionary *Dict,void *buf)
+{
+    struct ConcurrentDictionaryIterator *result = buf;
+
+    if (Dict == NULL || buf == NULL) {
+        NullPtrError("InitIterator");
+        return CONTAINER_ERROR_BADARG;
+    }
+    memset(result,0,sizeof(*result));
+    result->it.GetNext = GetNext;
+    result->it.GetPrevious = GetNext;
+    result->it.GetFirst = GetFirst;
+    result->it.Replace = ReplaceWithIterator;
+    result->it.GetPosition = GetPosition;
+    result->it.Seek = Seek;
+    result->Magic = CONCURRENTDICTIONARY_MAGIC_NUMBER;
+    result->Dict = Dict;
+    return 1;
+}
+
+/* The iterator is followed by room for a copy of one value */
+static size_t SizeofIterator(const ConcurrentDictionary *Dict)
+{
+    return roundup(sizeof(struct ConcurrentDictionaryIterator)) + (Dict ? Dict->ElementSize : 0);
+}
+
+static Iterator *NewIterator(ConcurrentDictionary *Dict)
+{
+    struct ConcurrentDictionaryIterator *result;
+
+    if (Dict == NULL) {
+        NullPtrError("NewIterator");
+        return NULL;
+    }
+    result = Dict->Allocator->malloc(SizeofIterator(Dict));
+    if (result == NULL) {
+        NoMemoryError(Dict,"NewIterator");
+        return NULL;
+    }
+    InitIterator(Dict,result);
+    return &result->it;
+}
+
+static int DeleteIterator(Iterator *it)
+{
+    struct ConcurrentDictionaryIterator *d = (struct ConcurrentDictionaryIterator *)it;
+
+    if (d == NULL) {
+        return NullPtrError("DeleteIterator");
+    }
+    if (d->Key)
+        d->Dict->Allocator->free(d->Key);
+    d->Dict->Allocator->free(it);
+    return 1;
+}
+
+static int Save(const ConcurrentDictionary *Dict,FILE *stream, SaveFunction saveFn,void *arg)
+{
+    Vector *al;
+    strCollection *sc;
+    int result = 1;
+
+    if (Dict == NULL) {
+        return NullPtrError("Save");
+    }
+    if (stream == NULL) {
+        return BadArgError(Dict,"Save");
+    }
+    if (Snapshot(Dict,&sc,&al) < 0)
+        return CONTAINER_ERROR_NOMEMORY;
+    if (al == NULL)
+        al = iVector.Create(sizeof(int),1);
+    if (fwrite(&DictionaryGuid,sizeof(guid),1,stream) == 0 ||
+        (istrCollection.Save(sc,stream,NULL,NULL) < 0) ||
+        (iVector.Save(al,stream,saveFn,arg) < 0))
+        result = EOF;
+    istrCollection.Finalize(sc);
+    iVector.Finalize(al);
+    return result;
+}
+
+static ConcurrentDictionary *Load(FILE *stream, ReadFunction readFn, void *arg)
+{
+    strCollection *sc;
+    Vector *al;
+    ConcurrentDictionary *result;
+    size_t i;
+    guid Guid;
+
+    if (stream == NULL) {
+        NullPtrError("Load");
+        return NULL;
+    }
+    if (fread(&Guid,sizeof(guid),1,stream) == 0) {
+        iError.RaiseError("iConcurrentDictionary.Load",CONTAINER_ERROR_FILE_READ);
+        return NULL;
+    }
+    if (memcmp(&Guid,&DictionaryGuid,sizeof(guid))) {
+        iError.RaiseError("iConcurrentDictionary.Load",CONTAINER_ERROR_WRONGFILE);
+        return NULL;
+    }
+    sc = istrCollection.Load(stream,NULL,NULL);
+    if (sc == NULL)
+        return NULL;
+    al = iVector.Load(stream,readFn,arg);
+    if (al == NULL) {
+        istrCollection.Finalize(sc);
+        return NULL;
+    }
+    result = Create(iVector.GetElementSize(al),istrCollection.Size(sc));
+    for (i=0; result && i<istrCollection.Size(sc);i++) {
+        add_nd(result,istrCollection.GetElement(sc,i),iVector.GetElement(al,i),0);
+    }
+    istrCollection.Finalize(sc);
+    iVector.Finalize(al);
+    return result;
+}
+
+static size_t GetElementSize(const ConcurrentDictionary *d)
+{
+    if (d == NULL) {
+        NullPtrError("GetElementSize");
+        return 0;
+    }
+    return d->ElementSize;
+}
+
+static const ContainerAllocator *GetAllocator(const ConcurrentDictionary *AL)
+{
+    if (AL == NULL) {
+        return NULL;
+    }
+    return AL->Allocator;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     InitWithAllocator ID:1
+ Purpose:       Initializes a dictionary object. The storage must be
+                at least Sizeof(NULL) bytes. The stripes, with their
+                locks, are allocated separately.
+ Input:         The storage, the element size, a hint for the number
+                of elements and the allocator to use
+ Output:        A pointer to the initialized dictionary
+ Errors:        If no more memory is available returns NULL
+------------------------------------------------------------------------*/
+static ConcurrentDictionary *InitWithAllocator(ConcurrentDictionary *Dict,size_t elementsize,size_t hint,const ContainerAllocator *allocator)
+{
+    size_t i,size = MIN_BUCKETS;
+
+    memset(Dict,0,sizeof(*Dict));
+    Dict->MaxLoadFactor = DEFAULT_MAX_LOAD_FACTOR;
+    while (size*CONCURRENT_STRIPES < hint && size < (((size_t)-1) >> 12))
+        size *= 2;
+    Dict->StripeBlock = allocator->malloc(CONCURRENT_STRIPES*STRIPE_SIZE + CACHE_LINE);
+    if (Dict->StripeBlock == NULL)
+        return NULL;
+    memset(Dict->StripeBlock,0,CONCURRENT_STRIPES*STRIPE_SIZE + CACHE_LINE);
+    Dict->Stripes = (struct ConcurrentStripe *)roundupTo((uintptr_t)Dict->StripeBlock,CACHE_LINE);
+    Dict->VTable = &iConcurrentDictionary;
+    Dict->ElementSize = elementsize;
+    Dict->Allocator = allocator;
+    Dict->RaiseError = iError.RaiseError;
+    Dict->hash = hash;
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(Dict,i);
+        s->buckets = allocator->malloc(size*sizeof(s->buckets[0]));
+        if (s->buckets == NULL) {
+            FreeStripes(Dict);
+            return NULL;
+        }
+        memset(s->buckets,0,size*sizeof(s->buckets[0]));
+        s->size = size;
+        LOCK_INIT(&s->Lock);
+    }
+    return Dict;
+}
+
+static ConcurrentDictionary *Init(ConcurrentDictionary *dict,size_t elementsize,size_t hint)
+{
+    return InitWithAllocator(dict, elementsize, hint, CurrentAllocator);
+}
+
+static ConcurrentDictionary *CreateWithAllocator(size_t elementsize,size_t hint,const ContainerAllocator *allocator)
+{
+    ConcurrentDictionary *Dict,*result;
+
+    Dict = allocator->malloc(sizeof(ConcurrentDictionary));
+    if (Dict == NULL) {
+        iError.RaiseError("iConcurrentDictionary.Create",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    result = InitWithAllocator(Dict,elementsize,hint,allocator);
+    if (result == NULL) {
+        iError.RaiseError("iConcurrentDictionary.Create",CONTAINER_ERROR_NOMEMORY);
+        allocator->free(Dict);
+    }
+    return result;
+}
+
+static ConcurrentDictionary *Create(size_t elementsize,size_t hint)
+{
+    return CreateWithAllocator(elementsize,hint,CurrentAllocator);
+}
+
+static ConcurrentDictionary *Copy(const ConcurrentDictionary *src)
+{
+    ConcurrentDictionary *result;
+    struct ConcurrentEntry *e,*c;
+    size_t i,j;
+    int ok = 1;
+
+    if (src == NULL) {
+        NullPtrError("Copy");
+        return NULL;
+    }
+    result = CreateWithAllocator(src->ElementSize,Size(src),src->Allocator);
+    if (result == NULL)
+        return NULL;
+    result->Flags = src->Flags;
+    result->hash = src->hash;
+    result->Seed = src->Seed;
+    result->RaiseError = src->RaiseError;
+    result->MaxLoadFactor = src->MaxLoadFactor;
+    result->DestructorFn = src->DestructorFn;
+    /* Same hash function: each entry goes to the same stripe */
+    for (i = 0; ok && i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(src,i);
+        READ_LOCK(&s->Lock);
+        for (j = 0; ok && j < s->size; j++) {
+            for (e = s->buckets[j]; e; e = e->Next) {
+                c = NewEntry(result,e->Key,e->Hash,VALUE(e));
+                if (c == NULL) {
+                    ok = 0;
+                    break;
+                }
+                LinkEntry(result,STRIPE(result,i),c);
+            }
+        }
+        UNLOCK(&s->Lock);
+    }
+    if (!ok) {
+        result->DestructorFn = NULL;
+        Finalize(result);
+        NoMemoryError(src,"Copy");
+        return NULL;
+    }
+    return result;
+}
+
+static int AddFromOther(const char *Key,const void *Value,void *arg)
+{
+    add_nd(arg,Key,Value,0);
+    return 1;
+}
+
+/* The source can be any dictionary: it is read through its own Apply */
+static int InsertIn(ConcurrentDictionary *dst,Dictionary *src)
+{
+    DictionaryInterface *intf;
+
+    if (dst == NULL) {
+        return NullPtrError("InsertIn");
+    }
+    if (src == NULL)
+        return BadArgError(dst,"InsertIn");
+    if (dst->Flags& CONTAINER_READONLY)
+        return ReadOnlyError(dst,"InsertIn");
+    intf = *(DictionaryInterface **)src;
+    if (intf->GetElementSize(src) != dst->ElementSize) {
+        return doerrorCall(dst->RaiseError,"InsertIn",CONTAINER_ERROR_INCOMPATIBLE);
+    }
+    return intf->Apply(src,AddFromOther,dst);
+}
+
+static ConcurrentDictionary *InitializeWith(size_t elementSize,size_t n, const char **Keys,const void *Values)
+{
+    ConcurrentDictionary *result = Create(elementSize,n);
+    size_t i;
+    const char *pValues = Values;
+
+    if (result) {
+        for (i = 0; i < n; i++) {
+            add_nd(result,Keys[i],pValues,0);
+            if (pValues)
+                pValues += elementSize;
+        }
+    }
+    return result;
+}
+
+static DestructorFunction SetDestructor(ConcurrentDictionary *cb,DestructorFunction fn)
+{
+    DestructorFunction oldfn;
+    if (cb == NULL)
+        return NULL;
+    oldfn = cb->DestructorFn;
+    if (fn)
+        cb->DestructorFn = fn;
+    return oldfn;
+}
+
+/* Changing the hash function or the seed moves the entries to other
+   stripes: all the stripes are locked and the entries linked again */
+static void ChangeHashing(ConcurrentDictionary *d,HashFunction fn,uint64_t Seed)
+{
+    struct ConcurrentEntry *all = NULL,*e,*next;
+    size_t i,j;
+
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(d,i);
+        WRITE_LOCK(&s->Lock);
+        for (j = 0; j < s->size; j++) {
+            for (e = s->buckets[j]; e; e = next) {
+                next = e->Next;
+                e->Next = all;
+                all = e;
+            }
+            s->buckets[j] = NULL;
+        }
+        s->count = 0;
+    }
+    d->hash = fn;
+    d->Seed = Seed;
+    for (e = all; e; e = next) {
+        next = e->Next;
+        e->Hash = HashKey(d,e->Key);
+        LinkEntry(d,StripeOf(d,e->Hash),e);
+    }
+    for (i = 0; i < CONCURRENT_STRIPES; i++)
+        UNLOCK(&STRIPE(d,i)->Lock);
+}
+
+static HashFunction SetHashFunction(ConcurrentDictionary *d,HashFunction newFn)
+{
+    HashFunction old;
+
+    if (d == NULL) {
+        return hash;
+    }
+    if (newFn == NULL || (newFn == d->hash && d->Seed == 0))
+        return d->hash;
+    old = d->hash;
+    ChangeHashing(d,newFn,0);
+    return old;
+}
+
+/* See SetSeed in dictionarygen.c */
+static int SetSeed(ConcurrentDictionary *d,uint64_t Seed)
+{
+    if (d == NULL)
+        return NullPtrError("SetSeed");
+    if (d->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(d,"SetSeed");
+    ChangeHashing(d,d->hash,Seed ? Seed : iHashFunctions.RandomSeed());
+    return 1;
+}
+
+static double GetLoadFactor(ConcurrentDictionary *d)
+{
+    size_t i,n = 0,size = 0;
+
+    if (d == NULL) {
+        NullPtrError("GetLoadFactor");
+        return 0;
+    }
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(d,i);
+        READ_LOCK(&s->Lock);
+        n += s->count;
+        size += s->size;
+        UNLOCK(&s->Lock);
+    }
+    return ((double)n)/size;
+}
+
+/* The limit applies to each stripe. Zero disables the growth. */
+static double SetMaxLoadFactor(ConcurrentDictionary *d,double newMax)
+{
+    double old;
+
+    if (d == NULL) {
+        NullPtrError("SetMaxLoadFactor");
+        return 0;
+    }
+    old = d->MaxLoadFactor;
+    if (newMax < 0) {
+        BadArgError(d,"SetMaxLoadFactor");
+        return old;
+    }
+    d->MaxLoadFactor = newMax;
+    return old;
+}
+
+static int GetElements(const ConcurrentDictionary *Dict,size_t n,const char **Keys,void **Results)
+{
+    size_t i;
+    int found = 0;
+
+    if (Dict == NULL)
+        return NullPtrError("GetElements");
+    if (n && (Keys == NULL || Results == NULL))
+        return BadArgError(Dict,"GetElements");
+    for (i = 0; i < n; i++) {
+        if (Keys[i] == NULL)
+            return BadArgError(Dict,"GetElements");
+        Results[i] = GetElement(Dict,Keys[i]);
+        if (Results[i])
+            found++;
+    }
+    return found;
+}
+
+static int ContainsMany(const ConcurrentDictionary *Dict,size_t n,const char **Keys,unsigned char *Results)
+{
+    size_t i;
+    int found = 0;
+
+    if (Dict == NULL)
+        return NullPtrError("ContainsMany");
+    if (n && (Keys == NULL || Results == NULL))
+        return BadArgError(Dict,"ContainsMany");
+    for (i = 0; i < n; i++) {
+        if (Keys[i] == NULL)
+            return BadArgError(Dict,"ContainsMany");
+        Results[i] = (unsigned char)Contains(Dict,Keys[i]);
+        found += Results[i];
+    }
+    return found;
+}
+
+static Dictionary *Freeze(const ConcurrentDictionary *Dict)
+{
+    strCollection *sc;
+    Vector *al;
+    Dictionary *result;
+
+    if (Dict == NULL) {
+        NullPtrError("Freeze");
+        return NULL;
+    }
+    if (Snapshot(Dict,&sc,&al) < 0)
+        return NULL;
+    result = FreezeStrCollection(sc,Dict->ElementSize,
+                                 al && iVector.Size(al) ? iVector.GetElement(al,0) : NULL);
+    istrCollection.Finalize(sc);
+    if (al)
+        iVector.Finalize(al);
+    return result;
+}
+
+/* The snapshot is the one of the frozen dictionary */
+static int SaveSnapshot(const ConcurrentDictionary *Dict,FILE *stream)
+{
+    Dictionary *frozen;
+    int result;
+
+    if (Dict == NULL)
+        return NullPtrError("SaveSnapshot");
+    if (stream == NULL)
+        return BadArgError(Dict,"SaveSnapshot");
+    frozen = Freeze(Dict);
+    if (frozen == NULL)
+        return CONTAINER_ERROR_NOMEMORY;
+    result = SaveFrozenSnapshot((struct FrozenDictionary *)frozen,stream);
+    iFrozenDictionary.Finalize(frozen);
+    return result;
+}
+
+/* Each key is already stored in the block of its entry. An intern table
+   can't be used since it isn't safe for concurrent use. */
+static int UseKeyArena(ConcurrentDictionary *Dict,Dictionary *InternTable)
+{
+    if (Dict == NULL)
+        return NullPtrError("UseKeyArena");
+    if (InternTable)
+        return doerrorCall(Dict->RaiseError,"UseKeyArena",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return 1;
+}
+
+/* The stripes are measured one after the other, each one under its read
+   lock: the result describes no single moment if other threads are
+   changing the dictionary */
+static int GetStatistics(const ConcurrentDictionary *Dict,HashStatistics *Stats)
+{
+    struct ConcurrentEntry *e;
+    size_t i,j,n;
+
+    if (Dict == NULL)
+        return NullPtrError("GetStatistics");
+    if (Stats == NULL)
+        return BadArgError(Dict,"GetStatistics");
+    HashStatsInit(Stats,0);
+    for (i = 0; i < CONCURRENT_STRIPES; i++) {
+        struct ConcurrentStripe *s = STRIPE(Dict,i);
+        READ_LOCK(&s->Lock);
+        Stats->Slots += s->size;
+        Stats->Resizes += s->Resizes;
+        for (j = 0; j < s->size; j++) {
+            n = 0;
+            for (e = s->buckets[j]; e; e = e->Next) {
+                Stats->KeyBytes += strlen(e->Key)+1;
+                n++;
+            }
+            HashStatsChain(Stats,n);
+        }
+        UNLOCK(&s->Lock);
+    }
+    HashStatsFinish(Stats,Dict->ElementSize,Sizeof(Dict));
+    return 1;
+}
+
+DictionaryInterface iConcurrentDictionary = {
+    (size_t (*)(const Dictionary *))Size,
+    (unsigned (*)(const Dictionary *))GetFlags,
+    (unsigned (*)(Dictionary *,unsigned))SetFlags,
+    (int (*)(Dictionary *))Clear,
+    (int (*)(const Dictionary *,const char *))Contains,
+    (int (*)(Dictionary *,const char *))Erase,
+    (int (*)(Dictionary *))Finalize,
+    (int (*)(Dictionary *,int (*)(const char *,const void *,void *),void *))Apply,
+    (int (*)(const Dictionary *,const Dictionary *))Equal,
+    (Dictionary *(*)(const Dictionary *))Copy,
+    (ErrorFunction (*)(Dictionary *,ErrorFunction))SetErrorFunction,
+    (size_t (*)(const Dictionary *))Sizeof,
+    (Iterator *(*)(Dictionary *))NewIterator,
+    (int (*)(Dictionary *,void *))InitIterator,
+    DeleteIterator,
+    (size_t (*)(const Dictionary *))SizeofIterator,
+    (int (*)(const Dictionary *,FILE *,SaveFunction,void *))Save,
+    (Dictionary *(*)(FILE *,ReadFunction,void *))Load,
+    (size_t (*)(const Dictionary *))GetElementSize,
+    (int (*)(Dictionary *,const char *,const void *))Add,
+    (void *(*)(const Dictionary *,const char *))GetElement,
+    (int (*)(Dictionary *,const char *,const void *))Replace,
+    (int (*)(Dictionary *,const char *,const void *))Insert,
+    (Vector *(*)(const Dictionary *))CastToArray,
+    (int (*)(const Dictionary *,const char *,void *))CopyElement,
+    (int (*)(Dictionary *,Dictionary *))InsertIn,
+    (Dictionary *(*)(size_t,size_t))Create,
+    (Dictionary *(*)(size_t,size_t,const ContainerAllocator *))CreateWithAllocator,
+    (Dictionary *(*)(Dictionary *,size_t,size_t))Init,
+    (Dictionary *(*)(Dictionary *,size_t,size_t,const ContainerAllocator *))InitWithAllocator,
+    (strCollection *(*)(const Dictionary *))GetKeys,
+    (const ContainerAllocator *(*)(const Dictionary *))GetAllocator,
+    (DestructorFunction (*)(Dictionary *,DestructorFunction))SetDestructor,
+    (Dictionary *(*)(size_t,size_t,const char **,const void *))InitializeWith,
+    (HashFunction (*)(Dictionary *,HashFunction))SetHashFunction,
+    (double (*)(Dictionary *))GetLoadFactor,
+    (double (*)(Dictionary *,double))SetMaxLoadFactor,
+    (int (*)(const Dictionary *,size_t,const char **,void **))GetElements,
+    (int (*)(const Dictionary *,size_t,const char **,unsigned char *))ContainsMany,
+    (Dictionary *(*)(const Dictionary *))Freeze,
+    FreezeStrCollection,
+    (int (*)(const Dictionary *,FILE *))SaveSnapshot,
+    OpenDictionarySnapshot,
+    (int (*)(Dictionary *,Dictionary *))UseKeyArena,
+    (int (*)(Dictionary *,uint64_t))SetSeed,
+    (int (*)(const Dictionary *,HashStatistics *))GetStatistics,
+};
@@ -397,6 +397,8 @@ typedef struct tagstrCollection {
     int (*Select)(strCollection *src, const Mask *m);
     strCollection *(*SelectCopy)(const strCollection *src,const Mask *m);
     /*    unsigned char *(*Find)(strCollection *SC,unsigned char *str,CompareInfo *ci); */
+    int (*SortParallel)(strCollection *SC);
+    int (*StableSort)(strCollection *SC);
 } strCollectionInterface;
 
 extern strCollectionInterface istrCollection;
@@ -482,6 +484,8 @@ typedef struct tagWstrCollection {
     int (*Select)(WstrCollection *src,const Mask*m);
     WstrCollection *(*SelectCopy)(const WstrCollection *src, const Mask *m);
 /*    wchar_t *Find(WstrCollection *SC,wchar_t *data,CompareInfo *ci); */
+    int (*SortParallel)(WstrCollection *SC);
+    int (*StableSort)(WstrCollection *SC);
 } WstrCollectionInterface;
 
 extern WstrCollectionInterface iWstrCollection;
@@ -558,6 +562,7 @@ typedef struct tagList {
     void *(*Advance)(ListElement **pListElement);
     ListElement *(*Skip)(ListElement *l,size_t n);
     List *(*SplitAfter)(List *l, ListElement *pt);
+    int (*StableSort)(List *l);
 } ListInterface;
 
 extern ListInterface iList;
@@ -724,6 +729,7 @@ typedef struct tagDlist {
     DlistElement *(*Skip)(DlistElement *l,size_t n);
     void *(*MoveBack)(DlistElement **pDlistElement);
     Dlist *(*SplitAfter)(Dlist *l, DlistElement *pt);
+    int (*StableSort)(Dlist *l);
 } DlistInterface;
 
 extern DlistInterface iDlist;
@@ -803,11 +809,44 @@ typedef struct tagVector {
     Mask *(*CompareEqual)(const Vector *left,const Vector *right,Mask *m);
     Mask *(*CompareEqualScalar)(const Vector *left, const void *right,Mask *m);
     int (*Reserve)(Vector *src,size_t newCapacity);
+    int (*SortParallel)(Vector *AL);
+    int (*SortByKey)(Vector *AL,size_t offset,size_t width,int KeyType);
+    int (*StableSort)(Vector *AL);
+    /* Vectors sorted with their comparison function */
+    int (*LowerBound)(const Vector *AL,const void *key,size_t *result);
+    int (*UpperBound)(const Vector *AL,const void *key,size_t *result);
+    int (*EqualRange)(const Vector *AL,const void *key,size_t *first,size_t *last);
+    int (*BinarySearch)(const Vector *AL,const void *key,size_t *result);
+    Vector *(*MergeSorted)(const Vector *a,const Vector *b);
+    Vector *(*SetUnion)(const Vector *a,const Vector *b);
+    Vector *(*SetIntersection)(const Vector *a,const Vector *b);
+    Vector *(*SetDifference)(const Vector *a,const Vector *b);
 } VectorInterface;
 
 extern VectorInterface iVector;
 
 #include "valarray.h"
+/* What GetStatistics reports about a dictionary or a hash table. The
+   probe length of an entry is the number of entries (chained tables),
+   groups of slots (iFlatDictionary) or slots (iFlatHashTable) read to
+   find it. The last element of the histograms counts everything above. */
+#define HASH_STATISTICS_HISTOGRAM 16
+typedef struct tagHashStatistics {
+    size_t Count;             /* Entries */
+    size_t Slots;             /* Buckets or slots */
+    size_t UsedSlots;         /* Buckets with entries or occupied slots */
+    size_t DeletedSlots;      /* Slots holding a deleted marker */
+    double LoadFactor;        /* Count/Slots */
+    size_t MaxProbeLength;
+    double MeanProbeLength;   /* Mean over all entries */
+    size_t Occupancy[HASH_STATISTICS_HISTOGRAM];   /* Slots by number of entries */
+    size_t ProbeLength[HASH_STATISTICS_HISTOGRAM]; /* Entries by probe length - 1 */
+    size_t Resizes;           /* Times the slots were reallocated with another size */
+    size_t KeyBytes;          /* Length of all keys, with their terminator */
+    size_t ValueBytes;        /* Count*ElementSize */
+    size_t MetadataBytes;     /* Headers, slots, links, hashes and unused slots */
+} HashStatistics;
+
 typedef struct _Dictionary Dictionary;
 typedef struct tagDictionary {
     size_t (*Size)(const Dictionary *Dict);
@@ -853,9 +892,25 @@ typedef struct tagDictionary {
     Dictionary *(*InitializeWith)(size_t elementSize,size_t n, const char **Keys,const void *Values);
     HashFunction (*SetHashFunction)(Dictionary *d,HashFunction newFn);
     double (*GetLoadFactor)(Dictionary *d);
+    double (*SetMaxLoadFactor)(Dictionary *d,double newMax);
+    int (*GetElements)(const Dictionary *d,size_t n,const char **Keys,void **Results);
+    int (*ContainsMany)(const Dictionary *d,size_t n,const char **Keys,unsigned char *Results);
+    Dictionary *(*Freeze)(const Dictionary *Dict);
+    Dictionary *(*FreezeKeys)(const strCollection *Keys,size_t ElementSize,const void *Values);
+    int (*SaveSnapshot)(const Dictionary *Dict,FILE *stream);
+    Dictionary *(*OpenSnapshot)(const char *FileName,int VerifyData);
+    int (*UseKeyArena)(Dictionary *Dict,Dictionary *InternTable);
+    int (*SetSeed)(Dictionary *Dict,uint64_t Seed);
+    int (*GetStatistics)(const Dictionary *Dict,HashStatistics *Stats);
 } DictionaryInterface;
 
 extern DictionaryInterface iDictionary;
+/* Same interface, open addressing implementation */
+extern DictionaryInterface iFlatDictionary;
+/* Read only dictionaries built by Freeze or FreezeKeys */
+extern DictionaryInterface iFrozenDictionary;
+/* Same interface, safe for concurrent use by several threads */
+extern DictionaryInterface iConcurrentDictionary;
 
 typedef struct _WDictionary WDictionary;
 typedef struct tagWDictionary {
@@ -902,12 +957,18 @@ typedef struct tagWDictionary {
     WDictionary *(*InitializeWith)(size_t elementSize,size_t n, const wchar_t **Keys,const void *Values);
     WHashFunction (*SetHashFunction)(WDictionary *d,WHashFunction newFn);
     double (*GetLoadFactor)(WDictionary *d);
+    double (*SetMaxLoadFactor)(WDictionary *d,double newMax);
+    int (*GetElements)(const WDictionary *d,size_t n,const wchar_t **Keys,void **Results);
+    int (*ContainsMany)(const WDictionary *d,size_t n,const wchar_t **Keys,unsigned char *Results);
+    int (*UseKeyArena)(WDictionary *Dict,WDictionary *InternTable);
+    int (*SetSeed)(WDictionary *Dict,uint64_t Seed);
+    int (*GetStatistics)(const WDictionary *Dict,HashStatistics *Stats);
 } WDictionaryInterface;
 extern WDictionaryInterface iWDictionary;
 
 /* ----------------------------------Hash table interface -----------------------*/
 typedef struct _HashTable HashTable;
-typedef unsigned int (*GeneralHashFunction)(const char *char_key, size_t *klen);
+typedef uint64_t (*GeneralHashFunction)(const char *char_key, size_t *klen);
 
 typedef struct tagHashTable {
     size_t (*Size)(const HashTable *HT);
@@ -939,10 +1000,54 @@ typedef struct tagHashTable {
     int (*Save)(const HashTable *HT,FILE *stream, SaveFunction saveFn,void *arg);
     HashTable *(*Load)(FILE *stream, ReadFunction readFn, void *arg);
     DestructorFunction (*SetDestructor)(HashTable *v,DestructorFunction fn);
+    int (*GetElements)(const HashTable *ht,size_t n,const void **Keys,const size_t *klens,void **Results);
+    int (*ContainsMany)(const HashTable *ht,size_t n,const void **Keys,const size_t *klens,unsigned char *Results);
+    int (*SetSeed)(HashTable *ht,uint64_t Seed);
+    int (*Reserve)(HashTable *ht,size_t n);
+    int (*ShrinkToFit)(HashTable *ht);
+    int (*GetStatistics)(const HashTable *ht,HashStatistics *Stats);
+    HashTable *(*BuildFrom)(size_t ElementSize,size_t n,const void **Keys,const size_t *klens,const void *Values);
+    HashTable *(*CreateIntegerKeys)(size_t ElementSize);
+    int (*AddInteger)(HashTable *ht,uint64_t key,const void *Data);
+    void *(*GetElementInteger)(const HashTable *ht,uint64_t key);
+    int (*EraseInteger)(HashTable *ht,uint64_t key);
+    int (*Scan)(HashTable *ht,size_t *Cursor,size_t Count,int (*Scanfn)(void *Key,size_t klen,void *data,void *arg),void *arg);
+    int (*CopyElement)(const HashTable *ht,const void *Key,size_t klen,void *outbuf);
+    int (*CopyElements)(const HashTable *ht,size_t n,const void **Keys,const size_t *klens,void *outbuf,unsigned char *Found);
 } HashTableInterface;
 
+/* Flag of the base table given to Merge: the merger function can be
+   called by several threads at once. Large tables are merged in
+   parallel, and without this flag the calls to the merger are made one
+   at a time. */
+#define HASHTABLE_THREADSAFE_MERGER 4
+
 extern HashTableInterface iHashTable;
+extern HashTableInterface iFlatHashTable;
+extern HashTableInterface iRCUHashTable;
+
+/* -------------------------------------------------------------------------
+ *                        String hash functions                              *
+ * Any of them can be passed to SetHashFunction. All except Times33 read the *
+ * key a word at a time.                                                     *
+ * ------------------------------------------------------------------------- */
+typedef struct tagHashFunctionsInterface {
+    size_t (*Times33)(const char *Key);
+    size_t (*Murmur)(const char *Key);
+    size_t (*Wy)(const char *Key);
+    size_t (*WMurmur)(const wchar_t *Key);
+    size_t (*WWy)(const wchar_t *Key);
+    uint64_t (*GeneralMurmur)(const char *Key,size_t *klen);
+    uint64_t (*GeneralWy)(const char *Key,size_t *klen);
+    uint64_t (*Hash64)(const void *Key,size_t len,uint64_t Seed);
+    uint64_t (*RandomSeed)(void);
+} HashFunctionsInterface;
+extern HashFunctionsInterface iHashFunctions;
 void qsortEx(void *base, size_t num, size_t width,CompareFunction cmp, CompareInfo *ExtraArgs);
+/* Types of the keys of iVector.SortByKey */
+#define CCL_KEY_UNSIGNED 0
+#define CCL_KEY_SIGNED   1
+#define CCL_KEY_FLOAT    2  /* float or double */
 
 /* ---------------------------------------------------------------------------
  *                                                                           *
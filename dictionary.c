@@ -21,5 +21,6 @@
 #define STRLEN strlen
 #define iSTRCOLLECTION istrCollection
 #define STRCOLLECTION strCollection
+#define DICTIONARY_FREEZE
 
 #include "dictionarygen.c"
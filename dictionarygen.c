@@ -79,6 +79,17 @@ static const guid DictionaryGuid = {0xa334a9d, 0x897c, 0x4bed,
 };
 
 
+/* Slot table sizes. The table grows to the next entry when the load
+   factor goes over the limit set with SetMaxLoadFactor */
+static const size_t primes[] = { 509, 509, 1021, 2053, 4093, 8191, 16381,
+    32771, 65521, 131071, 262147, 524287, 1048573, 2097143, 4194301,
+    8388593, 16777213, 33554393, 67108859, 134217689, 268435399,
+    536870909, 1073741789, 2147483647, 0 };
+#define DEFAULT_MAX_LOAD_FACTOR 1.0
+/* Number of non empty slots migrated at each Add/Insert/Erase while
+   a resize is in progress */
+#define REHASH_STEP 4
+
 static DATA_TYPE *Create(size_t elementsize,size_t hint);
 /*------------------------------------------------------------------------
  Procedure:     hash ID:1
@@ -189,6 +200,22 @@ static size_t hash(const CHARTYPE *key)
     return Hash;
 }
 
+/* With a seed the keys are hashed with Hash64, whatever the hash
+   function of the dictionary */
+static size_t HashKey(const DATA_TYPE *Dict,const CHARTYPE *Key)
+{
+    if (Dict->Seed)
+        return (size_t)iHashFunctions.Hash64(Key,STRLEN(Key)*sizeof(CHARTYPE),Dict->Seed);
+    return (*Dict->hash)(Key);
+}
+
+/* Two dictionaries that hash the keys in the same way can share the
+   hashes stored in the entries */
+static int SameHashing(const DATA_TYPE *d1,const DATA_TYPE *d2)
+{
+    return d1->Seed == d2->Seed && (d1->Seed || d1->hash == d2->hash);
+}
+
 #if 0
 static unsigned int hashlen(const char *key,int *klen)
 {
@@ -203,6 +230,355 @@ static unsigned int hashlen(const char *key,int *klen)
 }
 #endif
 
+/* Number of slots seen by the loops that visit all the entries */
+#define SLOTS(Dict) ((Dict)->OldSize+(Dict)->size+1)
+/*------------------------------------------------------------------------
+ Procedure:     GetSlot ID:1
+ Purpose:       Returns the chain at the given slot when both tables
+                are seen as a single one: first the table being
+                drained (if any), then the current one, then the list
+                of the entries kept in the guard tree.
+ Input:         The dictionary and the slot index, smaller than
+                SLOTS(Dict)
+ Output:        The head of the chain
+ Errors:        None
+------------------------------------------------------------------------*/
+static struct DATALIST *GetSlot(const DATA_TYPE *Dict,size_t idx)
+{
+    if (idx < Dict->OldSize)
+        return Dict->OldBuckets[idx];
+    idx -= Dict->OldSize;
+    if (idx < Dict->size)
+        return Dict->buckets[idx];
+    return Dict->GuardList;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                                Guarded chains                                  */
+/* ------------------------------------------------------------------------------ */
+/* When a chain of the current table grows over CHAIN_GUARD_LENGTH entries,
+   because of a poor hash function or because somebody chose keys that
+   collide, its entries are moved to an AVL tree ordered by hash and key.
+   The entries of the tree are also linked in that order through their
+   Next field, so the loops over all entries see them as one more slot,
+   and an entry can be unlinked once its predecessor in the tree is known. */
+static int GuardCompare(const CHARTYPE *Key,size_t h,const struct DATALIST *p)
+{
+    if (h != p->Hash)
+        return h < p->Hash ? -1 : 1;
+    return STRCMP(Key,p->Key);
+}
+
+#define GUARD_HEIGHT(n) ((n) ? (n)->height : 0)
+
+static void GuardUpdate(struct GuardNode *n)
+{
+    int l = GUARD_HEIGHT(n->down[0]), r = GUARD_HEIGHT(n->down[1]);
+
+    n->height = 1 + (l > r ? l : r);
+}
+
+/* Rotates the subtree so that the child in the given direction becomes
+   its root */
+static struct GuardNode *GuardRotate(struct GuardNode *n,int dir)
+{
+    struct GuardNode *c = n->down[dir];
+
+    n->down[dir] = c->down[!dir];
+    c->down[!dir] = n;
+    GuardUpdate(n);
+    GuardUpdate(c);
+    return c;
+}
+
+static struct GuardNode *GuardBalance(struct GuardNode *n)
+{
+    int diff,dir;
+
+    GuardUpdate(n);
+    diff = GUARD_HEIGHT(n->down[1]) - GUARD_HEIGHT(n->down[0]);
+    if (diff > 1 || diff < -1) {
+        dir = diff > 0;
+        if (GUARD_HEIGHT(n->down[dir]->down[!dir]) > GUARD_HEIGHT(n->down[dir]->down[dir]))
+            n->down[dir] = GuardRotate(n->down[dir],!dir);
+        n = GuardRotate(n,dir);
+    }
+    return n;
+}
+
+/* The key of the new node is not in the tree. *pred receives the entry
+   that precedes it. */
+static struct GuardNode *GuardInsert(struct GuardNode *n,struct GuardNode *node,struct DATALIST **pred)
+{
+    struct DATALIST *p = node->Entry;
+    int dir;
+
+    if (n == NULL)
+        return node;
+    dir = GuardCompare(p->Key,p->Hash,n->Entry) > 0;
+    if (dir)
+        *pred = n->Entry;
+    n->down[dir] = GuardInsert(n->down[dir],node,pred);
+    return GuardBalance(n);
+}
+
+static struct GuardNode *GuardRemoveMin(struct GuardNode *n,struct GuardNode **min)
+{
+    if (n->down[0] == NULL) {
+        *min = n;
+        return n->down[1];
+    }
+    n->down[0] = GuardRemoveMin(n->down[0],min);
+    return GuardBalance(n);
+}
+
+static struct GuardNode *GuardDelete(DATA_TYPE *Dict,struct GuardNode *n,const CHARTYPE *Key,size_t h,struct DATALIST **found)
+{
+    struct GuardNode *m;
+    int c;
+
+    if (n == NULL)
+        return NULL;
+    c = GuardCompare(Key,h,n->Entry);
+    if (c) {
+        n->down[c > 0] = GuardDelete(Dict,n->down[c > 0],Key,h,found);
+        return GuardBalance(n);
+    }
+    *found = n->Entry;
+    if (n->down[0] == NULL || n->down[1] == NULL)
+        m = n->down[n->down[0] == NULL];
+    else {
+        n->down[1] = GuardRemoveMin(n->down[1],&m);
+        m->down[0] = n->down[0];
+        m->down[1] = n->down[1];
+        m = GuardBalance(m);
+    }
+    Dict->Allocator->free(n);
+    return m;
+}
+
+static struct DATALIST *GuardFind(const DATA_TYPE *Dict,const CHARTYPE *Key,size_t h)
+{
+    struct GuardNode *n = Dict->GuardRoot;
+    int c;
+
+    while (n) {
+        c = GuardCompare(Key,h,n->Entry);
+        if (c == 0)
+            return n->Entry;
+        n = n->down[c > 0];
+    }
+    return NULL;
+}
+
+/* Returns the entry that precedes the given key in the list of the tree */
+static struct DATALIST *GuardPredecessor(const DATA_TYPE *Dict,const CHARTYPE *Key,size_t h)
+{
+    struct GuardNode *n = Dict->GuardRoot;
+    struct DATALIST *pred = NULL;
+    int c;
+
+    while (n) {
+        c = GuardCompare(Key,h,n->Entry);
+        if (c == 0) {
+            for (n = n->down[0]; n; n = n->down[1])
+                pred = n->Entry;
+            break;
+        }
+        if (c > 0)
+            pred = n->Entry;
+        n = n->down[c > 0];
+    }
+    return pred;
+}
+
+static int GuardAdd(DATA_TYPE *Dict,struct DATALIST *p)
+{
+    struct GuardNode *node = Dict->Allocator->malloc(sizeof(*node));
+    struct DATALIST *pred = NULL;
+
+    if (node == NULL)
+        return 0;
+    node->down[0] = node->down[1] = NULL;
+    node->Entry = p;
+    node->height = 1;
+    Dict->GuardRoot = GuardInsert(Dict->GuardRoot,node,&pred);
+    if (pred) {
+        p->Next = pred->Next;
+        pred->Next = p;
+    }
+    else {
+        p->Next = Dict->GuardList;
+        Dict->GuardList = p;
+    }
+    Dict->GuardCount++;
+    return 1;
+}
+
+/* Unlinks the entry with the given key from the tree and its list */
+static struct DATALIST *GuardErase(DATA_TYPE *Dict,const CHARTYPE *Key,size_t h)
+{
+    struct DATALIST *pred,*p = NULL;
+
+    if (Dict->GuardRoot == NULL)
+        return NULL;
+    pred = GuardPredecessor(Dict,Key,h);
+    Dict->GuardRoot = GuardDelete(Dict,Dict->GuardRoot,Key,h,&p);
+    if (p) {
+        if (pred)
+            pred->Next = p->Next;
+        else Dict->GuardList = p->Next;
+        Dict->GuardCount--;
+    }
+    return p;
+}
+
+/* Frees the nodes of the tree. The entries are not touched. */
+static void GuardFree(DATA_TYPE *Dict,struct GuardNode *n)
+{
+    if (n) {
+        GuardFree(Dict,n->down[0]);
+        GuardFree(Dict,n->down[1]);
+        Dict->Allocator->free(n);
+    }
+}
+
+static void GuardReset(DATA_TYPE *Dict)
+{
+    GuardFree(Dict,Dict->GuardRoot);
+    Dict->GuardRoot = NULL;
+    Dict->GuardList = NULL;
+    Dict->GuardCount = 0;
+}
+
+/* Counts the entries of a chain, stopping after CHAIN_GUARD_LENGTH+1 */
+static size_t ChainLength(const struct DATALIST *p)
+{
+    size_t n = 0;
+
+    for (; p && n <= CHAIN_GUARD_LENGTH; p = p->Next)
+        n++;
+    return n;
+}
+
+/* Moves the chain at slot i of the current table to the tree. If there is
+   no memory the remaining entries stay in the chain. */
+static void GuardChain(DATA_TYPE *Dict,size_t i)
+{
+    struct DATALIST *p = Dict->buckets[i],*q;
+
+    Dict->buckets[i] = NULL;
+    for (; p; p = q) {
+        q = p->Next;
+        if (!GuardAdd(Dict,p)) {
+            p->Next = Dict->buckets[i];
+            Dict->buckets[i] = p;
+        }
+    }
+    Dict->timestamp++;
+}
+
+/* Each entry keeps the full hash of its key: most entries of a chain
+   are rejected by comparing it, without reading the key */
+static struct DATALIST *FindEntryHash(const DATA_TYPE *Dict,const CHARTYPE *Key,size_t h)
+{
+    struct DATALIST *p;
+
+    for (p = Dict->buckets[h % Dict->size]; p; p = p->Next)
+        if (p->Hash == h && STRCMP(Key, p->Key) == 0)
+            return p;
+    if (Dict->OldBuckets) {
+        for (p = Dict->OldBuckets[h % Dict->OldSize]; p; p = p->Next)
+            if (p->Hash == h && STRCMP(Key, p->Key) == 0)
+                return p;
+    }
+    if (Dict->GuardRoot)
+        return GuardFind(Dict,Key,h);
+    return NULL;
+}
+
+static struct DATALIST *FindEntry(const DATA_TYPE *Dict,const CHARTYPE *Key)
+{
+    return FindEntryHash(Dict,Key,HashKey(Dict,Key));
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     RehashStep ID:1
+ Purpose:       Moves at most n non empty slots of the table being
+                drained into the current table. When the old table
+                is empty it is released.
+ Input:         The dictionary and the number of slots to migrate
+ Output:        None
+ Errors:        None
+------------------------------------------------------------------------*/
+static void RehashStep(DATA_TYPE *Dict,size_t n)
+{
+    size_t i,emptyVisits = 10*n;
+    struct DATALIST *p,*q;
+
+    if (Dict->OldBuckets == NULL)
+        return;
+    while (n > 0 && Dict->RehashIndex < Dict->OldSize) {
+        p = Dict->OldBuckets[Dict->RehashIndex];
+        Dict->OldBuckets[Dict->RehashIndex++] = NULL;
+        if (p == NULL) {
+            /* Bound the time spent skipping empty slots */
+            if (--emptyVisits == 0)
+                break;
+            continue;
+        }
+        for (; p; p = q) {
+            q = p->Next;
+            i = p->Hash % Dict->size;
+            p->Next = Dict->buckets[i];
+            Dict->buckets[i] = p;
+        }
+        n--;
+    }
+    /* Entries moved: any iterator positions are now meaningless */
+    Dict->timestamp++;
+    if (Dict->RehashIndex >= Dict->OldSize) {
+        Dict->Allocator->free(Dict->OldBuckets);
+        Dict->OldBuckets = NULL;
+        Dict->OldSize = Dict->RehashIndex = 0;
+    }
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Grow ID:1
+ Purpose:       Allocates a bigger slot table and starts migrating the
+                entries to it. The migration is done a few slots at a
+                time by RehashStep, so no single call pays for the
+                whole rehash.
+ Input:         The dictionary
+ Output:        None
+ Errors:        If there is no memory the dictionary keeps its current
+                table, it just gets longer chains.
+------------------------------------------------------------------------*/
+static void Grow(DATA_TYPE *Dict)
+{
+    size_t i,newSize;
+    struct DATALIST **newBuckets;
+
+    /* A previous resize is not finished: complete it first */
+    while (Dict->OldBuckets)
+        RehashStep(Dict,Dict->OldSize);
+    for (i = 1; primes[i] && primes[i] <= Dict->size; i++)
+        ;
+    newSize = primes[i] ? primes[i] : Dict->size*2+1;
+    newBuckets = Dict->Allocator->malloc(newSize*sizeof(newBuckets[0]));
+    if (newBuckets == NULL)
+        return;
+    memset(newBuckets,0,newSize*sizeof(newBuckets[0]));
+    Dict->OldBuckets = Dict->buckets;
+    Dict->OldSize = Dict->size;
+    Dict->RehashIndex = 0;
+    Dict->buckets = newBuckets;
+    Dict->size = newSize;
+    Dict->timestamp++;
+    Dict->Resizes++;
+}
+
 /*------------------------------------------------------------------------
  Procedure:     GetElement ID:1
  Purpose:       Returns an element given its key
@@ -216,7 +592,6 @@ static unsigned int hashlen(const char *key,int *klen)
 ------------------------------------------------------------------------*/
 static void *GetElement(const DATA_TYPE *Dict,const CHARTYPE *Key)
 {
-    size_t i;
     struct DATALIST *p;
 
     if (Dict == NULL || Key == NULL) {
@@ -228,16 +603,14 @@ static void *GetElement(const DATA_TYPE *Dict,const CHARTYPE *Key)
         return NULL;
 
     }
-    i = (*Dict->hash)(Key)%Dict->size;
-    for (p = Dict->buckets[i]; p; p = p->Next)
-        if (STRCMP(Key, p->Key) == 0)
-            return Dict->ElementSize ? p->Value : p->Key;
+    p = FindEntry(Dict,Key);
+    if (p)
+        return Dict->ElementSize ? p->Value : p->Key;
     return NULL;
 }
 
 static int CopyElement(const DATA_TYPE *Dict,const CHARTYPE *Key,void *outbuf)
 {
-    size_t i;
     struct DATALIST *p;
 
     if (Dict == NULL) {
@@ -247,15 +620,12 @@ static int CopyElement(const DATA_TYPE *Dict,const CHARTYPE *Key,void *outbuf)
         return BadArgError(Dict,"CopyElement");
 
     if (Dict->ElementSize == 0) return 0;
-    i = (*Dict->hash)(Key)%Dict->size;
-
-    for (p = Dict->buckets[i]; p; p = p->Next)
-        if (STRCMP(Key, p->Key) == 0) {
-            if (outbuf != NULL && Dict->ElementSize != 0)
-                memcpy(outbuf,p->Value,Dict->ElementSize);
-            return 1;
-        }
-    return 0;
+    p = FindEntry(Dict,Key);
+    if (p == NULL)
+        return 0;
+    if (outbuf != NULL)
+        memcpy(outbuf,p->Value,Dict->ElementSize);
+    return 1;
 }
 
 static int Contains(const DATA_TYPE *Dict,const CHARTYPE *Key)
@@ -272,63 +642,89 @@ static int Equal(const DATA_TYPE *d1,const DATA_TYPE *d2)
 {
     struct DATALIST *p1,*p2;
     size_t i;
+    int same;
     if (d1 == d2) return 1;
     if (d1 == NULL || d2 == NULL)
         return 0;
     if (d1->count != d2->count || d1->Flags != d2->Flags)
         return 0;
-    if (d1->size != d2->size || d1->hash != d2->hash)
-        return 0;
     if (d1->ElementSize != d2->ElementSize)
         return 0;
-    for (i=0; i < d1->size;i++) {
-        size_t j = 0;
-        p1 = d1->buckets[i]; p2 = d2->buckets[i];
-        while (p1 && p2) {
-            if (STRCMP((CHARTYPE *)p1->Key,(CHARTYPE *)p2->Key))
+    /* The slot tables can have different sizes (one of them may have
+       grown, or use another seed) so each key of d1 is looked up in d2 */
+    same = SameHashing(d1,d2);
+    for (i=0; i < SLOTS(d1);i++) {
+        for (p1 = GetSlot(d1,i); p1; p1 = p1->Next) {
+            p2 = FindEntryHash(d2,p1->Key,same ? p1->Hash : HashKey(d2,p1->Key));
+            if (p2 == NULL)
                 return 0;
             if (d1->ElementSize &&
                 memcmp(p1->Value,p2->Value,d1->ElementSize))
                 return 0;
-            j++;
-            p1 = p1->Next; p2 = p2->Next;
         }
-        if (p1 != p2)
-            return 0;
     }
     return 1;
 }
+/* Returns the storage of a new key: the copy kept in the shared table
+   of interned keys, a copy in the arena of the dictionary or a copy
+   allocated with its allocator. */
+static CHARTYPE *NewKey(DATA_TYPE *Dict,const CHARTYPE *Key)
+{
+    size_t len = sizeof(CHARTYPE)*(1+STRLEN(Key));
+    CHARTYPE *k;
+
+    if (Dict->InternTable) {
+        DATA_TYPE *t = Dict->InternTable;
+        k = t->VTable->GetElement(t,Key);
+        if (k == NULL && t->VTable->Add(t,Key,NULL) > 0)
+            k = t->VTable->GetElement(t,Key);
+        return k;
+    }
+    if (Dict->Arena.pool)
+        k = StringArenaAlloc(&Dict->Arena,len,sizeof(CHARTYPE));
+    else k = Dict->Allocator->malloc(len);
+    if (k)
+        memcpy(k,Key,len);
+    return k;
+}
+
+/* Keys in an arena or an intern table are released all together */
+static void FreeKey(DATA_TYPE *Dict,CHARTYPE *Key)
+{
+    if (Dict->Arena.pool == NULL && Dict->InternTable == NULL)
+        Dict->Allocator->free(Key);
+}
+
 /*------------------------------------------------------------------------
  Procedure:     Add ID:1
  Purpose:       Adds one entry to the dictionary. If another entry
                 exists for the same key it will be replaced.
- Input:         The dictionary, the key, and the value to be added
+ Input:         The dictionary, the key, its hash, and the value to be
+                added
  Output:        The number of items in the dictionary or a negative
                 error code
  Errors:        The container must be read/write.
 ------------------------------------------------------------------------*/
-static int add_nd(DATA_TYPE *Dict,const CHARTYPE *Key,const void *Value,int is_insert)
+static int add_nd(DATA_TYPE *Dict,const CHARTYPE *Key,size_t h,const void *Value,int is_insert)
 {
     size_t i;
     struct DATALIST *p;
     CHARTYPE *tmp;
     int result = 1;
 
-    i = (*Dict->hash)(Key)%Dict->size;
-    for (p = Dict->buckets[i]; p; p = p->Next) {
-        if (STRCMP(Key, p->Key) == 0)
-            break;
-    }
+    if (Dict->OldBuckets)
+        RehashStep(Dict,REHASH_STEP);
+    p = FindEntryHash(Dict,Key,h);
     if (p && is_insert) return 0;
     Dict->timestamp++;
     if (p == NULL) {
         /* Allocate both value and key to avoid leaving the
         container in an invalid state if a second allocation fails */
         p = Dict->Allocator->malloc(sizeof(*p)+Dict->ElementSize);
-        tmp = Dict->Allocator->malloc(sizeof(CHARTYPE)*(1+STRLEN(Key)));
+        tmp = NewKey(Dict,Key);
         if (p == NULL || tmp == NULL) {
             if (p) Dict->Allocator->free(p);
-            if (tmp) Dict->Allocator->free(tmp);
+            if (tmp) FreeKey(Dict,tmp);
             return NoMemoryError(Dict,"Add");
         }
         if (Value && Dict->ElementSize) {
@@ -338,11 +734,17 @@ static int add_nd(DATA_TYPE *Dict,const CHARTYPE *Key,const void *Value,int is_i
         else if (Dict->ElementSize == 0)
             p->Value = tmp;
         else p->Value = NULL;
-        STRCPY(tmp,Key);
         p->Key = tmp;
+        p->Hash = h;
+        i = h % Dict->size;
         p->Next = Dict->buckets[i];
         Dict->buckets[i] = p;
         Dict->count++;
+        if (ChainLength(p) > CHAIN_GUARD_LENGTH)
+            GuardChain(Dict,i);
+        if (Dict->MaxLoadFactor > 0 && Dict->OldBuckets == NULL &&
+            Dict->count > Dict->MaxLoadFactor*Dict->size)
+            Grow(Dict);
     }
     else {
         /* Overwrite the data for an existing element */
@@ -365,7 +767,7 @@ static int Add(DATA_TYPE *Dict,const CHARTYPE *Key,const void *Value)
     if (Key == NULL)
         return BadArgError(Dict,"Add");
 
-    result = add_nd(Dict,Key,Value,0);
+    result = add_nd(Dict,Key,HashKey(Dict,Key),Value,0);
     if (result >= 0 && (Dict->Flags & CONTAINER_HAS_OBSERVER))
         iObserver.Notify(Dict,CCL_ADD,Value,NULL);
     return result;
@@ -381,14 +783,13 @@ static int Insert(DATA_TYPE *Dict,const CHARTYPE *Key,const void *Value)
     if (Key == NULL || (Value == NULL && Dict->ElementSize > 0))
         return BadArgError(Dict,"Insert");
 
-    result = add_nd(Dict,Key,Value,1);
+    result = add_nd(Dict,Key,HashKey(Dict,Key),Value,1);
     if (result >= 0 && (Dict->Flags & CONTAINER_HAS_OBSERVER))
         iObserver.Notify(Dict,CCL_INSERT,Value,NULL);
     return result;
 }
 static int Replace(DATA_TYPE *Dict,const CHARTYPE *Key,const void *Value)
 {
-    size_t i;
     struct DATALIST *p;
 
     if (Dict == NULL) {
@@ -401,11 +802,7 @@ static int Replace(DATA_TYPE *Dict,const CHARTYPE *Key,const void *Value)
         return BadArgError(Dict,"Replace");
     }
 
-    i = (*Dict->hash)(Key)%Dict->size;
-    for (p = Dict->buckets[i]; p; p = p->Next) {
-        if (STRCMP((CHARTYPE *)Key, (CHARTYPE *)p->Key) == 0)
-            break;
-    }
+    p = FindEntry(Dict,Key);
     if (p == NULL) {
         return CONTAINER_ERROR_NOTFOUND;
     }
@@ -459,7 +856,10 @@ static size_t Sizeof(const DATA_TYPE *dict)
     if (dict == NULL) {
         return sizeof(Dictionary);
     }
-    return dict->ElementSize * dict->count + sizeof(dict) + dict->count*sizeof(struct DATALIST);
+    /* Each entry holds its link, key pointer, value pointer and the hash */
+    return dict->ElementSize * dict->count + sizeof(*dict) + dict->count*sizeof(struct DATALIST) +
+        (dict->size + dict->OldSize)*sizeof(dict->buckets[0]) +
+        dict->GuardCount*sizeof(struct GuardNode);
 }
 
 
@@ -507,8 +907,8 @@ static int Apply(DATA_TYPE *Dict,int (*apply)(const CHARTYPE *Key,const void *Va
     if (apply == NULL)
         return BadArgError(Dict,"Apply");
     stamp = Dict->timestamp;
-    for (i = 0; i < Dict->size; i++) {
-        for (p = Dict->buckets[i]; p; p = p->Next) {
+    for (i = 0; i < SLOTS(Dict); i++) {
+        for (p = GetSlot(Dict,i); p; p = p->Next) {
             if (Dict->ElementSize)
                 apply(p->Key,p->Value, ExtraArgs);
             else apply(p->Key,NULL,ExtraArgs);
@@ -540,9 +940,11 @@ static int InsertIn(DATA_TYPE *dst,DATA_TYPE *src)
         return CONTAINER_ERROR_INCOMPATIBLE;
     }
     stamp = src->timestamp;
-    for (i = 0; i < src->size; i++) {
-        for (p = src->buckets[i]; p; p = p->Next) {
-            r = add_nd(dst,p->Key,p->Value,0);
+    for (i = 0; i < SLOTS(src); i++) {
+        for (p = GetSlot(src,i); p; p = p->Next) {
+            r = add_nd(dst,p->Key,
+                       SameHashing(dst,src) ? p->Hash : HashKey(dst,p->Key),
+                       p->Value,0);
             if (r < 0)
                 return r;
             if (src->timestamp != stamp)
@@ -564,11 +966,43 @@ static int InsertIn(DATA_TYPE *dst,DATA_TYPE *src)
                 returns zero. If the dictionary is read-only the
                 result is also zero.
 ------------------------------------------------------------------------*/
-static int Erase(DATA_TYPE *Dict,const CHARTYPE *Key)
+static int erase_nd(DATA_TYPE *Dict,const CHARTYPE *Key)
 {
-    size_t i;
-    struct DATALIST **pp;
+    size_t h = HashKey(Dict,Key);
+    struct DATALIST **pp,*p = NULL;
+    int t;
+
+    for (t = 0; p == NULL && t < 2; t++) {
+        if (t == 0)
+            pp = &Dict->buckets[h % Dict->size];
+        else if (Dict->OldBuckets)
+            pp = &Dict->OldBuckets[h % Dict->OldSize];
+        else break;
+        for (; *pp; pp = &(*pp)->Next) {
+            if ((*pp)->Hash == h && STRCMP(Key, (*pp)->Key) == 0) {
+                p = *pp;
+                *pp = p->Next;
+                break;
+            }
+        }
+    }
+    if (p == NULL)
+        p = GuardErase(Dict,Key,h);
+    if (p == NULL)
+        return CONTAINER_ERROR_NOTFOUND;
+    if (Dict->Flags & CONTAINER_HAS_OBSERVER)
+        iObserver.Notify(Dict,CCL_ERASE_AT,p->Key,p->Value);
+    if (Dict->DestructorFn && Dict->ElementSize)
+        Dict->DestructorFn(p->Value);
+    FreeKey(Dict,p->Key);
+    Dict->Allocator->free(p);
+    Dict->count--;
+    Dict->timestamp++;
+    return 1;
+}
 
+static int Erase(DATA_TYPE *Dict,const CHARTYPE *Key)
+{
     if (Dict == NULL)
         return NullPtrError("Erase");
 
@@ -578,24 +1012,9 @@ static int Erase(DATA_TYPE *Dict,const CHARTYPE *Key)
     if (Dict->Flags & CONTAINER_READONLY) {
         return ReadOnlyError(Dict,"Erase");
     }
-    i = (*Dict->hash)(Key)%Dict->size;
-    for (pp = &Dict->buckets[i]; *pp; pp = &(*pp)->Next) {
-        if (STRCMP(Key, (*pp)->Key) == 0) {
-            struct DATALIST *p = *pp;
-            if (Dict->Flags & CONTAINER_HAS_OBSERVER)
-                iObserver.Notify(Dict,CCL_ERASE_AT,p->Key,p->Value);
-
-            *pp = p->Next;
-            if (Dict->DestructorFn && Dict->ElementSize)
-                Dict->DestructorFn(p->Value);
-            Dict->Allocator->free(p->Key);
-            Dict->Allocator->free(p);
-            Dict->count--;
-            Dict->timestamp++;
-            return 1;
-        }
-    }
-    return CONTAINER_ERROR_NOTFOUND;
+    if (Dict->OldBuckets)
+        RehashStep(Dict,REHASH_STEP);
+    return erase_nd(Dict,Key);
 }
 /*------------------------------------------------------------------------
  Procedure:     Clear ID:1
@@ -618,17 +1037,26 @@ static int Clear(DATA_TYPE *Dict)
     if (Dict->count > 0) {
         size_t i;
         struct DATALIST *p, *q;
-        for (i = 0; i < Dict->size; i++)
-            for (p = Dict->buckets[i]; p; p = q) {
+        for (i = 0; i < SLOTS(Dict); i++)
+            for (p = GetSlot(Dict,i); p; p = q) {
                 q = p->Next;
                 if (Dict->DestructorFn)
                     Dict->DestructorFn(p->Value);
-                Dict->Allocator->free(p->Key);
+                FreeKey(Dict,p->Key);
                 Dict->Allocator->free(p);
             }
     }
+    GuardReset(Dict);
+    if (Dict->Arena.pool)
+        StringArenaClear(&Dict->Arena);
     memset(Dict->buckets,0,Dict->size*sizeof(void *));
+    if (Dict->OldBuckets) {
+        Dict->Allocator->free(Dict->OldBuckets);
+        Dict->OldBuckets = NULL;
+        Dict->OldSize = Dict->RehashIndex = 0;
+    }
     Dict->count=0;
+    Dict->timestamp++;
     return 1;
 }
 
@@ -650,6 +1078,8 @@ static int Finalize(DATA_TYPE *Dict)
         iObserver.Notify(Dict,CCL_FINALIZE,NULL,NULL);
     if (Dict->VTable != &EXTERNAL_NAME)
         Dict->Allocator->free(Dict->VTable);
+    if (Dict->Arena.pool)
+        StringArenaFinalize(&Dict->Arena);
     Dict->Allocator->free(Dict->buckets);
     Dict->Allocator->free(Dict);
     return 1;
@@ -686,8 +1116,8 @@ static STRCOLLECTION *GetKeys(const DATA_TYPE *Dict)
     result = iSTRCOLLECTION.Create(Dict->count);
     if (result == NULL)
         return NULL;
-    for (i=0; i<Dict->size;i++) {
-        for (p = Dict->buckets[i]; p; p = p->Next) {
+    for (i=0; i<SLOTS(Dict);i++) {
+        for (p = GetSlot(Dict,i); p; p = p->Next) {
             iSTRCOLLECTION.Add(result,p->Key);
         }
     }
@@ -717,15 +1147,14 @@ static void *GetNext(Iterator *it)
         Dict->RaiseError("iDictionary.GetNext",CONTAINER_ERROR_OBJECT_CHANGED);
         return NULL;
     }
-    if (d->index >= Dict->size)
+    if (d->index >= SLOTS(Dict))
         return NULL;
-    while (Dict->buckets[d->index] == NULL) {
-        d->index++;
-        if (d->index >= Dict->size)
-            return NULL;
-    }
     if (d->dl == NULL) {
-        d->dl = Dict->buckets[d->index];
+        while ((d->dl = GetSlot(Dict,d->index)) == NULL) {
+            d->index++;
+            if (d->index >= SLOTS(Dict))
+                return NULL;
+        }
     }
     if (d->Dict->ElementSize == 0)
         retval = d->dl->Key;
@@ -776,7 +1205,7 @@ static int ReplaceWithIterator(Iterator *it, void *data,int direction)
     dl = li->dl;
     GetNext(it);
     if (data == NULL)
-        result = Erase(li->Dict, dl->Key);
+        result = erase_nd(li->Dict, dl->Key);
     else if (li->Dict->ElementSize) {
         memcpy(dl->Value,data,li->Dict->ElementSize);
         result = 1;
@@ -862,8 +1291,8 @@ static Vector *CastToArray(const DATA_TYPE *Dict)
         return NULL;
     result = iVector.Create(Dict->ElementSize,Dict->count);
 
-    for (i=0; i<Dict->size;i++) {
-        for (p = Dict->buckets[i]; p; p = p->Next) {
+    for (i=0; i<SLOTS(Dict);i++) {
+        for (p = GetSlot(Dict,i); p; p = p->Next) {
             iVector.Add(result,(char *)p->Value);
         }
     }
@@ -911,11 +1340,19 @@ static DATA_TYPE *Copy(const DATA_TYPE *src)
     }
     result->Flags = (src->Flags&~CONTAINER_HAS_OBSERVER);
     result->hash = src->hash;
+    result->Seed = src->Seed;
     result->RaiseError = src->RaiseError;
-    for (i=0; i<src->size;i++) {
-        rvp = src->buckets[i];
+    result->MaxLoadFactor = src->MaxLoadFactor;
+    result->InternTable = src->InternTable;
+    if (src->Arena.pool && StringArenaInit(&result->Arena,result->Allocator) < 0) {
+        Finalize(result);
+        NoMemoryError(src,"Copy");
+        return NULL;
+    }
+    for (i=0; i<SLOTS(src);i++) {
+        rvp = GetSlot(src,i);
         while (rvp) {
-            result->VTable->Add(result,rvp->Key,rvp->Value);
+            add_nd(result,rvp->Key,rvp->Hash,rvp->Value,0);
             rvp = rvp->Next;
         }
     }
@@ -993,8 +1430,7 @@ static const ContainerAllocator *GetAllocator(const DATA_TYPE *AL)
 static DATA_TYPE *InitWithAllocator(DATA_TYPE *Dict,size_t elementsize,size_t hint,const ContainerAllocator *allocator)
 {
     size_t i,allocSiz;
-    static size_t primes[] = { 509, 509, 1021, 2053, 4093, 8191, 16381,
-        32771, 65521, 131071, 262147, 524287, 1048573, 0 };
+
     for (i = 1; primes[i] < hint && primes[i] > 0; i++)
         ;
     allocSiz = sizeof (Dictionary);
@@ -1011,6 +1447,7 @@ static DATA_TYPE *InitWithAllocator(DATA_TYPE *Dict,size_t elementsize,size_t hi
     Dict->ElementSize = elementsize;
     Dict->Allocator = allocator;
     Dict->RaiseError = iError.RaiseError;
+    Dict->MaxLoadFactor = DEFAULT_MAX_LOAD_FACTOR;
     return Dict;
 }
 
@@ -1048,7 +1485,7 @@ static DATA_TYPE *InitializeWith(size_t elementSize,size_t n, const CHARTYPE **K
     if (result) {
         i=0;
         while (n-- > 0) {
-            add_nd(result,Keys[i],pValues,0);
+            add_nd(result,Keys[i],HashKey(result,Keys[i]),pValues,0);
             i++;
             pValues += elementSize;
         }
@@ -1067,19 +1504,82 @@ static DestructorFunction SetDestructor(DATA_TYPE *cb,DestructorFunction fn)
     return oldfn;
 }
 
+/* The stored hashes belong to the old hashing: finish any pending
+   migration, then hash every key again and put it in its new slot.
+   The guard tree is rebuilt with the chains that are still too long. */
+static void Rehash(DATA_TYPE *d)
+{
+    struct DATALIST *p,*q,*all = NULL;
+    size_t i;
+
+    while (d->OldBuckets)
+        RehashStep(d,d->OldSize);
+    for (i = 0; i < SLOTS(d); i++) {
+        for (p = GetSlot(d,i); p; p = q) {
+            q = p->Next;
+            p->Next = all;
+            all = p;
+        }
+        if (i < d->size)
+            d->buckets[i] = NULL;
+    }
+    GuardReset(d);
+    for (p = all; p; p = q) {
+        q = p->Next;
+        p->Hash = HashKey(d,p->Key);
+        i = p->Hash % d->size;
+        p->Next = d->buckets[i];
+        d->buckets[i] = p;
+    }
+    for (i = 0; i < d->size; i++) {
+        if (ChainLength(d->buckets[i]) > CHAIN_GUARD_LENGTH)
+            GuardChain(d,i);
+    }
+    d->timestamp++;
+}
+
 static HASHFUNCTION SetHashFunction(DATA_TYPE *d,HASHFUNCTION newFn)
 {
     HASHFUNCTION old;
+
     if (d == NULL) {
         return hash;
     }
     if (newFn == NULL)
         return d->hash;
     old = d->hash;
+    if (newFn == old && d->Seed == 0)
+        return old;
+    /* A hash function replaces the seeded hashing */
     d->hash = newFn;
+    d->Seed = 0;
+    Rehash(d);
     return old;
 }
 
+/*------------------------------------------------------------------------
+ Procedure:     SetSeed ID:1
+ Purpose:       Hashes the keys with Hash64 and the given seed instead
+                of the hash function of the dictionary. When the seed
+                is not known outside the process nobody can choose
+                keys that fall in the same slot. All the keys are
+                hashed again. SetHashFunction goes back to a function.
+ Input:         The dictionary and the seed. Zero asks for a random
+                seed.
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG if the dictionary is NULL, READONLY
+------------------------------------------------------------------------*/
+static int SetSeed(DATA_TYPE *d,uint64_t Seed)
+{
+    if (d == NULL)
+        return NullPtrError("SetSeed");
+    if (d->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(d,"SetSeed");
+    d->Seed = Seed ? Seed : iHashFunctions.RandomSeed();
+    Rehash(d);
+    return 1;
+}
+
 static size_t SizeofIterator(const DATA_TYPE *b)
 {
 	return sizeof(struct ITERATOR);
@@ -1090,6 +1590,289 @@ static double GetLoadFactor(DATA_TYPE *d)
     return ((double)d->count)/d->size;
 }
 
+/*------------------------------------------------------------------------
+ Procedure:     SetMaxLoadFactor ID:1
+ Purpose:       Sets the load factor above which the slot table grows.
+                The growth is incremental: the entries are moved to
+                the new table a few slots at a time at each Add,
+                Insert or Erase.
+ Input:         The dictionary and the new limit. Zero disables the
+                automatic growth.
+ Output:        The old limit
+ Errors:        A negative limit is rejected with BADARG
+------------------------------------------------------------------------*/
+static double SetMaxLoadFactor(DATA_TYPE *d,double newMax)
+{
+    double old;
+
+    if (d == NULL) {
+        NullPtrError("SetMaxLoadFactor");
+        return 0;
+    }
+    old = d->MaxLoadFactor;
+    if (newMax < 0) {
+        BadArgError(d,"SetMaxLoadFactor");
+        return old;
+    }
+    d->MaxLoadFactor = newMax;
+    return old;
+}
+
+#define BATCH_SIZE 16
+/*------------------------------------------------------------------------
+ Procedure:     LookupGroup ID:1
+ Purpose:       Looks up at most BATCH_SIZE keys. All hashes are computed
+                and their slots prefetched first, then the first entry
+                of each chain is prefetched, and only then the chains
+                are searched, so the cache misses of the group overlap
+                instead of being paid one after the other.
+ Input:         The dictionary, the number of keys, the keys and an
+                array for the entries found
+ Output:        Zero, or a negative value if a key is NULL
+ Errors:        None
+------------------------------------------------------------------------*/
+static int LookupGroup(const DATA_TYPE *Dict,size_t m,const CHARTYPE **Keys,struct DATALIST **Found)
+{
+    size_t h[BATCH_SIZE];
+    size_t j;
+
+    for (j = 0; j < m; j++) {
+        if (Keys[j] == NULL)
+            return -1;
+        h[j] = HashKey(Dict,Keys[j]);
+        CCL_PREFETCH(&Dict->buckets[h[j] % Dict->size]);
+    }
+    for (j = 0; j < m; j++)
+        CCL_PREFETCH(Dict->buckets[h[j] % Dict->size]);
+    for (j = 0; j < m; j++)
+        Found[j] = FindEntryHash(Dict,Keys[j],h[j]);
+    return 0;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     GetElements ID:1
+ Purpose:       Looks up n keys at once. Results[i] receives what
+                GetElement would return for Keys[i]: the data, the key
+                if the element size is zero, or NULL if not found.
+ Input:         The dictionary, the number of keys, the keys and an
+                array of n pointers for the results
+ Output:        The number of keys found or a negative error code
+ Errors:        BADARG if any argument or any key is NULL. READONLY
+                as GetElement.
+------------------------------------------------------------------------*/
+static int GetElements(const DATA_TYPE *Dict,size_t n,const CHARTYPE **Keys,void **Results)
+{
+    struct DATALIST *Found[BATCH_SIZE];
+    size_t i,j,m;
+    int found = 0;
+
+    if (Dict == NULL)
+        return NullPtrError("GetElements");
+    if (n && (Keys == NULL || Results == NULL))
+        return BadArgError(Dict,"GetElements");
+    if (Dict->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(Dict,"GetElements");
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+        if (LookupGroup(Dict,m,Keys+i,Found) < 0)
+            return BadArgError(Dict,"GetElements");
+        for (j = 0; j < m; j++) {
+            if (Found[j]) {
+                Results[i+j] = Dict->ElementSize ? Found[j]->Value : Found[j]->Key;
+                found++;
+            }
+            else Results[i+j] = NULL;
+        }
+    }
+    return found;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     ContainsMany ID:1
+ Purpose:       Tests n keys at once. Results[i] is set to 1 if Keys[i]
+                is in the dictionary, to zero otherwise.
+ Input:         The dictionary, the number of keys, the keys and an
+                array of n bytes for the results
+ Output:        The number of keys found or a negative error code
+ Errors:        BADARG if any argument or any key is NULL
+------------------------------------------------------------------------*/
+static int ContainsMany(const DATA_TYPE *Dict,size_t n,const CHARTYPE **Keys,unsigned char *Results)
+{
+    struct DATALIST *Found[BATCH_SIZE];
+    size_t i,j,m;
+    int found = 0;
+
+    if (Dict == NULL)
+        return NullPtrError("ContainsMany");
+    if (n && (Keys == NULL || Results == NULL))
+        return BadArgError(Dict,"ContainsMany");
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+        if (LookupGroup(Dict,m,Keys+i,Found) < 0)
+            return BadArgError(Dict,"ContainsMany");
+        for (j = 0; j < m; j++) {
+            Results[i+j] = Found[j] != NULL;
+            found += Results[i+j];
+        }
+    }
+    return found;
+}
+
+#ifdef DICTIONARY_FREEZE
+/*------------------------------------------------------------------------
+ Procedure:     Freeze ID:1
+ Purpose:       Builds a read only copy of the dictionary that answers
+                lookups with a single probe (see frozendictionary.c)
+ Input:         The dictionary
+ Output:        The frozen dictionary or NULL
+ Errors:        NOMEMORY
+------------------------------------------------------------------------*/
+static Dictionary *Freeze(const DATA_TYPE *Dict)
+{
+    const char **keys;
+    const void **values;
+    struct DATALIST *p;
+    size_t i,n = 0;
+    Dictionary *result;
+
+    if (Dict == NULL) {
+        NullPtrError("Freeze");
+        return NULL;
+    }
+    keys = Dict->Allocator->malloc((Dict->count+1)*sizeof(char *));
+    values = Dict->Allocator->malloc((Dict->count+1)*sizeof(void *));
+    if (keys == NULL || values == NULL) {
+        if (keys) Dict->Allocator->free(keys);
+        if (values) Dict->Allocator->free(values);
+        NoMemoryError(Dict,"Freeze");
+        return NULL;
+    }
+    for (i = 0; i < SLOTS(Dict); i++) {
+        for (p = GetSlot(Dict,i); p; p = p->Next) {
+            keys[n] = p->Key;
+            values[n++] = Dict->ElementSize ? p->Value : NULL;
+        }
+    }
+    result = FreezeDictionary(n,keys,values,Dict->ElementSize,Dict->Allocator);
+    Dict->Allocator->free(keys);
+    Dict->Allocator->free(values);
+    return result;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     SaveSnapshot ID:1
+ Purpose:       Writes a snapshot of the dictionary that can be opened
+                with OpenSnapshot and queried in place. The dictionary
+                is frozen and the frozen data is written.
+ Input:         The dictionary and an open binary stream
+ Output:        1 if OK, EOF if writing failed
+ Errors:        NOMEMORY, BADARG if the stream is NULL
+------------------------------------------------------------------------*/
+static int SaveSnapshot(const DATA_TYPE *Dict,FILE *stream)
+{
+    Dictionary *frozen;
+    int result;
+
+    if (Dict == NULL)
+        return NullPtrError("SaveSnapshot");
+    if (stream == NULL)
+        return BadArgError(Dict,"SaveSnapshot");
+    frozen = Freeze(Dict);
+    if (frozen == NULL)
+        return CONTAINER_ERROR_NOMEMORY;
+    result = SaveFrozenSnapshot((struct FrozenDictionary *)frozen,stream);
+    iFrozenDictionary.Finalize(frozen);
+    return result;
+}
+#endif
+
+/*------------------------------------------------------------------------
+ Procedure:     UseKeyArena ID:1
+ Purpose:       Stops allocating each key separately. With an intern
+                table the keys are stored once in that table and
+                shared by all the dictionaries that use it. Without
+                it the keys are packed in an arena owned by the
+                dictionary. In both cases erasing a key doesn't free
+                it: an arena is released by Clear and Finalize.
+ Input:         The dictionary, that must be empty, and a dictionary
+                with zero sized elements to use as intern table, or
+                NULL. The intern table must outlive the dictionary
+                and its keys must not be erased while it is in use.
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG, NOT_EMPTY, READONLY, NOMEMORY
+------------------------------------------------------------------------*/
+static int UseKeyArena(DATA_TYPE *Dict,DATA_TYPE *InternTable)
+{
+    if (Dict == NULL)
+        return NullPtrError("UseKeyArena");
+    if (Dict->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(Dict,"UseKeyArena");
+    if (InternTable == Dict ||
+        (InternTable && InternTable->VTable->GetElementSize(InternTable) != 0))
+        return BadArgError(Dict,"UseKeyArena");
+    if (Dict->count)
+        return doerrorCall(Dict->RaiseError,"UseKeyArena",CONTAINER_ERROR_NOT_EMPTY);
+    Dict->InternTable = InternTable;
+    if (InternTable) {
+        if (Dict->Arena.pool)
+            StringArenaFinalize(&Dict->Arena);
+    }
+    else if (Dict->Arena.pool == NULL &&
+             StringArenaInit(&Dict->Arena,Dict->Allocator) < 0)
+        return NoMemoryError(Dict,"UseKeyArena");
+    return 1;
+}
+
+/* The entries of the tree are found after comparing the keys above them */
+static void GuardStatistics(HashStatistics *s,const struct GuardNode *n,size_t depth)
+{
+    for (; n; n = n->down[1], depth++) {
+        GuardStatistics(s,n->down[0],depth+1);
+        HashStatsEntry(s,depth);
+        s->KeyBytes += (1+STRLEN(((struct DATALIST *)n->Entry)->Key))*sizeof(CHARTYPE);
+    }
+}
+
+static void ChainStatistics(HashStatistics *s,struct DATALIST **buckets,size_t first,size_t last)
+{
+    struct DATALIST *p;
+    size_t i,n;
+
+    for (i = first; i < last; i++) {
+        n = 0;
+        for (p = buckets[i]; p; p = p->Next) {
+            s->KeyBytes += (1+STRLEN(p->Key))*sizeof(CHARTYPE);
+            n++;
+        }
+        HashStatsChain(s,n);
+    }
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     GetStatistics ID:1
+ Purpose:       Measures the chains of the dictionary. The slots of a
+                table being drained after a resize are counted with the
+                others.
+ Input:         The dictionary and the statistics to fill
+ Output:        1 or a negative error code
+ Errors:        BADARG if an argument is NULL
+------------------------------------------------------------------------*/
+static int GetStatistics(const DATA_TYPE *Dict,HashStatistics *Stats)
+{
+    if (Dict == NULL)
+        return NullPtrError("GetStatistics");
+    if (Stats == NULL)
+        return BadArgError(Dict,"GetStatistics");
+    HashStatsInit(Stats,Dict->size + (Dict->OldBuckets ? Dict->OldSize - Dict->RehashIndex : 0));
+    ChainStatistics(Stats,Dict->buckets,0,Dict->size);
+    if (Dict->OldBuckets)
+        ChainStatistics(Stats,Dict->OldBuckets,Dict->RehashIndex,Dict->OldSize);
+    GuardStatistics(Stats,Dict->GuardRoot,1);
+    Stats->Resizes = Dict->Resizes;
+    HashStatsFinish(Stats,Dict->ElementSize,Sizeof(Dict));
+    return 1;
+}
+
 INTERFACE EXTERNAL_NAME  = {
     Size,
     GetFlags,
@@ -1127,4 +1910,16 @@ INTERFACE EXTERNAL_NAME  = {
     InitializeWith,
     SetHashFunction,
     GetLoadFactor,
+    SetMaxLoadFactor,
+    GetElements,
+    ContainsMany,
+#ifdef DICTIONARY_FREEZE
+    Freeze,
+    FreezeStrCollection,
+    SaveSnapshot,
+    OpenDictionarySnapshot,
+#endif
+    UseKeyArena,
+    SetSeed,
+    GetStatistics,
 };
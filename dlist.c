@@ -1172,6 +1172,35 @@ static int Sort(Dlist *l)
     l->timestamp++;
     return 1;
 }
+
+/* Sorts keeping the order of the elements that compare equal. The nodes
+   are relinked through Next, then the Previous links are rebuilt. */
+static int StableSort(Dlist *l)
+{
+    DlistElement *rvp,*prev = NULL;
+    CompareInfo ci;
+    void *last;
+
+    if (l == NULL) return iError.NullPtrError("iDlist.StableSort");
+
+    if (l->Flags&CONTAINER_READONLY) {
+    	l->RaiseError("iDlist.StableSort",CONTAINER_ERROR_READONLY,l);
+    	return CONTAINER_ERROR_READONLY;
+    }
+    if (l->count < 2)
+    	return 1;
+    ci.ContainerLeft = l;
+    ci.ContainerRight = NULL;
+    ci.ExtraArgs = NULL;
+    l->First = MergeSortLinked(l->First,l->count,offsetof(DlistElement,Data),l->Compare,&ci,&last);
+    l->Last = last;
+    for (rvp = l->First; rvp; rvp = rvp->Next) {
+    	rvp->Previous = prev;
+    	prev = rvp;
+    }
+    l->timestamp++;
+    return 1;
+}
 static int Apply(Dlist *L,int (Applyfn)(void *,void *),void *arg)
 {
     DlistElement *le;
@@ -2063,5 +2092,6 @@ DlistInterface iDlist = {
     Skip,
     MoveBack,
     SplitAfter,
+    StableSort,
 };
 
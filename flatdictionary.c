@@ -0,0 +1,1441 @@
+/*------------------------------------------------------------------------
+ Module:        flatdictionary.c
+ Author:        jacob
+ Project:       Containers
+ State:
+ Creation Date:
+ Description:   This file implements the Dictionary interface with an
+                open addressing table instead of chained lists.
+                Each slot holds the full hash of the key, a pointer to
+                the (copied) key and the value itself, so a lookup does
+                not follow any list pointer. A separate array of control
+                bytes, one per slot, holds 7 bits of the hash of the key
+                stored in the slot, or a marker for empty and deleted
+                slots. Lookups compare 8 control bytes at a time with
+                word sized operations, and only the slots whose control
+                byte matches are compared with the key.
+                The values live in the table: a pointer returned by
+                GetElement is valid only until the next Add or Insert,
+                since those can grow the table.
+------------------------------------------------------------------------*/
+#include <limits.h>
+#include <stddef.h>
+#include "containers.h"
+#include "ccl_internal.h"
+
+typedef struct FlatDictionary FlatDictionary;
+
+#define GROUP_WIDTH     FLATDICT_GROUP_WIDTH
+#define CTRL_EMPTY      0x80
+#define CTRL_DELETED    0xFE
+#define LSBS            0x0101010101010101ULL
+#define MSBS            0x8080808080808080ULL
+#define NOT_FOUND       ((size_t)-1)
+#define MIN_SIZE        16
+#define DEFAULT_MAX_LOAD_FACTOR 0.875
+
+#define VALUE_OFFSET    roundup(sizeof(struct FlatSlot))
+#define SLOT(d,i)       ((struct FlatSlot *)((d)->Slots + (i)*(d)->SlotSize))
+#define VALUE(s)        ((char *)(s) + VALUE_OFFSET)
+#define ISFULL(c)       (((c) & 0x80) == 0)
+
+/* Same guid as the chained dictionary: both implementations read and
+   write the same file format */
+static const guid DictionaryGuid = {0xa334a9d, 0x897c, 0x4bed,
+{0x92,0xa3,0x2,0xbf,0x86,0xd5,0x2e,0xcf}
+};
+
+static FlatDictionary *Create(size_t elementsize,size_t hint);
+
+static int doerrorCall(ErrorFunction err,const char *fnName,int code)
+{
+    char buf[256];
+
+    snprintf(buf,sizeof(buf),"iFlatDictionary.%s",fnName);
+    err(buf,code);
+    return code;
+}
+static int ReadOnlyError(const FlatDictionary *SC,const char *fnName)
+{
+    char buf[256];
+
+    snprintf(buf,sizeof(buf),"iFlatDictionary.%s",fnName);
+    SC->RaiseError(buf,CONTAINER_ERROR_READONLY,SC);
+    return CONTAINER_ERROR_READONLY;
+}
+static int NullPtrError(const char *fnName)
+{
+    return doerrorCall(iError.RaiseError,fnName,CONTAINER_ERROR_BADARG);
+}
+
+static int BadArgError(const FlatDictionary *SC,const char *fnName)
+{
+    return doerrorCall(SC->RaiseError,fnName,CONTAINER_ERROR_BADARG);
+}
+
+static int NoMemoryError(const FlatDictionary *SC,const char *fnName)
+{
+    return doerrorCall(SC->RaiseError,fnName,CONTAINER_ERROR_NOMEMORY);
+}
+
+static size_t hash(const char *key)
+{
+    size_t Hash = 0;
+    const unsigned char *p;
+
+    for (p = (const unsigned char *)key; *p; p++) {
+        Hash = Hash * 33 + *p;
+    }
+    return Hash;
+}
+
+/* See HashKey in dictionarygen.c */
+static size_t HashKey(const FlatDictionary *Dict,const char *Key)
+{
+    if (Dict->Seed)
+        return (size_t)iHashFunctions.Hash64(Key,strlen(Key),Dict->Seed);
+    return (*Dict->hash)(Key);
+}
+
+static int SameHashing(const FlatDictionary *d1,const FlatDictionary *d2)
+{
+    return d1->Seed == d2->Seed && (d1->Seed || d1->hash == d2->hash);
+}
+
+/* The user hash function can have weak high or low bits (the times 33
+   hash of a short string never sets the high bits of a 64 bit word).
+   Both the slot position and the control byte are taken from a mixed
+   copy of the hash. */
+static size_t Mix(size_t h)
+{
+#if SIZE_MAX > 0xffffffffu
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+#else
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+#endif
+    return h;
+}
+
+/* Reads the 8 control bytes at p. Byte i of the group is always at bits
+   8*i..8*i+7 whatever the byte order of the machine. */
+static uint64_t LoadGroup(const unsigned char *p)
+{
+    return  (uint64_t)p[0]        | ((uint64_t)p[1] << 8)  |
+           ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+           ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+/* Sets the high bit of each byte equal to h2. It can give a false
+   positive for a byte following a match: the key compare rejects it. */
+static uint64_t MatchByte(uint64_t g,unsigned h2)
+{
+    uint64_t x = g ^ (LSBS * h2);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+static uint64_t MatchEmpty(uint64_t g)
+{
+    return g & (~g << 6) & MSBS;
+}
+
+static uint64_t MatchEmptyOrDeleted(uint64_t g)
+{
+    return g & MSBS;
+}
+
+static unsigned LowestByte(uint64_t m)
+{
+#ifdef __GNUC__
+    return (unsigned)__builtin_ctzll(m) >> 3;
+#else
+    unsigned n = 0;
+    while ((m & 0xff) == 0) {
+        m >>= 8;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static unsigned HighestByte(uint64_t m)
+{
+#ifdef __GNUC__
+    return (63 - (unsigned)__builtin_clzll(m)) >> 3;
+#else
+    unsigned n = 7;
+    while ((m >> 56) == 0) {
+        m <<= 8;
+        n--;
+    }
+    return n;
+#endif
+}
+
+static void SetControl(FlatDictionary *d,size_t i,unsigned char c)
+{
+    d->Control[i] = c;
+    if (i < GROUP_WIDTH)
+        d->Control[d->size+i] = c;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     FindSlot ID:1
+ Purpose:       Finds the slot holding the given key. The groups are
+                visited in triangular order, which visits all of them
+                when the table size is a power of two. The search stops
+                at the first group with an empty slot.
+ Input:         The dictionary, the key and its hash
+ Output:        The slot index or NOT_FOUND
+ Errors:        None
+------------------------------------------------------------------------*/
+static size_t FindSlot(const FlatDictionary *d,const char *Key,size_t h)
+{
+    size_t m = Mix(h), mask = d->size - 1, pos = (m >> 7) & mask, step = 0;
+    unsigned h2 = (unsigned)(m & 0x7f);
+    uint64_t g,match;
+
+    for (;;) {
+        g = LoadGroup(d->Control+pos);
+        for (match = MatchByte(g,h2); match; match &= match - 1) {
+            size_t i = (pos + LowestByte(match)) & mask;
+            struct FlatSlot *s = SLOT(d,i);
+            if (s->Hash == h && strcmp(Key,s->Key) == 0)
+                return i;
+        }
+        if (MatchEmpty(g))
+            return NOT_FOUND;
+        step += GROUP_WIDTH;
+        pos = (pos + step) & mask;
+    }
+}
+
+/* Returns the first empty or deleted slot in the probe sequence of h */
+static size_t FindFreeSlot(const FlatDictionary *d,size_t h)
+{
+    size_t mask = d->size - 1, pos = (Mix(h) >> 7) & mask, step = 0;
+    uint64_t match;
+
+    for (;;) {
+        match = MatchEmptyOrDeleted(LoadGroup(d->Control+pos));
+        if (match)
+            return (pos + LowestByte(match)) & mask;
+        step += GROUP_WIDTH;
+        pos = (pos + step) & mask;
+    }
+}
+
+static int AllocTable(FlatDictionary *d,size_t size)
+{
+    unsigned char *ctrl;
+    char *slots;
+
+    ctrl = d->Allocator->malloc(size + GROUP_WIDTH);
+    slots = d->Allocator->malloc(size * d->SlotSize);
+    if (ctrl == NULL || slots == NULL) {
+        if (ctrl) d->Allocator->free(ctrl);
+        if (slots) d->Allocator->free(slots);
+        return CONTAINER_ERROR_NOMEMORY;
+    }
+    memset(ctrl,CTRL_EMPTY,size + GROUP_WIDTH);
+    d->Control = ctrl;
+    d->Slots = slots;
+    d->size = size;
+    d->Deleted = 0;
+    return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Rehash ID:1
+ Purpose:       Moves all entries into a new table of the given size,
+                dropping the deleted markers. The stored hashes are
+                used: no key is read.
+ Input:         The dictionary and the new size (a power of two)
+ Output:        1 or a negative error code
+ Errors:        NOMEMORY. The dictionary is unchanged.
+------------------------------------------------------------------------*/
+static int Rehash(FlatDictionary *d,size_t newSize)
+{
+    FlatDictionary old = *d;
+    size_t i,j;
+    int r;
+
+    r = AllocTable(d,newSize);
+    if (r < 0)
+        return r;
+    for (i = 0; i < old.size; i++) {
+        struct FlatSlot *s;
+        if (!ISFULL(old.Control[i]))
+            continue;
+        s = SLOT(&old,i);
+        j = FindFreeSlot(d,s->Hash);
+        SetControl(d,j,(unsigned char)(Mix(s->Hash) & 0x7f));
+        memcpy(SLOT(d,j),s,d->SlotSize);
+    }
+    d->Allocator->free(old.Control);
+    d->Allocator->free(old.Slots);
+    d->timestamp++;
+    if (newSize != old.size)
+        d->Resizes++;
+    return 1;
+}
+
+/* Returns the slot where a new entry with hash h should go, growing the
+   table if needed. The control byte is set. */
+static size_t NewSlot(FlatDictionary *d,size_t h)
+{
+    size_t i = FindFreeSlot(d,h);
+
+    if (d->Control[i] == CTRL_EMPTY &&
+        (d->count + d->Deleted + 1) > d->MaxLoadFactor*d->size) {
+        /* If many slots are just deleted markers rehash in place */
+        size_t newSize = d->size;
+        if (d->count + 1 > d->MaxLoadFactor*d->size/2)
+            newSize *= 2;
+        if (Rehash(d,newSize) < 0)
+            return NOT_FOUND;
+        i = FindFreeSlot(d,h);
+    }
+    if (d->Control[i] == CTRL_DELETED)
+        d->Deleted--;
+    SetControl(d,i,(unsigned char)(Mix(h) & 0x7f));
+    return i;
+}
+
+/* Marks slot i as free. If no probe sequence could have gone through
+   this slot while looking for a later entry (there is an empty slot
+   within the group around it) it becomes empty, otherwise deleted. */
+static void FreeSlot(FlatDictionary *d,size_t i)
+{
+    size_t mask = d->size - 1;
+    uint64_t after = MatchEmpty(LoadGroup(d->Control + i));
+    uint64_t before = MatchEmpty(LoadGroup(d->Control + ((i - GROUP_WIDTH) & mask)));
+
+    if (after && before &&
+        LowestByte(after) + (GROUP_WIDTH - 1 - HighestByte(before)) < GROUP_WIDTH) {
+        SetControl(d,i,CTRL_EMPTY);
+    }
+    else {
+        SetControl(d,i,CTRL_DELETED);
+        d->Deleted++;
+    }
+    d->count--;
+}
+
+static void *GetElement(const FlatDictionary *Dict,const char *Key)
+{
+    size_t i;
+    struct FlatSlot *s;
+
+    if (Dict == NULL || Key == NULL) {
+        NullPtrError("GetElement");
+        return NULL;
+    }
+    if (Dict->Flags & CONTAINER_READONLY) {
+        ReadOnlyError(Dict,"GetElement");
+        return NULL;
+    }
+    i = FindSlot(Dict,Key,HashKey(Dict,Key));
+    if (i == NOT_FOUND)
+        return NULL;
+    s = SLOT(Dict,i);
+    return Dict->ElementSize ? VALUE(s) : s->Key;
+}
+
+static int CopyElement(const FlatDictionary *Dict,const char *Key,void *outbuf)
+{
+    size_t i;
+
+    if (Dict == NULL) {
+        return NullPtrError("CopyElement");
+    }
+    if (Key == NULL)
+        return BadArgError(Dict,"CopyElement");
+
+    if (Dict->ElementSize == 0) return 0;
+    i = FindSlot(Dict,Key,HashKey(Dict,Key));
+    if (i == NOT_FOUND)
+        return 0;
+    if (outbuf != NULL)
+        memcpy(outbuf,VALUE(SLOT(Dict,i)),Dict->ElementSize);
+    return 1;
+}
+
+static int Contains(const FlatDictionary *Dict,const char *Key)
+{
+    if (Dict == NULL)  {
+        return NullPtrError("Contains");
+    }
+    if (Key == NULL)
+        return BadArgError(Dict,"Contains");
+    return FindSlot(Dict,Key,HashKey(Dict,Key)) != NOT_FOUND;
+}
+
+static int Equal(const FlatDictionary *d1,const FlatDictionary *d2)
+{
+    size_t i,j;
+    int same;
+
+    if (d1 == d2) return 1;
+    if (d1 == NULL || d2 == NULL)
+        return 0;
+    if (d1->count != d2->count || d1->Flags != d2->Flags)
+        return 0;
+    if (d1->ElementSize != d2->ElementSize)
+        return 0;
+    same = SameHashing(d1,d2);
+    for (i = 0; i < d1->size; i++) {
+        struct FlatSlot *s;
+        if (!ISFULL(d1->Control[i]))
+            continue;
+        s = SLOT(d1,i);
+        j = FindSlot(d2,s->Key,same ? s->Hash : HashKey(d2,s->Key));
+        if (j == NOT_FOUND)
+            return 0;
+        if (d1->ElementSize &&
+            memcmp(VALUE(s),VALUE(SLOT(d2,j)),d1->ElementSize))
+            return 0;
+    }
+    return 1;
+}
+
+/* The keys are copied into the allocator, the arena of the dictionary
+   or the shared table of interned keys */
+static char *NewKey(FlatDictionary *Dict,const char *Key)
+{
+    size_t len = 1+strlen(Key);
+    char *k;
+
+    if (Dict->InternTable) {
+        Dictionary *t = Dict->InternTable;
+        k = t->VTable->GetElement(t,Key);
+        if (k == NULL && t->VTable->Add(t,Key,NULL) > 0)
+            k = t->VTable->GetElement(t,Key);
+        return k;
+    }
+    if (Dict->Arena.pool)
+        k = StringArenaAlloc(&Dict->Arena,len,1);
+    else k = Dict->Allocator->malloc(len);
+    if (k)
+        memcpy(k,Key,len);
+    return k;
+}
+
+static void FreeKey(FlatDictionary *Dict,char *Key)
+{
+    if (Dict->Arena.pool == NULL && Dict->InternTable == NULL)
+        Dict->Allocator->free(Key);
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     add_nd ID:1
+ Purpose:       Adds or replaces an entry, given the hash of the key
+ Input:         The dictionary, the key, its hash, the value and a flag
+                that is true if an existing entry must be left alone
+ Output:        1 if a new entry was added, zero if an existing entry
+                was found, or a negative error code
+ Errors:        NOMEMORY
+------------------------------------------------------------------------*/
+static int add_nd(FlatDictionary *Dict,const char *Key,size_t h,const void *Value,int is_insert)
+{
+    size_t i;
+    struct FlatSlot *s;
+    char *tmp;
+
+    i = FindSlot(Dict,Key,h);
+    if (i != NOT_FOUND) {
+        if (is_insert) return 0;
+        Dict->timestamp++;
+        /* Overwrite the data for an existing element */
+        if (Dict->ElementSize) {
+            if (Value)
+                memcpy(VALUE(SLOT(Dict,i)),Value,Dict->ElementSize);
+            else memset(VALUE(SLOT(Dict,i)),0,Dict->ElementSize);
+        }
+        return 0;
+    }
+    tmp = NewKey(Dict,Key);
+    if (tmp == NULL)
+        return NoMemoryError(Dict,"Add");
+    i = NewSlot(Dict,h);
+    if (i == NOT_FOUND) {
+        FreeKey(Dict,tmp);
+        return NoMemoryError(Dict,"Add");
+    }
+    s = SLOT(Dict,i);
+    s->Hash = h;
+    s->Key = tmp;
+    if (Dict->ElementSize) {
+        if (Value)
+            memcpy(VALUE(s),Value,Dict->ElementSize);
+        else memset(VALUE(s),0,Dict->ElementSize);
+    }
+    Dict->count++;
+    Dict->timestamp++;
+    return 1;
+}
+
+static int Add(FlatDictionary *Dict,const char *Key,const void *Value)
+{
+    int result;
+
+    if (Dict == NULL)
+        return NullPtrError("Add");
+    if (Dict->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(Dict,"Add");
+    if (Key == NULL)
+        return BadArgError(Dict,"Add");
+
+    result = add_nd(Dict,Key,HashKey(Dict,Key),Value,0);
+    if (result >= 0 && (Dict->Flags & CONTAINER_HAS_OBSERVER))
+        iObserver.Notify(Dict,CCL_ADD,Value,NULL);
+    return result;
+}
+
+static int Insert(FlatDictionary *Dict,const char *Key,const void *Value)
+{
+    int result;
+
+    if (Dict == NULL)
+        return NullPtrError("Insert");
+    if (Dict->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(Dict,"Insert");
+    if (Key == NULL || (Value == NULL && Dict->ElementSize > 0))
+        return BadArgError(Dict,"Insert");
+
+    result = add_nd(Dict,Key,HashKey(Dict,Key),Value,1);
+    if (result >= 0 && (Dict->Flags & CONTAINER_HAS_OBSERVER))
+        iObserver.Notify(Dict,CCL_INSERT,Value,NULL);
+    return result;
+}
+
+static int Replace(FlatDictionary *Dict,const char *Key,const void *Value)
+{
+    size_t i;
+    char *p;
+
+    if (Dict == NULL) {
+        return NullPtrError("Replace");
+    }
+    if (Dict->Flags & CONTAINER_READONLY) {
+        return ReadOnlyError(Dict,"Replace");
+    }
+    if (Key == NULL || Value == NULL) {
+        return BadArgError(Dict,"Replace");
+    }
+    i = FindSlot(Dict,Key,HashKey(Dict,Key));
+    if (i == NOT_FOUND) {
+        return CONTAINER_ERROR_NOTFOUND;
+    }
+    if (Dict->ElementSize == 0)
+        return 1;
+    p = VALUE(SLOT(Dict,i));
+    if (Dict->Flags & CONTAINER_HAS_OBSERVER)
+        iObserver.Notify(Dict,CCL_REPLACE,p,Value);
+    Dict->timestamp++;
+    if (Dict->DestructorFn)
+        Dict->DestructorFn(p);
+    memcpy(p,Value,Dict->ElementSize);
+    return 1;
+}
+
+static size_t Size(const FlatDictionary *Dict)
+{
+    if (Dict == NULL) {
+        NullPtrError("Size");
+        return 0;
+    }
+    return Dict->count;
+}
+
+static unsigned GetFlags(const FlatDictionary *Dict)
+{
+    if (Dict == NULL) {
+        NullPtrError("GetFlags");
+        return 0;
+    }
+    return Dict->Flags;
+}
+
+static unsigned SetFlags(FlatDictionary *Dict,unsigned Flags)
+{
+    unsigned oldFlags;
+    if (Dict == NULL) {
+        NullPtrError("SetFlags");
+        return 0;
+    }
+    oldFlags = Dict->Flags;
+    Dict->Flags = Flags;
+    return oldFlags;
+}
+
+static size_t Sizeof(const FlatDictionary *dict)
+{
+    if (dict == NULL) {
+        return sizeof(FlatDictionary);
+    }
+    return sizeof(*dict) + dict->size*(dict->SlotSize+1) + GROUP_WIDTH;
+}
+
+static int Apply(FlatDictionary *Dict,int (*apply)(const char *Key,const void *Value, void *ExtraArgs),
+    void *ExtraArgs)
+{
+    size_t i;
+    unsigned stamp;
+    struct FlatSlot *s;
+
+    if (Dict == NULL) {
+        return	NullPtrError("Apply");
+    }
+    if (apply == NULL)
+        return BadArgError(Dict,"Apply");
+    stamp = Dict->timestamp;
+    for (i = 0; i < Dict->size; i++) {
+        if (!ISFULL(Dict->Control[i]))
+            continue;
+        s = SLOT(Dict,i);
+        apply(s->Key,Dict->ElementSize ? VALUE(s) : NULL,ExtraArgs);
+        if (Dict->timestamp != stamp)
+            return 0;
+    }
+    return 1;
+}
+
+static int InsertIn(FlatDictionary *dst,FlatDictionary *src)
+{
+    size_t i;
+    unsigned stamp;
+    int r;
+    struct FlatSlot *s;
+
+    if (dst == NULL) {
+        return NullPtrError("InsertIn");
+    }
+    if (src == NULL)
+        return BadArgError(dst,"InsertIn");
+
+    if (dst->Flags& CONTAINER_READONLY)
+        return ReadOnlyError(dst,"InsertIn");
+
+    if (src->ElementSize != dst->ElementSize) {
+        dst->RaiseError("iFlatDictionary.InsertIn",CONTAINER_ERROR_INCOMPATIBLE);
+        return CONTAINER_ERROR_INCOMPATIBLE;
+    }
+    stamp = src->timestamp;
+    for (i = 0; i < src->size; i++) {
+        if (!ISFULL(src->Control[i]))
+            continue;
+        s = SLOT(src,i);
+        r = add_nd(dst,s->Key,SameHashing(dst,src) ? s->Hash : HashKey(dst,s->Key),
+                   src->ElementSize ? VALUE(s) : NULL,0);
+        if (r < 0)
+            return r;
+        if (src->timestamp != stamp)
+            return 0;
+    }
+    if (dst->Flags & CONTAINER_HAS_OBSERVER)
+        iObserver.Notify(dst,CCL_INSERT_IN,src,NULL);
+    return 1;
+}
+
+static void EraseSlot(FlatDictionary *Dict,size_t i)
+{
+    struct FlatSlot *s = SLOT(Dict,i);
+
+    if (Dict->Flags & CONTAINER_HAS_OBSERVER)
+        iObserver.Notify(Dict,CCL_ERASE_AT,s->Key,VALUE(s));
+    if (Dict->DestructorFn && Dict->ElementSize)
+        Dict->DestructorFn(VALUE(s));
+    FreeKey(Dict,s->Key);
+    FreeSlot(Dict,i);
+    Dict->timestamp++;
+}
+
+static int Erase(FlatDictionary *Dict,const char *Key)
+{
+    size_t i;
+
+    if (Dict == NULL)
+        return NullPtrError("Erase");
+
+    if (Key == NULL)
+        return BadArgError(Dict,"Erase");
+
+    if (Dict->Flags & CONTAINER_READONLY) {
+        return ReadOnlyError(Dict,"Erase");
+    }
+    i = FindSlot(Dict,Key,HashKey(Dict,Key));
+    if (i == NOT_FOUND)
+        return CONTAINER_ERROR_NOTFOUND;
+    EraseSlot(Dict,i);
+    return 1;
+}
+
+static int Clear(FlatDictionary *Dict)
+{
+    size_t i;
+
+    if (Dict == NULL) {
+        return NullPtrError("Clear");
+    }
+    if (Dict->Flags & CONTAINER_READONLY) {
+        return ReadOnlyError(Dict,"Clear");
+    }
+    if (Dict->Flags & CONTAINER_HAS_OBSERVER)
+        iObserver.Notify(Dict,CCL_CLEAR,NULL,NULL);
+    for (i = 0; Dict->count > 0 && i < Dict->size; i++) {
+        struct FlatSlot *s;
+        if (!ISFULL(Dict->Control[i]))
+            continue;
+        s = SLOT(Dict,i);
+        if (Dict->DestructorFn && Dict->ElementSize)
+            Dict->DestructorFn(VALUE(s));
+        FreeKey(Dict,s->Key);
+    }
+    if (Dict->Arena.pool)
+        StringArenaClear(&Dict->Arena);
+    memset(Dict->Control,CTRL_EMPTY,Dict->size+GROUP_WIDTH);
+    Dict->count = Dict->Deleted = 0;
+    Dict->timestamp++;
+    return 1;
+}
+
+static int Finalize(FlatDictionary *Dict)
+{
+    int r = Clear(Dict);
+    if (0 > r)
+        return r;
+    if (Dict->Flags & CONTAINER_HAS_OBSERVER)
+        iObserver.Notify(Dict,CCL_FINALIZE,NULL,NULL);
+    if (Dict->VTable != &iFlatDictionary)
+        Dict->Allocator->free(Dict->VTable);
+    if (Dict->Arena.pool)
+        StringArenaFinalize(&Dict->Arena);
+    Dict->Allocator->free(Dict->Control);
+    Dict->Allocator->free(Dict->Slots);
+    Dict->Allocator->free(Dict);
+    return 1;
+}
+
+static ErrorFunction SetErrorFunction(FlatDictionary *Dict,ErrorFunction fn)
+{
+    ErrorFunction old;
+    if (Dict == NULL) { return iError.RaiseError; }
+    old = Dict->RaiseError;
+    if (fn) Dict->RaiseError = fn;
+    return old;
+}
+
+static strCollection *GetKeys(const FlatDictionary *Dict)
+{
+    size_t i;
+    strCollection *result;
+
+    if (Dict == NULL) {
+        NullPtrError("GetKeys");
+        return 0;
+    }
+    result = istrCollection.Create(Dict->count);
+    if (result == NULL)
+        return NULL;
+    for (i = 0; i < Dict->size; i++) {
+        if (ISFULL(Dict->Control[i]))
+            istrCollection.Add(result,SLOT(Dict,i)->Key);
+    }
+    return result;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                                Iterators                                       */
+/* ------------------------------------------------------------------------------ */
+static size_t GetPosition(Iterator *it)
+{
+    struct FlatDictionaryIterator *d = (struct FlatDictionaryIterator *)it;
+    return d->index;
+}
+
+static void *GetNext(Iterator *it)
+{
+    struct FlatDictionaryIterator *d = (struct FlatDictionaryIterator *)it;
+    FlatDictionary *Dict;
+    struct FlatSlot *s;
+
+    if (it == NULL) {
+        NullPtrError("GetNext");
+        return NULL;
+    }
+    Dict = d->Dict;
+    if (d->timestamp != Dict->timestamp) {
+        Dict->RaiseError("iFlatDictionary.GetNext",CONTAINER_ERROR_OBJECT_CHANGED);
+        return NULL;
+    }
+    while (d->index < Dict->size && !ISFULL(Dict->Control[d->index]))
+        d->index++;
+    if (d->index >= Dict->size)
+        return NULL;
+    s = SLOT(Dict,d->index);
+    d->index++;
+    return Dict->ElementSize ? VALUE(s) : s->Key;
+}
+
+static void *GetFirst(Iterator *it)
+{
+    struct FlatDictionaryIterator *d = (struct FlatDictionaryIterator *)it;
+
+    if (it == NULL) {
+        NullPtrError("GetFirst");
+        return NULL;
+    }
+    if (d->Dict->count == 0)
+        return NULL;
+    d->index = 0;
+    return GetNext(it);
+}
+
+/* Replaces the element returned by the last call to GetNext. Erasing
+   does not move other entries, so the iteration can go on. */
+static int ReplaceWithIterator(Iterator *it, void *data,int direction)
+{
+    struct FlatDictionaryIterator *li = (struct FlatDictionaryIterator *)it;
+    FlatDictionary *Dict;
+    size_t i;
+
+    if (it == NULL) {
+        return NullPtrError("Replace");
+    }
+    Dict = li->Dict;
+    if (Dict->Flags & CONTAINER_READONLY) {
+        Dict->RaiseError("Replace",CONTAINER_ERROR_READONLY);
+        return CONTAINER_ERROR_READONLY;
+    }
+    if (li->timestamp != Dict->timestamp) {
+        Dict->RaiseError("Replace",CONTAINER_ERROR_OBJECT_CHANGED);
+        return CONTAINER_ERROR_OBJECT_CHANGED;
+    }
+    if (li->index == 0 || !ISFULL(Dict->Control[li->index-1]))
+        return 0;
+    i = li->index - 1;
+    if (data == NULL)
+        EraseSlot(Dict,i);
+    else if (Dict->ElementSize) {
+        memcpy(VALUE(SLOT(Dict,i)),data,Dict->ElementSize);
+        Dict->timestamp++;
+    }
+    li->timestamp = Dict->timestamp;
+    return 1;
+}
+
+static void *Seek(Iterator *it, size_t idx)
+{
+    return NULL;
+}
+
+static int InitIterator(FlatDictionary *Dict,void *buf)
+{
+    struct FlatDictionaryIterator *result = buf;
+
+    if (Dict == NULL || buf == NULL) {
+        NullPtrError("InitIterator");
+        return CONTAINER_ERROR_BADARG;
+    }
+    result->it.GetNext = GetNext;
+    result->it.GetPrevious = GetNext;
+    result->it.GetFirst = GetFirst;
+    result->it.Replace = ReplaceWithIterator;
+    result->it.GetPosition = GetPosition;
+    result->it.Seek = Seek;
+    result->Dict = Dict;
+    result->index = 0;
+    result->timestamp = Dict->timestamp;
+    return 1;
+}
+
+static Iterator *NewIterator(FlatDictionary *Dict)
+{
+    struct FlatDictionaryIterator *result;
+
+    if (Dict == NULL) {
+        NullPtrError("NewIterator");
+        return NULL;
+    }
+    result = Dict->Allocator->malloc(sizeof(struct FlatDictionaryIterator));
+    if (result == NULL) {
+        NoMemoryError(Dict,"NewIterator");
+        return NULL;
+    }
+    InitIterator(Dict,result);
+    return &result->it;
+}
+
+static int DeleteIterator(Iterator *it)
+{
+    struct FlatDictionaryIterator *d = (struct FlatDictionaryIterator *)it;
+
+    if (d == NULL) {
+        return NullPtrError("DeleteIterator");
+    }
+    d->Dict->Allocator->free(it);
+    return 1;
+}
+
+static size_t SizeofIterator(const FlatDictionary *b)
+{
+    return sizeof(struct FlatDictionaryIterator);
+}
+
+static Vector *CastToArray(const FlatDictionary *Dict)
+{
+    size_t i;
+    Vector *result;
+
+    if (Dict == NULL) {
+        NullPtrError("CastToArray");
+        return NULL;
+    }
+    if (Dict->ElementSize == 0)
+        return NULL;
+    result = iVector.Create(Dict->ElementSize,Dict->count);
+    if (result == NULL)
+        return NULL;
+    for (i = 0; i < Dict->size; i++) {
+        if (ISFULL(Dict->Control[i]))
+            iVector.Add(result,VALUE(SLOT(Dict,i)));
+    }
+    return result;
+}
+
+static int Save(const FlatDictionary *Dict,FILE *stream, SaveFunction saveFn,void *arg)
+{
+    Vector *al;
+    strCollection *sc;
+    int result = 1;
+
+    if (Dict == NULL) {
+        return NullPtrError("Save");
+    }
+    if (stream == NULL) {
+        return BadArgError(Dict,"Save");
+    }
+    if (fwrite(&DictionaryGuid,sizeof(guid),1,stream) == 0) {
+        return EOF;
+    }
+    al = CastToArray(Dict);
+    sc = GetKeys(Dict);
+    if ((istrCollection.Save(sc,stream,NULL,NULL) < 0) ||
+        (iVector.Save(al,stream,saveFn,arg) < 0))
+        result = EOF;
+    istrCollection.Finalize(sc);
+    iVector.Finalize(al);
+    return result;
+}
+
+static FlatDictionary *Copy(const FlatDictionary *src)
+{
+    FlatDictionary *result;
+    size_t i;
+
+    if (src == NULL) {
+        NullPtrError("Copy");
+        return NULL;
+    }
+    result = src->Allocator->malloc(sizeof(*result));
+    if (result == NULL) {
+        NoMemoryError(src,"Copy");
+        return NULL;
+    }
+    *result = *src;
+    result->VTable = &iFlatDictionary;
+    result->Flags = (src->Flags&~CONTAINER_HAS_OBSERVER);
+    result->timestamp = 0;
+    memset(&result->Arena,0,sizeof(result->Arena));
+    if ((src->Arena.pool && StringArenaInit(&result->Arena,src->Allocator) < 0) ||
+        AllocTable(result,src->size) < 0) {
+        if (result->Arena.pool)
+            StringArenaFinalize(&result->Arena);
+        src->Allocator->free(result);
+        NoMemoryError(src,"Copy");
+        return NULL;
+    }
+    /* Same size and same hashes: the table can be copied as it is */
+    memcpy(result->Control,src->Control,src->size+GROUP_WIDTH);
+    memcpy(result->Slots,src->Slots,src->size*src->SlotSize);
+    result->Deleted = src->Deleted;
+    for (i = 0; i < src->size; i++) {
+        struct FlatSlot *s;
+        char *k;
+        if (!ISFULL(src->Control[i]))
+            continue;
+        s = SLOT(result,i);
+        k = NewKey(result,s->Key);
+        if (k == NULL) {
+            /* Drop the entries that could not be copied */
+            FreeSlot(result,i);
+            continue;
+        }
+        s->Key = k;
+    }
+    if (result->count != src->count) {
+        NoMemoryError(src,"Copy");
+        Finalize(result);
+        return NULL;
+    }
+    if (src->Flags & CONTAINER_HAS_OBSERVER)
+        iObserver.Notify(src,CCL_COPY,result,NULL);
+    return result;
+}
+
+static FlatDictionary *Load(FILE *stream, ReadFunction readFn, void *arg)
+{
+    strCollection *sc;
+    Vector *al;
+    FlatDictionary *result;
+    size_t i;
+    guid Guid;
+
+    if (stream == NULL) {
+        NullPtrError("Load");
+        return NULL;
+    }
+    if (fread(&Guid,sizeof(guid),1,stream) == 0) {
+        iError.RaiseError("iFlatDictionary.Load",CONTAINER_ERROR_FILE_READ);
+        return NULL;
+    }
+    if (memcmp(&Guid,&DictionaryGuid,sizeof(guid))) {
+        iError.RaiseError("iFlatDictionary.Load",CONTAINER_ERROR_WRONGFILE);
+        return NULL;
+    }
+    sc = istrCollection.Load(stream,NULL,NULL);
+    if (sc == NULL)
+        return NULL;
+    al = iVector.Load(stream,readFn,arg);
+    if (al == NULL) {
+        istrCollection.Finalize(sc);
+        return NULL;
+    }
+    result = Create(iVector.GetElementSize(al),istrCollection.Size(sc));
+    for (i=0; result && i<istrCollection.Size(sc);i++) {
+        char *key = istrCollection.GetElement(sc,i);
+        add_nd(result,key,HashKey(result,key),iVector.GetElement(al,i),0);
+    }
+    istrCollection.Finalize(sc);
+    iVector.Finalize(al);
+    return result;
+}
+
+static size_t GetElementSize(const FlatDictionary *d)
+{
+    if (d == NULL) {
+        NullPtrError("GetElementSize");
+        return 0;
+    }
+    return d->ElementSize;
+}
+
+static const ContainerAllocator *GetAllocator(const FlatDictionary *AL)
+{
+    if (AL == NULL) {
+        return NULL;
+    }
+    return AL->Allocator;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     InitWithAllocator ID:1
+ Purpose:       Initializes a dictionary object. The storage must be
+                at least Sizeof(NULL) bytes.
+ Input:         The storage, the element size, a hint for the number
+                of elements and the allocator to use
+ Output:        A pointer to the initialized dictionary
+ Errors:        If no more memory is available returns NULL
+------------------------------------------------------------------------*/
+static FlatDictionary *InitWithAllocator(FlatDictionary *Dict,size_t elementsize,size_t hint,const ContainerAllocator *allocator)
+{
+    size_t size = MIN_SIZE;
+
+    memset(Dict,0,sizeof(*Dict));
+    Dict->MaxLoadFactor = DEFAULT_MAX_LOAD_FACTOR;
+    while (size*Dict->MaxLoadFactor < hint && size < (((size_t)-1) >> 2))
+        size *= 2;
+    Dict->VTable = &iFlatDictionary;
+    Dict->ElementSize = elementsize;
+    Dict->SlotSize = roundup(VALUE_OFFSET + elementsize);
+    Dict->Allocator = allocator;
+    Dict->RaiseError = iError.RaiseError;
+    Dict->hash = hash;
+    if (AllocTable(Dict,size) < 0)
+        return NULL;
+    return Dict;
+}
+
+static FlatDictionary *Init(FlatDictionary *dict,size_t elementsize,size_t hint)
+{
+    return InitWithAllocator(dict, elementsize, hint, CurrentAllocator);
+}
+
+static FlatDictionary *CreateWithAllocator(size_t elementsize,size_t hint,const ContainerAllocator *allocator)
+{
+    FlatDictionary *Dict,*result;
+
+    Dict = allocator->malloc(sizeof(FlatDictionary));
+    if (Dict == NULL) {
+        iError.RaiseError("iFlatDictionary.Create",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    result = InitWithAllocator(Dict,elementsize,hint,allocator);
+    if (result == NULL)
+        allocator->free(Dict);
+    return result;
+}
+
+static FlatDictionary *Create(size_t elementsize,size_t hint)
+{
+    return CreateWithAllocator(elementsize,hint,CurrentAllocator);
+}
+
+static FlatDictionary *InitializeWith(size_t elementSize,size_t n, const char **Keys,const void *Values)
+{
+    FlatDictionary *result = Create(elementSize,n);
+    size_t i;
+    const char *pValues = Values;
+
+    if (result) {
+        for (i = 0; i < n; i++) {
+            add_nd(result,Keys[i],HashKey(result,Keys[i]),pValues,0);
+            if (pValues)
+                pValues += elementSize;
+        }
+    }
+    return result;
+}
+
+static DestructorFunction SetDestructor(FlatDictionary *cb,DestructorFunction fn)
+{
+    DestructorFunction oldfn;
+    if (cb == NULL)
+        return NULL;
+    oldfn = cb->DestructorFn;
+    if (fn)
+        cb->DestructorFn = fn;
+    return oldfn;
+}
+
+static void HashAllKeys(FlatDictionary *d)
+{
+    size_t i;
+
+    for (i = 0; i < d->size; i++) {
+        if (ISFULL(d->Control[i]))
+            SLOT(d,i)->Hash = HashKey(d,SLOT(d,i)->Key);
+    }
+}
+
+/* The hashes are stored in the table: changing the function or the seed
+   means hashing all keys again. */
+static int ChangeHashing(FlatDictionary *d,HashFunction fn,uint64_t Seed)
+{
+    HashFunction oldFn = d->hash;
+    uint64_t oldSeed = d->Seed;
+
+    d->hash = fn;
+    d->Seed = Seed;
+    HashAllKeys(d);
+    if (d->count && Rehash(d,d->size) < 0) {
+        /* Could not move the entries: restore the old hashes */
+        d->hash = oldFn;
+        d->Seed = oldSeed;
+        HashAllKeys(d);
+        return -1;
+    }
+    return 1;
+}
+
+static HashFunction SetHashFunction(FlatDictionary *d,HashFunction newFn)
+{
+    HashFunction old;
+
+    if (d == NULL) {
+        return hash;
+    }
+    if (newFn == NULL)
+        return d->hash;
+    old = d->hash;
+    if (newFn == old && d->Seed == 0)
+        return old;
+    if (ChangeHashing(d,newFn,0) < 0)
+        NoMemoryError(d,"SetHashFunction");
+    return old;
+}
+
+/* See SetSeed in dictionarygen.c */
+static int SetSeed(FlatDictionary *d,uint64_t Seed)
+{
+    if (d == NULL)
+        return NullPtrError("SetSeed");
+    if (d->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(d,"SetSeed");
+    if (ChangeHashing(d,d->hash,Seed ? Seed : iHashFunctions.RandomSeed()) < 0)
+        return NoMemoryError(d,"SetSeed");
+    return 1;
+}
+
+static double GetLoadFactor(FlatDictionary *d)
+{
+    return ((double)d->count)/d->size;
+}
+
+/* The table must keep at least one empty slot, so the limit must be
+   strictly between zero and one. */
+static double SetMaxLoadFactor(FlatDictionary *d,double newMax)
+{
+    double old;
+
+    if (d == NULL) {
+        NullPtrError("SetMaxLoadFactor");
+        return 0;
+    }
+    old = d->MaxLoadFactor;
+    if (newMax <= 0 || newMax >= 1) {
+        BadArgError(d,"SetMaxLoadFactor");
+        return old;
+    }
+    d->MaxLoadFactor = newMax;
+    return old;
+}
+
+#define BATCH_SIZE 16
+/* Looks up at most BATCH_SIZE keys: the control groups and the first
+   candidate slots of all keys are prefetched before any is searched */
+static int LookupGroup(const FlatDictionary *Dict,size_t m,const char **Keys,size_t *Found)
+{
+    size_t h[BATCH_SIZE],pos[BATCH_SIZE];
+    size_t j,mask = Dict->size - 1;
+
+    for (j = 0; j < m; j++) {
+        if (Keys[j] == NULL)
+            return -1;
+        h[j] = HashKey(Dict,Keys[j]);
+        pos[j] = (Mix(h[j]) >> 7) & mask;
+        CCL_PREFETCH(Dict->Control + pos[j]);
+    }
+    for (j = 0; j < m; j++)
+        CCL_PREFETCH(SLOT(Dict,pos[j]));
+    for (j = 0; j < m; j++)
+        Found[j] = FindSlot(Dict,Keys[j],h[j]);
+    return 0;
+}
+
+static int GetElements(const FlatDictionary *Dict,size_t n,const char **Keys,void **Results)
+{
+    size_t Found[BATCH_SIZE];
+    size_t i,j,m;
+    int found = 0;
+
+    if (Dict == NULL)
+        return NullPtrError("GetElements");
+    if (n && (Keys == NULL || Results == NULL))
+        return BadArgError(Dict,"GetElements");
+    if (Dict->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(Dict,"GetElements");
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+        if (LookupGroup(Dict,m,Keys+i,Found) < 0)
+            return BadArgError(Dict,"GetElements");
+        for (j = 0; j < m; j++) {
+            if (Found[j] != NOT_FOUND) {
+                struct FlatSlot *s = SLOT(Dict,Found[j]);
+                Results[i+j] = Dict->ElementSize ? VALUE(s) : s->Key;
+                found++;
+            }
+            else Results[i+j] = NULL;
+        }
+    }
+    return found;
+}
+
+static int ContainsMany(const FlatDictionary *Dict,size_t n,const char **Keys,unsigned char *Results)
+{
+    size_t Found[BATCH_SIZE];
+    size_t i,j,m;
+    int found = 0;
+
+    if (Dict == NULL)
+        return NullPtrError("ContainsMany");
+    if (n && (Keys == NULL || Results == NULL))
+        return BadArgError(Dict,"ContainsMany");
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+        if (LookupGroup(Dict,m,Keys+i,Found) < 0)
+            return BadArgError(Dict,"ContainsMany");
+        for (j = 0; j < m; j++) {
+            Results[i+j] = Found[j] != NOT_FOUND;
+            found += Results[i+j];
+        }
+    }
+    return found;
+}
+
+static Dictionary *Freeze(const FlatDictionary *Dict)
+{
+    const char **keys;
+    const void **values;
+    size_t i,n = 0;
+    Dictionary *result;
+
+    if (Dict == NULL) {
+        NullPtrError("Freeze");
+        return NULL;
+    }
+    keys = Dict->Allocator->malloc((Dict->count+1)*sizeof(char *));
+    values = Dict->Allocator->malloc((Dict->count+1)*sizeof(void *));
+    if (keys == NULL || values == NULL) {
+        if (keys) Dict->Allocator->free(keys);
+        if (values) Dict->Allocator->free(values);
+        NoMemoryError(Dict,"Freeze");
+        return NULL;
+    }
+    for (i = 0; i < Dict->size; i++) {
+        struct FlatSlot *s;
+        if (!ISFULL(Dict->Control[i]))
+            continue;
+        s = SLOT(Dict,i);
+        keys[n] = s->Key;
+        values[n++] = Dict->ElementSize ? VALUE(s) : NULL;
+    }
+    result = FreezeDictionary(n,keys,values,Dict->ElementSize,Dict->Allocator);
+    Dict->Allocator->free(keys);
+    Dict->Allocator->free(values);
+    return result;
+}
+
+/* The snapshot is the one of the frozen dictionary */
+static int SaveSnapshot(const FlatDictionary *Dict,FILE *stream)
+{
+    Dictionary *frozen;
+    int result;
+
+    if (Dict == NULL)
+        return NullPtrError("SaveSnapshot");
+    if (stream == NULL)
+        return BadArgError(Dict,"SaveSnapshot");
+    frozen = Freeze(Dict);
+    if (frozen == NULL)
+        return CONTAINER_ERROR_NOMEMORY;
+    result = SaveFrozenSnapshot((struct FrozenDictionary *)frozen,stream);
+    iFrozenDictionary.Finalize(frozen);
+    return result;
+}
+
+/* See UseKeyArena in dictionarygen.c */
+static int UseKeyArena(FlatDictionary *Dict,Dictionary *InternTable)
+{
+    if (Dict == NULL)
+        return NullPtrError("UseKeyArena");
+    if (Dict->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(Dict,"UseKeyArena");
+    if (InternTable == (Dictionary *)Dict ||
+        (InternTable && InternTable->VTable->GetElementSize(InternTable) != 0))
+        return BadArgError(Dict,"UseKeyArena");
+    if (Dict->count)
+        return doerrorCall(Dict->RaiseError,"UseKeyArena",CONTAINER_ERROR_NOT_EMPTY);
+    Dict->InternTable = InternTable;
+    if (InternTable) {
+        if (Dict->Arena.pool)
+            StringArenaFinalize(&Dict->Arena);
+    }
+    else if (Dict->Arena.pool == NULL &&
+             StringArenaInit(&Dict->Arena,Dict->Allocator) < 0)
+        return NoMemoryError(Dict,"UseKeyArena");
+    return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     GetStatistics ID:1
+ Purpose:       Measures the probe sequences. The probe length of an
+                entry is the number of groups of control bytes read by
+                FindSlot to reach it.
+ Input:         The dictionary and the statistics to fill
+ Output:        1 or a negative error code
+ Errors:        BADARG if an argument is NULL
+------------------------------------------------------------------------*/
+static int GetStatistics(const FlatDictionary *Dict,HashStatistics *Stats)
+{
+    size_t i,pos,step,groups,mask;
+    struct FlatSlot *s;
+
+    if (Dict == NULL)
+        return NullPtrError("GetStatistics");
+    if (Stats == NULL)
+        return BadArgError(Dict,"GetStatistics");
+    HashStatsInit(Stats,Dict->size);
+    mask = Dict->size - 1;
+    for (i = 0; i < Dict->size; i++) {
+        if (Dict->Control[i] == CTRL_DELETED)
+            Stats->DeletedSlots++;
+        if (!ISFULL(Dict->Control[i]))
+            continue;
+        s = SLOT(Dict,i);
+        pos = (Mix(s->Hash) >> 7) & mask;
+        for (step = 0, groups = 1; ((i - pos) & mask) >= GROUP_WIDTH; groups++) {
+            step += GROUP_WIDTH;
+            pos = (pos + step) & mask;
+        }
+        HashStatsProbe(Stats,groups);
+        Stats->KeyBytes += strlen(s->Key)+1;
+    }
+    Stats->Resizes = Dict->Resizes;
+    HashStatsFinish(Stats,Dict->ElementSize,Sizeof(Dict));
+    return 1;
+}
+
+DictionaryInterface iFlatDictionary = {
+    (size_t (*)(const Dictionary *))Size,
+    (unsigned (*)(const Dictionary *))GetFlags,
+    (unsigned (*)(Dictionary *,unsigned))SetFlags,
+    (int (*)(Dictionary *))Clear,
+    (int (*)(const Dictionary *,const char *))Contains,
+    (int (*)(Dictionary *,const char *))Erase,
+    (int (*)(Dictionary *))Finalize,
+    (int (*)(Dictionary *,int (*)(const char *,const void *,void *),void *))Apply,
+    (int (*)(const Dictionary *,const Dictionary *))Equal,
+    (Dictionary *(*)(const Dictionary *))Copy,
+    (ErrorFunction (*)(Dictionary *,ErrorFunction))SetErrorFunction,
+    (size_t (*)(const Dictionary *))Sizeof,
+    (Iterator *(*)(Dictionary *))NewIterator,
+    (int (*)(Dictionary *,void *))InitIterator,
+    DeleteIterator,
+    (size_t (*)(const Dictionary *))SizeofIterator,
+    (int (*)(const Dictionary *,FILE *,SaveFunction,void *))Save,
+    (Dictionary *(*)(FILE *,ReadFunction,void *))Load,
+    (size_t (*)(const Dictionary *))GetElementSize,
+    (int (*)(Dictionary *,const char *,const void *))Add,
+    (void *(*)(const Dictionary *,const char *))GetElement,
+    (int (*)(Dictionary *,const char *,const void *))Replace,
+    (int (*)(Dictionary *,const char *,const void *))Insert,
+    (Vector *(*)(const Dictionary *))CastToArray,
+    (int (*)(const Dictionary *,const char *,void *))CopyElement,
+    (int (*)(Dictionary *,Dictionary *))InsertIn,
+    (Dictionary *(*)(size_t,size_t))Create,
+    (Dictionary *(*)(size_t,size_t,const ContainerAllocator *))CreateWithAllocator,
+    (Dictionary *(*)(Dictionary *,size_t,size_t))Init,
+    (Dictionary *(*)(Dictionary *,size_t,size_t,const ContainerAllocator *))InitWithAllocator,
+    (strCollection *(*)(const Dictionary *))GetKeys,
+    (const ContainerAllocator *(*)(const Dictionary *))GetAllocator,
+    (DestructorFunction (*)(Dictionary *,DestructorFunction))SetDestructor,
+    (Dictionary *(*)(size_t,size_t,const char **,const void *))InitializeWith,
+    (HashFunction (*)(Dictionary *,HashFunction))SetHashFunction,
+    (double (*)(Dictionary *))GetLoadFactor,
+    (double (*)(Dictionary *,double))SetMaxLoadFactor,
+    (int (*)(const Dictionary *,size_t,const char **,void **))GetElements,
+    (int (*)(const Dictionary *,size_t,const char **,unsigned char *))ContainsMany,
+    (Dictionary *(*)(const Dictionary *))Freeze,
+    FreezeStrCollection,
+    (int (*)(const Dictionary *,FILE *))SaveSnapshot,
+    OpenDictionarySnapshot,
+    (int (*)(Dictionary *,Dictionary *))UseKeyArena,
+    (int (*)(Dictionary *,uint64_t))SetSeed,
+    (int (*)(const Dictionary *,HashStatistics *))GetStatistics,
+};
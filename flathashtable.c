@@ -0,0 +1,1447 @@
+/*------------------------------------------------------------------------
+ Module:        flathashtable.c
+ Author:        jacob
+ Project:       Containers
+ State:
+ Creation Date:
+ Description:   This file implements the HashTable interface with a
+                Robin Hood open addressing table instead of chained
+                entries. Each slot holds the hash, the key pointer and
+                length and the value, so a lookup reads consecutive
+                slots and follows no list pointer.
+                When an entry is inserted it takes the slot of any
+                entry that is nearer to its home slot than the new one
+                (the "rich" entry gives its place to the "poor" one)
+                and that entry goes on looking for a place. The
+                distances from the home slots stay short and even, and
+                a lookup stops as soon as it meets an entry nearer to
+                its home than the key being looked up would be.
+                Erasing an entry shifts back the entries that follow it
+                instead of leaving a deleted marker.
+                As in iHashTable the keys are not copied: the table
+                keeps the pointers given to Add. The values live in the
+                table: a pointer returned by GetElement is valid only
+                until the next Add or Erase, since Add can grow the
+                table and Erase shifts the entries back.
+------------------------------------------------------------------------*/
+#include <stddef.h>
+#include "containers.h"
+#include "ccl_internal.h"
+
+typedef struct FlatHashTable FlatHashTable;
+
+#define NOT_FOUND        ((size_t)-1)
+#define MIN_SIZE         16
+#define MAX_LOAD_FACTOR  0.875
+/* An entry farther than this from its home slot makes the table grow,
+   unless the table is mostly empty: then the keys collide because of
+   the hash function, and more slots would not help */
+#define MAX_PROBE_LENGTH 64
+/* Erase shrinks the table when less than one slot in 8 is used */
+#define SHRINK_RATIO     8
+
+#define VALUE_OFFSET    roundup(sizeof(struct FlatHashSlot))
+#define SLOT(t,i)       ((struct FlatHashSlot *)((t)->Slots + (i)*(t)->SlotSize))
+#define VALUE(s)        ((char *)(s) + VALUE_OFFSET)
+#define DISTANCE(t,i,s) (((i) - (size_t)(s)->hash) & ((t)->size - 1))
+
+static const guid FlatHashTableGuid = {0x6b8e2f41, 0x3c7a, 0x4d1a,
+{0xa5,0x62,0x1e,0x90,0xc4,0x3b,0x7d,0x58}
+};
+
+static FlatHashTable *Create(size_t ElementSize);
+static int Finalize(FlatHashTable *ht);
+
+static int doerrorCall(ErrorFunction err,const char *fnName,int code)
+{
+    char buf[256];
+
+    snprintf(buf,sizeof(buf),"iFlatHashTable.%s",fnName);
+    err(buf,code);
+    return code;
+}
+
+static int NullPtrError(const char *fnName)
+{
+    return doerrorCall(iError.RaiseError,fnName,CONTAINER_ERROR_BADARG);
+}
+
+static int BadArgError(const FlatHashTable *ht,const char *fnName)
+{
+    return doerrorCall(ht->RaiseError,fnName,CONTAINER_ERROR_BADARG);
+}
+
+static int ReadOnlyError(const FlatHashTable *ht,const char *fnName)
+{
+    return doerrorCall(ht->RaiseError,fnName,CONTAINER_ERROR_READONLY);
+}
+
+static int NoMemoryError(const FlatHashTable *ht,const char *fnName)
+{
+    return doerrorCall(ht->RaiseError,fnName,CONTAINER_ERROR_NOMEMORY);
+}
+
+/* Same function as iHashTable: times 33 over the bytes of the key */
+static uint64_t DefaultHashFunction(const char *char_key,size_t *klen)
+{
+    uint64_t hash = 0;
+    const unsigned char *p = (const unsigned char *)char_key;
+    size_t i;
+
+    if (*klen == (size_t)-1) {
+        for (; *p; p++)
+            hash = hash * 33 + *p;
+        *klen = p - (const unsigned char *)char_key;
+    }
+    else {
+        for (i = *klen; i; i--, p++)
+            hash = hash * 33 + *p;
+    }
+    return hash;
+}
+
+/* The user hash function can have weak low bits, and the home slot is
+   taken from them: the stored hash is a mixed copy */
+static uint64_t Mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static uint64_t HashKey(const FlatHashTable *ht,const void *key,size_t *klen)
+{
+    if (ht->Seed) {
+        if (*klen == (size_t)-1)
+            *klen = strlen(key);
+        return Mix(iHashFunctions.Hash64(key,*klen,ht->Seed));
+    }
+    return Mix(ht->Hash(key,klen));
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     FindSlot ID:1
+ Purpose:       Finds the slot of a key. The probe stops at an empty
+                slot, at an entry nearer to its home slot than the key
+                would be, or after the longest distance in the table.
+ Input:         The table, the key, its length and its (mixed) hash
+ Output:        The slot index or NOT_FOUND
+ Errors:        None
+------------------------------------------------------------------------*/
+static size_t FindSlot(const FlatHashTable *ht,const void *key,size_t klen,uint64_t h)
+{
+    size_t mask = ht->size - 1, i = (size_t)h & mask, d;
+    struct FlatHashSlot *s;
+
+    for (d = 0; d <= ht->MaxProbe; d++, i = (i + 1) & mask) {
+        s = SLOT(ht,i);
+        if (s->key == NULL || DISTANCE(ht,i,s) < d)
+            break;
+        if (s->hash == h && s->klen == klen && memcmp(s->key,key,klen) == 0)
+            return i;
+    }
+    return NOT_FOUND;
+}
+
+/* Places the entry held in the first spare slot. Every entry met that is
+   nearer to its home slot than the carried one is swapped with it. */
+static void PutEntry(FlatHashTable *ht)
+{
+    size_t mask = ht->size - 1,d = 0,sd,i;
+    char *e = ht->Spare,*tmp = ht->Spare + ht->SlotSize;
+    struct FlatHashSlot *s;
+
+    i = (size_t)((struct FlatHashSlot *)e)->hash & mask;
+    for (;; d++, i = (i + 1) & mask) {
+        s = SLOT(ht,i);
+        if (s->key == NULL) {
+            memcpy(s,e,ht->SlotSize);
+            break;
+        }
+        sd = DISTANCE(ht,i,s);
+        if (sd < d) {
+            memcpy(tmp,s,ht->SlotSize);
+            memcpy(s,e,ht->SlotSize);
+            memcpy(e,tmp,ht->SlotSize);
+            if (d > ht->MaxProbe)
+                ht->MaxProbe = d;
+            d = sd;
+        }
+    }
+    if (d > ht->MaxProbe)
+        ht->MaxProbe = d;
+}
+
+static char *AllocSlots(const FlatHashTable *ht,size_t size)
+{
+    char *slots = ht->Allocator->malloc(size * ht->SlotSize);
+    size_t i;
+
+    if (slots) {
+        for (i = 0; i < size; i++)
+            ((struct FlatHashSlot *)(slots + i*ht->SlotSize))->key = NULL;
+    }
+    return slots;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Rehash ID:1
+ Purpose:       Moves all entries into a new table of the given size.
+                The stored hashes are used: no key is read.
+ Input:         The table and the new size (a power of two larger than
+                the number of entries)
+ Output:        1 or a negative error code
+ Errors:        NOMEMORY. The table is unchanged.
+------------------------------------------------------------------------*/
+static int Rehash(FlatHashTable *ht,size_t newSize)
+{
+    char *old = ht->Slots,*slots;
+    size_t oldSize = ht->size,i;
+    struct FlatHashSlot *s;
+
+    slots = AllocSlots(ht,newSize);
+    if (slots == NULL)
+        return CONTAINER_ERROR_NOMEMORY;
+    ht->Slots = slots;
+    ht->size = newSize;
+    ht->MaxProbe = 0;
+    for (i = 0; i < oldSize; i++) {
+        s = (struct FlatHashSlot *)(old + i*ht->SlotSize);
+        if (s->key == NULL)
+            continue;
+        memcpy(ht->Spare,s,ht->SlotSize);
+        PutEntry(ht);
+    }
+    ht->Allocator->free(old);
+    ht->timestamp++;
+    if (newSize != oldSize)
+        ht->Resizes++;
+    return 1;
+}
+
+/* Adds an entry whose key is not in the table */
+static int NewEntry(FlatHashTable *ht,const void *key,size_t klen,uint64_t h,const void *val)
+{
+    struct FlatHashSlot *e = (struct FlatHashSlot *)ht->Spare;
+
+    if (ht->count + 1 > MAX_LOAD_FACTOR * ht->size &&
+        Rehash(ht,2*ht->size) < 0)
+        return NoMemoryError(ht,"Add");
+    e->hash = h;
+    e->key = key;
+    e->klen = klen;
+    if (ht->ElementSize) {
+        if (val)
+            memcpy(VALUE(e),val,ht->ElementSize);
+        else memset(VALUE(e),0,ht->ElementSize);
+    }
+    PutEntry(ht);
+    ht->count++;
+    ht->timestamp++;
+    if (ht->MaxProbe > MAX_PROBE_LENGTH && ht->count > ht->size/8)
+        Rehash(ht,2*ht->size);
+    return 1;
+}
+
+/* Removes the entry at slot i, moving back the entries that follow it
+   until an empty slot or an entry at its home slot */
+static void RemoveSlot(FlatHashTable *ht,size_t i)
+{
+    size_t mask = ht->size - 1,j = (i + 1) & mask;
+    struct FlatHashSlot *s;
+
+    if (ht->DestructorFn)
+        ht->DestructorFn(VALUE(SLOT(ht,i)));
+    for (;;) {
+        s = SLOT(ht,j);
+        if (s->key == NULL || DISTANCE(ht,j,s) == 0)
+            break;
+        memcpy(SLOT(ht,i),s,ht->SlotSize);
+        i = j;
+        j = (j + 1) & mask;
+    }
+    SLOT(ht,i)->key = NULL;
+    ht->count--;
+    ht->timestamp++;
+}
+
+static size_t Size(const FlatHashTable *ht)
+{
+    if (ht == NULL) {
+        NullPtrError("Size");
+        return 0;
+    }
+    return ht->count;
+}
+
+static unsigned GetFlags(const FlatHashTable *ht)
+{
+    if (ht == NULL) {
+        NullPtrError("GetFlags");
+        return 0;
+    }
+    return ht->Flags;
+}
+
+static unsigned SetFlags(FlatHashTable *ht,unsigned newval)
+{
+    unsigned oldval;
+
+    if (ht == NULL) {
+        NullPtrError("SetFlags");
+        return 0;
+    }
+    oldval = ht->Flags;
+    ht->Flags = newval;
+    return oldval;
+}
+
+/* The smallest power of two that holds n entries under the maximum load
+   factor */
+static size_t SizeFor(size_t n)
+{
+    size_t size = MIN_SIZE;
+
+    while (size*MAX_LOAD_FACTOR < n)
+        size *= 2;
+    return size;
+}
+
+/* Add grows the table at 7/8 of the slots, Erase shrinks it below 1/8,
+   to half the maximum load: a table whose size goes up and down around
+   some value isn't rehashed each time. */
+static void ShrinkIfSparse(FlatHashTable *ht)
+{
+    size_t n = 2*ht->count,size;
+
+    if (ht->size == MIN_SIZE || ht->count >= ht->size/SHRINK_RATIO)
+        return;
+    size = SizeFor(n > ht->Reserved ? n : ht->Reserved);
+    if (size < ht->size)
+        Rehash(ht,size);
+}
+
+static int Clear(FlatHashTable *ht)
+{
+    size_t i;
+    struct FlatHashSlot *s;
+
+    if (ht == NULL)
+        return NullPtrError("Clear");
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"Clear");
+    for (i = 0; i < ht->size; i++) {
+        s = SLOT(ht,i);
+        if (s->key) {
+            if (ht->DestructorFn)
+                ht->DestructorFn(VALUE(s));
+            s->key = NULL;
+        }
+    }
+    ht->count = 0;
+    ht->MaxProbe = 0;
+    ht->timestamp++;
+    /* No key is left in the pool of Load */
+    if (ht->KeyPool) {
+        iPool.Finalize(ht->KeyPool);
+        ht->KeyPool = NULL;
+    }
+    if (SizeFor(ht->Reserved) < ht->size)
+        Rehash(ht,SizeFor(ht->Reserved));
+    return 1;
+}
+
+static void *GetElement(const FlatHashTable *ht,const void *key,size_t klen)
+{
+    uint64_t h;
+    size_t i;
+
+    if (ht == NULL || key == NULL || klen == 0) {
+        NullPtrError("GetElement");
+        return NULL;
+    }
+    h = HashKey(ht,key,&klen);
+    i = FindSlot(ht,key,klen,h);
+    if (i == NOT_FOUND)
+        return NULL;
+    return VALUE(SLOT(ht,i));
+}
+
+static int Contains(const FlatHashTable *ht,const void *key,size_t klen)
+{
+    uint64_t h;
+
+    if (ht == NULL)
+        return NullPtrError("Contains");
+    if (key == NULL)
+        return BadArgError(ht,"Contains");
+    h = HashKey(ht,key,&klen);
+    return FindSlot(ht,key,klen,h) != NOT_FOUND;
+}
+
+/* Adds the key. Returns 1 if the key was added, zero if it was already
+   there: as in iHashTable its value is not changed. */
+static int Add(FlatHashTable *ht,const void *key,size_t klen,const void *val)
+{
+    uint64_t h;
+
+    if (ht == NULL || key == NULL || klen == 0)
+        return NullPtrError("Add");
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"Add");
+    h = HashKey(ht,key,&klen);
+    if (FindSlot(ht,key,klen,h) != NOT_FOUND)
+        return 0;
+    return NewEntry(ht,key,klen,h,val);
+}
+
+static int Replace(FlatHashTable *ht,const void *key,size_t klen,const void *val)
+{
+    uint64_t h;
+    size_t i;
+
+    if (ht == NULL || val == NULL || key == NULL || klen == 0)
+        return NullPtrError("Replace");
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"Replace");
+    h = HashKey(ht,key,&klen);
+    i = FindSlot(ht,key,klen,h);
+    if (i == NOT_FOUND)
+        return 0;
+    memcpy(VALUE(SLOT(ht,i)),val,ht->ElementSize);
+    return 1;
+}
+
+static int Erase(FlatHashTable *ht,const void *key,size_t klen)
+{
+    uint64_t h;
+    size_t i;
+
+    if (ht == NULL || key == NULL)
+        return NullPtrError("Erase");
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"Erase");
+    h = HashKey(ht,key,&klen);
+    i = FindSlot(ht,key,klen,h);
+    if (i == NOT_FOUND)
+        return 0;
+    RemoveSlot(ht,i);
+    ShrinkIfSparse(ht);
+    return 1;
+}
+
+/* Calls the function for each entry until it returns zero. Returns zero
+   if the scan was stopped, 1 otherwise. */
+static int Search(FlatHashTable *ht,int (*comp)(void *rec,const void *key,size_t klen,const void *value),void *rec)
+{
+    size_t i;
+    struct FlatHashSlot *s;
+
+    if (ht == NULL || comp == NULL)
+        return NullPtrError("Search");
+    for (i = 0; i < ht->size; i++) {
+        s = SLOT(ht,i);
+        if (s->key && (*comp)(rec,s->key,s->klen,VALUE(s)) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+static int Apply(FlatHashTable *ht,int (*Applyfn)(void *Key,size_t klen,void *data,void *arg),void *arg)
+{
+    size_t i;
+    struct FlatHashSlot *s;
+
+    if (ht == NULL || Applyfn == NULL)
+        return NullPtrError("Apply");
+    for (i = 0; i < ht->size; i++) {
+        s = SLOT(ht,i);
+        if (s->key && (*Applyfn)((void *)s->key,s->klen,VALUE(s),arg) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Scan ID:1
+ Purpose:       Visits the table in slices, so that a large table can
+                be scanned while it goes on changing between the
+                slices. Each call visits all the entries of a home
+                slot at once until Count
+                entries were given to the callback, and stores in
+                Cursor the home slot where the next call starts. Every
+                entry that stays in the table during the whole scan
+                is visited at least once, even if the table is resized
+                between two calls; entries added or erased during the
+                scan may be visited or not. The table must not change
+                during a call: the changes are made between two calls.
+                A scan starts with a cursor of zero.
+ Input:         The table, the cursor, the number of entries wanted,
+                the callback and its argument. A callback that returns
+                zero ends the slice; the next call visits that home
+                slot again.
+ Output:        1 if the scan goes on, 0 when it is complete (the
+                cursor is back to zero), a negative error code
+ Errors:        BADARG if the table, the cursor or the callback is NULL
+------------------------------------------------------------------------*/
+static int Scan(FlatHashTable *ht,size_t *Cursor,size_t Count,int (*Scanfn)(void *Key,size_t klen,void *data,void *arg),void *arg)
+{
+    size_t mask,v,i,d,sd,n = 0,buckets = 0;
+    struct FlatHashSlot *s;
+
+    if (ht == NULL || Cursor == NULL || Scanfn == NULL)
+        return NullPtrError("Scan");
+    mask = ht->size - 1;
+    v = *Cursor;
+    do {
+        /* The entries of a home slot follow each other, after the
+           entries of the previous home slots */
+        i = v & mask;
+        for (d = 0; d <= ht->MaxProbe; d++, i = (i + 1) & mask) {
+            s = SLOT(ht,i);
+            if (s->key == NULL || (sd = DISTANCE(ht,i,s)) < d)
+                break;
+            if (sd > d)
+                continue;
+            if ((*Scanfn)((void *)s->key,s->klen,VALUE(s),arg) == 0) {
+                *Cursor = v;
+                return 1;
+            }
+            n++;
+        }
+        v = HashScanNext(v,mask);
+    } while (v && n < Count && ++buckets < HASH_SCAN_BUCKETS*Count);
+    *Cursor = v;
+    return v != 0;
+}
+
+static ErrorFunction SetErrorFunction(FlatHashTable *ht,ErrorFunction fn)
+{
+    ErrorFunction old;
+
+    if (ht == NULL)
+        return iError.RaiseError;
+    old = ht->RaiseError;
+    ht->RaiseError = (fn) ? fn : iError.EmptyErrorFunction;
+    return old;
+}
+
+static size_t Sizeof(const FlatHashTable *ht)
+{
+    if (ht == NULL)
+        return sizeof(FlatHashTable);
+    return sizeof(FlatHashTable) + (ht->size+2)*ht->SlotSize;
+}
+
+static size_t GetElementSize(const FlatHashTable *ht)
+{
+    if (ht == NULL) {
+        NullPtrError("GetElementSize");
+        return 0;
+    }
+    return ht->ElementSize;
+}
+
+/* Changes the number of slots to the smallest power of two that is at
+   least newSize and holds the entries under the maximum load factor.
+   Zero doubles the table. */
+static int Resize(FlatHashTable *ht,size_t newSize)
+{
+    size_t size = MIN_SIZE;
+
+    if (ht == NULL)
+        return NullPtrError("Resize");
+    if (newSize == 0)
+        newSize = 2*ht->size;
+    while (size < newSize || size*MAX_LOAD_FACTOR < ht->count)
+        size *= 2;
+    if (size != ht->size && Rehash(ht,size) < 0)
+        return NoMemoryError(ht,"Resize");
+    return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Reserve ID:1
+ Purpose:       Makes room for n entries at once, so that adding them
+                doesn't rehash the table several times. Erase won't
+                shrink the table below that until ShrinkToFit.
+ Input:         The table and the number of entries
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG if the table is NULL, NOMEMORY
+------------------------------------------------------------------------*/
+static int Reserve(FlatHashTable *ht,size_t n)
+{
+    size_t size;
+
+    if (ht == NULL)
+        return NullPtrError("Reserve");
+    ht->Reserved = n;
+    size = SizeFor(n);
+    if (size > ht->size && Rehash(ht,size) < 0)
+        return NoMemoryError(ht,"Reserve");
+    return 1;
+}
+
+/* See BuildFrom in hashtable.c. The slots are allocated once for all
+   the keys, and the keys are added one after the other. */
+static FlatHashTable *BuildFrom(size_t ElementSize,size_t n,const void **Keys,const size_t *klens,const void *Values)
+{
+    FlatHashTable *ht;
+    size_t i;
+
+    if (n && Keys == NULL) {
+        NullPtrError("BuildFrom");
+        return NULL;
+    }
+    ht = Create(ElementSize);
+    if (ht == NULL)
+        return NULL;
+    if (Reserve(ht,n) < 0)
+        goto err;
+    for (i = 0; i < n; i++) {
+        if (Add(ht,Keys[i],klens ? klens[i] : (size_t)-1,
+                Values ? (const char *)Values + i*ElementSize : NULL) < 0)
+            goto err;
+    }
+    ht->Reserved = 0;
+    return ht;
+err:
+    Finalize(ht);
+    return NULL;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     ShrinkToFit ID:1
+ Purpose:       Rehashes the table into the smallest size that holds
+                its entries and cancels Reserve. The keys read by Load
+                are copied into a new pool, releasing the erased ones.
+ Input:         The table
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG if the table is NULL, NOMEMORY
+------------------------------------------------------------------------*/
+static int ShrinkToFit(FlatHashTable *ht)
+{
+    size_t size,i;
+    struct FlatHashSlot *s;
+    Pool *pool;
+    void *key;
+
+    if (ht == NULL)
+        return NullPtrError("ShrinkToFit");
+    ht->Reserved = 0;
+    size = SizeFor(ht->count);
+    if (size != ht->size && Rehash(ht,size) < 0)
+        return NoMemoryError(ht,"ShrinkToFit");
+    if (ht->KeyPool) {
+        pool = iPool.Create((ContainerAllocator *)ht->Allocator);
+        if (pool == NULL)
+            return NoMemoryError(ht,"ShrinkToFit");
+        for (i = 0; i < ht->size; i++) {
+            s = SLOT(ht,i);
+            if (s->key == NULL)
+                continue;
+            key = iPool.Alloc(pool,s->klen);
+            if (key == NULL) {
+                iPool.Finalize(pool);
+                return NoMemoryError(ht,"ShrinkToFit");
+            }
+            memcpy(key,s->key,s->klen);
+            s->key = key;
+        }
+        iPool.Finalize(ht->KeyPool);
+        ht->KeyPool = pool;
+    }
+    return 1;
+}
+
+static FlatHashTable *CreateWithAllocator(size_t ElementSize,const ContainerAllocator *allocator)
+{
+    FlatHashTable *ht = allocator->malloc(sizeof(FlatHashTable));
+
+    if (ht == NULL) {
+        iError.RaiseError("iFlatHashTable.Create",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    memset(ht,0,sizeof(*ht));
+    ht->VTable = &iFlatHashTable;
+    ht->ElementSize = ElementSize;
+    ht->SlotSize = roundup(VALUE_OFFSET + ElementSize);
+    ht->Allocator = allocator;
+    ht->RaiseError = iError.RaiseError;
+    ht->Hash = DefaultHashFunction;
+    ht->size = MIN_SIZE;
+    ht->Slots = AllocSlots(ht,ht->size);
+    ht->Spare = allocator->malloc(2*ht->SlotSize);
+    if (ht->Slots == NULL || ht->Spare == NULL) {
+        if (ht->Slots) allocator->free(ht->Slots);
+        if (ht->Spare) allocator->free(ht->Spare);
+        allocator->free(ht);
+        iError.RaiseError("iFlatHashTable.Create",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    return ht;
+}
+
+static FlatHashTable *Create(size_t ElementSize)
+{
+    return CreateWithAllocator(ElementSize,CurrentAllocator);
+}
+
+static FlatHashTable *Init(FlatHashTable *ht,size_t ElementSize)
+{
+    iError.RaiseError("iFlatHashTable.Init",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return NULL;
+}
+
+/* The integer keys of iHashTable (CreateIntegerKeys) are not implemented */
+static FlatHashTable *CreateIntegerKeys(size_t ElementSize)
+{
+    iError.RaiseError("iFlatHashTable.CreateIntegerKeys",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return NULL;
+}
+
+static int AddInteger(FlatHashTable *ht,uint64_t key,const void *val)
+{
+    iError.RaiseError("iFlatHashTable.AddInteger",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return CONTAINER_ERROR_NOTIMPLEMENTED;
+}
+
+static void *GetElementInteger(const FlatHashTable *ht,uint64_t key)
+{
+    iError.RaiseError("iFlatHashTable.GetElementInteger",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return NULL;
+}
+
+static int EraseInteger(FlatHashTable *ht,uint64_t key)
+{
+    iError.RaiseError("iFlatHashTable.EraseInteger",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return CONTAINER_ERROR_NOTIMPLEMENTED;
+}
+
+static int Finalize(FlatHashTable *ht)
+{
+    int r = Clear(ht);
+
+    if (r < 0)
+        return r;
+    if (ht->KeyPool)
+        iPool.Finalize(ht->KeyPool);
+    ht->Allocator->free(ht->Slots);
+    ht->Allocator->free(ht->Spare);
+    ht->Allocator->free(ht);
+    return 1;
+}
+
+/* The slots are copied as they are. As with iHashTable the keys are
+   shared with the original; the pool is not used. */
+static FlatHashTable *Copy(const FlatHashTable *orig,Pool *pool)
+{
+    FlatHashTable *ht;
+
+    if (orig == NULL) {
+        NullPtrError("Copy");
+        return NULL;
+    }
+    ht = orig->Allocator->malloc(sizeof(FlatHashTable));
+    if (ht == NULL) {
+        NoMemoryError(orig,"Copy");
+        return NULL;
+    }
+    *ht = *orig;
+    ht->KeyPool = NULL;
+    ht->timestamp = 0;
+    ht->Slots = orig->Allocator->malloc(orig->size*orig->SlotSize);
+    ht->Spare = orig->Allocator->malloc(2*orig->SlotSize);
+    if (ht->Slots == NULL || ht->Spare == NULL) {
+        if (ht->Slots) orig->Allocator->free(ht->Slots);
+        if (ht->Spare) orig->Allocator->free(ht->Spare);
+        orig->Allocator->free(ht);
+        NoMemoryError(orig,"Copy");
+        return NULL;
+    }
+    memcpy(ht->Slots,orig->Slots,orig->size*orig->SlotSize);
+    return ht;
+}
+
+/* Hashes all keys again after a change of the function or of the seed */
+static void HashAllKeys(FlatHashTable *ht)
+{
+    size_t i,klen;
+    struct FlatHashSlot *s;
+
+    for (i = 0; i < ht->size; i++) {
+        s = SLOT(ht,i);
+        if (s->key) {
+            klen = s->klen;
+            s->hash = HashKey(ht,s->key,&klen);
+        }
+    }
+}
+
+static int ChangeHashing(FlatHashTable *ht,GeneralHashFunction fn,uint64_t Seed)
+{
+    GeneralHashFunction oldFn = ht->Hash;
+    uint64_t oldSeed = ht->Seed;
+
+    ht->Hash = fn;
+    ht->Seed = Seed;
+    HashAllKeys(ht);
+    if (Rehash(ht,ht->size) < 0) {
+        ht->Hash = oldFn;
+        ht->Seed = oldSeed;
+        HashAllKeys(ht);
+        return CONTAINER_ERROR_NOMEMORY;
+    }
+    return 1;
+}
+
+static GeneralHashFunction SetHashFunction(FlatHashTable *ht,GeneralHashFunction Hash)
+{
+    GeneralHashFunction old;
+
+    if (ht == NULL)
+        return DefaultHashFunction;
+    old = ht->Hash;
+    if (Hash && (Hash != old || ht->Seed) && ChangeHashing(ht,Hash,0) < 0)
+        NoMemoryError(ht,"SetHashFunction");
+    return old;
+}
+
+/* See SetSeed in hashtable.c */
+static int SetSeed(FlatHashTable *ht,uint64_t Seed)
+{
+    if (ht == NULL)
+        return NullPtrError("SetSeed");
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"SetSeed");
+    if (ChangeHashing(ht,ht->Hash,Seed ? Seed : iHashFunctions.RandomSeed()) < 0)
+        return NoMemoryError(ht,"SetSeed");
+    return 1;
+}
+
+struct MergeInfo {
+    FlatHashTable *res;
+    Pool *p;
+    void *(*merger)(Pool *p,const void *key,size_t klen,const void *h1_val,
+                    const void *h2_val,const void *data);
+    const void *data;
+    int error;
+};
+
+static int MergeBase(void *key,size_t klen,void *val,void *arg)
+{
+    struct MergeInfo *mi = arg;
+    size_t kl = klen;
+
+    if (NewEntry(mi->res,key,klen,HashKey(mi->res,key,&kl),val) < 0) {
+        mi->error = 1;
+        return 0;
+    }
+    return 1;
+}
+
+static int MergeOverlay(void *key,size_t klen,void *val,void *arg)
+{
+    struct MergeInfo *mi = arg;
+    FlatHashTable *res = mi->res;
+    size_t kl = klen,i;
+    uint64_t h = HashKey(res,key,&kl);
+    const void *pvoid = val;
+
+    i = FindSlot(res,key,klen,h);
+    if (i == NOT_FOUND)
+        return MergeBase(key,klen,val,arg);
+    if (mi->merger)
+        pvoid = (*mi->merger)(mi->p,key,klen,val,VALUE(SLOT(res,i)),mi->data);
+    memcpy(VALUE(SLOT(res,i)),pvoid,res->ElementSize);
+    return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Merge ID:1
+ Purpose:       Builds a new flat table with the entries of both tables.
+                When a key is in both, the merger function (if given)
+                computes the value from the value in the overlay and
+                the value in the base, otherwise the overlay wins. The
+                tables are read through their interface, so they can
+                be of either implementation.
+ Input:         A pool passed to the merger, the two tables, the merger
+                and its data
+ Output:        The new table, that uses the hashing of base
+ Errors:        BADARG if a table is NULL, NOMEMORY
+------------------------------------------------------------------------*/
+static FlatHashTable *Merge(Pool *p,const HashTable *overlay,const HashTable *base,
+                            void *(*merger)(Pool *p,const void *key,size_t klen,
+                                            const void *h1_val,const void *h2_val,
+                                            const void *data),
+                            const void *data)
+{
+    struct MergeInfo mi;
+    size_t ElementSize;
+
+    if (overlay == NULL || base == NULL) {
+        NullPtrError("Merge");
+        return NULL;
+    }
+    ElementSize = base->VTable->GetElementSize(base);
+    mi.res = Create(ElementSize);
+    if (mi.res == NULL)
+        return NULL;
+    if (base->VTable == &iFlatHashTable) {
+        const FlatHashTable *b = (const FlatHashTable *)base;
+        mi.res->Hash = b->Hash;
+        mi.res->Seed = b->Seed;
+    }
+    Resize(mi.res,(size_t)((base->VTable->Size(base)+overlay->VTable->Size(overlay))/MAX_LOAD_FACTOR));
+    mi.p = p;
+    mi.merger = merger;
+    mi.data = data;
+    mi.error = 0;
+    base->VTable->Apply((HashTable *)base,MergeBase,&mi);
+    if (!mi.error)
+        overlay->VTable->Apply((HashTable *)overlay,MergeOverlay,&mi);
+    if (mi.error) {
+        Finalize(mi.res);
+        return NULL;
+    }
+    return mi.res;
+}
+
+static FlatHashTable *Overlay(Pool *p,const HashTable *overlay,const HashTable *base)
+{
+    return Merge(p,overlay,base,NULL,NULL);
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                                Iterators                                       */
+/* ------------------------------------------------------------------------------ */
+/* The iteration starts after an empty slot. Erasing an entry moves back
+   only the entries of its cluster, that ends before that empty slot, so
+   the iterator can look at the same slot again and see each entry once. */
+static void *GetNext(Iterator *it)
+{
+    struct FlatHashTableIterator *d = (struct FlatHashTableIterator *)it;
+    FlatHashTable *ht;
+    struct FlatHashSlot *s;
+
+    if (it == NULL) {
+        NullPtrError("GetNext");
+        return NULL;
+    }
+    ht = d->ht;
+    if (d->timestamp != ht->timestamp) {
+        ht->RaiseError("iFlatHashTable.GetNext",CONTAINER_ERROR_OBJECT_CHANGED);
+        return NULL;
+    }
+    for (; d->pos < ht->size; d->pos++) {
+        s = SLOT(ht,(d->start + d->pos) & (ht->size-1));
+        if (s->key) {
+            d->pos++;
+            return VALUE(s);
+        }
+    }
+    return NULL;
+}
+
+static void *GetFirst(Iterator *it)
+{
+    struct FlatHashTableIterator *d = (struct FlatHashTableIterator *)it;
+    FlatHashTable *ht;
+
+    if (it == NULL) {
+        NullPtrError("GetFirst");
+        return NULL;
+    }
+    ht = d->ht;
+    d->timestamp = ht->timestamp;
+    if (ht->count == 0)
+        return NULL;
+    /* The load factor leaves always an empty slot */
+    for (d->start = 0; SLOT(ht,d->start)->key; d->start++)
+        ;
+    d->pos = 0;
+    return GetNext(it);
+}
+
+/* Replaces or erases the element returned by the last call to GetNext */
+static int ReplaceWithIterator(Iterator *it,void *data,int direction)
+{
+    struct FlatHashTableIterator *li = (struct FlatHashTableIterator *)it;
+    FlatHashTable *ht;
+    size_t i;
+
+    if (it == NULL)
+        return NullPtrError("Replace");
+    ht = li->ht;
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"Replace");
+    if (li->timestamp != ht->timestamp) {
+        ht->RaiseError("iFlatHashTable.Replace",CONTAINER_ERROR_OBJECT_CHANGED);
+        return CONTAINER_ERROR_OBJECT_CHANGED;
+    }
+    if (li->pos == 0)
+        return 0;
+    i = (li->start + li->pos - 1) & (ht->size-1);
+    if (SLOT(ht,i)->key == NULL)
+        return 0;
+    if (data == NULL) {
+        RemoveSlot(ht,i);
+        li->pos--;
+    }
+    else memcpy(VALUE(SLOT(ht,i)),data,ht->ElementSize);
+    li->timestamp = ht->timestamp;
+    return 1;
+}
+
+static void *GetCurrent(Iterator *it)
+{
+    struct FlatHashTableIterator *li = (struct FlatHashTableIterator *)it;
+    struct FlatHashSlot *s;
+
+    if (it == NULL || li->pos == 0)
+        return NULL;
+    s = SLOT(li->ht,(li->start + li->pos - 1) & (li->ht->size-1));
+    return s->key ? VALUE(s) : NULL;
+}
+
+static int InitIterator(FlatHashTable *ht,void *buf)
+{
+    struct FlatHashTableIterator *result = buf;
+
+    if (ht == NULL || buf == NULL)
+        return NullPtrError("InitIterator");
+    memset(result,0,sizeof(*result));
+    result->it.GetNext = GetNext;
+    result->it.GetPrevious = GetNext;
+    result->it.GetFirst = GetFirst;
+    result->it.GetCurrent = GetCurrent;
+    result->it.Replace = ReplaceWithIterator;
+    result->ht = ht;
+    result->timestamp = ht->timestamp;
+    return 1;
+}
+
+static Iterator *NewIterator(FlatHashTable *ht)
+{
+    struct FlatHashTableIterator *result;
+
+    if (ht == NULL) {
+        NullPtrError("NewIterator");
+        return NULL;
+    }
+    result = ht->Allocator->malloc(sizeof(*result));
+    if (result == NULL) {
+        NoMemoryError(ht,"NewIterator");
+        return NULL;
+    }
+    InitIterator(ht,result);
+    return &result->it;
+}
+
+static int DeleteIterator(Iterator *it)
+{
+    struct FlatHashTableIterator *d = (struct FlatHashTableIterator *)it;
+
+    if (it == NULL)
+        return NullPtrError("DeleteIterator");
+    d->ht->Allocator->free(it);
+    return 1;
+}
+
+static size_t SizeofIterator(const FlatHashTable *ht)
+{
+    return sizeof(struct FlatHashTableIterator);
+}
+
+static DestructorFunction SetDestructor(FlatHashTable *ht,DestructorFunction fn)
+{
+    DestructorFunction oldfn;
+
+    if (ht == NULL)
+        return NULL;
+    oldfn = ht->DestructorFn;
+    if (fn)
+        ht->DestructorFn = fn;
+    return oldfn;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                              Save and Load                                     */
+/* ------------------------------------------------------------------------------ */
+static int DefaultLoadFunction(void *element,void *arg,FILE *Infile)
+{
+    size_t len = *(size_t *)arg;
+
+    return len == fread(element,1,len,Infile);
+}
+
+/* Key lengths are written in ULE128: 7 bits per byte, the high bit set
+   in all bytes but the last */
+static int decode_ule128(FILE *stream,size_t *val)
+{
+    size_t i = 0;
+    int c;
+
+    val[0] = 0;
+    do {
+        c = fgetc(stream);
+        if (c == EOF)
+            return EOF;
+        val[0] += ((size_t)(c & 0x7f) << (i * 7));
+        i++;
+    } while ((0x80 & c) && (i < 2*sizeof(size_t)));
+    return (int)i;
+}
+
+static int encode_ule128(FILE *stream,size_t val)
+{
+    int i = 0;
+
+    do {
+        size_t c = val & 0x7f;
+        val >>= 7;
+        if (val)
+            c |= 0x80;
+        if (fputc((int)c,stream) == EOF)
+            return EOF;
+        i++;
+    } while (val);
+    return i;
+}
+
+/* The file has the format of iHashTable files: the guid, the number of
+   entries, the size of the elements, the flags and the number of bytes
+   of the entries, then for each entry the length of the key (ULE128
+   encoded), the key and the value. Without a save function the entries
+   are written in large blocks. */
+static int Save(const FlatHashTable *ht,FILE *stream,SaveFunction saveFn,void *arg)
+{
+    size_t i;
+    struct FlatHashSlot *s;
+    struct BlockFile bf;
+    uint64_t count,elemsiz,bytes = SAVED_WITH_FUNCTION;
+    int rv = 1;
+
+    if (ht == NULL || stream == NULL)
+        return NullPtrError("Save");
+    if (saveFn == NULL) {
+        bytes = 0;
+        for (i = 0; i < ht->size; i++) {
+            s = SLOT(ht,i);
+            if (s->key)
+                bytes += ULE128Size(s->klen) + s->klen + ht->ElementSize;
+        }
+    }
+    count = ht->count;
+    elemsiz = ht->ElementSize;
+    if (fwrite(&FlatHashTableGuid,sizeof(guid),1,stream) == 0 ||
+        fwrite(&count,sizeof(count),1,stream) == 0 ||
+        fwrite(&elemsiz,sizeof(elemsiz),1,stream) == 0 ||
+        fwrite(&ht->Flags,sizeof(unsigned),1,stream) == 0 ||
+        fwrite(&bytes,sizeof(bytes),1,stream) == 0)
+        return EOF;
+    if (saveFn) {
+        for (i = 0; i < ht->size; i++) {
+            s = SLOT(ht,i);
+            if (s->key == NULL)
+                continue;
+            if (encode_ule128(stream,s->klen) <= 0 ||
+                fwrite(s->key,1,s->klen,stream) != s->klen ||
+                saveFn(VALUE(s),arg,stream) <= 0)
+                return EOF;
+        }
+        return 1;
+    }
+    if (BlockFileInit(&bf,stream,0,ht->Allocator) < 0)
+        return NoMemoryError(ht,"Save");
+    for (i = 0; i < ht->size && rv > 0; i++) {
+        s = SLOT(ht,i);
+        if (s->key == NULL)
+            continue;
+        if (BlockFileWriteULE128(&bf,s->klen) < 0 ||
+            BlockFileWrite(&bf,s->key,s->klen) < 0 ||
+            BlockFileWrite(&bf,VALUE(s),ht->ElementSize) < 0)
+            rv = EOF;
+    }
+    if (rv > 0 && BlockFileFlush(&bf) < 0)
+        rv = EOF;
+    BlockFileFinalize(&bf);
+    return rv;
+}
+
+/* The keys are stored in a pool owned by the table. A file written
+   without a save function and read without a read function is read in
+   large blocks. */
+static FlatHashTable *Load(FILE *stream,ReadFunction readFn,void *arg)
+{
+    uint64_t count,elemsiz,bytes;
+    size_t i,ElementSize,klen;
+    unsigned Flags;
+    FlatHashTable *ht;
+    char *key,*val = NULL;
+    struct BlockFile bf;
+    int blocks;
+    guid Guid;
+
+    if (stream == NULL) {
+        NullPtrError("Load");
+        return NULL;
+    }
+    if (fread(&Guid,sizeof(guid),1,stream) == 0 ||
+        fread(&count,sizeof(count),1,stream) == 0 ||
+        fread(&elemsiz,sizeof(elemsiz),1,stream) == 0 ||
+        fread(&Flags,sizeof(unsigned),1,stream) == 0 ||
+        fread(&bytes,sizeof(bytes),1,stream) == 0) {
+        iError.RaiseError("iFlatHashTable.Load",CONTAINER_ERROR_FILE_READ);
+        return NULL;
+    }
+    if (memcmp(&Guid,&FlatHashTableGuid,sizeof(guid))) {
+        iError.RaiseError("iFlatHashTable.Load",CONTAINER_ERROR_WRONGFILE);
+        return NULL;
+    }
+    ElementSize = (size_t)elemsiz;
+    blocks = (readFn == NULL && bytes != SAVED_WITH_FUNCTION);
+    if (readFn == NULL) {
+        readFn = DefaultLoadFunction;
+        arg = &ElementSize;
+    }
+    ht = Create(ElementSize);
+    if (ht == NULL)
+        return NULL;
+    bf.buf = NULL;
+    ht->KeyPool = iPool.Create((ContainerAllocator *)ht->Allocator);
+    if (ht->KeyPool == NULL || Resize(ht,SizeFor((size_t)count)) < 0 ||
+        (val = ht->Allocator->malloc(ElementSize+1)) == NULL ||
+        (blocks && BlockFileInit(&bf,stream,bytes,ht->Allocator) < 0))
+        goto nomem;
+    for (i = 0; i < count; i++) {
+        if (blocks) {
+            if (BlockFileReadULE128(&bf,&klen) <= 0)
+                goto readerr;
+            if ((key = iPool.Alloc(ht->KeyPool,klen)) == NULL)
+                goto nomem;
+            if (BlockFileRead(&bf,key,klen) < 0 ||
+                BlockFileRead(&bf,val,ElementSize) < 0)
+                goto readerr;
+        }
+        else {
+            if (decode_ule128(stream,&klen) <= 0)
+                goto readerr;
+            if ((key = iPool.Alloc(ht->KeyPool,klen)) == NULL)
+                goto nomem;
+            if (fread(key,1,klen,stream) != klen ||
+                readFn(val,arg,stream) <= 0)
+                goto readerr;
+        }
+        if (Add(ht,key,klen,val) < 0)
+            goto nomem;
+    }
+    if (bf.buf)
+        BlockFileFinalize(&bf);
+    ht->Allocator->free(val);
+    ht->Flags = Flags;
+    return ht;
+readerr:
+    iError.RaiseError("iFlatHashTable.Load",CONTAINER_ERROR_FILE_READ);
+    goto err;
+nomem:
+    iError.RaiseError("iFlatHashTable.Load",CONTAINER_ERROR_NOMEMORY);
+err:
+    if (bf.buf)
+        BlockFileFinalize(&bf);
+    if (val)
+        ht->Allocator->free(val);
+    Finalize(ht);
+    return NULL;
+}
+
+#define BATCH_SIZE 16
+/*
+ * Looks up at most BATCH_SIZE keys. All keys are hashed and their home
+ * slots prefetched before the probes start, so the cache misses of the
+ * group overlap.
+ */
+static int LookupGroup(const FlatHashTable *ht,size_t m,const void **Keys,const size_t *klens,size_t *Found)
+{
+    uint64_t h[BATCH_SIZE];
+    size_t kl[BATCH_SIZE];
+    size_t j;
+
+    for (j = 0; j < m; j++) {
+        if (Keys[j] == NULL)
+            return -1;
+        kl[j] = klens ? klens[j] : (size_t)-1;
+        h[j] = HashKey(ht,Keys[j],&kl[j]);
+        CCL_PREFETCH(SLOT(ht,(size_t)h[j] & (ht->size-1)));
+    }
+    for (j = 0; j < m; j++)
+        Found[j] = FindSlot(ht,Keys[j],kl[j],h[j]);
+    return 0;
+}
+
+static int GetElements(const FlatHashTable *ht,size_t n,const void **Keys,const size_t *klens,void **Results)
+{
+    size_t Found[BATCH_SIZE];
+    size_t i,j,m;
+    int found = 0;
+
+    if (ht == NULL)
+        return NullPtrError("GetElements");
+    if (n && (Keys == NULL || Results == NULL))
+        return BadArgError(ht,"GetElements");
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+        if (LookupGroup(ht,m,Keys+i,klens ? klens+i : NULL,Found) < 0)
+            return BadArgError(ht,"GetElements");
+        for (j = 0; j < m; j++) {
+            if (Found[j] != NOT_FOUND) {
+                Results[i+j] = VALUE(SLOT(ht,Found[j]));
+                found++;
+            }
+            else Results[i+j] = NULL;
+        }
+    }
+    return found;
+}
+
+/* The value of a key copied to outbuf. Returns 1 if the key was
+   found, 0 if not (outbuf is not changed). */
+static int CopyElement(const FlatHashTable *ht,const void *key,size_t klen,void *outbuf)
+{
+    void *p;
+
+    if (ht == NULL)
+        return NullPtrError("CopyElement");
+    if (outbuf == NULL)
+        return BadArgError(ht,"CopyElement");
+    p = GetElement(ht,key,klen);
+    if (p == NULL)
+        return 0;
+    memcpy(outbuf,p,ht->ElementSize);
+    return 1;
+}
+
+/* GetElements copying the values of the keys found to outbuf, an array
+   of n elements. Found[i], if Found isn't NULL, tells if Keys[i] was. */
+static int CopyElements(const FlatHashTable *ht,size_t n,const void **Keys,const size_t *klens,void *outbuf,unsigned char *Found)
+{
+    void *Results[BATCH_SIZE];
+    size_t i,j,m;
+    int r,found = 0;
+
+    if (ht == NULL)
+        return NullPtrError("CopyElements");
+    if (n && outbuf == NULL)
+        return BadArgError(ht,"CopyElements");
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+        r = GetElements(ht,m,Keys+i,klens ? klens+i : NULL,Results);
+        if (r < 0)
+            return r;
+        found += r;
+        for (j = 0; j < m; j++) {
+            if (Results[j])
+                memcpy((char *)outbuf + (i+j)*ht->ElementSize,Results[j],ht->ElementSize);
+            if (Found)
+                Found[i+j] = Results[j] != NULL;
+        }
+    }
+    return found;
+}
+
+static int ContainsMany(const FlatHashTable *ht,size_t n,const void **Keys,const size_t *klens,unsigned char *Results)
+{
+    size_t Found[BATCH_SIZE];
+    size_t i,j,m;
+    int found = 0;
+
+    if (ht == NULL)
+        return NullPtrError("ContainsMany");
+    if (n && (Keys == NULL || Results == NULL))
+        return BadArgError(ht,"ContainsMany");
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+        if (LookupGroup(ht,m,Keys+i,klens ? klens+i : NULL,Found) < 0)
+            return BadArgError(ht,"ContainsMany");
+        for (j = 0; j < m; j++) {
+            Results[i+j] = Found[j] != NOT_FOUND;
+            found += Results[i+j];
+        }
+    }
+    return found;
+}
+
+/* The probe length of an entry is its distance from its home slot plus
+   one */
+static int GetStatistics(const FlatHashTable *ht,HashStatistics *Stats)
+{
+    struct FlatHashSlot *s;
+    size_t i;
+
+    if (ht == NULL)
+        return NullPtrError("GetStatistics");
+    if (Stats == NULL)
+        return BadArgError(ht,"GetStatistics");
+    HashStatsInit(Stats,ht->size);
+    for (i = 0; i < ht->size; i++) {
+        s = SLOT(ht,i);
+        if (s->key == NULL)
+            continue;
+        HashStatsProbe(Stats,DISTANCE(ht,i,s)+1);
+        Stats->KeyBytes += s->klen;
+    }
+    Stats->Resizes = ht->Resizes;
+    HashStatsFinish(Stats,ht->ElementSize,Sizeof(ht));
+    return 1;
+}
+
+HashTableInterface iFlatHashTable = {
+    (size_t (*)(const HashTable *))Size,
+    (unsigned (*)(const HashTable *))GetFlags,
+    (unsigned (*)(HashTable *,unsigned))SetFlags,
+    (int (*)(HashTable *))Clear,
+    (int (*)(const HashTable *,const void *,size_t))Contains,
+    (HashTable *(*)(size_t))Create,
+    (HashTable *(*)(HashTable *,size_t))Init,
+    (size_t (*)(const HashTable *))Sizeof,
+    (size_t (*)(const HashTable *))GetElementSize,
+    (int (*)(HashTable *,const void *,size_t,const void *))Add,
+    (void *(*)(const HashTable *,const void *,size_t))GetElement,
+    (int (*)(HashTable *,int (*)(void *,const void *,size_t,const void *),void *))Search,
+    (int (*)(HashTable *,const void *,size_t))Erase,
+    (int (*)(HashTable *))Finalize,
+    (int (*)(HashTable *,int (*)(void *,size_t,void *,void *),void *))Apply,
+    (ErrorFunction (*)(HashTable *,ErrorFunction))SetErrorFunction,
+    (int (*)(HashTable *,size_t))Resize,
+    (int (*)(HashTable *,const void *,size_t,const void *))Replace,
+    (HashTable *(*)(const HashTable *,Pool *))Copy,
+    (GeneralHashFunction (*)(HashTable *,GeneralHashFunction))SetHashFunction,
+    (HashTable *(*)(Pool *,const HashTable *,const HashTable *))Overlay,
+    (HashTable *(*)(Pool *,const HashTable *,const HashTable *,
+                    void *(*)(Pool *,const void *,size_t,const void *,const void *,const void *),
+                    const void *))Merge,
+    (Iterator *(*)(HashTable *))NewIterator,
+    (int (*)(HashTable *,void *))InitIterator,
+    DeleteIterator,
+    (size_t (*)(const HashTable *))SizeofIterator,
+    (int (*)(const HashTable *,FILE *,SaveFunction,void *))Save,
+    (HashTable *(*)(FILE *,ReadFunction,void *))Load,
+    (DestructorFunction (*)(HashTable *,DestructorFunction))SetDestructor,
+    (int (*)(const HashTable *,size_t,const void **,const size_t *,void **))GetElements,
+    (int (*)(const HashTable *,size_t,const void **,const size_t *,unsigned char *))ContainsMany,
+    (int (*)(HashTable *,uint64_t))SetSeed,
+    (int (*)(HashTable *,size_t))Reserve,
+    (int (*)(HashTable *))ShrinkToFit,
+    (int (*)(const HashTable *,HashStatistics *))GetStatistics,
+    (HashTable *(*)(size_t,size_t,const void **,const size_t *,const void *))BuildFrom,
+    (HashTable *(*)(size_t))CreateIntegerKeys,
+    (int (*)(HashTable *,uint64_t,const void *))AddInteger,
+    (void *(*)(const HashTable *,uint64_t))GetElementInteger,
+    (int (*)(HashTable *,uint64_t))EraseInteger,
+    (int (*)(HashTable *,size_t *,size_t,int (*)(void *,size_t,void *,void *),void *))Scan,
+    (int (*)(const HashTable *,const void *,size_t,void *))CopyElement,
+    (int (*)(const HashTable *,size_t,const void **,const size_t *,void *,unsigned char *))CopyElements,
+};
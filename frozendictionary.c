@@ -0,0 +1,1373 @@
+/*------------------------------------------------------------------------
+ Module:        frozendictionary.c
+ Author:        jacob
+ Project:       Containers
+ State:
+ Creation Date:
+ Description:   Read only dictionaries built with a minimal perfect hash.
+                The keys are hashed with a seeded 64 bit hash and
+                distributed into about n/3 buckets. The buckets are
+                placed from the biggest to the smallest: for each one a
+                pair of displacements (d0,d1) is searched so that all
+                its keys fall into free entries, the position of a key
+                being (base(hash,d0) + d1) mod n, where base is a mix of
+                the hash and d0 scaled to n. Buckets with a single key are placed directly
+                in the next free entry by choosing d1.
+                A lookup computes the hash, reads the displacements of
+                the bucket and compares the key with the one entry it
+                designates: there is no chain and no probe sequence.
+                All the data lives in one block: the header, the
+                displacements, the entries with their values and the
+                characters of the keys.
+------------------------------------------------------------------------*/
+#include <limits.h>
+#include <stddef.h>
+#include "containers.h"
+#include "ccl_internal.h"
+#ifdef UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+typedef struct FrozenDictionary FrozenDictionary;
+
+#define NOT_FOUND       ((size_t)-1)
+#define KEYS_PER_BUCKET 3
+#define MAX_ATTEMPTS    16
+#define MAX_D0          1024
+#define ENTRY_OFFSET    roundup(sizeof(struct FrozenEntry))
+#define ENTRY(d,i)      ((struct FrozenEntry *)((d)->Entries + (i)*(d)->EntrySize))
+#define VALUE(e)        ((char *)(e) + ENTRY_OFFSET)
+#define KEY(d,e)        ((d)->Keys + (e)->KeyOffset)
+
+static const guid DictionaryGuid = {0xa334a9d, 0x897c, 0x4bed,
+{0x92,0xa3,0x2,0xbf,0x86,0xd5,0x2e,0xcf}
+};
+
+static int doerrorCall(ErrorFunction err,const char *fnName,int code)
+{
+    char buf[256];
+
+    snprintf(buf,sizeof(buf),"iFrozenDictionary.%s",fnName);
+    err(buf,code);
+    return code;
+}
+static int ReadOnlyError(const FrozenDictionary *SC,const char *fnName)
+{
+    return doerrorCall(SC->RaiseError,fnName,CONTAINER_ERROR_READONLY);
+}
+static int NullPtrError(const char *fnName)
+{
+    return doerrorCall(iError.RaiseError,fnName,CONTAINER_ERROR_BADARG);
+}
+
+static int BadArgError(const FrozenDictionary *SC,const char *fnName)
+{
+    return doerrorCall(SC->RaiseError,fnName,CONTAINER_ERROR_BADARG);
+}
+
+static uint64_t Mix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* The seeded word at a time hash of hashfunctions.c */
+static uint64_t Hash64(const char *key,uint64_t seed)
+{
+    return iHashFunctions.Hash64(key,strlen(key),seed);
+}
+
+/* Maps a 32 bit value into [0,n) with a multiplication instead of a
+   division */
+static size_t Reduce(uint64_t x,size_t n)
+{
+    return (size_t)(((x & 0xffffffffULL) * n) >> 32);
+}
+
+static size_t Bucket(uint64_t h,size_t nbuckets)
+{
+    return Reduce(h >> 32,nbuckets);
+}
+
+/* Position of a key before adding d1. Each d0 gives an independent
+   placement of the keys of a bucket. */
+static size_t Base(uint64_t h,size_t m,uint32_t d0)
+{
+    return Reduce(d0 ? Mix64(h ^ (d0 * 0x9E3779B97F4A7C15ULL)) : h,m);
+}
+
+static size_t Position(uint64_t h,size_t m,uint32_t d0,uint32_t d1)
+{
+    size_t p = Base(h,m,d0) + d1;
+    return p >= m ? p - m : p;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Lookup ID:1
+ Purpose:       Finds the entry of a key with a single probe
+ Input:         The dictionary and the key
+ Output:        The entry index or NOT_FOUND
+ Errors:        None
+------------------------------------------------------------------------*/
+static size_t Lookup(const FrozenDictionary *d,const char *Key)
+{
+    uint64_t h;
+    size_t b,i;
+    struct FrozenEntry *e;
+
+    if (d->size == 0)
+        return NOT_FOUND;
+    h = Hash64(Key,d->Seed);
+    b = Bucket(h,d->NBuckets);
+    i = Position(h,d->size,d->Displacement[2*b],d->Displacement[2*b+1]);
+    e = ENTRY(d,i);
+    if (e->Hash == h && strcmp(Key,KEY(d,e)) == 0)
+        return i;
+    return NOT_FOUND;
+}
+
+/* Temporary data used while building the table */
+struct Builder {
+    size_t n;                   /* Number of keys given */
+    size_t m;                   /* Number of distinct keys */
+    size_t nbuckets;
+    uint64_t seed;
+    uint64_t *hash;             /* n hashes */
+    size_t *start;              /* nbuckets+1 offsets into items */
+    size_t *items;              /* Key indexes grouped by bucket */
+    size_t *order;              /* Buckets sorted by decreasing size */
+    size_t *slotOf;             /* Entry of each key or NOT_FOUND if dropped */
+    uint32_t *disp;
+    unsigned char *taken;
+    const char **Keys;
+    const ContainerAllocator *allocator;
+};
+
+static void FreeBuilder(struct Builder *b)
+{
+    const ContainerAllocator *a = b->allocator;
+
+    if (b->hash) a->free(b->hash);
+    if (b->start) a->free(b->start);
+    if (b->items) a->free(b->items);
+    if (b->order) a->free(b->order);
+    if (b->slotOf) a->free(b->slotOf);
+    if (b->disp) a->free(b->disp);
+    if (b->taken) a->free(b->taken);
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Distribute ID:1
+ Purpose:       Hashes all keys with the current seed, groups them by
+                bucket and drops the duplicates (the first one stays).
+ Input:         The builder
+ Output:        1 if the keys can be placed with this seed, zero if two
+                different keys of a bucket cannot be separated.
+ Errors:        None
+------------------------------------------------------------------------*/
+static int Distribute(struct Builder *b)
+{
+    size_t i,j,k,bk;
+
+    memset(b->start,0,(b->nbuckets+1)*sizeof(size_t));
+    for (i = 0; i < b->n; i++) {
+        b->hash[i] = Hash64(b->Keys[i],b->seed);
+        b->start[Bucket(b->hash[i],b->nbuckets)+1]++;
+    }
+    for (i = 0; i < b->nbuckets; i++)
+        b->start[i+1] += b->start[i];
+    /* order is used as the fill pointer of each bucket here */
+    memcpy(b->order,b->start,b->nbuckets*sizeof(size_t));
+    for (i = 0; i < b->n; i++) {
+        bk = Bucket(b->hash[i],b->nbuckets);
+        b->items[b->order[bk]++] = i;
+    }
+    b->m = b->n;
+    for (i = 0; i < b->n; i++)
+        b->slotOf[i] = 0;
+    for (bk = 0; bk < b->nbuckets; bk++) {
+        for (j = b->start[bk]; j < b->start[bk+1]; j++) {
+            for (k = b->start[bk]; k < j; k++) {
+                size_t kj = b->items[j], kk = b->items[k];
+                if (b->slotOf[kk] == NOT_FOUND || b->hash[kj] != b->hash[kk])
+                    continue;
+                if (strcmp(b->Keys[kj],b->Keys[kk]) == 0) {
+                    b->slotOf[kj] = NOT_FOUND;
+                    b->m--;
+                    break;
+                }
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/* Tries to place the live keys of bucket bk with displacements (d0,d1) */
+static int TryPlace(struct Builder *b,size_t bk,uint32_t d0,uint32_t d1)
+{
+    size_t j,k,pos;
+
+    for (j = b->start[bk]; j < b->start[bk+1]; j++) {
+        size_t key = b->items[j];
+        if (b->slotOf[key] == NOT_FOUND)
+            continue;
+        pos = Position(b->hash[key],b->m,d0,d1);
+        if (b->taken[pos])
+            goto undo;
+        b->taken[pos] = 1;
+        b->slotOf[key] = pos;
+    }
+    return 1;
+undo:
+    for (k = b->start[bk]; k < j; k++) {
+        size_t key = b->items[k];
+        if (b->slotOf[key] != NOT_FOUND)
+            b->taken[b->slotOf[key]] = 0;
+    }
+    return 0;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Place ID:1
+ Purpose:       Chooses the displacements of all buckets, from the
+                biggest bucket to the smallest.
+ Input:         The builder, after Distribute
+ Output:        1 if all keys were placed, zero if some bucket could not
+                be placed with this seed
+ Errors:        None
+------------------------------------------------------------------------*/
+static int Place(struct Builder *b)
+{
+    size_t i,bk,size,maxSize = 0,nextFree = 0;
+    size_t *count,*live;
+    uint32_t d0,d1;
+    int r = 1;
+
+    if (b->m == 0)
+        return 1;
+    /* Count the live keys of each bucket, and sort the buckets by that
+       count with a counting sort */
+    live = b->allocator->malloc(b->nbuckets*sizeof(size_t));
+    if (live == NULL)
+        return -1;
+    for (bk = 0; bk < b->nbuckets; bk++) {
+        live[bk] = 0;
+        for (i = b->start[bk]; i < b->start[bk+1]; i++)
+            if (b->slotOf[b->items[i]] != NOT_FOUND)
+                live[bk]++;
+        if (live[bk] > maxSize)
+            maxSize = live[bk];
+    }
+    count = b->allocator->malloc((maxSize+2)*sizeof(size_t));
+    if (count == NULL) {
+        b->allocator->free(live);
+        return -1;
+    }
+    memset(count,0,(maxSize+2)*sizeof(size_t));
+    for (bk = 0; bk < b->nbuckets; bk++)
+        count[maxSize - live[bk] + 1]++;
+    for (i = 0; i <= maxSize; i++)
+        count[i+1] += count[i];
+    for (bk = 0; bk < b->nbuckets; bk++)
+        b->order[count[maxSize - live[bk]]++] = bk;
+
+    memset(b->taken,0,b->m);
+    memset(b->disp,0,2*b->nbuckets*sizeof(uint32_t));
+    for (i = 0; i < b->nbuckets && r; i++) {
+        bk = b->order[i];
+        size = live[bk];
+        if (size == 0)
+            break;
+        if (size == 1) {
+            /* A single key can go to any free entry: d1 moves it there */
+            size_t j,key = 0;
+            for (j = b->start[bk]; j < b->start[bk+1]; j++)
+                if (b->slotOf[b->items[j]] != NOT_FOUND)
+                    key = b->items[j];
+            while (b->taken[nextFree])
+                nextFree++;
+            d1 = (uint32_t)((nextFree + b->m - Base(b->hash[key],b->m,0)) % b->m);
+            b->disp[2*bk] = 0;
+            b->disp[2*bk+1] = d1;
+            b->taken[nextFree] = 1;
+            b->slotOf[key] = nextFree;
+            continue;
+        }
+        r = 0;
+        for (d0 = 0; d0 < MAX_D0 && !r; d0++) {
+            for (d1 = 0; d1 < b->m; d1++) {
+                if (TryPlace(b,bk,d0,d1)) {
+                    b->disp[2*bk] = d0;
+                    b->disp[2*bk+1] = d1;
+                    r = 1;
+                    break;
+                }
+            }
+        }
+    }
+    b->allocator->free(count);
+    b->allocator->free(live);
+    return r;
+}
+
+Dictionary *FreezeDictionary(size_t n,const char **Keys,const void **Values,size_t ElementSize,const ContainerAllocator *allocator)
+{
+    struct Builder b;
+    FrozenDictionary *d;
+    size_t i,keyBytes,entrySize,dispOffset,entriesOffset,keysOffset,total,pos;
+    int attempt,r = 0;
+
+    if (allocator == NULL)
+        allocator = CurrentAllocator;
+    memset(&b,0,sizeof(b));
+    b.n = n;
+    b.Keys = Keys;
+    b.allocator = allocator;
+    b.nbuckets = n/KEYS_PER_BUCKET + 1;
+    if (n > 0xffffffffUL) {
+        iError.RaiseError("iFrozenDictionary.Freeze",CONTAINER_ERROR_BADARG);
+        return NULL;
+    }
+    b.hash = allocator->malloc((n+1)*sizeof(uint64_t));
+    b.start = allocator->malloc((b.nbuckets+1)*sizeof(size_t));
+    b.items = allocator->malloc((n+1)*sizeof(size_t));
+    b.order = allocator->malloc(b.nbuckets*sizeof(size_t));
+    b.slotOf = allocator->malloc((n+1)*sizeof(size_t));
+    b.disp = allocator->malloc(2*b.nbuckets*sizeof(uint32_t));
+    b.taken = allocator->malloc(n+1);
+    if (!b.hash || !b.start || !b.items || !b.order || !b.slotOf || !b.disp || !b.taken)
+        goto nomem;
+    for (attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+        b.seed = Mix64(0x9E3779B97F4A7C15ULL * (attempt+1));
+        if (!Distribute(&b))
+            continue;
+        r = Place(&b);
+        if (r < 0)
+            goto nomem;
+        if (r)
+            break;
+    }
+    if (r == 0) {
+        FreeBuilder(&b);
+        iError.RaiseError("iFrozenDictionary.Freeze",CONTAINER_INTERNAL_ERROR);
+        return NULL;
+    }
+    keyBytes = 0;
+    for (i = 0; i < n; i++)
+        if (b.slotOf[i] != NOT_FOUND)
+            keyBytes += strlen(Keys[i]) + 1;
+    entrySize = roundup(ENTRY_OFFSET + ElementSize);
+    dispOffset = roundupTo(sizeof(FrozenDictionary),sizeof(uint64_t));
+    entriesOffset = roundupTo(dispOffset + 2*b.nbuckets*sizeof(uint32_t),sizeof(uint64_t));
+    keysOffset = entriesOffset + b.m*entrySize;
+    total = keysOffset + keyBytes;
+    d = allocator->malloc(total);
+    if (d == NULL)
+        goto nomem;
+    memset(d,0,entriesOffset);
+    d->VTable = &iFrozenDictionary;
+    d->count = d->size = b.m;
+    d->RaiseError = iError.RaiseError;
+    d->ElementSize = ElementSize;
+    d->Allocator = allocator;
+    d->Seed = b.seed;
+    d->NBuckets = b.nbuckets;
+    d->Displacement = (uint32_t *)((char *)d + dispOffset);
+    d->Entries = (char *)d + entriesOffset;
+    d->EntrySize = entrySize;
+    d->Keys = (char *)d + keysOffset;
+    d->KeysSize = keyBytes;
+    d->BlockSize = total;
+    memcpy(d->Displacement,b.disp,2*b.nbuckets*sizeof(uint32_t));
+    keyBytes = 0;
+    for (i = 0; i < n; i++) {
+        struct FrozenEntry *e;
+        if (b.slotOf[i] == NOT_FOUND)
+            continue;
+        pos = b.slotOf[i];
+        e = ENTRY(d,pos);
+        e->Hash = b.hash[i];
+        e->KeyOffset = keyBytes;
+        strcpy(d->Keys+keyBytes,Keys[i]);
+        keyBytes += strlen(Keys[i]) + 1;
+        if (ElementSize) {
+            if (Values && Values[i])
+                memcpy(VALUE(e),Values[i],ElementSize);
+            else memset(VALUE(e),0,ElementSize);
+        }
+    }
+    FreeBuilder(&b);
+    return (Dictionary *)d;
+nomem:
+    FreeBuilder(&b);
+    iError.RaiseError("iFrozenDictionary.Freeze",CONTAINER_ERROR_NOMEMORY);
+    return NULL;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     FreezeStrCollection ID:1
+ Purpose:       Builds a frozen dictionary from a collection of keys.
+ Input:         The keys, the size of the data and an array of
+                ElementSize*Size(Keys) bytes with the data of each key
+                in the order of the collection, or NULL to store zeroes.
+ Output:        The new dictionary or NULL
+ Errors:        BADARG if Keys is NULL, NOMEMORY
+------------------------------------------------------------------------*/
+Dictionary *FreezeStrCollection(const strCollection *Keys,size_t ElementSize,const void *Values)
+{
+    size_t i,n;
+    const char **keys;
+    const void **values;
+    Dictionary *result;
+    const ContainerAllocator *allocator;
+
+    if (Keys == NULL) {
+        NullPtrError("FreezeKeys");
+        return NULL;
+    }
+    n = istrCollection.Size(Keys);
+    allocator = istrCollection.GetAllocator(Keys);
+    if (allocator == NULL)
+        allocator = CurrentAllocator;
+    keys = allocator->malloc((n+1)*sizeof(char *));
+    values = allocator->malloc((n+1)*sizeof(void *));
+    if (keys == NULL || values == NULL) {
+        if (keys) allocator->free(keys);
+        if (values) allocator->free(values);
+        iError.RaiseError("iFrozenDictionary.FreezeKeys",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        keys[i] = istrCollection.GetElement((strCollection *)Keys,i);
+        values[i] = Values ? (const char *)Values + i*ElementSize : NULL;
+    }
+    result = FreezeDictionary(n,keys,values,ElementSize,allocator);
+    allocator->free(keys);
+    allocator->free(values);
+    return result;
+}
+
+static void *GetElement(const FrozenDictionary *Dict,const char *Key)
+{
+    size_t i;
+
+    if (Dict == NULL || Key == NULL) {
+        NullPtrError("GetElement");
+        return NULL;
+    }
+    i = Lookup(Dict,Key);
+    if (i == NOT_FOUND)
+        return NULL;
+    return Dict->ElementSize ? VALUE(ENTRY(Dict,i)) : KEY(Dict,ENTRY(Dict,i));
+}
+
+static int CopyElement(const FrozenDictionary *Dict,const char *Key,void *outbuf)
+{
+    size_t i;
+
+    if (Dict == NULL) {
+        return NullPtrError("CopyElement");
+    }
+    if (Key == NULL)
+        return BadArgError(Dict,"CopyElement");
+    if (Dict->ElementSize == 0) return 0;
+    i = Lookup(Dict,Key);
+    if (i == NOT_FOUND)
+        return 0;
+    if (outbuf != NULL)
+        memcpy(outbuf,VALUE(ENTRY(Dict,i)),Dict->ElementSize);
+    return 1;
+}
+
+static int Contains(const FrozenDictionary *Dict,const char *Key)
+{
+    if (Dict == NULL)  {
+        return NullPtrError("Contains");
+    }
+    if (Key == NULL)
+        return BadArgError(Dict,"Contains");
+    return Lookup(Dict,Key) != NOT_FOUND;
+}
+
+/* The other dictionary can have any implementation: it is queried
+   through its own interface */
+static int Equal(const FrozenDictionary *d1,const Dictionary *d2)
+{
+    size_t i;
+    DictionaryInterface *intf;
+
+    if ((const void *)d1 == (const void *)d2) return 1;
+    if (d1 == NULL || d2 == NULL)
+        return 0;
+    intf = *(DictionaryInterface **)d2;
+    if (intf->Size(d2) != d1->count || intf->GetElementSize(d2) != d1->ElementSize)
+        return 0;
+    for (i = 0; i < d1->size; i++) {
+        struct FrozenEntry *e = ENTRY(d1,i);
+        void *p = intf->GetElement(d2,KEY(d1,e));
+        if (p == NULL)
+            return 0;
+        if (d1->ElementSize && memcmp(p,VALUE(e),d1->ElementSize))
+            return 0;
+    }
+    return 1;
+}
+
+static int Add(FrozenDictionary *Dict,const char *Key,const void *Value)
+{
+    if (Dict == NULL)
+        return NullPtrError("Add");
+    return ReadOnlyError(Dict,"Add");
+}
+
+static int Insert(FrozenDictionary *Dict,const char *Key,const void *Value)
+{
+    if (Dict == NULL)
+        return NullPtrError("Insert");
+    return ReadOnlyError(Dict,"Insert");
+}
+
+static int Replace(FrozenDictionary *Dict,const char *Key,const void *Value)
+{
+    if (Dict == NULL)
+        return NullPtrError("Replace");
+    return ReadOnlyError(Dict,"Replace");
+}
+
+static int Erase(FrozenDictionary *Dict,const char *Key)
+{
+    if (Dict == NULL)
+        return NullPtrError("Erase");
+    return ReadOnlyError(Dict,"Erase");
+}
+
+static int Clear(FrozenDictionary *Dict)
+{
+    if (Dict == NULL)
+        return NullPtrError("Clear");
+    return ReadOnlyError(Dict,"Clear");
+}
+
+static int InsertIn(FrozenDictionary *dst,Dictionary *src)
+{
+    if (dst == NULL)
+        return NullPtrError("InsertIn");
+    return ReadOnlyError(dst,"InsertIn");
+}
+
+static size_t Size(const FrozenDictionary *Dict)
+{
+    if (Dict == NULL) {
+        NullPtrError("Size");
+        return 0;
+    }
+    return Dict->count;
+}
+
+static unsigned GetFlags(const FrozenDictionary *Dict)
+{
+    if (Dict == NULL) {
+        NullPtrError("GetFlags");
+        return 0;
+    }
+    return Dict->Flags;
+}
+
+static unsigned SetFlags(FrozenDictionary *Dict,unsigned Flags)
+{
+    unsigned oldFlags;
+    if (Dict == NULL) {
+        NullPtrError("SetFlags");
+        return 0;
+    }
+    oldFlags = Dict->Flags;
+    Dict->Flags = Flags;
+    return oldFlags;
+}
+
+/* The data goes from the displacements to the end of the keys, in
+   the block of a frozen dictionary as well as in a snapshot */
+static size_t DataSize(const FrozenDictionary *d)
+{
+    return (size_t)(d->Keys - (char *)d->Displacement) + d->KeysSize;
+}
+
+static size_t Sizeof(const FrozenDictionary *dict)
+{
+    if (dict == NULL) {
+        return sizeof(FrozenDictionary);
+    }
+    if (dict->Mapping)
+        return sizeof(*dict) + DataSize(dict);
+    return dict->BlockSize;
+}
+
+static int Apply(FrozenDictionary *Dict,int (*apply)(const char *Key,const void *Value, void *ExtraArgs),
+    void *ExtraArgs)
+{
+    size_t i;
+
+    if (Dict == NULL) {
+        return	NullPtrError("Apply");
+    }
+    if (apply == NULL)
+        return BadArgError(Dict,"Apply");
+    for (i = 0; i < Dict->size; i++) {
+        struct FrozenEntry *e = ENTRY(Dict,i);
+        apply(KEY(Dict,e),Dict->ElementSize ? VALUE(e) : NULL,ExtraArgs);
+    }
+    return 1;
+}
+
+static int Finalize(FrozenDictionary *Dict)
+{
+    size_t i;
+
+    if (Dict == NULL)
+        return NullPtrError("Finalize");
+    if (Dict->Flags & CONTAINER_HAS_OBSERVER)
+        iObserver.Notify(Dict,CCL_FINALIZE,NULL,NULL);
+    if (Dict->Mapping) {
+        /* The values are in a read only file mapping: no destructor */
+#ifdef UNIX
+        munmap(Dict->Mapping,Dict->MappingSize);
+#else
+        Dict->Allocator->free(Dict->Mapping);
+#endif
+    }
+    else if (Dict->DestructorFn && Dict->ElementSize) {
+        for (i = 0; i < Dict->size; i++)
+            Dict->DestructorFn(VALUE(ENTRY(Dict,i)));
+    }
+    Dict->Allocator->free(Dict);
+    return 1;
+}
+
+static ErrorFunction SetErrorFunction(FrozenDictionary *Dict,ErrorFunction fn)
+{
+    ErrorFunction old;
+    if (Dict == NULL) { return iError.RaiseError; }
+    old = Dict->RaiseError;
+    if (fn) Dict->RaiseError = fn;
+    return old;
+}
+
+static strCollection *GetKeys(const FrozenDictionary *Dict)
+{
+    size_t i;
+    strCollection *result;
+
+    if (Dict == NULL) {
+        NullPtrError("GetKeys");
+        return 0;
+    }
+    result = istrCollection.Create(Dict->count);
+    if (result == NULL)
+        return NULL;
+    for (i = 0; i < Dict->size; i++)
+        istrCollection.Add(result,KEY(Dict,ENTRY(Dict,i)));
+    return result;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                                Iterators                                       */
+/* ------------------------------------------------------------------------------ */
+static size_t GetPosition(Iterator *it)
+{
+    struct FrozenDictionaryIterator *d = (struct FrozenDictionaryIterator *)it;
+    return d->index;
+}
+
+static void *GetNext(Iterator *it)
+{
+    struct FrozenDictionaryIterator *d = (struct FrozenDictionaryIterator *)it;
+    FrozenDictionary *Dict;
+    struct FrozenEntry *e;
+
+    if (it == NULL) {
+        NullPtrError("GetNext");
+        return NULL;
+    }
+    Dict = d->Dict;
+    if (d->index >= Dict->size)
+        return NULL;
+    e = ENTRY(Dict,d->index);
+    d->index++;
+    return Dict->ElementSize ? VALUE(e) : KEY(Dict,e);
+}
+
+static void *GetFirst(Iterator *it)
+{
+    struct FrozenDictionaryIterator *d = (struct FrozenDictionaryIterator *)it;
+
+    if (it == NULL) {
+        NullPtrError("GetFirst");
+        return NULL;
+    }
+    d->index = 0;
+    return GetNext(it);
+}
+
+static int ReplaceWithIterator(Iterator *it, void *data,int direction)
+{
+    struct FrozenDictionaryIterator *li = (struct FrozenDictionaryIterator *)it;
+
+    if (it == NULL) {
+        return NullPtrError("Replace");
+    }
+    return ReadOnlyError(li->Dict,"Replace");
+}
+
+static void *Seek(Iterator *it, size_t idx)
+{
+    struct FrozenDictionaryIterator *d = (struct FrozenDictionaryIterator *)it;
+
+    if (it == NULL || idx >= d->Dict->size)
+        return NULL;
+    d->index = idx;
+    return GetNext(it);
+}
+
+static int InitIterator(FrozenDictionary *Dict,void *buf)
+{
+    struct FrozenDictionaryIterator *result = buf;
+
+    if (Dict == NULL || buf == NULL) {
+        NullPtrError("InitIterator");
+        return CONTAINER_ERROR_BADARG;
+    }
+    result->it.GetNext = GetNext;
+    result->it.GetPrevious = GetNext;
+    result->it.GetFirst = GetFirst;
+    result->it.Replace = ReplaceWithIterator;
+    result->it.GetPosition = GetPosition;
+    result->it.Seek = Seek;
+    result->Dict = Dict;
+    result->index = 0;
+    result->timestamp = Dict->timestamp;
+    return 1;
+}
+
+static Iterator *NewIterator(FrozenDictionary *Dict)
+{
+    struct FrozenDictionaryIterator *result;
+
+    if (Dict == NULL) {
+        NullPtrError("NewIterator");
+        return NULL;
+    }
+    result = Dict->Allocator->malloc(sizeof(struct FrozenDictionaryIterator));
+    if (result == NULL) {
+        doerrorCall(Dict->RaiseError,"NewIterator",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    InitIterator(Dict,result);
+    return &result->it;
+}
+
+static int DeleteIterator(Iterator *it)
+{
+    struct FrozenDictionaryIterator *d = (struct FrozenDictionaryIterator *)it;
+
+    if (d == NULL) {
+        return NullPtrError("DeleteIterator");
+    }
+    d->Dict->Allocator->free(it);
+    return 1;
+}
+
+static size_t SizeofIterator(const FrozenDictionary *b)
+{
+    return sizeof(struct FrozenDictionaryIterator);
+}
+
+static Vector *CastToArray(const FrozenDictionary *Dict)
+{
+    size_t i;
+    Vector *result;
+
+    if (Dict == NULL) {
+        NullPtrError("CastToArray");
+        return NULL;
+    }
+    if (Dict->ElementSize == 0)
+        return NULL;
+    result = iVector.Create(Dict->ElementSize,Dict->count);
+    if (result == NULL)
+        return NULL;
+    for (i = 0; i < Dict->size; i++)
+        iVector.Add(result,VALUE(ENTRY(Dict,i)));
+    return result;
+}
+
+/* Same file format as the other dictionaries */
+static int Save(const FrozenDictionary *Dict,FILE *stream, SaveFunction saveFn,void *arg)
+{
+    Vector *al;
+    strCollection *sc;
+    int result = 1;
+
+    if (Dict == NULL) {
+        return NullPtrError("Save");
+    }
+    if (stream == NULL) {
+        return BadArgError(Dict,"Save");
+    }
+    if (fwrite(&DictionaryGuid,sizeof(guid),1,stream) == 0) {
+        return EOF;
+    }
+    al = CastToArray(Dict);
+    if (al == NULL)
+        al = iVector.Create(sizeof(int),1);
+    sc = GetKeys(Dict);
+    if ((istrCollection.Save(sc,stream,NULL,NULL) < 0) ||
+        (iVector.Save(al,stream,saveFn,arg) < 0))
+        result = EOF;
+    istrCollection.Finalize(sc);
+    iVector.Finalize(al);
+    return result;
+}
+
+static FrozenDictionary *Load(FILE *stream, ReadFunction readFn, void *arg)
+{
+    strCollection *sc;
+    Vector *al;
+    Dictionary *result;
+    guid Guid;
+
+    if (stream == NULL) {
+        NullPtrError("Load");
+        return NULL;
+    }
+    if (fread(&Guid,sizeof(guid),1,stream) == 0) {
+        iError.RaiseError("iFrozenDictionary.Load",CONTAINER_ERROR_FILE_READ);
+        return NULL;
+    }
+    if (memcmp(&Guid,&DictionaryGuid,sizeof(guid))) {
+        iError.RaiseError("iFrozenDictionary.Load",CONTAINER_ERROR_WRONGFILE);
+        return NULL;
+    }
+    sc = istrCollection.Load(stream,NULL,NULL);
+    if (sc == NULL)
+        return NULL;
+    al = iVector.Load(stream,readFn,arg);
+    if (al == NULL) {
+        istrCollection.Finalize(sc);
+        return NULL;
+    }
+    if (iVector.Size(al) && iVector.Size(al) == istrCollection.Size(sc))
+        result = FreezeStrCollection(sc,iVector.GetElementSize(al),iVector.GetElement(al,0));
+    else result = FreezeStrCollection(sc,0,NULL);
+    istrCollection.Finalize(sc);
+    iVector.Finalize(al);
+    return (FrozenDictionary *)result;
+}
+
+/*------------------------------------------------------------------------
+ Snapshots. A snapshot file holds a header followed by the data of a
+ frozen dictionary (displacements, entries and keys) exactly as it is in
+ memory. All offsets are relative to the start of the data, so the file
+ can be mapped at any address and queried in place.
+------------------------------------------------------------------------*/
+#define SNAPSHOT_VERSION    1
+#define SNAPSHOT_HASH_ID    2           /* iHashFunctions.Hash64 */
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_ALIGN      64
+
+struct SnapshotHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t HashId;
+    uint32_t SizeofSizeT;
+    uint32_t ByteOrder;
+    uint64_t Seed;
+    uint64_t Count;
+    uint64_t NBuckets;
+    uint64_t ElementSize;
+    uint64_t EntrySize;
+    uint64_t EntriesOffset;
+    uint64_t KeysOffset;
+    uint64_t KeysSize;
+    uint64_t DataOffset;
+    uint64_t DataSize;
+    uint64_t DataChecksum;
+    uint64_t HeaderChecksum;
+};
+
+static const char SnapshotMagic[8] = {'C','C','L','S','N','A','P','1'};
+
+static uint64_t Checksum(const void *data,size_t len)
+{
+    const unsigned char *p = data;
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len,w;
+
+    while (len >= sizeof(uint64_t)) {
+        memcpy(&w,p,sizeof(uint64_t));
+        h = Mix64(h ^ w);
+        p += sizeof(uint64_t);
+        len -= sizeof(uint64_t);
+    }
+    if (len) {
+        w = 0;
+        memcpy(&w,p,len);
+        h = Mix64(h ^ w);
+    }
+    return h;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     SaveFrozenSnapshot ID:1
+ Purpose:       Writes a frozen dictionary in the snapshot format
+ Input:         The dictionary and an open binary stream
+ Output:        1 if OK, EOF if writing failed
+ Errors:        BADARG if the stream is NULL
+------------------------------------------------------------------------*/
+int SaveFrozenSnapshot(const FrozenDictionary *Dict,FILE *stream)
+{
+    struct SnapshotHeader hdr;
+    char pad[SNAPSHOT_ALIGN];
+    const char *data;
+
+    if (Dict == NULL)
+        return NullPtrError("SaveSnapshot");
+    if (stream == NULL)
+        return BadArgError(Dict,"SaveSnapshot");
+    data = (const char *)Dict->Displacement;
+    memset(&hdr,0,sizeof(hdr));
+    memcpy(hdr.Magic,SnapshotMagic,sizeof(hdr.Magic));
+    hdr.Version = SNAPSHOT_VERSION;
+    hdr.HashId = SNAPSHOT_HASH_ID;
+    hdr.SizeofSizeT = sizeof(size_t);
+    hdr.ByteOrder = SNAPSHOT_BYTE_ORDER;
+    hdr.Seed = Dict->Seed;
+    hdr.Count = Dict->size;
+    hdr.NBuckets = Dict->NBuckets;
+    hdr.ElementSize = Dict->ElementSize;
+    hdr.EntrySize = Dict->EntrySize;
+    hdr.EntriesOffset = Dict->Entries - data;
+    hdr.KeysOffset = Dict->Keys - data;
+    hdr.KeysSize = Dict->KeysSize;
+    hdr.DataOffset = roundupTo(sizeof(hdr),SNAPSHOT_ALIGN);
+    hdr.DataSize = DataSize(Dict);
+    hdr.DataChecksum = Checksum(data,hdr.DataSize);
+    hdr.HeaderChecksum = Checksum(&hdr,sizeof(hdr));
+    memset(pad,0,sizeof(pad));
+    if (fwrite(&hdr,sizeof(hdr),1,stream) == 0)
+        return EOF;
+    if (hdr.DataOffset > sizeof(hdr) &&
+        fwrite(pad,hdr.DataOffset - sizeof(hdr),1,stream) == 0)
+        return EOF;
+    if (hdr.DataSize && fwrite(data,hdr.DataSize,1,stream) == 0)
+        return EOF;
+    return 1;
+}
+
+/* Checks that the header describes data that fits in the file and that
+   this library can read */
+static int CheckHeader(struct SnapshotHeader *hdr,uint64_t fileSize)
+{
+    uint64_t sum = hdr->HeaderChecksum;
+
+    hdr->HeaderChecksum = 0;
+    if (Checksum(hdr,sizeof(*hdr)) != sum)
+        return 0;
+    hdr->HeaderChecksum = sum;
+    if (hdr->Version != SNAPSHOT_VERSION || hdr->HashId != SNAPSHOT_HASH_ID ||
+        hdr->SizeofSizeT != sizeof(size_t) || hdr->ByteOrder != SNAPSHOT_BYTE_ORDER)
+        return 0;
+    if (hdr->DataOffset < sizeof(*hdr) || hdr->DataOffset % sizeof(uint64_t) ||
+        hdr->DataSize > fileSize || hdr->DataOffset > fileSize - hdr->DataSize)
+        return 0;
+    if (hdr->NBuckets == 0 || hdr->EntrySize < ENTRY_OFFSET + hdr->ElementSize ||
+        hdr->EntrySize % sizeof(uint64_t) ||
+        hdr->EntriesOffset < 2*hdr->NBuckets*sizeof(uint32_t) ||
+        hdr->EntriesOffset % sizeof(uint64_t) ||
+        hdr->KeysOffset < hdr->EntriesOffset ||
+        (hdr->KeysOffset - hdr->EntriesOffset)/hdr->EntrySize < hdr->Count ||
+        hdr->KeysOffset + hdr->KeysSize != hdr->DataSize)
+        return 0;
+    return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     OpenDictionarySnapshot ID:1
+ Purpose:       Opens a snapshot file as a read only dictionary without
+                deserializing it: the file is mapped in memory (read
+                in memory in systems without mmap) and the lookups
+                and iterations read it in place.
+ Input:         The file name and a flag. If VerifyData is not zero
+                the checksum of the whole data is verified, what
+                touches all the pages of the file. The header is
+                always verified.
+ Output:        A dictionary or NULL
+ Errors:        FILEOPEN, FILE_READ, WRONGFILE, NOMEMORY
+------------------------------------------------------------------------*/
+Dictionary *OpenDictionarySnapshot(const char *FileName,int VerifyData)
+{
+    struct SnapshotHeader hdr;
+    FrozenDictionary *d;
+    char *mapping,*data;
+    uint64_t fileSize;
+    FILE *f;
+#ifdef UNIX
+    struct stat st;
+    int fd;
+#endif
+
+    if (FileName == NULL) {
+        NullPtrError("OpenSnapshot");
+        return NULL;
+    }
+    f = fopen(FileName,"rb");
+    if (f == NULL) {
+        iError.RaiseError("iFrozenDictionary.OpenSnapshot",CONTAINER_ERROR_FILEOPEN);
+        return NULL;
+    }
+    if (fread(&hdr,sizeof(hdr),1,f) == 0) {
+        fclose(f);
+        iError.RaiseError("iFrozenDictionary.OpenSnapshot",CONTAINER_ERROR_FILE_READ);
+        return NULL;
+    }
+    if (memcmp(hdr.Magic,SnapshotMagic,sizeof(hdr.Magic))) {
+        fclose(f);
+        iError.RaiseError("iFrozenDictionary.OpenSnapshot",CONTAINER_ERROR_WRONGFILE);
+        return NULL;
+    }
+    fseek(f,0,SEEK_END);
+    fileSize = ftell(f);
+    if (!CheckHeader(&hdr,fileSize)) {
+        fclose(f);
+        iError.RaiseError("iFrozenDictionary.OpenSnapshot",CONTAINER_ERROR_WRONGFILE);
+        return NULL;
+    }
+#ifdef UNIX
+    fclose(f);
+    fd = open(FileName,O_RDONLY);
+    if (fd < 0 || fstat(fd,&st) < 0 || (uint64_t)st.st_size != fileSize) {
+        if (fd >= 0) close(fd);
+        iError.RaiseError("iFrozenDictionary.OpenSnapshot",CONTAINER_ERROR_FILEOPEN);
+        return NULL;
+    }
+    mapping = mmap(NULL,fileSize,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        iError.RaiseError("iFrozenDictionary.OpenSnapshot",CONTAINER_ERROR_FILE_READ);
+        return NULL;
+    }
+#else
+    mapping = CurrentAllocator->malloc(fileSize);
+    if (mapping == NULL) {
+        fclose(f);
+        iError.RaiseError("iFrozenDictionary.OpenSnapshot",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    fseek(f,0,SEEK_SET);
+    if (fread(mapping,1,fileSize,f) != fileSize) {
+        fclose(f);
+        CurrentAllocator->free(mapping);
+        iError.RaiseError("iFrozenDictionary.OpenSnapshot",CONTAINER_ERROR_FILE_READ);
+        return NULL;
+    }
+    fclose(f);
+#endif
+    data = mapping + hdr.DataOffset;
+    d = NULL;
+    if (!VerifyData || Checksum(data,hdr.DataSize) == hdr.DataChecksum)
+        d = CurrentAllocator->malloc(sizeof(FrozenDictionary));
+    if (d == NULL) {
+#ifdef UNIX
+        munmap(mapping,fileSize);
+#else
+        CurrentAllocator->free(mapping);
+#endif
+        iError.RaiseError("iFrozenDictionary.OpenSnapshot",
+                          VerifyData ? CONTAINER_ERROR_WRONGFILE : CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    memset(d,0,sizeof(*d));
+    d->VTable = &iFrozenDictionary;
+    d->count = d->size = hdr.Count;
+    d->RaiseError = iError.RaiseError;
+    d->ElementSize = hdr.ElementSize;
+    d->Allocator = CurrentAllocator;
+    d->Seed = hdr.Seed;
+    d->NBuckets = hdr.NBuckets;
+    d->Displacement = (uint32_t *)data;
+    d->Entries = data + hdr.EntriesOffset;
+    d->EntrySize = hdr.EntrySize;
+    d->Keys = data + hdr.KeysOffset;
+    d->KeysSize = hdr.KeysSize;
+    d->BlockSize = sizeof(FrozenDictionary);
+    d->Mapping = mapping;
+    d->MappingSize = fileSize;
+    return (Dictionary *)d;
+}
+
+static int SaveSnapshot(const FrozenDictionary *Dict,FILE *stream)
+{
+    return SaveFrozenSnapshot(Dict,stream);
+}
+
+/* The keys are already packed in the block of the dictionary */
+static int UseKeyArena(FrozenDictionary *Dict,Dictionary *InternTable)
+{
+    if (Dict == NULL)
+        return NullPtrError("UseKeyArena");
+    return ReadOnlyError(Dict,"UseKeyArena");
+}
+
+/* The keys of a frozen dictionary are found with a single probe whatever
+   they are: there is nothing to seed */
+static int SetSeed(FrozenDictionary *Dict,uint64_t Seed)
+{
+    if (Dict == NULL)
+        return NullPtrError("SetSeed");
+    return ReadOnlyError(Dict,"SetSeed");
+}
+
+static FrozenDictionary *Copy(const FrozenDictionary *src)
+{
+    FrozenDictionary *result;
+    char *base;
+    size_t dataOffset,dataSize;
+
+    if (src == NULL) {
+        NullPtrError("Copy");
+        return NULL;
+    }
+    dataOffset = roundupTo(sizeof(FrozenDictionary),sizeof(uint64_t));
+    dataSize = DataSize(src);
+    result = src->Allocator->malloc(dataOffset + dataSize);
+    if (result == NULL) {
+        doerrorCall(src->RaiseError,"Copy",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    *result = *src;
+    base = (char *)result + dataOffset;
+    memcpy(base,src->Displacement,dataSize);
+    result->Displacement = (uint32_t *)base;
+    result->Entries = base + (src->Entries - (char *)src->Displacement);
+    result->Keys = base + (src->Keys - (char *)src->Displacement);
+    result->BlockSize = dataOffset + dataSize;
+    result->Mapping = NULL;
+    result->MappingSize = 0;
+    result->Flags &= ~CONTAINER_HAS_OBSERVER;
+    return result;
+}
+
+static Dictionary *Freeze(const FrozenDictionary *Dict)
+{
+    return (Dictionary *)Copy(Dict);
+}
+
+static size_t GetElementSize(const FrozenDictionary *d)
+{
+    if (d == NULL) {
+        NullPtrError("GetElementSize");
+        return 0;
+    }
+    return d->ElementSize;
+}
+
+static const ContainerAllocator *GetAllocator(const FrozenDictionary *AL)
+{
+    if (AL == NULL) {
+        return NULL;
+    }
+    return AL->Allocator;
+}
+
+/* An empty frozen dictionary: the hint is ignored since nothing can be
+   added. */
+static FrozenDictionary *CreateWithAllocator(size_t elementsize,size_t hint,const ContainerAllocator *allocator)
+{
+    return (FrozenDictionary *)FreezeDictionary(0,NULL,NULL,elementsize,allocator);
+}
+
+static FrozenDictionary *Create(size_t elementsize,size_t hint)
+{
+    return CreateWithAllocator(elementsize,hint,CurrentAllocator);
+}
+
+/* The size of a frozen dictionary depends on its keys: it can't be
+   built in storage given by the caller */
+static FrozenDictionary *InitWithAllocator(FrozenDictionary *Dict,size_t elementsize,size_t hint,const ContainerAllocator *allocator)
+{
+    iError.RaiseError("iFrozenDictionary.Init",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return NULL;
+}
+
+static FrozenDictionary *Init(FrozenDictionary *dict,size_t elementsize,size_t hint)
+{
+    return InitWithAllocator(dict, elementsize, hint, CurrentAllocator);
+}
+
+static FrozenDictionary *InitializeWith(size_t elementSize,size_t n, const char **Keys,const void *Values)
+{
+    const void **values;
+    size_t i;
+    Dictionary *result;
+
+    values = CurrentAllocator->malloc((n+1)*sizeof(void *));
+    if (values == NULL) {
+        iError.RaiseError("iFrozenDictionary.InitializeWith",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    for (i = 0; i < n; i++)
+        values[i] = Values ? (const char *)Values + i*elementSize : NULL;
+    result = FreezeDictionary(n,Keys,values,elementSize,CurrentAllocator);
+    CurrentAllocator->free(values);
+    return (FrozenDictionary *)result;
+}
+
+static DestructorFunction SetDestructor(FrozenDictionary *cb,DestructorFunction fn)
+{
+    DestructorFunction oldfn;
+    if (cb == NULL)
+        return NULL;
+    oldfn = cb->DestructorFn;
+    if (fn)
+        cb->DestructorFn = fn;
+    return oldfn;
+}
+
+/* The table is built with its own seeded hash: the user hash function
+   is not used */
+static HashFunction SetHashFunction(FrozenDictionary *d,HashFunction newFn)
+{
+    if (d == NULL)
+        return NULL;
+    return d->hash;
+}
+
+static double GetLoadFactor(FrozenDictionary *d)
+{
+    return d->size ? 1.0 : 0.0;
+}
+
+static double SetMaxLoadFactor(FrozenDictionary *d,double newMax)
+{
+    if (d == NULL) {
+        NullPtrError("SetMaxLoadFactor");
+        return 0;
+    }
+    ReadOnlyError(d,"SetMaxLoadFactor");
+    return 1.0;
+}
+
+static int GetElements(const FrozenDictionary *Dict,size_t n,const char **Keys,void **Results)
+{
+    size_t i,k;
+    int found = 0;
+
+    if (Dict == NULL)
+        return NullPtrError("GetElements");
+    if (n && (Keys == NULL || Results == NULL))
+        return BadArgError(Dict,"GetElements");
+    for (i = 0; i < n; i++) {
+        if (Keys[i] == NULL)
+            return BadArgError(Dict,"GetElements");
+        k = Lookup(Dict,Keys[i]);
+        if (k == NOT_FOUND)
+            Results[i] = NULL;
+        else {
+            struct FrozenEntry *e = ENTRY(Dict,k);
+            Results[i] = Dict->ElementSize ? VALUE(e) : KEY(Dict,e);
+            found++;
+        }
+    }
+    return found;
+}
+
+static int ContainsMany(const FrozenDictionary *Dict,size_t n,const char **Keys,unsigned char *Results)
+{
+    size_t i;
+    int found = 0;
+
+    if (Dict == NULL)
+        return NullPtrError("ContainsMany");
+    if (n && (Keys == NULL || Results == NULL))
+        return BadArgError(Dict,"ContainsMany");
+    for (i = 0; i < n; i++) {
+        if (Keys[i] == NULL)
+            return BadArgError(Dict,"ContainsMany");
+        Results[i] = Lookup(Dict,Keys[i]) != NOT_FOUND;
+        found += Results[i];
+    }
+    return found;
+}
+
+/* A lookup reads one displacement and one entry: every probe length is
+   one, and the table never resizes */
+static int GetStatistics(const FrozenDictionary *Dict,HashStatistics *Stats)
+{
+    size_t i;
+
+    if (Dict == NULL)
+        return NullPtrError("GetStatistics");
+    if (Stats == NULL)
+        return BadArgError(Dict,"GetStatistics");
+    HashStatsInit(Stats,Dict->size);
+    for (i = 0; i < Dict->count; i++)
+        HashStatsProbe(Stats,1);
+    Stats->KeyBytes = Dict->KeysSize;
+    HashStatsFinish(Stats,Dict->ElementSize,Sizeof(Dict) - Dict->KeysSize);
+    return 1;
+}
+
+DictionaryInterface iFrozenDictionary = {
+    (size_t (*)(const Dictionary *))Size,
+    (unsigned (*)(const Dictionary *))GetFlags,
+    (unsigned (*)(Dictionary *,unsigned))SetFlags,
+    (int (*)(Dictionary *))Clear,
+    (int (*)(const Dictionary *,const char *))Contains,
+    (int (*)(Dictionary *,const char *))Erase,
+    (int (*)(Dictionary *))Finalize,
+    (int (*)(Dictionary *,int (*)(const char *,const void *,void *),void *))Apply,
+    (int (*)(const Dictionary *,const Dictionary *))Equal,
+    (Dictionary *(*)(const Dictionary *))Copy,
+    (ErrorFunction (*)(Dictionary *,ErrorFunction))SetErrorFunction,
+    (size_t (*)(const Dictionary *))Sizeof,
+    (Iterator *(*)(Dictionary *))NewIterator,
+    (int (*)(Dictionary *,void *))InitIterator,
+    DeleteIterator,
+    (size_t (*)(const Dictionary *))SizeofIterator,
+    (int (*)(const Dictionary *,FILE *,SaveFunction,void *))Save,
+    (Dictionary *(*)(FILE *,ReadFunction,void *))Load,
+    (size_t (*)(const Dictionary *))GetElementSize,
+    (int (*)(Dictionary *,const char *,const void *))Add,
+    (void *(*)(const Dictionary *,const char *))GetElement,
+    (int (*)(Dictionary *,const char *,const void *))Replace,
+    (int (*)(Dictionary *,const char *,const void *))Insert,
+    (Vector *(*)(const Dictionary *))CastToArray,
+    (int (*)(const Dictionary *,const char *,void *))CopyElement,
+    (int (*)(Dictionary *,Dictionary *))InsertIn,
+    (Dictionary *(*)(size_t,size_t))Create,
+    (Dictionary *(*)(size_t,size_t,const ContainerAllocator *))CreateWithAllocator,
+    (Dictionary *(*)(Dictionary *,size_t,size_t))Init,
+    (Dictionary *(*)(Dictionary *,size_t,size_t,const ContainerAllocator *))InitWithAllocator,
+    (strCollection *(*)(const Dictionary *))GetKeys,
+    (const ContainerAllocator *(*)(const Dictionary *))GetAllocator,
+    (DestructorFunction (*)(Dictionary *,DestructorFunction))SetDestructor,
+    (Dictionary *(*)(size_t,size_t,const char **,const void *))InitializeWith,
+    (HashFunction (*)(Dictionary *,HashFunction))SetHashFunction,
+    (double (*)(Dictionary *))GetLoadFactor,
+    (double (*)(Dictionary *,double))SetMaxLoadFactor,
+    (int (*)(const Dictionary *,size_t,const char **,void **))GetElements,
+    (int (*)(const Dictionary *,size_t,const char **,unsigned char *))ContainsMany,
+    (Dictionary *(*)(const Dictionary *))Freeze,
+    FreezeStrCollection,
+    (int (*)(const Dictionary *,FILE *))SaveSnapshot,
+    OpenDictionarySnapshot,
+    (int (*)(Dictionary *,Dictionary *))UseKeyArena,
+    (int (*)(Dictionary *,uint64_t))SetSeed,
+    (int (*)(const Dictionary *,HashStatistics *))GetStatistics,
+};
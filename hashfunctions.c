@@ -0,0 +1,353 @@
+/*------------------------------------------------------------------------
+ Module:        hashfunctions.c
+ Author:        jacob
+ Project:       Containers
+ State:
+ Creation Date:
+ Description:   String hash functions that can be given to the
+                SetHashFunction function of the dictionaries and of the
+                hash table.
+                Times33 is the byte at a time function used by default
+                by the dictionaries. The other functions find the
+                length of the key first (strlen is vectorized by the C
+                library) and then read the key 8 or 16 bytes at a time,
+                so they are much faster on long keys, and every bit of
+                the key affects every bit of the result.
+                Murmur is MurmurHash64A by Austin Appleby, Wy follows
+                the wyhash design by Wang Yi (both in the public
+                domain). Hash64 is the seeded 64 bit version of Wy,
+                for hashing any block of bytes. RandomSeed returns
+                seeds for it that can't be guessed from outside the
+                process, so the hashes of the keys can't be predicted.
+------------------------------------------------------------------------*/
+#include <time.h>
+#include "containers.h"
+#include "ccl_internal.h"
+
+#define MURMUR_M    0xc6a4a7935bd1e995ULL
+#define MURMUR_SEED 0x9E3779B97F4A7C15ULL
+#define WY_S0       0xa0761d6478bd642fULL
+#define WY_S1       0xe7037ed1a0b428dbULL
+#define WY_S2       0x8ebc6af09c88c6e3ULL
+#define WY_S3       0x589965cc75374cc3ULL
+#define WY_SEED     0x2d358dccaa6c78a5ULL
+
+/* Unaligned reads. The compilers turn the memcpy into a single load. */
+static uint64_t Read64(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+static uint64_t Read32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v,p,sizeof(v));
+    return v;
+}
+
+/* Full 64x64 bit product: the low half in *a, the high half in *b */
+static void Mul128(uint64_t *a,uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha*hb, rm0 = ha*lb, rm1 = hb*la, rl = la*lb;
+    uint64_t t = rl + (rm0 << 32), lo, carry = t < rl;
+
+    lo = t + (rm1 << 32);
+    carry += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+static uint64_t Mum(uint64_t a,uint64_t b)
+{
+    Mul128(&a,&b);
+    return a ^ b;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Hash64 ID:1
+ Purpose:       Hashes a block of bytes with a seed. Keys shorter than
+                16 bytes are read with at most 4 overlapping loads,
+                longer keys 16 or 48 bytes per round, each round being
+                one or three 64x64->128 bit multiplications.
+ Input:         The bytes, their number and the seed
+ Output:        The 64 bit hash
+ Errors:        None
+------------------------------------------------------------------------*/
+static uint64_t Hash64(const void *key,size_t len,uint64_t seed)
+{
+    const unsigned char *p = key;
+    uint64_t a,b;
+    size_t i;
+
+    seed ^= Mum(seed ^ WY_S0,WY_S1);
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t off = (len >> 3) << 2;
+            a = (Read32(p) << 32) | Read32(p+off);
+            b = (Read32(p+len-4) << 32) | Read32(p+len-4-off);
+        }
+        else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len-1];
+            b = 0;
+        }
+        else a = b = 0;
+    }
+    else {
+        i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = Mum(Read64(p) ^ WY_S1,Read64(p+8) ^ seed);
+                see1 = Mum(Read64(p+16) ^ WY_S2,Read64(p+24) ^ see1);
+                see2 = Mum(Read64(p+32) ^ WY_S3,Read64(p+40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = Mum(Read64(p) ^ WY_S1,Read64(p+8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = Read64(p+i-16);
+        b = Read64(p+i-8);
+    }
+    a ^= WY_S1;
+    b ^= seed;
+    Mul128(&a,&b);
+    return Mum(a ^ WY_S0 ^ len,b ^ WY_S1);
+}
+
+static uint64_t Murmur64(const void *key,size_t len,uint64_t seed)
+{
+    const unsigned char *p = key,*end = p + (len & ~(size_t)7);
+    uint64_t h = seed ^ (len * MURMUR_M),k;
+
+    for (; p != end; p += 8) {
+        k = Read64(p);
+        k *= MURMUR_M;
+        k ^= k >> 47;
+        k *= MURMUR_M;
+        h ^= k;
+        h *= MURMUR_M;
+    }
+    switch (len & 7) {
+        case 7: h ^= (uint64_t)p[6] << 48;
+        case 6: h ^= (uint64_t)p[5] << 40;
+        case 5: h ^= (uint64_t)p[4] << 32;
+        case 4: h ^= (uint64_t)p[3] << 24;
+        case 3: h ^= (uint64_t)p[2] << 16;
+        case 2: h ^= (uint64_t)p[1] << 8;
+        case 1: h ^= (uint64_t)p[0];
+                h *= MURMUR_M;
+    }
+    h ^= h >> 47;
+    h *= MURMUR_M;
+    h ^= h >> 47;
+    return h;
+}
+
+static size_t Times33(const char *key)
+{
+    size_t Hash = 0;
+    const unsigned char *p;
+
+    for (p = (const unsigned char *)key; *p; p++) {
+        Hash = Hash * 33 + *p;
+    }
+    return Hash;
+}
+
+static size_t Murmur(const char *key)
+{
+    return (size_t)Murmur64(key,strlen(key),MURMUR_SEED);
+}
+
+static size_t Wy(const char *key)
+{
+    return (size_t)Hash64(key,strlen(key),WY_SEED);
+}
+
+static size_t WMurmur(const wchar_t *key)
+{
+    return (size_t)Murmur64(key,wcslen(key)*sizeof(wchar_t),MURMUR_SEED);
+}
+
+static size_t WWy(const wchar_t *key)
+{
+    return (size_t)Hash64(key,wcslen(key)*sizeof(wchar_t),WY_SEED);
+}
+
+/* Versions for the hash table. A length of (size_t)-1 means a zero
+   terminated key, and its length is returned in *klen. */
+static uint64_t GeneralMurmur(const char *key,size_t *klen)
+{
+    if (*klen == (size_t)-1)
+        *klen = strlen(key);
+    return Murmur64(key,*klen,MURMUR_SEED);
+}
+
+static uint64_t GeneralWy(const char *key,size_t *klen)
+{
+    if (*klen == (size_t)-1)
+        *klen = strlen(key);
+    return Hash64(key,*klen,WY_SEED);
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     RandomSeed ID:1
+ Purpose:       Returns a random seed for Hash64. The system random
+                source is used if there is one, otherwise the clock,
+                some addresses and a counter are hashed together.
+ Input:         None
+ Output:        A seed that is never zero
+ Errors:        None
+------------------------------------------------------------------------*/
+static uint64_t RandomSeed(void)
+{
+    static uint64_t counter;
+    uint64_t seed = 0,v[4];
+#ifdef UNIX
+    FILE *f = fopen("/dev/urandom","rb");
+
+    if (f) {
+        if (fread(&seed,sizeof(seed),1,f) != 1)
+            seed = 0;
+        fclose(f);
+    }
+#endif
+    if (seed == 0) {
+        v[0] = (uint64_t)time(NULL);
+        v[1] = (uint64_t)clock();
+        v[2] = (uint64_t)(uintptr_t)&v;
+        v[3] = ++counter;
+        seed = Hash64(v,sizeof(v),(uint64_t)(uintptr_t)&counter);
+    }
+    return seed ? seed : WY_SEED;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*              Statistics of the dictionaries and hash tables                    */
+/* ------------------------------------------------------------------------------ */
+#define LAST_BAR (HASH_STATISTICS_HISTOGRAM-1)
+
+void HashStatsInit(HashStatistics *s,size_t Slots)
+{
+    memset(s,0,sizeof(*s));
+    s->Slots = Slots;
+}
+
+/* An entry that doesn't occupy a slot of its own */
+void HashStatsEntry(HashStatistics *s,size_t probes)
+{
+    s->Count++;
+    s->ProbeLength[probes <= LAST_BAR ? probes-1 : LAST_BAR]++;
+    if (probes > s->MaxProbeLength)
+        s->MaxProbeLength = probes;
+    s->MeanProbeLength += (double)probes;
+}
+
+/* The i-th entry of a chain is found after reading i+1 entries */
+void HashStatsChain(HashStatistics *s,size_t length)
+{
+    size_t i;
+
+    if (length == 0)
+        return;
+    s->UsedSlots++;
+    s->Occupancy[length < LAST_BAR ? length : LAST_BAR]++;
+    for (i = 1; i <= length; i++)
+        HashStatsEntry(s,i);
+}
+
+/* An entry of an open addressing table, found after reading probes
+   slots or groups */
+void HashStatsProbe(HashStatistics *s,size_t probes)
+{
+    s->UsedSlots++;
+    s->Occupancy[1]++;
+    HashStatsEntry(s,probes);
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     HashStatsFinish ID:1
+ Purpose:       Computes the fields that depend on the counts: the
+                averages, the empty slots and the memory that isn't
+                used by the values
+ Input:         The statistics, the size of the values and the memory
+                used by the container without its keys
+ Output:        None
+ Errors:        None
+------------------------------------------------------------------------*/
+void HashStatsFinish(HashStatistics *s,size_t ElementSize,size_t Sizeof)
+{
+    if (s->Count)
+        s->MeanProbeLength /= (double)s->Count;
+    if (s->Slots) {
+        s->LoadFactor = (double)s->Count/s->Slots;
+        s->Occupancy[0] = s->Slots - s->UsedSlots;
+    }
+    s->ValueBytes = s->Count*ElementSize;
+    s->MetadataBytes = Sizeof > s->ValueBytes ? Sizeof - s->ValueBytes : 0;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                 Resumable scans of the hash tables                             */
+/* ------------------------------------------------------------------------------ */
+static size_t ReverseBits(size_t v)
+{
+    size_t r = 0;
+    unsigned i;
+
+    for (i = 0; i < 8*sizeof(size_t); i++) {
+        r = (r << 1) | (v & 1);
+        v >>= 1;
+    }
+    return r;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     HashScanNext ID:1
+ Purpose:       Gives the bucket that follows the given one in a scan.
+                The cursor is incremented on its reversed bits: the
+                high bits of the bucket index change first. If the
+                table doubles between two slices of a scan, each bucket
+                already visited becomes two buckets that are before the
+                new cursor; if it is halved, the buckets still to visit
+                hold all the entries not yet returned. No entry present
+                during the whole scan is missed; after a shrink some
+                can be returned twice.
+ Input:         The cursor (the bucket just visited) and the mask of
+                the table (number of buckets - 1)
+ Output:        The next cursor, zero when all buckets were visited
+ Errors:        None
+------------------------------------------------------------------------*/
+size_t HashScanNext(size_t cursor,size_t mask)
+{
+    cursor |= ~mask;
+    cursor = ReverseBits(cursor);
+    cursor++;
+    return ReverseBits(cursor);
+}
+
+HashFunctionsInterface iHashFunctions = {
+    Times33,
+    Murmur,
+    Wy,
+    WMurmur,
+    WWy,
+    GeneralMurmur,
+    GeneralWy,
+    Hash64,
+    RandomSeed,
+};
@@ -0,0 +1,662 @@
+/*------------------------------------------------------------------------
+ Module:        hashmapgen.c
+ Author:        jacob
+ Project:       Containers
+ State:
+ Creation Date:
+ Description:   Template implementation of a hash map from KEY_TYPE to
+                DATA_TYPE. Besides the parameters of hashmapgen.h the
+                parameter file can define:
+                HASH_KEY(k)     An expression giving a 64 bit hash of
+                                the key k. By default the key converted
+                                to uint64_t, good for integer and
+                                pointer keys.
+                KEY_EQUAL(a,b)  An expression true when the keys a and
+                                b are equal. By default a == b.
+                Both are expanded in the code, so the compiler inlines
+                them: a lookup calls no function through a pointer and
+                copies no key or value with memcpy.
+                The table is a Robin Hood open addressing table like
+                iFlatHashTable. The hash is multiplied by the golden
+                ratio and the home slot taken from its top bits, so
+                consecutive integers spread over the whole table. Each
+                slot holds the key, the value and the distance to the
+                home slot: the hashes are not stored, and a rehash
+                computes them again.
+                A pointer returned by GetElement is valid only until
+                the next Add or Insert, since they can grow the table.
+------------------------------------------------------------------------*/
+#include "containers.h"
+#include "ccl_internal.h"
+#include "hashmapgen.h"
+
+#ifndef HASH_KEY
+#define HASH_KEY(k) ((uint64_t)(k))
+#endif
+#ifndef KEY_EQUAL
+#define KEY_EQUAL(a,b) ((a) == (b))
+#endif
+
+#define MIN_SIZE         16
+#define MIN_SHIFT        60     /* 64 - log2(MIN_SIZE) */
+#define MAX_LOAD_FACTOR  0.875
+/* Erase shrinks the table when less than one slot in 8 is used */
+#define SHRINK_RATIO     8
+#define HOME(m,k)        ((size_t)((HASH_KEY(k) * 0x9e3779b97f4a7c15ULL) >> (m)->Shift))
+#define STRINGIFY_(a)    #a
+#define STRINGIFY(a)     STRINGIFY_(a)
+#define MAP_NAME_STRING  STRINGIFY(INTERFACE_NAME(MAP_NAME))
+
+static MAP_TYPE *CreateWithAllocator(size_t n,const ContainerAllocator *allocator);
+
+static int doerrorCall(ErrorFunction err,const char *fnName,int code)
+{
+    char buf[256];
+
+    snprintf(buf,sizeof(buf),"%s.%s",MAP_NAME_STRING,fnName);
+    err(buf,code);
+    return code;
+}
+
+static int NullPtrError(const char *fnName)
+{
+    return doerrorCall(iError.RaiseError,fnName,CONTAINER_ERROR_BADARG);
+}
+
+static int ReadOnlyError(const MAP_TYPE *m,const char *fnName)
+{
+    return doerrorCall(m->RaiseError,fnName,CONTAINER_ERROR_READONLY);
+}
+
+static int NoMemoryError(const MAP_TYPE *m,const char *fnName)
+{
+    return doerrorCall(m->RaiseError,fnName,CONTAINER_ERROR_NOMEMORY);
+}
+
+/* The smallest power of two that holds n entries under the maximum load
+   factor */
+static size_t SizeFor(size_t n,unsigned *shift)
+{
+    size_t size = MIN_SIZE;
+    unsigned s = MIN_SHIFT;
+
+    while (size*MAX_LOAD_FACTOR < n) {
+        size *= 2;
+        s--;
+    }
+    if (shift)
+        *shift = s;
+    return size;
+}
+
+static MAP_SLOT *AllocSlots(const MAP_TYPE *m,size_t size)
+{
+    MAP_SLOT *slots = m->Allocator->malloc(size * sizeof(MAP_SLOT));
+    size_t i;
+
+    if (slots) {
+        for (i = 0; i < size; i++)
+            slots[i].Psl = 0;
+    }
+    return slots;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     FindSlot ID:1
+ Purpose:       Finds the slot of a key. The probe stops at an empty
+                slot or at an entry nearer to its home slot than the
+                key would be.
+ Input:         The map and the key
+ Output:        The slot or NULL
+ Errors:        None
+------------------------------------------------------------------------*/
+static MAP_SLOT *FindSlot(const MAP_TYPE *m,KEY_TYPE key)
+{
+    size_t mask = m->size - 1,i = HOME(m,key);
+    unsigned d;
+    MAP_SLOT *s;
+
+    for (d = 1;; d++, i = (i + 1) & mask) {
+        s = m->Slots + i;
+        if (s->Psl < d)
+            return NULL;
+        if (s->Psl == d && KEY_EQUAL(s->Key,key))
+            return s;
+    }
+}
+
+/* Places the entry e, swapping it with every entry met that is nearer
+   to its home slot. Returns the slot where e itself was stored. */
+static MAP_SLOT *PutEntry(MAP_TYPE *m,MAP_SLOT e)
+{
+    size_t mask = m->size - 1,i = HOME(m,e.Key);
+    MAP_SLOT *s,*result = NULL,tmp;
+
+    e.Psl = 1;
+    for (;; e.Psl++, i = (i + 1) & mask) {
+        s = m->Slots + i;
+        if (s->Psl == 0) {
+            *s = e;
+            return result ? result : s;
+        }
+        if (s->Psl < e.Psl) {
+            tmp = *s;
+            *s = e;
+            e = tmp;
+            if (result == NULL)
+                result = s;
+        }
+    }
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Rehash ID:1
+ Purpose:       Moves all entries into a new table of the given size
+ Input:         The map and the new size (a power of two larger than
+                the number of entries) with its shift
+ Output:        1 or a negative error code
+ Errors:        NOMEMORY. The map is unchanged.
+------------------------------------------------------------------------*/
+static int Rehash(MAP_TYPE *m,size_t newSize,unsigned shift)
+{
+    MAP_SLOT *old = m->Slots,*slots;
+    size_t oldSize = m->size,i;
+
+    slots = AllocSlots(m,newSize);
+    if (slots == NULL)
+        return CONTAINER_ERROR_NOMEMORY;
+    m->Slots = slots;
+    m->size = newSize;
+    m->Shift = shift;
+    for (i = 0; i < oldSize; i++) {
+        if (old[i].Psl)
+            PutEntry(m,old[i]);
+    }
+    m->Allocator->free(old);
+    m->timestamp++;
+    if (newSize != oldSize)
+        m->Resizes++;
+    return 1;
+}
+
+/* Adds an entry whose key is not in the map */
+static MAP_SLOT *NewEntry(MAP_TYPE *m,KEY_TYPE key,DATA_TYPE data)
+{
+    MAP_SLOT e;
+
+    if (m->count + 1 > MAX_LOAD_FACTOR * m->size &&
+        Rehash(m,2*m->size,m->Shift-1) < 0) {
+        NoMemoryError(m,"Add");
+        return NULL;
+    }
+    e.Key = key;
+    e.Data = data;
+    m->count++;
+    m->timestamp++;
+    return PutEntry(m,e);
+}
+
+/* Removes the entry at the given slot, moving back the entries that
+   follow it until an empty slot or an entry at its home slot */
+static void RemoveSlot(MAP_TYPE *m,MAP_SLOT *s)
+{
+    size_t mask = m->size - 1,i = s - m->Slots,j = (i + 1) & mask;
+
+    if (m->DestructorFn)
+        m->DestructorFn(&s->Data);
+    while (m->Slots[j].Psl > 1) {
+        m->Slots[i] = m->Slots[j];
+        m->Slots[i].Psl--;
+        i = j;
+        j = (j + 1) & mask;
+    }
+    m->Slots[i].Psl = 0;
+    m->count--;
+    m->timestamp++;
+}
+
+/* Add grows the table at 7/8 of the slots, Erase shrinks it below 1/8,
+   to half the maximum load */
+static void ShrinkIfSparse(MAP_TYPE *m)
+{
+    size_t n = 2*m->count,size;
+    unsigned shift;
+
+    if (m->size == MIN_SIZE || m->count >= m->size/SHRINK_RATIO)
+        return;
+    size = SizeFor(n > m->Reserved ? n : m->Reserved,&shift);
+    if (size < m->size)
+        Rehash(m,size,shift);
+}
+
+static size_t Size(const MAP_TYPE *m)
+{
+    if (m == NULL) {
+        NullPtrError("Size");
+        return 0;
+    }
+    return m->count;
+}
+
+static unsigned GetFlags(const MAP_TYPE *m)
+{
+    if (m == NULL) {
+        NullPtrError("GetFlags");
+        return 0;
+    }
+    return m->Flags;
+}
+
+static unsigned SetFlags(MAP_TYPE *m,unsigned newval)
+{
+    unsigned oldval;
+
+    if (m == NULL) {
+        NullPtrError("SetFlags");
+        return 0;
+    }
+    oldval = m->Flags;
+    m->Flags = newval;
+    return oldval;
+}
+
+static int Clear(MAP_TYPE *m)
+{
+    size_t i,size;
+    unsigned shift;
+
+    if (m == NULL)
+        return NullPtrError("Clear");
+    if (m->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(m,"Clear");
+    for (i = 0; i < m->size; i++) {
+        if (m->Slots[i].Psl) {
+            if (m->DestructorFn)
+                m->DestructorFn(&m->Slots[i].Data);
+            m->Slots[i].Psl = 0;
+        }
+    }
+    m->count = 0;
+    m->timestamp++;
+    size = SizeFor(m->Reserved,&shift);
+    if (size < m->size)
+        Rehash(m,size,shift);
+    return 1;
+}
+
+static DATA_TYPE *GetElement(const MAP_TYPE *m,KEY_TYPE key)
+{
+    MAP_SLOT *s;
+
+    if (m == NULL) {
+        NullPtrError("GetElement");
+        return NULL;
+    }
+    s = FindSlot(m,key);
+    return s ? &s->Data : NULL;
+}
+
+static int CopyElement(const MAP_TYPE *m,KEY_TYPE key,DATA_TYPE *outbuf)
+{
+    MAP_SLOT *s;
+
+    if (m == NULL || outbuf == NULL)
+        return NullPtrError("CopyElement");
+    s = FindSlot(m,key);
+    if (s == NULL)
+        return 0;
+    *outbuf = s->Data;
+    return 1;
+}
+
+static int Contains(const MAP_TYPE *m,KEY_TYPE key)
+{
+    if (m == NULL)
+        return NullPtrError("Contains");
+    return FindSlot(m,key) != NULL;
+}
+
+/* Adds the key. Returns 1 if the key was added, zero if it was already
+   there: as in iHashTable its value is not changed. */
+static int Add(MAP_TYPE *m,KEY_TYPE key,DATA_TYPE data)
+{
+    if (m == NULL)
+        return NullPtrError("Add");
+    if (m->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(m,"Add");
+    if (FindSlot(m,key))
+        return 0;
+    return NewEntry(m,key,data) ? 1 : CONTAINER_ERROR_NOMEMORY;
+}
+
+/* Changes the value of a key. Returns zero if the key isn't there. */
+static int Replace(MAP_TYPE *m,KEY_TYPE key,DATA_TYPE data)
+{
+    MAP_SLOT *s;
+
+    if (m == NULL)
+        return NullPtrError("Replace");
+    if (m->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(m,"Replace");
+    s = FindSlot(m,key);
+    if (s == NULL)
+        return 0;
+    if (m->DestructorFn)
+        m->DestructorFn(&s->Data);
+    s->Data = data;
+    return 1;
+}
+
+/* Adds the key or changes its value. Returns 1 if the key was added,
+   zero if it was already there. */
+static int Insert(MAP_TYPE *m,KEY_TYPE key,DATA_TYPE data)
+{
+    if (m == NULL)
+        return NullPtrError("Insert");
+    if (m->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(m,"Insert");
+    if (Replace(m,key,data))
+        return 0;
+    return NewEntry(m,key,data) ? 1 : CONTAINER_ERROR_NOMEMORY;
+}
+
+static int Erase(MAP_TYPE *m,KEY_TYPE key)
+{
+    MAP_SLOT *s;
+
+    if (m == NULL)
+        return NullPtrError("Erase");
+    if (m->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(m,"Erase");
+    s = FindSlot(m,key);
+    if (s == NULL)
+        return 0;
+    RemoveSlot(m,s);
+    ShrinkIfSparse(m);
+    return 1;
+}
+
+/* Calls the function for each entry until it returns zero. Returns zero
+   if the scan was stopped, 1 otherwise. */
+static int Apply(MAP_TYPE *m,int (*Applyfn)(KEY_TYPE *key,DATA_TYPE *data,void *arg),void *arg)
+{
+    size_t i;
+
+    if (m == NULL || Applyfn == NULL)
+        return NullPtrError("Apply");
+    for (i = 0; i < m->size; i++) {
+        if (m->Slots[i].Psl &&
+            Applyfn(&m->Slots[i].Key,&m->Slots[i].Data,arg) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+static ErrorFunction SetErrorFunction(MAP_TYPE *m,ErrorFunction fn)
+{
+    ErrorFunction old;
+
+    if (m == NULL)
+        return iError.RaiseError;
+    old = m->RaiseError;
+    if (fn)
+        m->RaiseError = fn;
+    return old;
+}
+
+static DestructorFunction SetDestructor(MAP_TYPE *m,DestructorFunction fn)
+{
+    DestructorFunction old;
+
+    if (m == NULL)
+        return NULL;
+    old = m->DestructorFn;
+    if (fn)
+        m->DestructorFn = fn;
+    return old;
+}
+
+static size_t Sizeof(const MAP_TYPE *m)
+{
+    if (m == NULL)
+        return sizeof(MAP_TYPE);
+    return sizeof(MAP_TYPE) + m->size*sizeof(MAP_SLOT);
+}
+
+/* Makes room for n entries: no Add grows the table until there are
+   more, and Erase doesn't shrink it below that. */
+static int Reserve(MAP_TYPE *m,size_t n)
+{
+    size_t size;
+    unsigned shift;
+
+    if (m == NULL)
+        return NullPtrError("Reserve");
+    if (m->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(m,"Reserve");
+    m->Reserved = n;
+    size = SizeFor(n,&shift);
+    if (size > m->size && Rehash(m,size,shift) < 0)
+        return NoMemoryError(m,"Reserve");
+    return 1;
+}
+
+static int ShrinkToFit(MAP_TYPE *m)
+{
+    size_t size;
+    unsigned shift;
+
+    if (m == NULL)
+        return NullPtrError("ShrinkToFit");
+    m->Reserved = 0;
+    size = SizeFor(m->count,&shift);
+    if (size < m->size && Rehash(m,size,shift) < 0)
+        return NoMemoryError(m,"ShrinkToFit");
+    return 1;
+}
+
+static int GetStatistics(const MAP_TYPE *m,HashStatistics *Stats)
+{
+    size_t i;
+
+    if (m == NULL || Stats == NULL)
+        return NullPtrError("GetStatistics");
+    HashStatsInit(Stats,m->size);
+    for (i = 0; i < m->size; i++) {
+        if (m->Slots[i].Psl)
+            HashStatsProbe(Stats,m->Slots[i].Psl);
+    }
+    Stats->Resizes = m->Resizes;
+    Stats->KeyBytes = m->count*sizeof(KEY_TYPE);
+    HashStatsFinish(Stats,sizeof(DATA_TYPE),Sizeof(m) - Stats->KeyBytes);
+    return 1;
+}
+
+static MAP_TYPE *Copy(const MAP_TYPE *orig)
+{
+    MAP_TYPE *m;
+
+    if (orig == NULL) {
+        NullPtrError("Copy");
+        return NULL;
+    }
+    m = orig->Allocator->malloc(sizeof(MAP_TYPE));
+    if (m == NULL) {
+        NoMemoryError(orig,"Copy");
+        return NULL;
+    }
+    *m = *orig;
+    m->Slots = orig->Allocator->malloc(orig->size*sizeof(MAP_SLOT));
+    if (m->Slots == NULL) {
+        orig->Allocator->free(m);
+        NoMemoryError(orig,"Copy");
+        return NULL;
+    }
+    memcpy(m->Slots,orig->Slots,orig->size*sizeof(MAP_SLOT));
+    m->Flags &= ~CONTAINER_READONLY;
+    m->timestamp = 0;
+    return m;
+}
+
+static int Finalize(MAP_TYPE *m)
+{
+    int r = Clear(m);
+
+    if (r < 0)
+        return r;
+    m->Allocator->free(m->Slots);
+    m->Allocator->free(m);
+    return 1;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                                Iterators                                       */
+/* ------------------------------------------------------------------------------ */
+/* The iterators return a pointer to the value. GetKey returns the key of
+   the current entry. */
+static void *GetNext(Iterator *it)
+{
+    struct ITERATOR(MAP_NAME) *mi = (struct ITERATOR(MAP_NAME) *)it;
+    MAP_TYPE *m = mi->Map;
+
+    if (mi->timestamp != m->timestamp) {
+        doerrorCall(m->RaiseError,"GetNext",CONTAINER_ERROR_OBJECT_CHANGED);
+        return NULL;
+    }
+    while (mi->index < m->size) {
+        MAP_SLOT *s = m->Slots + mi->index++;
+        if (s->Psl) {
+            mi->Current = s;
+            return &s->Data;
+        }
+    }
+    mi->Current = NULL;
+    return NULL;
+}
+
+static void *GetFirst(Iterator *it)
+{
+    struct ITERATOR(MAP_NAME) *mi = (struct ITERATOR(MAP_NAME) *)it;
+
+    mi->index = 0;
+    mi->timestamp = mi->Map->timestamp;
+    return GetNext(it);
+}
+
+static void *GetCurrent(Iterator *it)
+{
+    struct ITERATOR(MAP_NAME) *mi = (struct ITERATOR(MAP_NAME) *)it;
+
+    return mi->Current ? &mi->Current->Data : NULL;
+}
+
+static void *GetPrevious(Iterator *it)
+{
+    return NULL;
+}
+
+static KEY_TYPE *GetKey(Iterator *it)
+{
+    struct ITERATOR(MAP_NAME) *mi = (struct ITERATOR(MAP_NAME) *)it;
+
+    if (mi == NULL) {
+        NullPtrError("GetKey");
+        return NULL;
+    }
+    return mi->Current ? &mi->Current->Key : NULL;
+}
+
+static Iterator *NewIterator(MAP_TYPE *m)
+{
+    struct ITERATOR(MAP_NAME) *result;
+
+    if (m == NULL) {
+        NullPtrError("NewIterator");
+        return NULL;
+    }
+    result = m->Allocator->malloc(sizeof(struct ITERATOR(MAP_NAME)));
+    if (result == NULL) {
+        NoMemoryError(m,"NewIterator");
+        return NULL;
+    }
+    memset(result,0,sizeof(*result));
+    result->it.GetNext = GetNext;
+    result->it.GetPrevious = GetPrevious;
+    result->it.GetFirst = GetFirst;
+    result->it.GetCurrent = GetCurrent;
+    result->Map = m;
+    result->timestamp = m->timestamp;
+    return &result->it;
+}
+
+static int DeleteIterator(Iterator *it)
+{
+    struct ITERATOR(MAP_NAME) *mi = (struct ITERATOR(MAP_NAME) *)it;
+
+    if (it == NULL)
+        return NullPtrError("DeleteIterator");
+    mi->Map->Allocator->free(mi);
+    return 1;
+}
+
+/* n is the number of entries expected: the table is created with room
+   for them */
+static MAP_TYPE *CreateWithAllocator(size_t n,const ContainerAllocator *allocator)
+{
+    MAP_TYPE *m;
+
+    if (allocator == NULL) {
+        NullPtrError("CreateWithAllocator");
+        return NULL;
+    }
+    m = allocator->malloc(sizeof(MAP_TYPE));
+    if (m == NULL) {
+        doerrorCall(iError.RaiseError,"Create",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    memset(m,0,sizeof(*m));
+    m->VTable = &INTERFACE_NAME(MAP_NAME);
+    m->Allocator = allocator;
+    m->RaiseError = iError.RaiseError;
+    m->size = SizeFor(n,&m->Shift);
+    m->Slots = AllocSlots(m,m->size);
+    if (m->Slots == NULL) {
+        allocator->free(m);
+        doerrorCall(iError.RaiseError,"Create",CONTAINER_ERROR_NOMEMORY);
+        return NULL;
+    }
+    return m;
+}
+
+static MAP_TYPE *Create(size_t n)
+{
+    return CreateWithAllocator(n,CurrentAllocator);
+}
+
+INTERFACE(MAP_NAME) INTERFACE_NAME(MAP_NAME) = {
+    Size,
+    GetFlags,
+    SetFlags,
+    Clear,
+    Contains,
+    Erase,
+    Finalize,
+    Apply,
+    Copy,
+    SetErrorFunction,
+    Sizeof,
+    NewIterator,
+    DeleteIterator,
+    GetKey,
+    Add,
+    Replace,
+    Insert,
+    GetElement,
+    CopyElement,
+    Reserve,
+    ShrinkToFit,
+    SetDestructor,
+    GetStatistics,
+    Create,
+    CreateWithAllocator,
+};
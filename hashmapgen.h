@@ -0,0 +1,100 @@
+/* Template header for hash maps from a key type to a value type. The
+   parameter file defines:
+   KEY_TYPE   The type of the keys
+   DATA_TYPE  The type of the values
+   MAP_NAME   The prefix of the names. MAP_NAME intptrdouble produces the
+              intptrdoubleMap container and its iintptrdoubleMap interface.
+              If it isn't defined KEY_TYPE followed by DATA_TYPE is used,
+              and both must then be single identifiers.
+   The keys and the values are stored in the slots of the table and passed
+   by value. See hashmapgen.c for the parameters of the implementation. */
+#if !defined(KEY_TYPE) || !defined(DATA_TYPE)
+#error "The symbols KEY_TYPE and DATA_TYPE MUST be defined"
+#else
+#ifndef MAP_NAME
+#define MAP_NAME CONCAT3(KEY_TYPE,,DATA_TYPE)
+#endif
+#undef MAP_TYPE
+#undef MAP_TYPE_
+#undef MAP_SLOT
+#undef INTERFACE
+#undef ITERATOR
+#undef INTERFACE_NAME
+#undef MAP_STRUCT_INTERNAL_NAME
+#undef INTERFACE_STRUCT_INTERNAL_NAME
+
+#define CONCAT(x,y) x ## y
+#define CONCAT3_(a,b,c) a##b##c
+#define CONCAT3(a,b,c) CONCAT3_(a,b,c)
+#define EVAL(t) t
+#define MAP_TYPE_(t) CONCAT(t,Map)
+#define MAP_TYPE MAP_TYPE_(EVAL(MAP_NAME))
+#define MAP_SLOT CONCAT3(__,EVAL(MAP_NAME),MapSlot)
+#define INTERFACE(t) CONCAT3_(t,Map,Interface)
+#define ITERATOR(t) CONCAT3_(t,Map,Iterator)
+#define INTERFACE_NAME(a) CONCAT3(i,EVAL(a),Map)
+#define MAP_STRUCT_INTERNAL_NAME(a) CONCAT3(__,EVAL(a),Map)
+#define INTERFACE_STRUCT_INTERNAL_NAME(a) CONCAT3(__,EVAL(a),MapInterface)
+
+/* Psl is the distance of the entry from its home slot plus one, zero
+   for an empty slot */
+typedef struct MAP_SLOT {
+    unsigned Psl;
+    KEY_TYPE Key;
+    DATA_TYPE Data;
+} MAP_SLOT;
+
+typedef struct MAP_STRUCT_INTERNAL_NAME(MAP_NAME) MAP_TYPE;
+typedef struct INTERFACE_STRUCT_INTERNAL_NAME(MAP_NAME) INTERFACE(MAP_NAME);
+struct MAP_STRUCT_INTERNAL_NAME(MAP_NAME) {
+    INTERFACE(MAP_NAME) *VTable;       /* Methods table */
+    size_t count;               /* in elements units */
+    unsigned Flags;
+    unsigned timestamp;         /* Changed at each modification */
+    size_t size;                /* Number of slots. Always a power of two */
+    unsigned Shift;             /* 64 - log2(size): the home slot is the top of the hash */
+    MAP_SLOT *Slots;
+    size_t Reserved;            /* Reserve argument, the map won't shrink below it */
+    size_t Resizes;             /* Rehashes into a table of another size */
+    ErrorFunction RaiseError;   /* Error function */
+    const ContainerAllocator *Allocator;
+    DestructorFunction DestructorFn;
+};
+
+struct ITERATOR(MAP_NAME) {
+    Iterator it;
+    MAP_TYPE *Map;
+    size_t index;               /* Next slot to visit */
+    MAP_SLOT *Current;
+    unsigned timestamp;
+};
+extern INTERFACE(MAP_NAME) INTERFACE_NAME(MAP_NAME);
+
+struct INTERFACE_STRUCT_INTERNAL_NAME(MAP_NAME) {
+    size_t (*Size)(const MAP_TYPE *m);
+    unsigned (*GetFlags)(const MAP_TYPE *m);
+    unsigned (*SetFlags)(MAP_TYPE *m,unsigned flags);
+    int (*Clear)(MAP_TYPE *m);
+    int (*Contains)(const MAP_TYPE *m,KEY_TYPE key);
+    int (*Erase)(MAP_TYPE *m,KEY_TYPE key);
+    int (*Finalize)(MAP_TYPE *m);
+    int (*Apply)(MAP_TYPE *m,int (*Applyfn)(KEY_TYPE *key,DATA_TYPE *data,void *arg),void *arg);
+    MAP_TYPE *(*Copy)(const MAP_TYPE *m);
+    ErrorFunction (*SetErrorFunction)(MAP_TYPE *m,ErrorFunction fn);
+    size_t (*Sizeof)(const MAP_TYPE *m);
+    Iterator *(*NewIterator)(MAP_TYPE *m);
+    int (*DeleteIterator)(Iterator *it);
+    KEY_TYPE *(*GetKey)(Iterator *it);
+    int (*Add)(MAP_TYPE *m,KEY_TYPE key,DATA_TYPE data);
+    int (*Replace)(MAP_TYPE *m,KEY_TYPE key,DATA_TYPE data);
+    int (*Insert)(MAP_TYPE *m,KEY_TYPE key,DATA_TYPE data);
+    DATA_TYPE *(*GetElement)(const MAP_TYPE *m,KEY_TYPE key);
+    int (*CopyElement)(const MAP_TYPE *m,KEY_TYPE key,DATA_TYPE *outbuf);
+    int (*Reserve)(MAP_TYPE *m,size_t n);
+    int (*ShrinkToFit)(MAP_TYPE *m);
+    DestructorFunction (*SetDestructor)(MAP_TYPE *m,DestructorFunction fn);
+    int (*GetStatistics)(const MAP_TYPE *m,HashStatistics *Stats);
+    MAP_TYPE *(*Create)(size_t n);
+    MAP_TYPE *(*CreateWithAllocator)(size_t n,const ContainerAllocator *mm);
+};
+#endif
@@ -4,13 +4,21 @@
 #include "containers.h"
 #include "ccl_internal.h"
 
-static const guid HashTableGuid = {0x3a3d3aab, 0xb14a, 0x4249,
+static const guid HashTableGuid = {0x3a3d3aab, 0xb14a, 0x424a,
 {0x98,0x2,0xbd,0xdc,0xa5,0x62,0x59,0x75}
 };
 
 
 #define INITIAL_MAX 15 /* tunable == 2^n - 1 */
-static unsigned int DefaultHashFunction(const char *char_key, size_t *klen);
+#define SHRINK_RATIO 8 /* Erase shrinks when less than 1/8 of the slots are used */
+/* Entries allocated together in one block (Copy, Merge, Rebuild) are
+   rounded up so that each one is aligned. The tables made by
+   CreateIntegerKeys keep the key after the value. */
+#define ENTRY_BASE(ht) ((sizeof(HashEntry)+(ht)->ElementSize+sizeof(uint64_t)-1) & ~(sizeof(uint64_t)-1))
+#define ENTRY_SIZE(ht) (ENTRY_BASE(ht) + ((ht)->IntegerKeys ? sizeof(uint64_t) : 0))
+#define INTEGER_KEY(ht,he) ((uint64_t *)((char *)(he) + ENTRY_BASE(ht)))
+#define ENTRY_AT(base,i,esize) ((HashEntry *)((char *)(base)+(i)*(esize)))
+static uint64_t DefaultHashFunction(const char *char_key, size_t *klen);
 static HashTable * Merge(Pool *p, const HashTable *overlay, const HashTable *base,
                 void * (*merger)(Pool *p, const void *key, size_t klen,
                                 const void *h1_val, const void *h2_val,
@@ -31,9 +39,17 @@ static int NullPtrError(const char *fnName)
 }
 
 
+static int NoMemoryError(const HashTable *ht,const char *fnName)
+{
+    char buf[256];
+    snprintf(buf,sizeof(buf),"iHashTable.%s",fnName);
+    ht->RaiseError(buf,CONTAINER_ERROR_NOMEMORY);
+    return CONTAINER_ERROR_NOMEMORY;
+}
+
 static HashEntry **alloc_array(HashTable *ht, size_t max)
 {
-   return iPool.Calloc(ht->pool, (max+1),(sizeof(*ht->array) + ht->ElementSize ));
+   return iPool.Calloc(ht->pool, (max+1),sizeof(*ht->array));
 }
 
 /* Decode ULE128 string */
@@ -75,18 +91,38 @@ static int encode_ule128(FILE *stream,size_t val)
     return i;
 }
 
+/* The header is allocated apart from the pool, so that ShrinkToFit can
+   replace the pool */
 static HashTable * Create(size_t ElementSize)
 {
     HashTable *ht;
     Pool *pool = iPool.Create(NULL);
-    ht = iPool.Calloc(pool, 1, sizeof(HashTable));
+
+    if (pool == NULL)
+        goto nomem;
+    ht = CurrentAllocator->calloc(1, sizeof(HashTable));
+    if (ht == NULL) {
+        iPool.Finalize(pool);
+        goto nomem;
+    }
     ht->pool = pool;
+    ht->OwnPool = 1;
     ht->max = INITIAL_MAX;
     ht->array = alloc_array(ht, ht->max);
+    if (ht->array == NULL) {
+        iPool.Finalize(pool);
+        CurrentAllocator->free(ht);
+        goto nomem;
+    }
     ht->Hash = DefaultHashFunction;
     ht->VTable = &iHashTable;
     ht->ElementSize = ElementSize;
+    ht->RaiseError = iError.RaiseError;
+    ht->Allocator = CurrentAllocator;
     return ht;
+nomem:
+    iError.RaiseError("iHashTable.Create",CONTAINER_ERROR_NOMEMORY);
+    return NULL;
 }
 
 static HashTable *Init(HashTable *ht,size_t ElementSize)
@@ -94,46 +130,304 @@ static HashTable *Init(HashTable *ht,size_t ElementSize)
     iError.RaiseError("iHashTable.Init",CONTAINER_ERROR_NOTIMPLEMENTED);
     return NULL;
 }
+/* The integer keys are mixed so that all their bits reach the slot
+   index: IDs that differ only in their high bits don't collide */
+static uint64_t MixInteger(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* With a seed the keys are hashed with Hash64, whatever the hash
+   function of the table. The integer keys are hashed with MixInteger,
+   after adding the seed. */
+static uint64_t HashKey(const HashTable *ht,const void *key,size_t *klen)
+{
+    uint64_t k;
+
+    if (ht->IntegerKeys && *klen == sizeof(uint64_t)) {
+        memcpy(&k,key,sizeof(k));
+        return MixInteger(k + ht->Seed);
+    }
+    if (ht->Seed) {
+        if (*klen == (size_t)-1)
+            *klen = strlen(key);
+        return iHashFunctions.Hash64(key,*klen,ht->Seed);
+    }
+    return ht->Hash(key,klen);
+}
+
+static int SameHashing(const HashTable *h1,const HashTable *h2)
+{
+    return h1->IntegerKeys == h2->IntegerKeys && h1->Seed == h2->Seed &&
+           (h1->Seed || h1->IntegerKeys || h1->Hash == h2->Hash);
+}
+
+/* A copied entry of a table with integer keys gets its own copy of the
+   key instead of pointing to the key of the original */
+static void KeepKey(const HashTable *ht,HashEntry *he)
+{
+    uint64_t *k;
+
+    if (ht->IntegerKeys && he->klen == sizeof(uint64_t)) {
+        k = INTEGER_KEY(ht,he);
+        if (he->key != k) {
+            memcpy(k,he->key,sizeof(uint64_t));
+            he->key = k;
+        }
+    }
+}
+
+/* The hashes are stored in the entries: after a change of the function
+   or of the seed all keys are hashed again and the entries relinked */
+static void Rehash(HashTable *ht)
+{
+    HashEntry *all = NULL,*he,*nxt;
+    size_t i,klen;
+
+    for (i = 0; i <= ht->max; i++) {
+        for (he = ht->array[i]; he; he = nxt) {
+            nxt = he->next;
+            he->next = all;
+            all = he;
+        }
+        ht->array[i] = NULL;
+    }
+    for (he = all; he; he = nxt) {
+        nxt = he->next;
+        klen = he->klen;
+        he->hash = HashKey(ht,he->key,&klen);
+        i = he->hash & ht->max;
+        he->next = ht->array[i];
+        ht->array[i] = he;
+    }
+    ht->timestamp++;
+}
+
 static GeneralHashFunction SetHashFunction(HashTable *ht, GeneralHashFunction Hash)
 {
     GeneralHashFunction old = ht->Hash;
-    if (Hash)
+    if (Hash && (Hash != old || ht->Seed)) {
+        /* A hash function replaces the seeded hashing */
         ht->Hash = Hash;
+        ht->Seed = 0;
+        Rehash(ht);
+    }
     return old;
 }
 
+/*------------------------------------------------------------------------
+ Procedure:     SetSeed ID:1
+ Purpose:       Hashes the keys with Hash64 and the given seed instead
+                of the hash function of the table, so that the slots of
+                the keys can't be predicted from outside the process.
+                The entries already in the table are hashed again.
+ Input:         The table and the seed. Zero asks for a random seed.
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG if the table is NULL, READONLY
+------------------------------------------------------------------------*/
+static int SetSeed(HashTable *ht,uint64_t Seed)
+{
+    if (ht == NULL)
+        return NullPtrError("SetSeed");
+    if (ht->Flags & CONTAINER_READONLY) {
+        iError.RaiseError("iHashTable.SetSeed",CONTAINER_ERROR_READONLY);
+        return CONTAINER_ERROR_READONLY;
+    }
+    ht->Seed = Seed ? Seed : iHashFunctions.RandomSeed();
+    Rehash(ht);
+    return 1;
+}
+
 /*
- * Resizing a hash table
+ * Resizing a hash table. The table grows when it holds more entries
+ * than slots and shrinks only when less than one slot in SHRINK_RATIO
+ * is used, so that a table whose size goes up and down around some
+ * value isn't rebuilt each time. Shrinking only relinks the entries,
+ * so the pointers returned by GetElement for the other keys stay
+ * valid; the memory of the erased entries is given back by ShrinkToFit.
  */
 
+/* The smallest mask (number of slots - 1) with at least n slots */
+static size_t MaskFor(size_t n)
+{
+    size_t max = INITIAL_MAX;
+
+    while (n && max < n-1)
+        max = 2*max+1;
+    return max;
+}
+
+/* Links the entries into a new array of newmax+1 slots. The entries
+   don't move. */
+static int Relink(HashTable *ht,size_t newmax)
+{
+    HashEntry **new_array,*he,*nxt;
+    size_t i,j;
+
+    new_array = alloc_array(ht, newmax);
+    if (new_array == NULL)
+        return CONTAINER_ERROR_NOMEMORY;
+    for (i = 0; i <= ht->max; i++) {
+        for (he = ht->array[i]; he; he = nxt) {
+            nxt = he->next;
+            j = he->hash & newmax;
+            he->next = new_array[j];
+            new_array[j] = he;
+        }
+    }
+    ht->array = new_array;
+    if (newmax != ht->max)
+        ht->Resizes++;
+    ht->max = newmax;
+    ht->timestamp++;
+    return 1;
+}
+
+/* The pool never gives memory back: the entries are copied into a fresh
+   pool, that holds only the new array and one block with the entries,
+   and the old pool is released. A table that doesn't own its pool (made
+   by Copy or Merge with a pool argument) can only be relinked. */
+static int Rebuild(HashTable *ht,size_t newmax)
+{
+    Pool *pool;
+    HashEntry **array,*he,*ne;
+    char *entries = NULL;
+    size_t esize = ENTRY_SIZE(ht),j = 0;
+    size_t i,k;
+
+    if (!ht->OwnPool)
+        return Relink(ht,newmax);
+    pool = iPool.Create((ContainerAllocator *)ht->Allocator);
+    if (pool == NULL)
+        return CONTAINER_ERROR_NOMEMORY;
+    array = iPool.Calloc(pool,newmax+1,sizeof(*array));
+    if (array && ht->count)
+        entries = iPool.Alloc(pool,esize*ht->count);
+    if (array == NULL || (ht->count && entries == NULL)) {
+        iPool.Finalize(pool);
+        return CONTAINER_ERROR_NOMEMORY;
+    }
+    for (i = 0; i <= ht->max; i++) {
+        for (he = ht->array[i]; he; he = he->next) {
+            ne = ENTRY_AT(entries,j++,esize);
+            memcpy(ne,he,sizeof(HashEntry)+ht->ElementSize);
+            KeepKey(ht,ne);
+            k = ne->hash & newmax;
+            ne->next = array[k];
+            array[k] = ne;
+        }
+    }
+    iPool.Finalize(ht->pool);
+    ht->pool = pool;
+    ht->array = array;
+    if (newmax != ht->max)
+        ht->Resizes++;
+    ht->max = newmax;
+    ht->free = NULL;
+    ht->timestamp++;
+    return 1;
+}
+
+static void ShrinkIfSparse(HashTable *ht)
+{
+    size_t n = 2*ht->count;
+    size_t newmax;
+
+    if (ht->max == INITIAL_MAX || ht->count >= (ht->max+1)/SHRINK_RATIO)
+        return;
+    newmax = MaskFor(n > ht->Reserved ? n : ht->Reserved);
+    if (newmax < ht->max)
+        Relink(ht,newmax);
+}
+
 static int Resize(HashTable *ht,size_t newsize)
 {
-    HashIndex hi,*hiptr;
-    HashEntry **new_array;
     size_t new_max;
-    char *p;
 
     if (ht == NULL)
-        return CONTAINER_ERROR_BADARG;
+        return NullPtrError("Resize");
     if (newsize == 0)
         new_max = ht->max * 2 + 1;
-    else new_max = newsize;
-    new_array = alloc_array(ht, new_max);
-    for (hiptr = first(&hi); hiptr; hiptr = next(hiptr)) {
-        size_t i = hiptr->This->hash % new_max;
-        p = (char *)new_array;
-        p += i * (ht->ElementSize+sizeof(HashEntry));
-        hiptr->This->next = (HashEntry *)(p+sizeof(HashEntry)+ht->ElementSize);
-        memcpy(p, hiptr->This,sizeof(HashEntry)+ht->ElementSize);
+    else new_max = MaskFor(newsize);
+    if (new_max != ht->max && Relink(ht,new_max) < 0)
+        return NoMemoryError(ht,"Resize");
+    return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Reserve ID:1
+ Purpose:       Allocates the slots for n entries at once, so that
+                adding them doesn't resize the table several times.
+                The table won't shrink below n slots when entries are
+                erased, until ShrinkToFit is called.
+ Input:         The table and the number of entries
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG if the table is NULL, NOMEMORY
+------------------------------------------------------------------------*/
+static int Reserve(HashTable *ht,size_t n)
+{
+    size_t new_max;
+
+    if (ht == NULL)
+        return NullPtrError("Reserve");
+    ht->Reserved = n;
+    new_max = MaskFor(n);
+    if (new_max > ht->max && Relink(ht,new_max) < 0)
+        return NoMemoryError(ht,"Reserve");
+    return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     ShrinkToFit ID:1
+ Purpose:       Gives back the memory of the erased entries: the table
+                is rebuilt with as many slots as entries in a new pool,
+                and the old pool is released. Cancels Reserve.
+ Input:         The table
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG if the table is NULL, NOMEMORY
+------------------------------------------------------------------------*/
+static int ShrinkToFit(HashTable *ht)
+{
+    HashEntry *he;
+    Pool *pool;
+    void *key;
+    size_t i;
+
+    if (ht == NULL)
+        return NullPtrError("ShrinkToFit");
+    ht->Reserved = 0;
+    if (Rebuild(ht,MaskFor(ht->count)) < 0)
+        return NoMemoryError(ht,"ShrinkToFit");
+    if (ht->KeyPool) {
+        /* The keys of the erased entries are left in the pool of Load */
+        pool = iPool.Create((ContainerAllocator *)ht->Allocator);
+        if (pool == NULL)
+            return NoMemoryError(ht,"ShrinkToFit");
+        for (i = 0; i <= ht->max; i++) {
+            for (he = ht->array[i]; he; he = he->next) {
+                key = iPool.Alloc(pool,he->klen);
+                if (key == NULL) {
+                    iPool.Finalize(pool);
+                    return NoMemoryError(ht,"ShrinkToFit");
+                }
+                memcpy(key,he->key,he->klen);
+                he->key = key;
+            }
+        }
+        iPool.Finalize(ht->KeyPool);
+        ht->KeyPool = pool;
     }
-    ht->array = new_array;
-    ht->max = (unsigned)new_max;
     return 1;
 }
 
-static unsigned int DefaultHashFunction(const char *char_key, size_t *klen)
+static uint64_t DefaultHashFunction(const char *char_key, size_t *klen)
 {
-    unsigned int hash = 0;
+    uint64_t hash = 0;
     const unsigned char *key = (const unsigned char *)char_key;
     const unsigned char *p;
     size_t i;
@@ -204,17 +498,29 @@ static unsigned int DefaultHashFunction(const char *char_key, size_t *klen)
 static HashEntry **find_entry(HashTable *ht,const void *key,size_t klen,const void *val)
 {
     HashEntry **hashTablePointer, *he;
-    unsigned int hash;
-
-    hash = ht->Hash(key, &klen);
-
-    /* scan linked list */
-    for (hashTablePointer = &ht->array[hash & ht->max], he = *hashTablePointer;
-        he; hashTablePointer = &he->next, he = *hashTablePointer) {
-        if (he->hash == hash
-            && he->klen == klen
-            && memcmp(he->key, key, klen) == 0)
-            break;
+    uint64_t hash,k;
+
+    if (ht->IntegerKeys && klen == sizeof(uint64_t)) {
+        /* All the keys are stored in the entries: one word is compared */
+        memcpy(&k,key,sizeof(k));
+        hash = MixInteger(k + ht->Seed);
+        for (hashTablePointer = &ht->array[hash & ht->max], he = *hashTablePointer;
+            he; hashTablePointer = &he->next, he = *hashTablePointer) {
+            if (he->hash == hash && *INTEGER_KEY(ht,he) == k)
+                break;
+        }
+    }
+    else {
+        hash = HashKey(ht,key,&klen);
+
+        /* scan linked list */
+        for (hashTablePointer = &ht->array[hash & ht->max], he = *hashTablePointer;
+            he; hashTablePointer = &he->next, he = *hashTablePointer) {
+            if (he->hash == hash
+                && he->klen == klen
+                && memcmp(he->key, key, klen) == 0)
+                break;
+        }
     }
     if (he || !val)
         return hashTablePointer;
@@ -223,11 +529,12 @@ static HashEntry **find_entry(HashTable *ht,const void *key,size_t klen,const vo
     if ((he = ht->free) != NULL)
         ht->free = he->next;
     else
-        he = iPool.Alloc(ht->pool, sizeof(*he));
+        he = iPool.Alloc(ht->pool, ht->IntegerKeys ? ENTRY_SIZE(ht) : sizeof(*he)+ht->ElementSize);
     he->next = NULL;
     he->hash = hash;
     he->key  = key;
     he->klen = klen;
+    KeepKey(ht,he);
     memcpy(he->val,val,ht->ElementSize);
     *hashTablePointer = he;
     ht->count++;
@@ -237,13 +544,13 @@ static HashEntry **find_entry(HashTable *ht,const void *key,size_t klen,const vo
 static int Replace(HashTable *ht,const void *key,size_t klen,const void *val)
 {
     HashEntry **hep, *he;
-    unsigned int hash;
+    uint64_t hash;
 
     if (ht == NULL ||val == NULL || key == NULL || klen == 0) {
         iError.RaiseError("iHashTable.Replace",CONTAINER_ERROR_BADARG);
         return CONTAINER_ERROR_BADARG;
     }
-    hash = ht->Hash(key, &klen);
+    hash = HashKey(ht,key,&klen);
 
     /* scan linked list */
     for (hep = &ht->array[hash & ht->max], he = *hep;
@@ -261,19 +568,25 @@ static int Replace(HashTable *ht,const void *key,size_t klen,const void *val)
 static int Add(HashTable *ht,const void *key, size_t klen, const void *val)
 {
     size_t oldCount;
-    if (ht == NULL || key == NULL || klen == 0) {
+    if (ht == NULL || key == NULL || klen == 0 ||
+        (ht->IntegerKeys && klen != sizeof(uint64_t))) {
         iError.RaiseError("iHashTable.Add",CONTAINER_ERROR_BADARG);
         return CONTAINER_ERROR_BADARG;
     }
     oldCount = ht->count;
     find_entry(ht,key,klen,val);
-    return oldCount != ht->count;
+    if (oldCount == ht->count)
+        return 0;
+    /* check that the collision rate isn't too high */
+    if (ht->count > ht->max)
+        Relink(ht,ht->max * 2 + 1);
+    return 1;
 }
 
 static void *GetElement(const HashTable *ht,const void *key, size_t klen)
 {
     HashEntry **v = find_entry((HashTable *)ht,key, klen, NULL);
-    if (v)
+    if (v && *v)
         return (void *)((*v)->val);
     return NULL;
 }
@@ -301,46 +614,63 @@ static size_t GetElementSize(const HashTable *l)
 }
 
 
+/* Without a pool the copy gets a pool of its own */
 static HashTable *Copy( const HashTable *orig,Pool *pool)
 {
     HashTable *ht;
-    HashEntry *new_vals;
-    unsigned int i, j;
+    char *new_vals = NULL;
+    size_t esize;
+    size_t i, j;
+    int ownPool = (pool == NULL);
 
     if (orig == NULL) {
         iError.RaiseError("iHashTable.Copy",CONTAINER_ERROR_BADARG);
         return NULL;
     }
-    if (pool == NULL)
-        pool = orig->pool;
-    ht = iPool.Alloc(pool, sizeof(HashTable) +
-                    sizeof(*ht->array) * (orig->max + 1) +
-                    (sizeof(HashEntry)+orig->ElementSize) * orig->count);
+    if (ownPool) {
+        pool = iPool.Create((ContainerAllocator *)orig->Allocator);
+        ht = pool ? orig->Allocator->malloc(sizeof(HashTable)) : NULL;
+    }
+    else ht = iPool.Alloc(pool, sizeof(HashTable));
+    if (ht == NULL)
+        goto nomem;
+    *ht = *orig;
     ht->pool = pool;
+    ht->OwnPool = ownPool;
+    ht->KeyPool = NULL;
     ht->free = NULL;
-    ht->count = orig->count;
-    ht->max = orig->max;
-    ht->Hash = orig->Hash;
-    ht->array = (HashEntry **)((char *)ht + sizeof(HashTable));
-
-    new_vals = (HashEntry *)((char *)(ht) + sizeof(HashTable) +
-                                    sizeof(*ht->array) * (orig->max + 1));
+    ht->timestamp = 0;
+    esize = ENTRY_SIZE(orig);
+    ht->array = alloc_array(ht, ht->max);
+    if (ht->array && orig->count)
+        new_vals = iPool.Alloc(pool, esize * orig->count);
+    if (ht->array == NULL || (orig->count && new_vals == NULL)) {
+        if (ownPool)
+            orig->Allocator->free(ht);
+        goto nomem;
+    }
     j = 0;
     for (i = 0; i <= ht->max; i++) {
         HashEntry **new_entry = &(ht->array[i]);
         HashEntry *orig_entry = orig->array[i];
         while (orig_entry) {
-            *new_entry = &new_vals[j++];
+            *new_entry = ENTRY_AT(new_vals,j++,esize);
             (*new_entry)->hash = orig_entry->hash;
             (*new_entry)->key = orig_entry->key;
             (*new_entry)->klen = orig_entry->klen;
             memcpy((*new_entry)->val , orig_entry->val,ht->ElementSize);
+            KeepKey(ht,*new_entry);
             new_entry = &((*new_entry)->next);
             orig_entry = orig_entry->next;
         }
         *new_entry = NULL;
     }
     return ht;
+nomem:
+    if (ownPool && pool)
+        iPool.Finalize(pool);
+    iError.RaiseError("iHashTable.Copy",CONTAINER_ERROR_NOMEMORY);
+    return NULL;
 }
 
 static HashEntry **HashSet(HashTable *ht, const void *key, size_t klen, const void *val)
@@ -359,11 +689,7 @@ static HashEntry **HashSet(HashTable *ht, const void *key, size_t klen, const vo
         }
         else {
             /* replace entry */
-            memcpy((*hep)->val , (void *)val,sizeof(HashEntry)+ht->ElementSize);
-            /* check that the collision rate isn't too high */
-            if (ht->count > ht->max) {
-                Resize(ht,0);
-            }
+            memcpy((*hep)->val , (void *)val,ht->ElementSize);
         }
     }
     /* else key not present and val==NULL */
@@ -372,25 +698,256 @@ static HashEntry **HashSet(HashTable *ht, const void *key, size_t klen, const vo
 
 static int Remove(HashTable *ht,const void *key,size_t klen)
 {
-    HashEntry **hep = HashSet(ht,key,klen,NULL);
-    if (hep)
-        return 1;
-    return 0;
+    size_t oldCount;
+
+    if (ht == NULL || key == NULL || klen == 0) {
+        iError.RaiseError("iHashTable.Erase",CONTAINER_ERROR_BADARG);
+        return CONTAINER_ERROR_BADARG;
+    }
+    oldCount = ht->count;
+    HashSet(ht,key,klen,NULL);
+    if (oldCount == ht->count)
+        return 0;
+    ShrinkIfSparse(ht);
+    return 1;
 }
 
-static int Clear(HashTable *ht)
+static void RemoveAll(HashTable *ht)
 {
     HashIndex HashIdx,*hi;
 	HashIdx.ht = ht;
     for (hi = first(&HashIdx); hi; hi = next(hi))
         HashSet(ht, hi->This->key, hi->This->klen, NULL);
+}
+
+/* The memory of the entries is given back */
+static int Clear(HashTable *ht)
+{
+    if (ht == NULL)
+        return NullPtrError("Clear");
+    RemoveAll(ht);
+    if (ht->KeyPool) {
+        iPool.Finalize(ht->KeyPool);
+        ht->KeyPool = NULL;
+    }
+    Rebuild(ht,MaskFor(ht->Reserved));
     return 1;
 }
 
 static int Finalize(HashTable *ht)
 {
-    Clear(ht);
+    if (ht == NULL)
+        return NullPtrError("Finalize");
+    RemoveAll(ht);
+    if (ht->KeyPool)
+        iPool.Finalize(ht->KeyPool);
     iPool.Finalize(ht->pool);
+    if (ht->OwnPool)
+        ht->Allocator->free(ht);
+    return 1;
+}
+
+/*
+ * Parallel merge. The slots of the result are split into one range per
+ * thread. Each thread counts the entries of its share of both tables
+ * that go into each range, then copies them into the block of the
+ * result, grouped by range; the copies of one range follow each other,
+ * first those of the base, then those of the overlay. Then each thread
+ * links the copies of its range into its slots, so that no two threads
+ * write to the same slot, and looks up the overlay entries among those
+ * of the base. The copies of overlay entries already in the base stay
+ * unused, as in the sequential version.
+ */
+#define PARALLEL_MERGE_MIN 65536 /* Entries per thread worth a thread */
+#define MERGE_OFFSET(job,table,range,share) \
+    ((job)->Offsets[((table)*(job)->nThreads + (range))*(job)->nThreads + (share)])
+
+typedef void *(*MergeFunction)(Pool *p,const void *key,size_t klen,
+                               const void *h1_val,const void *h2_val,
+                               const void *data);
+
+struct MergeJob {
+    HashTable *res;
+    const HashTable *Tables[2];    /* Base and overlay */
+    int SameHashing;
+    char *new_vals;
+    size_t esize;
+    unsigned nThreads,shift;       /* The result has 2^shift slots */
+    size_t *Offsets;               /* [table][range][share] */
+    size_t Begin[2][PARALLEL_MAX_THREADS+1]; /* Copies of each range */
+    size_t Added[PARALLEL_MAX_THREADS];      /* Overlay entries added */
+    Pool *p;
+    MergeFunction merger;
+    const void *data;
+    int SerialMerger;
+};
+
+/* The overlay entries are hashed like the base */
+static uint64_t MergeHash(struct MergeJob *job,int table,const HashEntry *he)
+{
+    size_t klen = he->klen;
+
+    if (table == 0 || job->SameHashing)
+        return he->hash;
+    return HashKey(job->Tables[0],he->key,&klen);
+}
+
+static unsigned MergeRange(const struct MergeJob *job,uint64_t hash)
+{
+    return (unsigned)(((hash & job->res->max) * job->nThreads) >> job->shift);
+}
+
+/* Share of the slots of a table handled by a thread */
+static void MergeShare(const struct MergeJob *job,const HashTable *ht,unsigned share,size_t *first,size_t *last)
+{
+    size_t n = (size_t)ht->max + 1;
+
+    *first = n * share / job->nThreads;
+    *last = n * (share+1) / job->nThreads;
+}
+
+static void MergeCount(void *arg,unsigned share)
+{
+    struct MergeJob *job = arg;
+    HashEntry *he;
+    size_t k,first,last;
+    int t;
+
+    for (t = 0; t < 2; t++) {
+        MergeShare(job,job->Tables[t],share,&first,&last);
+        for (k = first; k < last; k++) {
+            for (he = job->Tables[t]->array[k]; he; he = he->next)
+                MERGE_OFFSET(job,t,MergeRange(job,MergeHash(job,t,he)),share)++;
+        }
+    }
+}
+
+static void MergeCopy(void *arg,unsigned share)
+{
+    struct MergeJob *job = arg;
+    HashEntry *he,*ne;
+    size_t k,first,last;
+    uint64_t h;
+    int t;
+
+    for (t = 0; t < 2; t++) {
+        MergeShare(job,job->Tables[t],share,&first,&last);
+        for (k = first; k < last; k++) {
+            for (he = job->Tables[t]->array[k]; he; he = he->next) {
+                h = MergeHash(job,t,he);
+                ne = ENTRY_AT(job->new_vals,MERGE_OFFSET(job,t,MergeRange(job,h),share)++,job->esize);
+                ne->hash = h;
+                ne->key = he->key;
+                ne->klen = he->klen;
+                KeepKey(job->res,ne);
+                memcpy(ne->val,he->val,job->res->ElementSize);
+            }
+        }
+    }
+}
+
+static void MergeLink(void *arg,unsigned range)
+{
+    struct MergeJob *job = arg;
+    HashTable *res = job->res;
+    HashEntry *ne,*ent,**slot;
+    size_t j,added = 0;
+    void *pvoid;
+
+    for (j = job->Begin[0][range]; j < job->Begin[0][range+1]; j++) {
+        ne = ENTRY_AT(job->new_vals,j,job->esize);
+        slot = &res->array[ne->hash & res->max];
+        ne->next = *slot;
+        *slot = ne;
+    }
+    for (j = job->Begin[1][range]; j < job->Begin[1][range+1]; j++) {
+        ne = ENTRY_AT(job->new_vals,j,job->esize);
+        slot = &res->array[ne->hash & res->max];
+        for (ent = *slot; ent; ent = ent->next) {
+            if (ent->hash == ne->hash && ent->klen == ne->klen &&
+                memcmp(ent->key,ne->key,ne->klen) == 0)
+                break;
+        }
+        if (ent == NULL) {
+            ne->next = *slot;
+            *slot = ne;
+            added++;
+        }
+        else if (job->merger == NULL)
+            memcpy(ent->val,ne->val,res->ElementSize);
+        else {
+            if (job->SerialMerger)
+                ParallelEnter();
+            pvoid = job->merger(job->p,ne->key,ne->klen,ne->val,ent->val,job->data);
+            memcpy(ent->val,pvoid,res->ElementSize);
+            if (job->SerialMerger)
+                ParallelLeave();
+        }
+    }
+    job->Added[range] = added;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     ParallelMerge ID:1
+ Purpose:       Fills the result of Merge in nThreads threads. The
+                merger is called by several threads at once if the
+                base has the HASHTABLE_THREADSAFE_MERGER flag, one
+                thread at a time otherwise.
+ Input:         The result with its empty slots, the block for the
+                entries, the tables and the merger
+ Output:        1, or zero if the offsets couldn't be allocated (the
+                result is unchanged)
+ Errors:        None
+------------------------------------------------------------------------*/
+static int ParallelMerge(HashTable *res,char *new_vals,unsigned nThreads,Pool *p,
+                         const HashTable *overlay,const HashTable *base,
+                         MergeFunction merger,const void *data)
+{
+    struct MergeJob *job;
+    size_t pos = 0,n;
+    unsigned t,range,share;
+
+    job = base->Allocator->calloc(1,sizeof(*job));
+    if (job == NULL)
+        return 0;
+    job->Offsets = base->Allocator->calloc(2*(size_t)nThreads*nThreads,sizeof(size_t));
+    if (job->Offsets == NULL) {
+        base->Allocator->free(job);
+        return 0;
+    }
+    job->res = res;
+    job->Tables[0] = base;
+    job->Tables[1] = overlay;
+    job->SameHashing = SameHashing(overlay,base);
+    job->new_vals = new_vals;
+    job->esize = ENTRY_SIZE(base);
+    job->nThreads = nThreads;
+    while (((size_t)1 << job->shift) <= res->max)
+        job->shift++;
+    job->p = p;
+    job->merger = merger;
+    job->data = data;
+    job->SerialMerger = !(base->Flags & HASHTABLE_THREADSAFE_MERGER);
+    ParallelRun(nThreads,MergeCount,job);
+    /* The counts become the positions of the copies */
+    for (t = 0; t < 2; t++) {
+        for (range = 0; range < nThreads; range++) {
+            job->Begin[t][range] = pos;
+            for (share = 0; share < nThreads; share++) {
+                n = MERGE_OFFSET(job,t,range,share);
+                MERGE_OFFSET(job,t,range,share) = pos;
+                pos += n;
+            }
+        }
+        job->Begin[t][nThreads] = pos;
+    }
+    ParallelRun(nThreads,MergeCopy,job);
+    ParallelRun(nThreads,MergeLink,job);
+    res->count = base->count;
+    for (range = 0; range < nThreads; range++)
+        res->count += (unsigned)job->Added[range];
+    base->Allocator->free(job->Offsets);
+    base->Allocator->free(job);
     return 1;
 }
 
@@ -409,50 +966,69 @@ static HashTable * Merge(Pool *p, const HashTable *overlay, const HashTable *bas
                                         const void *data)
 {
     HashTable *res;
-    HashEntry *new_vals = NULL;
+    char *new_vals = NULL;
     HashEntry *iter;
-    HashEntry *ent;
-    unsigned int i,j,k;
+    HashEntry *ent,*ne;
+    size_t i,j,k;
     void *pvoid;
+    uint64_t h;
+    size_t klen,esize;
+    unsigned nThreads;
 
     if (p == NULL || overlay == NULL || base == NULL) {
         iError.RaiseError("iHashTable.Merge",CONTAINER_ERROR_BADARG);
         return NULL;
     }
     res = iPool.Alloc(p, sizeof(HashTable));
+    if (res == NULL)
+        return NULL;
+    *res = *base;
     res->pool = p;
+    res->OwnPool = 0;
+    res->KeyPool = NULL;
     res->free = NULL;
-    res->Hash = base->Hash;
+    res->timestamp = 0;
     res->count = base->count;
+    esize = ENTRY_SIZE(base);
     res->max = (overlay->max > base->max) ? overlay->max : base->max;
     if (base->count + overlay->count > res->max) {
         res->max = res->max * 2 + 1;
     }
     res->array = alloc_array(res, res->max);
-    if (base->count + overlay->count) {
-        new_vals = iPool.Alloc(p, (sizeof(HashEntry)+base->ElementSize) *
-                            (base->count + overlay->count));
-    }
-    if (new_vals == NULL) {
+    if (res->array == NULL)
         return NULL;
+    if (base->count + overlay->count) {
+        new_vals = iPool.Alloc(p, esize * (base->count + overlay->count));
+        if (new_vals == NULL)
+            return NULL;
     }
+    /* Large tables are merged by several threads */
+    nThreads = ParallelThreads();
+    if ((base->count + overlay->count)/PARALLEL_MERGE_MIN < nThreads)
+        nThreads = (unsigned)((base->count + overlay->count)/PARALLEL_MERGE_MIN);
+    if (nThreads > 1 &&
+        ParallelMerge(res,new_vals,nThreads,p,overlay,base,merger,data))
+        return res;
     j = 0;
     for (k = 0; k <= base->max; k++) {
         for (iter = base->array[k]; iter; iter = iter->next) {
             i = iter->hash & res->max;
-            new_vals[j].klen = iter->klen;
-            new_vals[j].key = iter->key;
-            memcpy(new_vals[j].val , iter->val,base->ElementSize);
-            new_vals[j].hash = iter->hash;
-            new_vals[j].next = res->array[i];
-            res->array[i] = &new_vals[j];
-            j++;
+            ne = ENTRY_AT(new_vals,j++,esize);
+            ne->klen = iter->klen;
+            ne->key = iter->key;
+            KeepKey(res,ne);
+            memcpy(ne->val , iter->val,base->ElementSize);
+            ne->hash = iter->hash;
+            ne->next = res->array[i];
+            res->array[i] = ne;
         }
     }
 
     for (k = 0; k <= overlay->max; k++) {
         for (iter = overlay->array[k]; iter; iter = iter->next) {
-            i = iter->hash & res->max;
+            klen = iter->klen;
+            h = SameHashing(overlay,base) ? iter->hash : HashKey(base,iter->key,&klen);
+            i = h & res->max;
             for (ent = res->array[i]; ent; ent = ent->next) {
                 if ((ent->klen == iter->klen) &&
                     (memcmp(ent->key, iter->key, iter->klen) == 0)) {
@@ -468,20 +1044,254 @@ static HashTable * Merge(Pool *p, const HashTable *overlay, const HashTable *bas
                 }
             }
             if (!ent) {
-                new_vals[j].klen = iter->klen;
-                new_vals[j].key = iter->key;
-                memcpy(new_vals[j].val , iter->val,base->ElementSize);
-                new_vals[j].hash = iter->hash;
-                new_vals[j].next = res->array[i];
-                res->array[i] = &new_vals[j];
+                ne = ENTRY_AT(new_vals,j++,esize);
+                ne->klen = iter->klen;
+                ne->key = iter->key;
+                KeepKey(res,ne);
+                memcpy(ne->val , iter->val,base->ElementSize);
+                ne->hash = h;
+                ne->next = res->array[i];
+                res->array[i] = ne;
                 res->count++;
-                j++;
             }
         }
     }
     return res;
 }
 
+/*
+ * Bulk build. The keys are split into one share per thread and the slots
+ * into one range per thread, as in the parallel merge. Each thread hashes
+ * its share and counts the keys that fall in each range, then copies its
+ * entries into the block of the table grouped by range, and finally links
+ * the entries of its range into its slots: no slot is written by two
+ * threads and no lock is taken. Inside a range the entries keep the order
+ * of the arrays, so of several equal keys the first one is kept, as with
+ * a series of Add calls.
+ */
+#define BUILD_OFFSET(job,range,share) ((job)->Offsets[(range)*(job)->nThreads + (share)])
+
+struct BuildJob {
+    HashTable *ht;
+    size_t n;
+    const void **Keys;
+    const size_t *klens;
+    const char *Values;
+    uint64_t *Hashes;
+    size_t *Lengths;               /* Lengths of the strings if klens is NULL */
+    char *entries;
+    size_t esize;
+    unsigned nThreads,shift;       /* The table has 2^shift slots */
+    size_t *Offsets;               /* [range][share] */
+    size_t Begin[PARALLEL_MAX_THREADS+1];
+    size_t Added[PARALLEL_MAX_THREADS];
+};
+
+static unsigned BuildRange(const struct BuildJob *job,uint64_t hash)
+{
+    return (unsigned)(((hash & job->ht->max) * job->nThreads) >> job->shift);
+}
+
+static void BuildCount(void *arg,unsigned share)
+{
+    struct BuildJob *job = arg;
+    size_t i,klen,first = job->n*share/job->nThreads,last = job->n*(share+1)/job->nThreads;
+
+    for (i = first; i < last; i++) {
+        klen = job->klens ? job->klens[i] : (size_t)-1;
+        job->Hashes[i] = HashKey(job->ht,job->Keys[i],&klen);
+        if (job->Lengths)
+            job->Lengths[i] = klen;
+        BUILD_OFFSET(job,BuildRange(job,job->Hashes[i]),share)++;
+    }
+}
+
+static void BuildCopy(void *arg,unsigned share)
+{
+    struct BuildJob *job = arg;
+    size_t i,first = job->n*share/job->nThreads,last = job->n*(share+1)/job->nThreads;
+    size_t ElementSize = job->ht->ElementSize;
+    HashEntry *ne;
+
+    for (i = first; i < last; i++) {
+        ne = ENTRY_AT(job->entries,BUILD_OFFSET(job,BuildRange(job,job->Hashes[i]),share)++,job->esize);
+        ne->hash = job->Hashes[i];
+        ne->key = job->Keys[i];
+        ne->klen = job->Lengths ? job->Lengths[i] : job->klens[i];
+        if (job->Values)
+            memcpy(ne->val,job->Values + i*ElementSize,ElementSize);
+        else memset(ne->val,0,ElementSize);
+    }
+}
+
+static void BuildLink(void *arg,unsigned range)
+{
+    struct BuildJob *job = arg;
+    HashTable *ht = job->ht;
+    HashEntry *ne,*ent,**slot;
+    size_t j,added = 0;
+
+    for (j = job->Begin[range]; j < job->Begin[range+1]; j++) {
+        ne = ENTRY_AT(job->entries,j,job->esize);
+        slot = &ht->array[ne->hash & ht->max];
+        for (ent = *slot; ent; ent = ent->next) {
+            if (ent->hash == ne->hash && ent->klen == ne->klen &&
+                memcmp(ent->key,ne->key,ne->klen) == 0)
+                break;
+        }
+        if (ent == NULL) {
+            ne->next = *slot;
+            *slot = ne;
+            added++;
+        }
+    }
+    job->Added[range] = added;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     BuildFrom ID:1
+ Purpose:       Creates a table holding n keys with their values. The
+                slots are allocated once for all the keys and, for
+                large arrays, the table is filled by several threads.
+ Input:         The size of the values, the number of keys, the keys,
+                their lengths (NULL if the keys are zero terminated
+                strings) and the values, n*ElementSize bytes (NULL for
+                zeroed values). As with Add the keys are not copied.
+ Output:        The new table or NULL
+ Errors:        BADARG if a key is NULL or has a zero length, NOMEMORY
+------------------------------------------------------------------------*/
+static HashTable *BuildFrom(size_t ElementSize,size_t n,const void **Keys,const size_t *klens,const void *Values)
+{
+    struct BuildJob job;
+    HashTable *ht,*result = NULL;
+    size_t i,pos = 0,cnt;
+    unsigned range,share;
+
+    if (n && Keys == NULL) {
+        NullPtrError("BuildFrom");
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        if (Keys[i] == NULL || (klens && klens[i] == 0)) {
+            NullPtrError("BuildFrom");
+            return NULL;
+        }
+    }
+    ht = Create(ElementSize);
+    if (ht == NULL || n == 0)
+        return ht;
+    memset(&job,0,sizeof(job));
+    job.ht = ht;
+    job.n = n;
+    job.Keys = Keys;
+    job.klens = klens;
+    job.Values = Values;
+    job.esize = ENTRY_SIZE(ht);
+    job.nThreads = ParallelThreads();
+    if (n/PARALLEL_MERGE_MIN < job.nThreads)
+        job.nThreads = n/PARALLEL_MERGE_MIN ? (unsigned)(n/PARALLEL_MERGE_MIN) : 1;
+    ht->max = MaskFor(n);
+    while (((size_t)1 << job.shift) <= ht->max)
+        job.shift++;
+    ht->array = alloc_array(ht,ht->max);
+    job.entries = iPool.Alloc(ht->pool,job.esize*n);
+    job.Hashes = ht->Allocator->malloc(n*sizeof(uint64_t));
+    job.Offsets = ht->Allocator->calloc((size_t)job.nThreads*job.nThreads,sizeof(size_t));
+    if (klens == NULL)
+        job.Lengths = ht->Allocator->malloc(n*sizeof(size_t));
+    if (ht->array == NULL || job.entries == NULL || job.Hashes == NULL ||
+        job.Offsets == NULL || (klens == NULL && job.Lengths == NULL)) {
+        NoMemoryError(ht,"BuildFrom");
+        goto done;
+    }
+    ParallelRun(job.nThreads,BuildCount,&job);
+    /* The counts become the positions of the entries */
+    for (range = 0; range < job.nThreads; range++) {
+        job.Begin[range] = pos;
+        for (share = 0; share < job.nThreads; share++) {
+            cnt = BUILD_OFFSET(&job,range,share);
+            BUILD_OFFSET(&job,range,share) = pos;
+            pos += cnt;
+        }
+    }
+    job.Begin[job.nThreads] = pos;
+    ParallelRun(job.nThreads,BuildCopy,&job);
+    ParallelRun(job.nThreads,BuildLink,&job);
+    for (range = 0; range < job.nThreads; range++)
+        ht->count += (unsigned)job.Added[range];
+    result = ht;
+done:
+    if (job.Hashes) ht->Allocator->free(job.Hashes);
+    if (job.Offsets) ht->Allocator->free(job.Offsets);
+    if (job.Lengths) ht->Allocator->free(job.Lengths);
+    if (result == NULL)
+        Finalize(ht);
+    return result;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     CreateIntegerKeys ID:1
+ Purpose:       Creates a table whose keys are 64 bit integers. The
+                keys are copied into the entries, hashed by mixing
+                their bits instead of with the byte loop of the hash
+                function and compared as one word.
+                The functions that take a key pointer accept a pointer
+                to an uint64_t with a length of 8.
+ Input:         The size of the values
+ Output:        The new table or NULL
+ Errors:        NOMEMORY
+------------------------------------------------------------------------*/
+static HashTable *CreateIntegerKeys(size_t ElementSize)
+{
+    HashTable *ht = Create(ElementSize);
+
+    if (ht)
+        ht->IntegerKeys = 1;
+    return ht;
+}
+
+static int IntegerKeysError(const HashTable *ht,const char *fnName)
+{
+    char buf[256];
+
+    if (ht == NULL)
+        return NullPtrError(fnName);
+    snprintf(buf,sizeof(buf),"iHashTable.%s",fnName);
+    ht->RaiseError(buf,CONTAINER_ERROR_BADARG);
+    return CONTAINER_ERROR_BADARG;
+}
+
+static int AddInteger(HashTable *ht,uint64_t key,const void *val)
+{
+    if (ht == NULL || !ht->IntegerKeys)
+        return IntegerKeysError(ht,"AddInteger");
+    return Add(ht,&key,sizeof(key),val);
+}
+
+static void *GetElementInteger(const HashTable *ht,uint64_t key)
+{
+    HashEntry *he;
+    uint64_t h;
+
+    if (ht == NULL || !ht->IntegerKeys) {
+        IntegerKeysError(ht,"GetElementInteger");
+        return NULL;
+    }
+    h = MixInteger(key + ht->Seed);
+    for (he = ht->array[h & ht->max]; he; he = he->next) {
+        if (he->hash == h && *INTEGER_KEY(ht,he) == key)
+            return he->val;
+    }
+    return NULL;
+}
+
+static int EraseInteger(HashTable *ht,uint64_t key)
+{
+    if (ht == NULL || !ht->IntegerKeys)
+        return IntegerKeysError(ht,"EraseInteger");
+    return Remove(ht,&key,sizeof(key));
+}
+
 /* This is basically the following...
  * for every element in hash table {
  *    comp elemeny.key, element.value
@@ -538,6 +1348,49 @@ static int Apply(HashTable *ht,int (*Applyfn)(void *Key,size_t klen,void *data,v
     }
     return dorv;
 }
+/*------------------------------------------------------------------------
+ Procedure:     Scan ID:1
+ Purpose:       Visits the table in slices, so that a large table can
+                be scanned while it goes on changing between the
+                slices. Each call visits whole buckets until Count
+                entries were given to the callback, and stores in
+                Cursor the bucket where the next call starts. Every
+                entry that stays in the table during the whole scan
+                is visited at least once, even if the table is resized
+                between two calls; entries added or erased during the
+                scan may be visited or not. The table must not change
+                during a call: the changes are made between two calls.
+                A scan starts with a cursor of zero.
+ Input:         The table, the cursor, the number of entries wanted,
+                the callback and its argument. A callback that returns
+                zero ends the slice; the next call visits that bucket
+                again.
+ Output:        1 if the scan goes on, 0 when it is complete (the
+                cursor is back to zero), a negative error code
+ Errors:        BADARG if the table, the cursor or the callback is NULL
+------------------------------------------------------------------------*/
+static int Scan(HashTable *ht,size_t *Cursor,size_t Count,int (*Scanfn)(void *Key,size_t klen,void *data,void *arg),void *arg)
+{
+    HashEntry *he;
+    size_t v,n = 0,buckets = 0;
+
+    if (ht == NULL || Cursor == NULL || Scanfn == NULL)
+        return NullPtrError("Scan");
+    v = *Cursor;
+    do {
+        for (he = ht->array[v & ht->max]; he; he = he->next) {
+            if ((*Scanfn)((void *)he->key,he->klen,he->val,arg) == 0) {
+                *Cursor = v;
+                return 1;
+            }
+            n++;
+        }
+        v = HashScanNext(v,ht->max);
+    } while (v && n < Count && ++buckets < HASH_SCAN_BUCKETS*Count);
+    *Cursor = v;
+    return v != 0;
+}
+
 static ErrorFunction SetErrorFunction(HashTable *ht,ErrorFunction fn)
 {
     ErrorFunction old;
@@ -555,7 +1408,8 @@ static size_t Sizeof(const HashTable *HT)
 {
     if (HT == NULL)
         return sizeof(HashTable);
-    return sizeof(HashTable) + HT->count * (sizeof(HashEntry)+HT->ElementSize);
+    return sizeof(HashTable) + sizeof(*HT->array) * (HT->max + 1) +
+           HT->count * (sizeof(HashEntry)+HT->ElementSize+(HT->IntegerKeys ? sizeof(uint64_t) : 0));
 }
 static unsigned GetFlags(const HashTable *AL)
 {
@@ -567,14 +1421,6 @@ static unsigned SetFlags(HashTable *AL,unsigned newval)
     AL->Flags = newval;
     return oldval;
 }
-static int DefaultSaveFunction(const void *element,void *arg, FILE *Outfile)
-{
-    size_t *pLength = arg;
-    size_t len = *pLength;
-
-    return len == fwrite(element,1,len,Outfile);
-}
-
 static int DefaultLoadFunction(void *element,void *arg, FILE *Infile)
 {
     size_t len = *(size_t *)arg;
@@ -582,63 +1428,98 @@ static int DefaultLoadFunction(void *element,void *arg, FILE *Infile)
     return len == fread(element,1,len,Infile);
 }
 
+/*------------------------------------------------------------------------
+ Procedure:     Save ID:1
+ Purpose:       Writes the guid, the number of entries, the size of
+                the elements, the flags and the number of bytes of the
+                entries, then for each entry the length of the key
+                (ULE128 encoded), the key and the value. Without a save
+                function the entries are written in large blocks; with
+                one they go through stdio and their byte count is
+                written as SAVED_WITH_FUNCTION. A table with integer
+                keys saves its flags with SAVED_INTEGER_KEYS set.
+ Input:         The table, the stream, the save function and its
+                argument
+ Output:        1 if OK, EOF or a negative error code otherwise
+ Errors:        BADARG, NOMEMORY, EOF if a write fails
+------------------------------------------------------------------------*/
+#define SAVED_INTEGER_KEYS 0x80000000u
 static int Save(const HashTable *HT,FILE *stream, SaveFunction saveFn,void *arg)
 {
     HashIndex  hix;
     HashIndex *hi;
-    int rv;
-    int retval=1;
-    size_t elemsiz;
+    struct BlockFile bf;
+    uint64_t count,elemsiz,bytes = SAVED_WITH_FUNCTION;
+    unsigned Flags;
+    int rv = 1;
 
     if (HT == NULL || stream == NULL) {
         return NullPtrError("Save");
     }
+    hix.ht = (HashTable *)HT;
     if (saveFn == NULL) {
-        saveFn = DefaultSaveFunction;
-        elemsiz = HT->ElementSize;
-        arg = &elemsiz;
+        bytes = 0;
+        for (hi = first(&hix); hi; hi = next(hi))
+            bytes += ULE128Size(hi->This->klen) + hi->This->klen + HT->ElementSize;
     }
-    if (fwrite(&HashTableGuid,sizeof(guid),1,stream) == 0)
-        return EOF;
-    if (fwrite(HT,1,sizeof(HashTable),stream) == 0)
+    count = HT->count;
+    elemsiz = HT->ElementSize;
+    Flags = HT->Flags | (HT->IntegerKeys ? SAVED_INTEGER_KEYS : 0);
+    if (fwrite(&HashTableGuid,sizeof(guid),1,stream) == 0 ||
+        fwrite(&count,sizeof(count),1,stream) == 0 ||
+        fwrite(&elemsiz,sizeof(elemsiz),1,stream) == 0 ||
+        fwrite(&Flags,sizeof(unsigned),1,stream) == 0 ||
+        fwrite(&bytes,sizeof(bytes),1,stream) == 0)
         return EOF;
 
-    hix.ht    = (HashTable *)HT;
-    hix.index = 0;
-    hix.This  = NULL;
-    hix.next  = NULL;
-
-    hi = next(&hix);
-    if (hi) {
-        /* Scan the entire table */
-        do {
-            rv = encode_ule128(stream, hi->This->klen);
-            if (rv > 0)
-                rv = (int)fwrite(hi->This->key,1,hi->This->klen,stream);
-            if (rv > 0)
-                rv = (int)saveFn(hi->This->val,arg,stream);
-        } while (rv > 0 && (hi = next(hi)));
-
-        if (rv <= 0) {
-            retval = (int)rv;
+    if (saveFn) {
+        for (hi = first(&hix); hi && rv > 0; hi = next(hi)) {
+            if (encode_ule128(stream, hi->This->klen) <= 0 ||
+                fwrite(hi->This->key,1,hi->This->klen,stream) != hi->This->klen ||
+                saveFn(hi->This->val,arg,stream) <= 0)
+                rv = EOF;
         }
+        return rv;
     }
-    return retval;
+    if (BlockFileInit(&bf,stream,0,HT->Allocator) < 0)
+        return NoMemoryError(HT,"Save");
+    for (hi = first(&hix); hi && rv > 0; hi = next(hi)) {
+        if (BlockFileWriteULE128(&bf,hi->This->klen) < 0 ||
+            BlockFileWrite(&bf,hi->This->key,hi->This->klen) < 0 ||
+            BlockFileWrite(&bf,hi->This->val,HT->ElementSize) < 0)
+            rv = EOF;
+    }
+    if (rv > 0 && BlockFileFlush(&bf) < 0)
+        rv = EOF;
+    BlockFileFinalize(&bf);
+    return rv;
 }
 
+/* The bucket array is sized for all the entries before they are read,
+   and the keys are stored in a pool owned by the table. A file written
+   without a save function and read without a read function is read in
+   large blocks. The integer keys are read into a word and copied into
+   their entries by Add. */
 static HashTable *Load(FILE *stream, ReadFunction readFn,void *arg)
 {
-    size_t i,len,keybuflen;
-    HashTable *result=NULL,HT;
-    char *keybuf=NULL,*valbuf=NULL;
+    uint64_t count,elemsiz,bytes,intkey;
+    size_t i,len,ElementSize;
+    unsigned Flags;
+    HashTable *ht;
+    char *key,*val = NULL;
+    struct BlockFile bf;
+    int blocks;
     guid Guid;
 
-    if (readFn == NULL) {
-        readFn = DefaultLoadFunction;
-        arg = &HT.ElementSize;
+    if (stream == NULL) {
+        NullPtrError("Load");
+        return NULL;
     }
-
-    if (fread(&Guid,sizeof(guid),1,stream) == 0) {
+    if (fread(&Guid,sizeof(guid),1,stream) == 0 ||
+        fread(&count,sizeof(count),1,stream) == 0 ||
+        fread(&elemsiz,sizeof(elemsiz),1,stream) == 0 ||
+        fread(&Flags,sizeof(unsigned),1,stream) == 0 ||
+        fread(&bytes,sizeof(bytes),1,stream) == 0) {
         iError.RaiseError("iHashTable.Load",CONTAINER_ERROR_FILE_READ);
         return NULL;
     }
@@ -646,44 +1527,63 @@ static HashTable *Load(FILE *stream, ReadFunction readFn,void *arg)
         iError.RaiseError("iHashTable.Load",CONTAINER_ERROR_WRONGFILE);
         return NULL;
     }
-    if (fread(&HT,1,sizeof(HashTable),stream) == 0) {
-        iError.RaiseError("HashTable.Load",CONTAINER_ERROR_FILE_READ);
-        return NULL;
+    ElementSize = (size_t)elemsiz;
+    blocks = (readFn == NULL && bytes != SAVED_WITH_FUNCTION);
+    if (readFn == NULL) {
+        readFn = DefaultLoadFunction;
+        arg = &ElementSize;
     }
-    result = iHashTable.Create(HT.ElementSize);
-    if (result == NULL)
+    ht = (Flags & SAVED_INTEGER_KEYS) ? CreateIntegerKeys(ElementSize) : Create(ElementSize);
+    if (ht == NULL)
         return NULL;
-    keybuflen = 4096;
-    keybuf = malloc(keybuflen);
-    valbuf = malloc(HT.ElementSize);
-    result->Flags = HT.Flags;
-    for (i=0; i< HT.count; i++) {
-        if (decode_ule128(stream, &len) <= 0) {
-        err:
-            iError.RaiseError("iHashTable.Load",CONTAINER_ERROR_FILE_READ);
-            goto out;
-        }
-        if (keybuflen < len) {
-            void *tmp = realloc(keybuf,len);
-            if (tmp == NULL) {
-                iError.RaiseError("iHashTable.Load",CONTAINER_ERROR_NOMEMORY);
-                goto out;
-            }
-            keybuf = tmp;
-            keybuflen = len;
-        }
-        if (fread(keybuf,1,len,stream) == 0) {
-            goto err;
+    Flags &= ~SAVED_INTEGER_KEYS;
+    bf.buf = NULL;
+    ht->KeyPool = iPool.Create((ContainerAllocator *)ht->Allocator);
+    if (ht->KeyPool == NULL || Resize(ht,(size_t)count) < 0 ||
+        (val = ht->Allocator->malloc(ElementSize+1)) == NULL ||
+        (blocks && BlockFileInit(&bf,stream,bytes,ht->Allocator) < 0))
+        goto nomem;
+    for (i = 0; i < count; i++) {
+        if (blocks) {
+            if (BlockFileReadULE128(&bf,&len) <= 0 || len == 0 ||
+                (ht->IntegerKeys && len != sizeof(intkey)))
+                goto readerr;
+            if ((key = ht->IntegerKeys ? (char *)&intkey : iPool.Alloc(ht->KeyPool,len)) == NULL)
+                goto nomem;
+            if (BlockFileRead(&bf,key,len) < 0 ||
+                BlockFileRead(&bf,val,ElementSize) < 0)
+                goto readerr;
         }
-        if (readFn(valbuf,arg,stream) == 0) {
-            goto err;
+        else {
+            if (decode_ule128(stream,&len) <= 0 || len == 0 ||
+                (ht->IntegerKeys && len != sizeof(intkey)))
+                goto readerr;
+            if ((key = ht->IntegerKeys ? (char *)&intkey : iPool.Alloc(ht->KeyPool,len)) == NULL)
+                goto nomem;
+            if (fread(key,1,len,stream) != len ||
+                readFn(val,arg,stream) <= 0)
+                goto readerr;
         }
-        iHashTable.Add(result,keybuf,len,valbuf);
+        if (Add(ht,key,len,val) < 0)
+            goto nomem;
     }
-out:
-    if (keybuf) free(keybuf);
-    if (valbuf) free(valbuf);
-    return result;
+    if (bf.buf)
+        BlockFileFinalize(&bf);
+    ht->Allocator->free(val);
+    ht->Flags = Flags;
+    return ht;
+readerr:
+    iError.RaiseError("iHashTable.Load",CONTAINER_ERROR_FILE_READ);
+    goto err;
+nomem:
+    iError.RaiseError("iHashTable.Load",CONTAINER_ERROR_NOMEMORY);
+err:
+    if (bf.buf)
+        BlockFileFinalize(&bf);
+    if (val)
+        ht->Allocator->free(val);
+    Finalize(ht);
+    return NULL;
 }
 
 /* ------------------------------------------------------------------------------ */
@@ -761,8 +1661,11 @@ static int ReplaceWithIterator(Iterator *it, void *data,int direction)
         return 0;
     current = *li->Current;
     GetNext(it);
-    if (data == NULL)
-        result = Remove(li->ht, current.This->key,current.This->klen);
+    /* HashSet doesn't shrink the table, that would move the entries */
+    if (data == NULL) {
+        HashSet(li->ht, current.This->key,current.This->klen,NULL);
+        result = 1;
+    }
     else {
         memcpy(current.This->val,data,li->ht->ElementSize);
         result = 1;
@@ -792,6 +1695,7 @@ static Iterator *NewIterator(HashTable *ht)
     result->timestamp = ht->timestamp;
     result->Current = NULL;
     result->ht = ht;
+    result->hi.ht = ht;
     return &result->it;
 }
 
@@ -811,6 +1715,7 @@ static int InitIterator(HashTable *ht,void *buf)
     result->timestamp = ht->timestamp;
     result->Current = NULL;
     result->ht = ht;
+    result->hi.ht = ht;
     return 1;
 }
 
@@ -841,6 +1746,177 @@ static DestructorFunction SetDestructor(HashTable *cb,DestructorFunction fn)
     return oldfn;
 }
 
+#define BATCH_SIZE 16
+/*
+ * Looks up at most BATCH_SIZE keys. All keys are hashed and their slots
+ * prefetched first, then the first entry of each chain is prefetched,
+ * and only then the chains are searched: the cache misses of the group
+ * overlap instead of being paid one after the other.
+ */
+static int LookupGroup(const HashTable *ht,size_t m,const void **Keys,const size_t *klens,HashEntry **Found)
+{
+    uint64_t h[BATCH_SIZE];
+    size_t kl[BATCH_SIZE];
+    size_t j;
+    HashEntry *he;
+
+    for (j = 0; j < m; j++) {
+        if (Keys[j] == NULL)
+            return -1;
+        kl[j] = klens ? klens[j] : (size_t)-1;
+        h[j] = HashKey(ht,Keys[j],&kl[j]);
+        CCL_PREFETCH(&ht->array[h[j] & ht->max]);
+    }
+    for (j = 0; j < m; j++)
+        CCL_PREFETCH(ht->array[h[j] & ht->max]);
+    for (j = 0; j < m; j++) {
+        for (he = ht->array[h[j] & ht->max]; he; he = he->next) {
+            if (he->hash == h[j]
+                && he->klen == kl[j]
+                && memcmp(he->key, Keys[j], kl[j]) == 0)
+                break;
+        }
+        Found[j] = he;
+    }
+    return 0;
+}
+
+/*
+ * Looks up n keys at once. Results[i] receives what GetElement would
+ * return for Keys[i]. If klens is NULL all keys are zero terminated
+ * strings. Returns the number of keys found.
+ */
+static int GetElements(const HashTable *ht,size_t n,const void **Keys,const size_t *klens,void **Results)
+{
+    HashEntry *Found[BATCH_SIZE];
+    size_t i,j,m;
+    int found = 0;
+
+    if (ht == NULL)
+        return NullPtrError("GetElements");
+    if (n && (Keys == NULL || Results == NULL)) {
+        ht->RaiseError("iHashTable.GetElements",CONTAINER_ERROR_BADARG);
+        return CONTAINER_ERROR_BADARG;
+    }
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+        if (LookupGroup(ht,m,Keys+i,klens ? klens+i : NULL,Found) < 0) {
+            ht->RaiseError("iHashTable.GetElements",CONTAINER_ERROR_BADARG);
+            return CONTAINER_ERROR_BADARG;
+        }
+        for (j = 0; j < m; j++) {
+            if (Found[j]) {
+                Results[i+j] = Found[j]->val;
+                found++;
+            }
+            else Results[i+j] = NULL;
+        }
+    }
+    return found;
+}
+
+/* The value of a key copied to outbuf. Returns 1 if the key was
+   found, 0 if not (outbuf is not changed). */
+static int CopyElement(const HashTable *ht,const void *key,size_t klen,void *outbuf)
+{
+    void *p;
+
+    if (ht == NULL)
+        return NullPtrError("CopyElement");
+    if (outbuf == NULL) {
+        ht->RaiseError("iHashTable.CopyElement",CONTAINER_ERROR_BADARG);
+        return CONTAINER_ERROR_BADARG;
+    }
+    p = GetElement(ht,key,klen);
+    if (p == NULL)
+        return 0;
+    memcpy(outbuf,p,ht->ElementSize);
+    return 1;
+}
+
+/* GetElements copying the values of the keys found to outbuf, an array
+   of n elements. Found[i], if Found isn't NULL, tells if Keys[i] was. */
+static int CopyElements(const HashTable *ht,size_t n,const void **Keys,const size_t *klens,void *outbuf,unsigned char *Found)
+{
+    void *Results[BATCH_SIZE];
+    size_t i,j,m;
+    int r,found = 0;
+
+    if (ht == NULL)
+        return NullPtrError("CopyElements");
+    if (n && outbuf == NULL) {
+        ht->RaiseError("iHashTable.CopyElements",CONTAINER_ERROR_BADARG);
+        return CONTAINER_ERROR_BADARG;
+    }
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+        r = GetElements(ht,m,Keys+i,klens ? klens+i : NULL,Results);
+        if (r < 0)
+            return r;
+        found += r;
+        for (j = 0; j < m; j++) {
+            if (Results[j])
+                memcpy((char *)outbuf + (i+j)*ht->ElementSize,Results[j],ht->ElementSize);
+            if (Found)
+                Found[i+j] = Results[j] != NULL;
+        }
+    }
+    return found;
+}
+
+/*
+ * Tests n keys at once: Results[i] is set to 1 if Keys[i] is in the
+ * table, to zero otherwise. Returns the number of keys found.
+ */
+static int ContainsMany(const HashTable *ht,size_t n,const void **Keys,const size_t *klens,unsigned char *Results)
+{
+    HashEntry *Found[BATCH_SIZE];
+    size_t i,j,m;
+    int found = 0;
+
+    if (ht == NULL)
+        return NullPtrError("ContainsMany");
+    if (n && (Keys == NULL || Results == NULL)) {
+        ht->RaiseError("iHashTable.ContainsMany",CONTAINER_ERROR_BADARG);
+        return CONTAINER_ERROR_BADARG;
+    }
+    for (i = 0; i < n; i += m) {
+        m = (n - i < BATCH_SIZE) ? n - i : BATCH_SIZE;
+        if (LookupGroup(ht,m,Keys+i,klens ? klens+i : NULL,Found) < 0) {
+            ht->RaiseError("iHashTable.ContainsMany",CONTAINER_ERROR_BADARG);
+            return CONTAINER_ERROR_BADARG;
+        }
+        for (j = 0; j < m; j++) {
+            Results[i+j] = Found[j] != NULL;
+            found += Results[i+j];
+        }
+    }
+    return found;
+}
+
+/* The keys are counted but don't belong to the table, unless Load read
+   them */
+static int GetStatistics(const HashTable *ht,HashStatistics *Stats)
+{
+    HashEntry *he;
+    size_t i,n;
+
+    if (ht == NULL || Stats == NULL)
+        return NullPtrError("GetStatistics");
+    HashStatsInit(Stats,(size_t)ht->max + 1);
+    for (i = 0; i <= ht->max; i++) {
+        n = 0;
+        for (he = ht->array[i]; he; he = he->next) {
+            Stats->KeyBytes += he->klen;
+            n++;
+        }
+        HashStatsChain(Stats,n);
+    }
+    Stats->Resizes = ht->Resizes;
+    /* The integer keys are stored in the entries */
+    HashStatsFinish(Stats,ht->ElementSize,Sizeof(ht) - (ht->IntegerKeys ? Stats->KeyBytes : 0));
+    return 1;
+}
 
 HashTableInterface iHashTable = {
 Size,
@@ -872,5 +1948,19 @@ SizeofIterator,
 Save,
 Load,
 SetDestructor,
+GetElements,
+ContainsMany,
+SetSeed,
+Reserve,
+ShrinkToFit,
+GetStatistics,
+BuildFrom,
+CreateIntegerKeys,
+AddInteger,
+GetElementInteger,
+EraseInteger,
+Scan,
+CopyElement,
+CopyElements,
 };
 
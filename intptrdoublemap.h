@@ -0,0 +1,14 @@
+#ifndef __intptrdoubleMap_h__
+#define __intptrdoubleMap_h__
+#include "containers.h"
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
+#define KEY_TYPE intptr_t
+#define DATA_TYPE double
+#define MAP_NAME intptrdouble
+#include "hashmapgen.h"
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
+#endif
@@ -0,0 +1,11 @@
+#include "containers.h"
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
+#define KEY_TYPE intptr_t
+#define DATA_TYPE void *
+#define MAP_NAME intptrptr
+#include "hashmapgen.c"
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
@@ -0,0 +1,14 @@
+#ifndef __intptrptrMap_h__
+#define __intptrptrMap_h__
+#include "containers.h"
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
+#define KEY_TYPE intptr_t
+#define DATA_TYPE void *
+#define MAP_NAME intptrptr
+#include "hashmapgen.h"
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
+#endif
@@ -1153,6 +1153,37 @@ static int Sort(List * l)
     return 1;
 
 }
+
+/*------------------------------------------------------------------------
+ Procedure:     StableSort ID:1
+ Purpose:       Sorts the list keeping the order of the elements that
+                compare equal. The nodes are relinked in place: nothing
+                is allocated. Sorted or nearly sorted lists take linear
+                time.
+ Input:         The list
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG if the list is NULL, READONLY
+------------------------------------------------------------------------*/
+static int StableSort(List * l)
+{
+    CompareInfo     ci;
+    void           *last;
+
+    if (l == NULL)
+        return NullPtrError("StableSort");
+    if (l->Flags & CONTAINER_READONLY)
+        return ErrorReadOnly(l, "StableSort");
+    if (l->count < 2)
+        return 1;
+    ci.ContainerLeft = l;
+    ci.ContainerRight = NULL;
+    ci.ExtraArgs = NULL;
+    l->First = MergeSortLinked(l->First, l->count, offsetof(ListElement, Data), l->Compare, &ci, &last);
+    l->Last = last;
+    l->timestamp++;
+    return 1;
+}
+
 static int      Apply(List * L, int (Applyfn) (void *, void *), void *arg) {
     ListElement    *le;
     void           *pElem = NULL;
@@ -2103,4 +2134,5 @@ ListInterface   iList = {
     Advance,
     Skip,
     SplitAfter,
+    StableSort,
 };
@@ -0,0 +1,142 @@
+/*------------------------------------------------------------------------
+ Module:        parallel.c
+ Author:        jacob
+ Project:       Containers
+ State:
+ Creation Date:
+ Description:   Runs the parts of a job in several threads, for the
+                functions of the library that process large containers
+                in parallel. The threads are started for the job and
+                joined at its end: the jobs are long enough for the
+                cost of starting a thread not to matter.
+------------------------------------------------------------------------*/
+#include "containers.h"
+#include "ccl_internal.h"
+#ifdef UNIX
+#include <pthread.h>
+#include <unistd.h>
+typedef pthread_t Thread;
+static pthread_mutex_t SerialLock = PTHREAD_MUTEX_INITIALIZER;
+#else
+#include <windows.h>
+typedef HANDLE Thread;
+static volatile LONG SerialLock;
+#endif
+
+struct Part {
+    void (*Work)(void *arg,unsigned i);
+    void *arg;
+    unsigned i;
+};
+
+/*------------------------------------------------------------------------
+ Procedure:     ParallelThreads ID:1
+ Purpose:       Returns the number of threads a job should use
+ Input:         None
+ Output:        The value of CCL_THREADS if it is set, otherwise the
+                number of processors, between 1 and PARALLEL_MAX_THREADS
+ Errors:        None
+------------------------------------------------------------------------*/
+unsigned ParallelThreads(void)
+{
+    const char *env = getenv("CCL_THREADS");
+    long n = 0;
+
+    if (env)
+        n = atol(env);
+    if (n <= 0) {
+#ifdef UNIX
+        n = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        n = si.dwNumberOfProcessors;
+#endif
+    }
+    if (n <= 0)
+        n = 1;
+    return n > PARALLEL_MAX_THREADS ? PARALLEL_MAX_THREADS : (unsigned)n;
+}
+
+#ifdef UNIX
+static void *RunPart(void *arg)
+{
+    struct Part *p = arg;
+
+    p->Work(p->arg,p->i);
+    return NULL;
+}
+#else
+static DWORD WINAPI RunPart(LPVOID arg)
+{
+    struct Part *p = arg;
+
+    p->Work(p->arg,p->i);
+    return 0;
+}
+#endif
+
+/*------------------------------------------------------------------------
+ Procedure:     ParallelRun ID:1
+ Purpose:       Calls Work(arg,i) for i from 0 to n-1, each call in its
+                own thread. Part 0 runs in the calling thread.
+ Input:         The number of parts (at most PARALLEL_MAX_THREADS), the
+                function and its argument
+ Output:        None. All the parts are done when it returns.
+ Errors:        The parts whose thread can't be started run in the
+                calling thread.
+------------------------------------------------------------------------*/
+void ParallelRun(unsigned n,void (*Work)(void *arg,unsigned i),void *arg)
+{
+    struct Part parts[PARALLEL_MAX_THREADS];
+    Thread threads[PARALLEL_MAX_THREADS];
+    char started[PARALLEL_MAX_THREADS];
+    unsigned i;
+
+    if (n > PARALLEL_MAX_THREADS)
+        n = PARALLEL_MAX_THREADS;
+    for (i = 1; i < n; i++) {
+        parts[i].Work = Work;
+        parts[i].arg = arg;
+        parts[i].i = i;
+#ifdef UNIX
+        started[i] = pthread_create(&threads[i],NULL,RunPart,&parts[i]) == 0;
+#else
+        threads[i] = CreateThread(NULL,0,RunPart,&parts[i],0,NULL);
+        started[i] = threads[i] != NULL;
+#endif
+    }
+    if (n)
+        Work(arg,0);
+    for (i = 1; i < n; i++) {
+        if (!started[i]) {
+            Work(arg,i);
+            continue;
+        }
+#ifdef UNIX
+        pthread_join(threads[i],NULL);
+#else
+        WaitForSingleObject(threads[i],INFINITE);
+        CloseHandle(threads[i]);
+#endif
+    }
+}
+
+void ParallelEnter(void)
+{
+#ifdef UNIX
+    pthread_mutex_lock(&SerialLock);
+#else
+    while (InterlockedCompareExchange(&SerialLock,1,0))
+        Sleep(0);
+#endif
+}
+
+void ParallelLeave(void)
+{
+#ifdef UNIX
+    pthread_mutex_unlock(&SerialLock);
+#else
+    InterlockedExchange(&SerialLock,0);
+#endif
+}
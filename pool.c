@@ -52,6 +52,7 @@ The algorithms of this code have been adapted from the Apache runtime library.
 #endif
 #ifndef TEST
 #include "containers.h"
+#include "ccl_internal.h"
 #else
 #include <string.h>
 #include <stdlib.h>
@@ -494,6 +495,7 @@ static void PoolFinalize(Pool *pool)
 {
     MemoryNode_t *active;
     Allocator *allocator;
+    ContainerAllocator *m;
 
     /* Find the block attached to the pool structure.  Save a copy of the
      * allocator pointer, because the pool struct soon will be no more.
@@ -505,9 +507,11 @@ static void PoolFinalize(Pool *pool)
     /* Free all the nodes in the pool (including the node holding the
      * pool struct), by giving them back to the allocator.
      */
-    allocator_free(allocator, active,pool->MemManager);
+    m = pool->MemManager;
+    allocator_free(allocator, active,m);
 
-    destroyAllocator(allocator,pool->MemManager);
+    destroyAllocator(allocator,m);
+    m->free(allocator);
 }
 
 static Pool *newPool(ContainerAllocator *m)
@@ -548,6 +552,60 @@ PoolAllocatorInterface iPool = {
     PoolFinalize,
 };
 
+#ifndef TEST
+/*
+ * String arenas. The strings are packed one after the other in chunks
+ * taken from a pool, without the 8 byte rounding of PoolAlloc, and they
+ * are all released together when the pool is cleared or destroyed.
+ */
+#define ARENA_CHUNK (32*1024 - MEMORYNODE_SIZE)
+
+int StringArenaInit(struct StringArena *a,const ContainerAllocator *m)
+{
+    a->pool = newPool((ContainerAllocator *)m);
+    a->next = NULL;
+    a->left = 0;
+    return a->pool ? 1 : CONTAINER_ERROR_NOMEMORY;
+}
+
+void *StringArenaAlloc(struct StringArena *a,size_t size,size_t align)
+{
+    char *p;
+    size_t pad = (align - ((uintptr_t)a->next & (align-1))) & (align-1);
+
+    if (size + pad <= a->left) {
+        p = a->next + pad;
+        a->next = p + size;
+        a->left -= size + pad;
+        return p;
+    }
+    /* Big strings get their own block, so the current chunk is kept */
+    if (size > ARENA_CHUNK/4)
+        return PoolAlloc(a->pool,size);
+    p = PoolAlloc(a->pool,ARENA_CHUNK);
+    if (p == NULL)
+        return NULL;
+    a->next = p + size;
+    a->left = ARENA_CHUNK - size;
+    return p;
+}
+
+void StringArenaClear(struct StringArena *a)
+{
+    PoolClear(a->pool);
+    a->next = NULL;
+    a->left = 0;
+}
+
+void StringArenaFinalize(struct StringArena *a)
+{
+    PoolFinalize(a->pool);
+    a->pool = NULL;
+    a->next = NULL;
+    a->left = 0;
+}
+#endif
+
 #ifdef TEST
 int main(void)
 {
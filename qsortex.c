@@ -1,159 +1,1114 @@
-/*---------------------------------------------------------------------------*/
-/* qsort() - perform a quicksort on an array                                 */
-/*---------------------------------------------------------------------------*/
-#include <errno.h>
+/*------------------------------------------------------------------------
+ Module:        qsortex.c
+ Author:        jacob
+ Project:       Containers
+ State:
+ Creation Date:
+ Description:   qsortEx sorts an array with a comparison function that
+                receives a CompareInfo. All the Sort functions of the
+                library end here.
+                The algorithm is the pattern-defeating quicksort of
+                Orson Peters (pdqsort): an introsort whose worst case
+                is O(n log n), that recognizes the patterns that make a
+                plain quicksort slow.
+                - An input already sorted or sorted in reverse order is
+                  recognized in one pass.
+                - The pivot is the median of three elements, or of
+                  three medians of three above NINTHER_THRESHOLD
+                  elements.
+                - A part whose pivot equals the element before it (the
+                  pivot of an earlier partition) is made of elements
+                  that are not smaller than it: the equal elements are
+                  put on the left and not sorted again, so many
+                  duplicates cost linear time.
+                - A partition that found the elements already in place
+                  is followed by an insertion sort that gives up after
+                  a few moves, so that an almost sorted input is sorted
+                  in nearly linear time.
+                - An unbalanced partition shuffles some elements to
+                  break the pattern that caused it, and after log2(n)
+                  of them the part is sorted with heapsort.
+                The partition collects the offsets of the misplaced
+                elements of blocks of BLOCK_SIZE elements (Edelkamp and
+                Weiss, BlockQuicksort), so that the result of a
+                comparison is added to a count instead of deciding a
+                branch. The elements are exchanged by words when their
+                size and the array allow it.
+                ParallelSort sorts large arrays in several threads.
+------------------------------------------------------------------------*/
 #include <string.h>
 #include <stdlib.h>
 #include "containers.h"
+#include "ccl_internal.h"
 
+#define INSERTION_SORT_THRESHOLD 24 /* Smaller parts are sorted by insertion */
+#define NINTHER_THRESHOLD        128 /* Larger parts take a median of 9 elements */
+#define PARTIAL_INSERTION_LIMIT  8   /* Moves allowed to an optimistic insertion sort */
+#define BLOCK_SIZE               64  /* Elements examined per block of the partition */
+#define PARALLEL_SORT_MIN        65536 /* Elements per thread worth a thread */
 
-/*
-// qsort.c
-//
-// Quick sort
-//
-// Copyright (C) 2002 Michael Ringgaard. All rights reserved.
-//
-// Redistribution and use in source and binary forms, with or without
-// modification, are permitted provided that the following conditions
-// are met:
-// 
-// 1. Redistributions of source code must retain the above copyright 
-//    notice, this list of conditions and the following disclaimer.  
-// 2. Redistributions in binary form must reproduce the above copyright
-//    notice, this list of conditions and the following disclaimer in the
-//    documentation and/or other materials provided with the distribution.  
-// 3. Neither the name of the project nor the names of its contributors
-//    may be used to endorse or promote products derived from this software
-//    without specific prior written permission. 
-// 
-// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
-// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
-// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
-// ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
-// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
-// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
-// OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
-// HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
-// LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
-// OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF 
-// SUCH DAMAGE.
-*/
-
-#define CUTOFF 8
-
-static void shortsort(char *lo, char *hi, size_t width, int (*comp)(const void *, const void *,CompareInfo *ExtraArgs),CompareInfo *ExtraARgs);
-static void swap(char *p, char *q, size_t width);
+/* How the elements are exchanged */
+#define SWAP_BYTES 0
+#define SWAP_INT   1  /* One aligned 32 bit word */
+#define SWAP_LONG  2  /* One aligned 64 bit word */
+#define SWAP_WORDS 3  /* Several aligned size_t words */
 
-void qsortEx(void *base, size_t num, size_t width, CompareFunction comp, CompareInfo *ExtraArgs)
+struct SortArgs {
+    size_t w;                /* Size of an element */
+    CompareFunction cmp;
+    CompareInfo *ci;
+    int SwapType;
+};
+
+#define LESS(s,a,b) ((s)->cmp((a),(b),(s)->ci) < 0)
+
+static void Swap(const struct SortArgs *s,char *a,char *b)
+{
+    size_t n,*p,*q,t;
+    uint32_t t32;
+    uint64_t t64;
+    char tmp;
+
+    switch (s->SwapType) {
+    case SWAP_INT:
+        t32 = *(uint32_t *)a;
+        *(uint32_t *)a = *(uint32_t *)b;
+        *(uint32_t *)b = t32;
+        break;
+    case SWAP_LONG:
+        t64 = *(uint64_t *)a;
+        *(uint64_t *)a = *(uint64_t *)b;
+        *(uint64_t *)b = t64;
+        break;
+    case SWAP_WORDS:
+        p = (size_t *)a;
+        q = (size_t *)b;
+        for (n = s->w/sizeof(size_t); n > 0; n--) {
+            t = *p;
+            *p++ = *q;
+            *q++ = t;
+        }
+        break;
+    default:
+        for (n = s->w; n > 0; n--) {
+            tmp = *a;
+            *a++ = *b;
+            *b++ = tmp;
+        }
+        break;
+    }
+}
+
+static int GetSwapType(const void *base,size_t width)
+{
+    size_t align = (size_t)(uintptr_t)base | width;
+
+    if (width == sizeof(uint32_t) && align % sizeof(uint32_t) == 0)
+        return SWAP_INT;
+    if (width == sizeof(uint64_t) && align % sizeof(uint64_t) == 0)
+        return SWAP_LONG;
+    if (align % sizeof(size_t) == 0)
+        return SWAP_WORDS;
+    return SWAP_BYTES;
+}
+
+static void InsertionSort(const struct SortArgs *s,char *begin,char *end)
+{
+    size_t w = s->w;
+    char *cur,*sift;
+
+    for (cur = begin + w; cur < end; cur += w) {
+        for (sift = cur; sift > begin && LESS(s,sift,sift - w); sift -= w)
+            Swap(s,sift,sift - w);
+    }
+}
+
+/* The element before begin is not greater than any element of the
+   part, so it stops the moves */
+static void UnguardedInsertionSort(const struct SortArgs *s,char *begin,char *end)
+{
+    size_t w = s->w;
+    char *cur,*sift;
+
+    for (cur = begin + w; cur < end; cur += w) {
+        for (sift = cur; LESS(s,sift,sift - w); sift -= w)
+            Swap(s,sift,sift - w);
+    }
+}
+
+/* An insertion sort that gives up after PARTIAL_INSERTION_LIMIT moves.
+   Returns 1 if the part is sorted. */
+static int PartialInsertionSort(const struct SortArgs *s,char *begin,char *end)
+{
+    size_t w = s->w,limit = 0;
+    char *cur,*sift;
+
+    for (cur = begin + w; cur < end; cur += w) {
+        for (sift = cur; sift > begin && LESS(s,sift,sift - w); sift -= w)
+            Swap(s,sift,sift - w);
+        limit += (size_t)(cur - sift)/w;
+        if (limit > PARTIAL_INSERTION_LIMIT)
+            return cur + w == end;
+    }
+    return 1;
+}
+
+static void Sort2(const struct SortArgs *s,char *a,char *b)
+{
+    if (LESS(s,b,a))
+        Swap(s,a,b);
+}
+
+/* Puts the median of the three elements in b */
+static void Sort3(const struct SortArgs *s,char *a,char *b,char *c)
+{
+    Sort2(s,a,b);
+    Sort2(s,b,c);
+    Sort2(s,a,b);
+}
+
+static void SiftDown(const struct SortArgs *s,char *base,size_t root,size_t n)
+{
+    size_t w = s->w,child;
+
+    for (;;) {
+        child = 2*root + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && LESS(s,base + child*w,base + (child+1)*w))
+            child++;
+        if (!LESS(s,base + root*w,base + child*w))
+            break;
+        Swap(s,base + root*w,base + child*w);
+        root = child;
+    }
+}
+
+static void HeapSort(const struct SortArgs *s,char *begin,char *end)
+{
+    size_t w = s->w,n = (size_t)(end - begin)/w,i;
+
+    for (i = n/2; i-- > 0;)
+        SiftDown(s,begin,i,n);
+    for (i = n - 1; i > 0; i--) {
+        Swap(s,begin,begin + i*w);
+        SiftDown(s,begin,0,i);
+    }
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     PartitionRight ID:1
+ Purpose:       Partitions [begin,end) around the pivot at begin: the
+                smaller elements go left, the others right. The pivot
+                stays at begin until the end. The elements between the
+                two scans are examined by blocks: the offsets of those
+                on the wrong side are stored, and pairs of them are
+                exchanged.
+ Input:         The part, whose median of three is at begin. An element
+                not smaller than the pivot follows it.
+ Output:        The final place of the pivot. *AlreadyPartitioned is
+                set when no element had to be moved.
+ Errors:        None
+------------------------------------------------------------------------*/
+static char *PartitionRight(const struct SortArgs *s,char *begin,char *end,int *AlreadyPartitioned)
 {
-  char *lo, *hi;
-  char *mid;
-  char *loguy, *higuy;
-  size_t size;
-  char *lostk[30], *histk[30];
-  int stkptr;
+    unsigned char offsets_l[BLOCK_SIZE],offsets_r[BLOCK_SIZE];
+    size_t w = s->w,num_l = 0,num_r = 0,start_l = 0,start_r = 0;
+    size_t num_unknown,left_split,right_split,num,i;
+    char *first = begin,*last = end,*base_l,*base_r,*pivot_pos;
+
+    do first += w; while (LESS(s,first,begin));
+    if (first - w == begin) {
+        while (first < last) {
+            last -= w;
+            if (LESS(s,last,begin))
+                break;
+        }
+    }
+    else do last -= w; while (!LESS(s,last,begin));
+    *AlreadyPartitioned = first >= last;
+    if (first < last) {
+        Swap(s,first,last);
+        first += w;
+        base_l = first;
+        base_r = last;
+        while (first < last) {
+            /* Fill the empty blocks with the elements on the wrong side */
+            num_unknown = (size_t)(last - first)/w;
+            left_split = num_l == 0 ? (num_r == 0 ? num_unknown/2 : num_unknown) : 0;
+            right_split = num_r == 0 ? num_unknown - left_split : 0;
+            if (left_split > BLOCK_SIZE)
+                left_split = BLOCK_SIZE;
+            if (right_split > BLOCK_SIZE)
+                right_split = BLOCK_SIZE;
+            for (i = 0; i < left_split; i++) {
+                offsets_l[num_l] = (unsigned char)i;
+                num_l += !LESS(s,first,begin);
+                first += w;
+            }
+            for (i = 0; i < right_split;) {
+                offsets_r[num_r] = (unsigned char)++i;
+                last -= w;
+                num_r += LESS(s,last,begin);
+            }
+            num = num_l < num_r ? num_l : num_r;
+            for (i = 0; i < num; i++)
+                Swap(s,base_l + offsets_l[start_l+i]*w,base_r - offsets_r[start_r+i]*w);
+            num_l -= num;
+            num_r -= num;
+            start_l += num;
+            start_r += num;
+            if (num_l == 0) {
+                start_l = 0;
+                base_l = first;
+            }
+            if (num_r == 0) {
+                start_r = 0;
+                base_r = last;
+            }
+        }
+        /* The elements of the block that is left go to the other side */
+        if (num_l) {
+            while (num_l--) {
+                last -= w;
+                Swap(s,base_l + offsets_l[start_l+num_l]*w,last);
+            }
+            first = last;
+        }
+        if (num_r) {
+            while (num_r--) {
+                Swap(s,base_r - offsets_r[start_r+num_r]*w,first);
+                first += w;
+            }
+        }
+    }
+    pivot_pos = first - w;
+    if (pivot_pos != begin)
+        Swap(s,begin,pivot_pos);
+    return pivot_pos;
+}
 
-  if (num < 2 || width == 0) return;
-  stkptr = 0;
+/* Partitions [begin,end) putting the elements equal to the pivot at
+   begin on the left. The element before begin is equal to the pivot,
+   and no element of the part is smaller. */
+static char *PartitionLeft(const struct SortArgs *s,char *begin,char *end)
+{
+    size_t w = s->w;
+    char *first = begin,*last = end;
 
-  lo = base;
-  hi = (char *) base + width * (num - 1);
+    do last -= w; while (LESS(s,begin,last));
+    if (last + w == end) {
+        while (first < last) {
+            first += w;
+            if (LESS(s,begin,first))
+                break;
+        }
+    }
+    else do first += w; while (!LESS(s,begin,first));
+    while (first < last) {
+        Swap(s,first,last);
+        do last -= w; while (LESS(s,begin,last));
+        do first += w; while (!LESS(s,begin,first));
+    }
+    if (last != begin)
+        Swap(s,begin,last);
+    return last;
+}
 
-recurse:
-  size = (hi - lo) / width + 1;
+/* Exchanges some elements of a part left unbalanced by a partition, so
+   that the next pivot doesn't fall in the same pattern */
+static void BreakPatterns(const struct SortArgs *s,char *begin,char *pivot_pos,char *end)
+{
+    size_t w = s->w,l_size = (size_t)(pivot_pos - begin)/w;
+    size_t r_size = (size_t)(end - pivot_pos)/w - 1,q;
 
-  if (size <= CUTOFF) 
-  {
-    shortsort(lo, hi, width, comp,ExtraArgs);
-  }
-  else 
-  {
-    mid = lo + (size / 2) * width;
-    swap(mid, lo, width);
+    if (l_size >= INSERTION_SORT_THRESHOLD) {
+        q = l_size/4;
+        Swap(s,begin,begin + q*w);
+        Swap(s,pivot_pos - w,pivot_pos - q*w);
+        if (l_size > NINTHER_THRESHOLD) {
+            Swap(s,begin + w,begin + (q+1)*w);
+            Swap(s,begin + 2*w,begin + (q+2)*w);
+            Swap(s,pivot_pos - 2*w,pivot_pos - (q+1)*w);
+            Swap(s,pivot_pos - 3*w,pivot_pos - (q+2)*w);
+        }
+    }
+    if (r_size >= INSERTION_SORT_THRESHOLD) {
+        q = r_size/4;
+        Swap(s,pivot_pos + w,pivot_pos + (q+1)*w);
+        Swap(s,end - w,end - q*w);
+        if (r_size > NINTHER_THRESHOLD) {
+            Swap(s,pivot_pos + 2*w,pivot_pos + (q+2)*w);
+            Swap(s,pivot_pos + 3*w,pivot_pos + (q+3)*w);
+            Swap(s,end - 2*w,end - (q+1)*w);
+            Swap(s,end - 3*w,end - (q+2)*w);
+        }
+    }
+}
 
-    loguy = lo;
-    higuy = hi + width;
+/*------------------------------------------------------------------------
+ Procedure:     SortLoop ID:1
+ Purpose:       Sorts [begin,end). The smaller side of each partition
+                is sorted by a recursive call and the larger one in the
+                loop, so that the depth stays below log2(n).
+ Input:         The part, the number of unbalanced partitions allowed
+                before heapsort takes over, and whether the part starts
+                the array (otherwise the element before it is not
+                greater than any element of the part).
+ Output:        None
+ Errors:        None
+------------------------------------------------------------------------*/
+static void SortLoop(const struct SortArgs *s,char *begin,char *end,int bad_allowed,int leftmost)
+{
+    size_t w = s->w,size,half,l_size,r_size;
+    char *pivot_pos;
+    int already;
 
     for (;;) {
-      /* Changed <= to < and >= to > according to the advise of "pete" of comp.lang.c. */
-      do { loguy += width; } while (loguy <= hi && comp(loguy, lo,ExtraArgs) < 0);
-      do { higuy -= width; } while (higuy > lo && comp(higuy, lo,ExtraArgs) > 0);
-      if (higuy < loguy) break;
-      swap(loguy, higuy, width);
+        size = (size_t)(end - begin)/w;
+        if (size < INSERTION_SORT_THRESHOLD) {
+            if (leftmost)
+                InsertionSort(s,begin,end);
+            else UnguardedInsertionSort(s,begin,end);
+            return;
+        }
+        half = size/2;
+        if (size > NINTHER_THRESHOLD) {
+            Sort3(s,begin,begin + half*w,end - w);
+            Sort3(s,begin + w,begin + (half-1)*w,end - 2*w);
+            Sort3(s,begin + 2*w,begin + (half+1)*w,end - 3*w);
+            Sort3(s,begin + (half-1)*w,begin + half*w,begin + (half+1)*w);
+            Swap(s,begin,begin + half*w);
+        }
+        else Sort3(s,begin + half*w,begin,end - w);
+        /* The element before the part was the pivot of an earlier
+           partition: if it equals this pivot all the elements equal to
+           it are put on the left, and they are in their place */
+        if (!leftmost && !LESS(s,begin - w,begin)) {
+            begin = PartitionLeft(s,begin,end) + w;
+            continue;
+        }
+        pivot_pos = PartitionRight(s,begin,end,&already);
+        l_size = (size_t)(pivot_pos - begin)/w;
+        r_size = size - l_size - 1;
+        if (l_size < size/8 || r_size < size/8) {
+            if (--bad_allowed == 0) {
+                HeapSort(s,begin,end);
+                return;
+            }
+            BreakPatterns(s,begin,pivot_pos,end);
+        }
+        else if (already && PartialInsertionSort(s,begin,pivot_pos) &&
+                 PartialInsertionSort(s,pivot_pos + w,end))
+            return;
+        if (l_size < r_size) {
+            SortLoop(s,begin,pivot_pos,bad_allowed,leftmost);
+            begin = pivot_pos + w;
+            leftmost = 0;
+        }
+        else {
+            SortLoop(s,pivot_pos + w,end,bad_allowed,0);
+            end = pivot_pos;
+        }
+    }
+}
+
+void qsortEx(void *base, size_t num, size_t width, CompareFunction comp, CompareInfo *ExtraArgs)
+{
+    struct SortArgs s;
+    char *lo = base,*hi;
+    size_t i;
+    int log2n = 0;
+
+    if (num < 2 || width == 0) return;
+    s.w = width;
+    s.cmp = comp;
+    s.ci = ExtraArgs;
+    s.SwapType = GetSwapType(base,width);
+    /* A sorted or reversed input is recognized in one pass */
+    for (i = 1; i < num && !LESS(&s,lo + i*width,lo + (i-1)*width); i++)
+        ;
+    if (i == num)
+        return;
+    if (i == 1) {
+        for (i = 1; i < num && !LESS(&s,lo + (i-1)*width,lo + i*width); i++)
+            ;
+        if (i == num) {
+            for (hi = lo + (num-1)*width; lo < hi; lo += width, hi -= width)
+                Swap(&s,lo,hi);
+            return;
+        }
+    }
+    for (i = num; i > 1; i >>= 1)
+        log2n++;
+    SortLoop(&s,(char *)base,(char *)base + num*width,log2n,1);
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                              Parallel sort                                     */
+/* ------------------------------------------------------------------------------ */
+struct SortJob {
+    struct SortArgs s;
+    char *base;
+    size_t n;
+    unsigned nThreads;
+    unsigned nRuns;
+    size_t Run[PARALLEL_MAX_THREADS+1];   /* Bounds of the sorted runs */
+    char *src,*dst;                       /* The merges read src and write dst */
+    unsigned Parts;                       /* Threads per merge */
+};
+
+static void CopyElement(const struct SortArgs *s,char *dst,const char *src)
+{
+    if (s->SwapType == SWAP_LONG)
+        *(uint64_t *)dst = *(const uint64_t *)src;
+    else if (s->SwapType == SWAP_INT)
+        *(uint32_t *)dst = *(const uint32_t *)src;
+    else memcpy(dst,src,s->w);
+}
+
+static void SortRun(void *arg,unsigned i)
+{
+    struct SortJob *job = arg;
+    size_t w = job->s.w;
+
+    qsortEx(job->base + job->Run[i]*w,job->Run[i+1] - job->Run[i],w,job->s.cmp,job->s.ci);
+}
+
+/* The number of elements of A among the first k of the merge of A (m
+   elements) and B (n elements). On equal keys those of A come first. */
+static size_t CoRank(const struct SortArgs *s,size_t k,const char *A,size_t m,const char *B,size_t n)
+{
+    size_t w = s->w,lo = k > n ? k - n : 0,hi = k < m ? k : m,i,j;
+
+    while (lo < hi) {
+        i = lo + (hi - lo)/2;
+        j = k - i;
+        if (j > 0 && i < m && !LESS(s,B + (j-1)*w,A + i*w))
+            lo = i + 1;
+        else hi = i;
+    }
+    return lo;
+}
+
+/* Part i%Parts of the merge of the runs 2*(i/Parts) and 2*(i/Parts)+1.
+   The last run is copied when it has no pair. */
+static void MergePart(void *arg,unsigned i)
+{
+    struct SortJob *job = arg;
+    const struct SortArgs *s = &job->s;
+    size_t w = s->w,pair = i/job->Parts,part = i%job->Parts;
+    size_t start = job->Run[2*pair],mid,end,len,k0,k1,a,ae,b,be;
+    char *A,*B,*out;
+
+    mid = job->Run[2*pair+1];
+    end = 2*pair+2 <= job->nRuns ? job->Run[2*pair+2] : mid;
+    len = end - start;
+    k0 = len*part/job->Parts;
+    k1 = len*(part+1)/job->Parts;
+    A = job->src + start*w;
+    B = job->src + mid*w;
+    a = CoRank(s,k0,A,mid - start,B,end - mid);
+    ae = CoRank(s,k1,A,mid - start,B,end - mid);
+    b = k0 - a;
+    be = k1 - ae;
+    out = job->dst + (start + k0)*w;
+    while (a < ae && b < be) {
+        if (LESS(s,B + b*w,A + a*w)) {
+            CopyElement(s,out,B + b*w);
+            b++;
+        }
+        else {
+            CopyElement(s,out,A + a*w);
+            a++;
+        }
+        out += w;
+    }
+    memcpy(out,A + a*w,(ae - a)*w);
+    out += (ae - a)*w;
+    memcpy(out,B + b*w,(be - b)*w);
+}
+
+static void CopyBack(void *arg,unsigned i)
+{
+    struct SortJob *job = arg;
+    size_t w = job->s.w,first = job->n*i/job->nThreads,last = job->n*(i+1)/job->nThreads;
+
+    memcpy(job->base + first*w,job->src + first*w,(last - first)*w);
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     ParallelSort ID:1
+ Purpose:       Sorts an array in several threads. The array is cut in
+                one run per thread, sorted by qsortEx. The runs are
+                then merged by pairs into a buffer and back, until one
+                run is left; each merge is cut into parts of the same
+                length by a binary search of the place where a part
+                starts in each run, so that all threads work in every
+                round.
+ Input:         As qsortEx, and the allocator of the buffer
+ Output:        None
+ Errors:        None. Without memory for the buffer the array is sorted
+                in the caller's thread.
+------------------------------------------------------------------------*/
+void ParallelSort(void *base,size_t num,size_t width,CompareFunction cmp,CompareInfo *ci,const ContainerAllocator *mm)
+{
+    struct SortJob job;
+    char *buf = NULL,*tmp;
+    unsigned i,pairs;
+
+    job.nThreads = ParallelThreads();
+    if (num/PARALLEL_SORT_MIN < job.nThreads)
+        job.nThreads = (unsigned)(num/PARALLEL_SORT_MIN);
+    if (job.nThreads > 1 && width)
+        buf = (mm ? mm : CurrentAllocator)->malloc(num*width);
+    if (buf == NULL) {
+        qsortEx(base,num,width,cmp,ci);
+        return;
+    }
+    job.s.w = width;
+    job.s.cmp = cmp;
+    job.s.ci = ci;
+    /* The buffer is aligned for any type */
+    job.s.SwapType = GetSwapType(base,width);
+    job.base = base;
+    job.n = num;
+    job.nRuns = job.nThreads;
+    for (i = 0; i <= job.nRuns; i++)
+        job.Run[i] = num*i/job.nRuns;
+    ParallelRun(job.nThreads,SortRun,&job);
+    job.src = base;
+    job.dst = buf;
+    while (job.nRuns > 1) {
+        pairs = (job.nRuns + 1)/2;
+        job.Parts = (job.nThreads + pairs - 1)/pairs;
+        ParallelRun(pairs*job.Parts,MergePart,&job);
+        for (i = 0; i < pairs; i++)
+            job.Run[i] = job.Run[2*i];
+        job.Run[pairs] = num;
+        job.nRuns = pairs;
+        tmp = job.src;
+        job.src = job.dst;
+        job.dst = tmp;
+    }
+    if (job.src != (char *)base)
+        ParallelRun(job.nThreads,CopyBack,&job);
+    (mm ? mm : CurrentAllocator)->free(buf);
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                               Radix sort                                       */
+/* ------------------------------------------------------------------------------ */
+#define RADIX_BITS  8
+#define RADIX       (1 << RADIX_BITS)
+
+/* The key of a record as an unsigned number in the same order: the sign
+   bit of the signed integers is flipped, and a negative float has all
+   its bits flipped, a positive one only its sign bit */
+static uint64_t RadixKey(const char *rec,size_t KeyWidth,int KeyType)
+{
+    uint64_t k,sign = (uint64_t)1 << (8*KeyWidth - 1);
+    uint32_t k32;
+    uint16_t k16;
+
+    switch (KeyWidth) {
+    case 1: k = *(const unsigned char *)rec; break;
+    case 2: memcpy(&k16,rec,2); k = k16; break;
+    case 4: memcpy(&k32,rec,4); k = k32; break;
+    default: memcpy(&k,rec,8); break;
+    }
+    if (KeyType == CCL_KEY_SIGNED)
+        k ^= sign;
+    else if (KeyType == CCL_KEY_FLOAT) {
+        if (k & sign)
+            k = ~k & (sign | (sign - 1));
+        else k |= sign;
+    }
+    return k;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     RadixSort ID:1
+ Purpose:       Sorts the records by their key, one byte of the key per
+                pass starting with the lowest: each pass counts the
+                records by the value of the byte and moves them into a
+                buffer in that order, keeping the order of the previous
+                pass. The counts of all passes are made in one reading
+                of the records, and a pass where all records have the
+                same byte is skipped.
+ Input:         The records, their number and width, the offset, width
+                and type of the key, and the allocator of the buffer
+ Output:        1 if sorted, 0 if the buffer can't be allocated
+ Errors:        None
+------------------------------------------------------------------------*/
+static int RadixSort(void *base,size_t num,size_t width,size_t offset,size_t KeyWidth,int KeyType,const ContainerAllocator *mm)
+{
+    size_t (*count)[RADIX],i,pos,sum,c;
+    struct SortArgs s;
+    char *src = base,*dst,*buf,*tmp;
+    unsigned pass,shift;
+    uint64_t k;
+
+    buf = mm->malloc(num*width);
+    count = mm->malloc(KeyWidth*sizeof(*count));
+    if (buf == NULL || count == NULL) {
+        if (buf) mm->free(buf);
+        if (count) mm->free(count);
+        return 0;
+    }
+    memset(count,0,KeyWidth*sizeof(*count));
+    for (i = 0; i < num; i++) {
+        k = RadixKey(src + i*width + offset,KeyWidth,KeyType);
+        for (pass = 0; pass < KeyWidth; pass++, k >>= RADIX_BITS)
+            count[pass][k & (RADIX-1)]++;
+    }
+    s.w = width;
+    s.SwapType = GetSwapType(base,width);
+    dst = buf;
+    for (pass = 0; pass < KeyWidth; pass++) {
+        shift = pass*RADIX_BITS;
+        k = RadixKey(src + offset,KeyWidth,KeyType);
+        if (count[pass][(k >> shift) & (RADIX-1)] == num)
+            continue;
+        /* The counts become the first position of each value */
+        for (sum = 0, c = 0; c < RADIX; c++) {
+            pos = count[pass][c];
+            count[pass][c] = sum;
+            sum += pos;
+        }
+        for (i = 0; i < num; i++) {
+            k = RadixKey(src + i*width + offset,KeyWidth,KeyType);
+            pos = count[pass][(k >> shift) & (RADIX-1)]++;
+            CopyElement(&s,dst + pos*width,src + i*width);
+        }
+        tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+    if (src != (char *)base)
+        memcpy(base,src,num*width);
+    mm->free(count);
+    mm->free(buf);
+    return 1;
+}
+
+struct KeyArgs {
+    size_t offset,KeyWidth;
+    int KeyType;
+};
+
+static int CompareKeys(const void *a,const void *b,CompareInfo *ci)
+{
+    const struct KeyArgs *k = ci->ExtraArgs;
+    uint64_t ka = RadixKey((const char *)a + k->offset,k->KeyWidth,k->KeyType);
+    uint64_t kb = RadixKey((const char *)b + k->offset,k->KeyWidth,k->KeyType);
+
+    return (ka > kb) - (ka < kb);
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     KeySort ID:1
+ Purpose:       Sorts records by an integer or floating point key. A
+                radix sort reads each record once per byte of the key
+                and calls no function, but it has to count the records
+                and to fill a buffer: below RADIX_SORT_MIN records
+                qsortEx is faster.
+ Input:         The records, their number and width, the offset, width
+                and type (CCL_KEY_xxx) of the key, and the allocator of
+                the buffer (NULL for the current allocator)
+ Output:        1, or a negative error code
+ Errors:        BADARG if the key doesn't fit the records or has a
+                width that isn't 1, 2, 4 or 8 (4 or 8 for a float)
+------------------------------------------------------------------------*/
+int KeySort(void *base,size_t num,size_t width,size_t offset,size_t KeyWidth,int KeyType,const ContainerAllocator *mm)
+{
+    struct KeyArgs k;
+    CompareInfo ci;
+
+    if (KeyWidth != 1 && KeyWidth != 2 && KeyWidth != 4 && KeyWidth != 8)
+        return CONTAINER_ERROR_BADARG;
+    if (KeyType < CCL_KEY_UNSIGNED || KeyType > CCL_KEY_FLOAT ||
+        (KeyType == CCL_KEY_FLOAT && KeyWidth < 4) ||
+        offset > width || KeyWidth > width - offset)
+        return CONTAINER_ERROR_BADARG;
+    if (num < 2)
+        return 1;
+    if (num >= RADIX_SORT_MIN &&
+        RadixSort(base,num,width,offset,KeyWidth,KeyType,mm ? mm : CurrentAllocator))
+        return 1;
+    k.offset = offset;
+    k.KeyWidth = KeyWidth;
+    k.KeyType = KeyType;
+    ci.ContainerLeft = ci.ContainerRight = NULL;
+    ci.ExtraArgs = &k;
+    qsortEx(base,num,width,CompareKeys,&ci);
+    return 1;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                                Stable sort                                     */
+/* ------------------------------------------------------------------------------ */
+/* An adaptive natural merge sort in the manner of TimSort. The input is
+   cut into the runs it already has (a strictly descending run is
+   reversed), runs shorter than MinRun are extended by insertion, and the
+   runs are merged as they are found, keeping on a stack lengths that
+   grow at least like the Fibonacci numbers. A sorted input is a single
+   run: n-1 comparisons and no moves. */
+#define MIN_MERGE 64  /* Shorter inputs are sorted by insertion */
+#define MAX_RUNS  96  /* Enough for 2^64 elements */
+
+/* Between MIN_MERGE/2 and MIN_MERGE, so that n/MinRun is a power of
+   two or a bit less: the merges are then balanced. */
+static size_t MinRun(size_t n)
+{
+    size_t r = 0;
+
+    while (n >= MIN_MERGE) {
+        r |= n & 1;
+        n >>= 1;
     }
+    return n + r;
+}
+
+/* Returns 1 and the first of the two runs to merge if the lengths at
+   the top of the stack break the invariants, 0 if they don't */
+static int RunToMerge(const size_t *Len,unsigned n,unsigned *pi)
+{
+    unsigned i;
+
+    if (n < 2)
+        return 0;
+    i = n - 2;
+    if ((i > 0 && Len[i-1] <= Len[i] + Len[i+1]) ||
+        (i > 1 && Len[i-2] <= Len[i-1] + Len[i])) {
+        if (Len[i-1] < Len[i+1])
+            i--;
+    }
+    else if (Len[i] > Len[i+1])
+        return 0;
+    *pi = i;
+    return 1;
+}
+
+/* The pair of runs merged when the input is exhausted */
+static unsigned LastRunToMerge(const size_t *Len,unsigned n)
+{
+    unsigned i = n - 2;
+
+    if (i > 0 && Len[i-1] < Len[i+1])
+        i--;
+    return i;
+}
 
-    swap(lo, higuy, width);
+struct MergeState {
+    struct SortArgs s;
+    char *base;
+    char *buf;                /* Room for half of the elements */
+    unsigned n;               /* Runs on the stack */
+    size_t Start[MAX_RUNS];
+    size_t Len[MAX_RUNS];
+};
+
+/* Sorts num elements of which the first start are sorted */
+static void BinaryInsertionSort(const struct SortArgs *s,char *base,size_t num,size_t start,char *tmp)
+{
+    size_t lo,hi,mid,w = s->w;
+    char *p;
+
+    for (; start < num; start++) {
+        p = base + start*w;
+        lo = 0;
+        hi = start;
+        while (lo < hi) {
+            mid = lo + (hi - lo)/2;
+            if (LESS(s,p,base + mid*w))
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        if (lo < start) {
+            CopyElement(s,tmp,p);
+            memmove(base + (lo+1)*w,base + lo*w,(start - lo)*w);
+            CopyElement(s,base + lo*w,tmp);
+        }
+    }
+}
+
+/* Length of the run at base, reversed if it is strictly descending */
+static size_t CountRun(const struct SortArgs *s,char *base,size_t num)
+{
+    size_t n = 2,w = s->w;
+    char *lo,*hi;
+
+    if (num < 2)
+        return num;
+    if (LESS(s,base + w,base)) {
+        while (n < num && LESS(s,base + n*w,base + (n-1)*w))
+            n++;
+        for (lo = base, hi = base + (n-1)*w; lo < hi; lo += w, hi -= w)
+            Swap(s,lo,hi);
+    }
+    else while (n < num && !LESS(s,base + n*w,base + (n-1)*w))
+        n++;
+    return n;
+}
 
-    if (higuy - 1 - lo >= hi - loguy) 
-    {
-      if (lo + width < higuy) 
-      {
-        lostk[stkptr] = lo;
-        histk[stkptr] = higuy - width;
-        ++stkptr;
-      }
+/* Index of the first of the n sorted elements greater than key */
+static size_t UpperBound(const struct SortArgs *s,const char *key,const char *base,size_t n)
+{
+    size_t lo = 0,mid;
 
-      if (loguy < hi) 
-      {
-        lo = loguy;
-        goto recurse;
-      }
+    while (lo < n) {
+        mid = lo + (n - lo)/2;
+        if (LESS(s,key,base + mid*s->w))
+            n = mid;
+        else
+            lo = mid + 1;
     }
-    else
-    {
-      if (loguy < hi) 
-      {
-        lostk[stkptr] = loguy;
-        histk[stkptr] = hi;
-        ++stkptr;
-      }
+    return lo;
+}
 
-      if (lo + width < higuy) 
-      {
-        hi = higuy - width;
-        goto recurse;
-      }
+/* Index of the first of the n sorted elements not less than key */
+static size_t LowerBound(const struct SortArgs *s,const char *key,const char *base,size_t n)
+{
+    size_t lo = 0,mid;
+
+    while (lo < n) {
+        mid = lo + (n - lo)/2;
+        if (LESS(s,base + mid*s->w,key))
+            lo = mid + 1;
+        else
+            n = mid;
     }
-  }
+    return lo;
+}
 
-  --stkptr;
-  if (stkptr >= 0) 
-  {
-    lo = lostk[stkptr];
-    hi = histk[stkptr];
-    goto recurse;
-  }
-  else
-    return;
+/* Merges the runs i and i+1. The shorter of the two is copied to the
+   buffer; on equal elements the one of the first run goes first. */
+static void MergeAt(struct MergeState *m,unsigned i)
+{
+    const struct SortArgs *s = &m->s;
+    size_t w = s->w,na = m->Len[i],nb = m->Len[i+1],j,k;
+    char *a = m->base + m->Start[i]*w,*b = a + na*w,*out;
+
+    m->Len[i] = na + nb;
+    if (i + 3 == m->n) {
+        m->Start[i+1] = m->Start[i+2];
+        m->Len[i+1] = m->Len[i+2];
+    }
+    m->n--;
+    /* The elements of a not greater than the first of b, and those of b
+       not less than the last of a, are already in place */
+    k = UpperBound(s,b,a,na);
+    a += k*w;
+    na -= k;
+    if (na == 0)
+        return;
+    nb = LowerBound(s,b - w,b,nb);
+    if (nb == 0)
+        return;
+    if (na <= nb) {
+        memcpy(m->buf,a,na*w);
+        out = a;
+        for (j = 0, k = 0; j < na && k < nb; out += w) {
+            if (LESS(s,b + k*w,m->buf + j*w))
+                CopyElement(s,out,b + k++*w);
+            else
+                CopyElement(s,out,m->buf + j++*w);
+        }
+        memcpy(out,m->buf + j*w,(na - j)*w);
+    }
+    else {
+        memcpy(m->buf,b,nb*w);
+        out = b + nb*w;
+        while (na && nb) {
+            out -= w;
+            if (LESS(s,m->buf + (nb-1)*w,a + (na-1)*w))
+                CopyElement(s,out,a + --na*w);
+            else
+                CopyElement(s,out,m->buf + --nb*w);
+        }
+        memcpy(a + na*w,m->buf,nb*w);
+    }
 }
 
-static void shortsort(char *lo, char *hi, size_t width, CompareFunction comp,CompareInfo *ExtraArgs)
+/*------------------------------------------------------------------------
+ Procedure:     MergeSort ID:1
+ Purpose:       Sorts an array keeping the order of equal elements. It
+                is linear on sorted, reversed or nearly sorted input.
+ Input:         The array, the number and width of its elements, the
+                comparison function and its argument, the allocator of
+                a buffer of half the array (NULL for the current one)
+ Output:        1, or a negative error code
+ Errors:        NOMEMORY if the buffer can't be allocated
+------------------------------------------------------------------------*/
+int MergeSort(void *base,size_t num,size_t width,CompareFunction cmp,CompareInfo *ci,const ContainerAllocator *mm)
 {
-  char *p, *max;
+    struct MergeState m;
+    size_t lo = 0,run,MinRunLen,n;
+    unsigned i;
 
-  while (hi > lo) 
-  {
-    max = lo;
-    for (p = lo+width; p <= hi; p += width) if (comp(p, max,ExtraArgs) > 0) max = p;
-    swap(max, hi, width);
-    hi -= width;
-  }
+    if (num < 2 || width == 0)
+        return 1;
+    if (mm == NULL)
+        mm = CurrentAllocator;
+    m.buf = mm->malloc((num/2 + 1)*width);
+    if (m.buf == NULL)
+        return CONTAINER_ERROR_NOMEMORY;
+    m.s.w = width;
+    m.s.cmp = cmp;
+    m.s.ci = ci;
+    m.s.SwapType = GetSwapType(base,width);
+    m.base = base;
+    m.n = 0;
+    MinRunLen = MinRun(num);
+    while (lo < num) {
+        run = CountRun(&m.s,m.base + lo*width,num - lo);
+        if (run < MinRunLen) {
+            n = num - lo < MinRunLen ? num - lo : MinRunLen;
+            BinaryInsertionSort(&m.s,m.base + lo*width,n,run,m.buf);
+            run = n;
+        }
+        m.Start[m.n] = lo;
+        m.Len[m.n++] = run;
+        lo += run;
+        while (RunToMerge(m.Len,m.n,&i))
+            MergeAt(&m,i);
+    }
+    while (m.n > 1)
+        MergeAt(&m,LastRunToMerge(m.Len,m.n));
+    mm->free(m.buf);
+    return 1;
 }
 
-static void swap(char *a, char *b, size_t width)
+/* The lists and double linked lists are sorted by relinking their
+   nodes, whose first field is the pointer to the next one. */
+typedef struct LinkedNode {
+    struct LinkedNode *Next;
+} LinkedNode;
+
+struct LinkedSort {
+    CompareFunction cmp;
+    CompareInfo *ci;
+    size_t DataOffset;
+    unsigned n;
+    LinkedNode *First[MAX_RUNS];
+    LinkedNode *Last[MAX_RUNS];
+    size_t Len[MAX_RUNS];
+};
+
+#define NODE_LESS(ls,a,b) ((ls)->cmp((char *)(a) + (ls)->DataOffset,(char *)(b) + (ls)->DataOffset,(ls)->ci) < 0)
+
+static void MergeLinked(struct LinkedSort *ls,unsigned i)
 {
-  char tmp;
+    LinkedNode *a = ls->First[i],*b = ls->First[i+1],head,*t = &head;
 
-  if (a != b)
-  {
-    while (width--) 
-    {
-      tmp = *a;
-      *a++ = *b;
-      *b++ = tmp;
+    if (!NODE_LESS(ls,b,ls->Last[i])) {
+        ls->Last[i]->Next = b;
+        ls->Last[i] = ls->Last[i+1];
+    }
+    else {
+        while (a && b) {
+            if (NODE_LESS(ls,b,a)) {
+                t->Next = b;
+                b = b->Next;
+            }
+            else {
+                t->Next = a;
+                a = a->Next;
+            }
+            t = t->Next;
+        }
+        if (a)
+            t->Next = a;
+        else {
+            t->Next = b;
+            ls->Last[i] = ls->Last[i+1];
+        }
+        ls->First[i] = head.Next;
     }
-  }
+    ls->Len[i] += ls->Len[i+1];
+    if (i + 3 == ls->n) {
+        ls->First[i+1] = ls->First[i+2];
+        ls->Last[i+1] = ls->Last[i+2];
+        ls->Len[i+1] = ls->Len[i+2];
+    }
+    ls->n--;
 }
 
+/*------------------------------------------------------------------------
+ Procedure:     MergeSortLinked ID:1
+ Purpose:       Sorts a linked list like MergeSort sorts an array,
+                relinking its nodes without any allocation.
+ Input:         The first of the count nodes, the offset of their data,
+                the comparison function and its argument, and where to
+                store the last node
+ Output:        The first node. The Next field of the last one is NULL.
+ Errors:        None
+------------------------------------------------------------------------*/
+void *MergeSortLinked(void *First,size_t count,size_t DataOffset,CompareFunction cmp,CompareInfo *ci,void **pLast)
+{
+    struct LinkedSort ls;
+    LinkedNode *p = First,*q,*r,*first,*last;
+    size_t len,MinRunLen = MinRun(count);
+    unsigned i;
 
+    ls.cmp = cmp;
+    ls.ci = ci;
+    ls.DataOffset = DataOffset;
+    ls.n = 0;
+    while (p) {
+        first = last = p;
+        p = p->Next;
+        len = 1;
+        if (p && NODE_LESS(&ls,p,first)) {
+            do {
+                q = p->Next;
+                p->Next = first;
+                first = p;
+                p = q;
+                len++;
+            } while (p && NODE_LESS(&ls,p,first));
+        }
+        else while (p && !NODE_LESS(&ls,p,last)) {
+            last = p;
+            p = p->Next;
+            len++;
+        }
+        last->Next = NULL;
+        /* A short run is extended by inserting the following nodes after
+           the last one not greater */
+        for (; p && len < MinRunLen; len++) {
+            q = p;
+            p = p->Next;
+            if (NODE_LESS(&ls,q,first)) {
+                q->Next = first;
+                first = q;
+            }
+            else if (!NODE_LESS(&ls,q,last)) {
+                last->Next = q;
+                q->Next = NULL;
+                last = q;
+            }
+            else {
+                for (r = first; !NODE_LESS(&ls,q,r->Next); r = r->Next)
+                    ;
+                q->Next = r->Next;
+                r->Next = q;
+            }
+        }
+        ls.First[ls.n] = first;
+        ls.Last[ls.n] = last;
+        ls.Len[ls.n++] = len;
+        while (RunToMerge(ls.Len,ls.n,&i))
+            MergeLinked(&ls,i);
+    }
+    if (ls.n == 0) {
+        *pLast = NULL;
+        return NULL;
+    }
+    while (ls.n > 1)
+        MergeLinked(&ls,LastRunToMerge(ls.Len,ls.n));
+    *pLast = ls.Last[0];
+    return ls.First[0];
+}
@@ -0,0 +1,1680 @@
+/*------------------------------------------------------------------------
+ Module:        rcuhashtable.c
+ Author:        jacob
+ Project:       Containers
+ State:
+ Creation Date:
+ Description:   This file implements the HashTable interface for
+                tables read by many threads and changed a few times
+                per second. Readers take no lock and write no shared
+                memory: GetElement, Contains, GetElements,
+                ContainsMany, Search, Apply, Save, Copy and the
+                iterators can run in any number of threads at the same
+                time as one writer, and their throughput grows with the
+                number of cores.
+                Writers (Add, Replace, Erase, Clear, Resize and the
+                other functions that change the table) take a lock and
+                never modify memory a reader can reach: a new entry is
+                filled and then linked with a single pointer store, an
+                erased entry is unlinked, a replaced value is a new
+                entry linked in place of the old one, and growing,
+                shrinking or rehashing builds a new bucket array with
+                new entries and publishes it with one store.
+                The memory taken out of the table is freed when no
+                reader can still hold a pointer to it, with an epoch
+                scheme: each thread has a record where it writes the
+                global epoch when it starts reading and zero when it
+                is done. Retired memory is stamped with a new epoch and
+                freed once every record is zero or not older than the
+                stamp. Readers announce themselves with a store and a
+                memory fence, never with a locked instruction.
+                Unlike iHashTable the keys are copied into the entries,
+                so a reader may still compare a key its owner has just
+                erased. GetElement returns a pointer into the table
+                that stays valid only while no other thread erases or
+                replaces that key; CopyElement and CopyElements copy
+                the values inside the read section, and values are
+                also read safely in the callbacks of Search and Apply
+                and during an iteration.
+                An iteration is a read section from GetFirst until
+                GetNext returns NULL or the iterator is deleted: it must
+                stay in one thread, and while it lasts the memory
+                retired by the writers isn't freed.
+                Finalize, SetFlags, SetErrorFunction and SetDestructor
+                must not run concurrently with other calls.
+------------------------------------------------------------------------*/
+#include <stddef.h>
+#include "containers.h"
+#include "ccl_internal.h"
+#ifdef UNIX
+#include <pthread.h>
+typedef pthread_mutex_t Mutex;
+#define MUTEX_INIT(m)    pthread_mutex_init(m,NULL)
+#define MUTEX_DESTROY(m) pthread_mutex_destroy(m)
+#define LOCK(m)          pthread_mutex_lock(m)
+#define UNLOCK(m)        pthread_mutex_unlock(m)
+#define FULL_FENCE()     __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define LOAD_PTR(p)      __atomic_load_n(p,__ATOMIC_ACQUIRE)
+#define STORE_PTR(p,v)   __atomic_store_n(p,v,__ATOMIC_RELEASE)
+#define LOAD_EPOCH(p)    __atomic_load_n(p,__ATOMIC_ACQUIRE)
+#define STORE_EPOCH(p,v) __atomic_store_n(p,v,__ATOMIC_RELEASE)
+#define NEXT_EPOCH(p)    __atomic_add_fetch(p,1,__ATOMIC_SEQ_CST)
+#else
+#include <windows.h>
+typedef CRITICAL_SECTION Mutex;
+#define MUTEX_INIT(m)    InitializeCriticalSection(m)
+#define MUTEX_DESTROY(m) DeleteCriticalSection(m)
+#define LOCK(m)          EnterCriticalSection(m)
+#define UNLOCK(m)        LeaveCriticalSection(m)
+#define FULL_FENCE()     MemoryBarrier()
+/* Volatile accesses are acquire loads and release stores on x86 */
+#define LOAD_PTR(p)      (*(void * volatile *)(p))
+#define STORE_PTR(p,v)   (*(void * volatile *)(p) = (v))
+#ifdef _WIN64
+#define LOAD_EPOCH(p)    (*(volatile uint64_t *)(p))
+#define STORE_EPOCH(p,v) (*(volatile uint64_t *)(p) = (v))
+#else
+#define LOAD_EPOCH(p)    ((uint64_t)InterlockedCompareExchange64((volatile LONGLONG *)(p),0,0))
+#define STORE_EPOCH(p,v) InterlockedExchange64((volatile LONGLONG *)(p),(LONGLONG)(v))
+#endif
+#define NEXT_EPOCH(p)    ((uint64_t)InterlockedIncrement64((volatile LONGLONG *)(p)))
+#endif
+
+typedef struct RCUHashTable RCUHashTable;
+
+#define INITIAL_MAX     15         /* 2^n - 1 */
+#define SHRINK_RATIO    8          /* Erase shrinks below 1/8 of the buckets */
+#define RECLAIM_BATCH   64         /* Retired blocks kept before trying to free them */
+#define MAX_RETIRED     2          /* Blocks retired by one change: an entry and an array */
+#define ENTRY_SIZE(ht,klen) (sizeof(HashEntry) + (ht)->ElementSize + (klen))
+#define ENTRY_KEY(ht,e) ((e)->val + (ht)->ElementSize)
+
+static const guid RCUHashTableGuid = {0x5c0e7d13, 0x9b2f, 0x4e61,
+{0x8a,0x47,0x3d,0xf2,0x19,0xc6,0x05,0xbe}
+};
+
+/* ------------------------------------------------------------------------------ */
+/*                                 Readers                                        */
+/* ------------------------------------------------------------------------------ */
+/* One record per thread that reads, kept in a list that only grows. The
+   records of the threads that ended are reused. Each one fills at least
+   two cache lines, so no two readers write to the same line. */
+struct RCUReader {
+    uint64_t Epoch;                /* Zero outside read sections */
+    size_t Nesting;                /* Read sections opened by the thread */
+    int InUse;
+    struct RCUReader *Next;
+    char Padding[128 - sizeof(uint64_t) - sizeof(size_t) - sizeof(int) - sizeof(void *)];
+};
+
+static struct RCUReader *Readers;
+static uint64_t GlobalEpoch = 1;
+
+#ifdef UNIX
+static pthread_key_t ReaderKey;
+static pthread_once_t ReaderKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t RegistryLock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_REGISTRY()   pthread_mutex_lock(&RegistryLock)
+#define UNLOCK_REGISTRY() pthread_mutex_unlock(&RegistryLock)
+#define GET_READER()      ((struct RCUReader *)pthread_getspecific(ReaderKey))
+#define SET_READER(r)     pthread_setspecific(ReaderKey,r)
+
+/* Called when a thread ends: its record can be taken by another thread */
+static void ReleaseReader(void *p)
+{
+    struct RCUReader *r = p;
+
+    LOCK_REGISTRY();
+    r->Nesting = 0;
+    STORE_EPOCH(&r->Epoch,0);
+    r->InUse = 0;
+    UNLOCK_REGISTRY();
+}
+
+static void MakeReaderKey(void)
+{
+    pthread_key_create(&ReaderKey,ReleaseReader);
+}
+#define INIT_READERS()    pthread_once(&ReaderKeyOnce,MakeReaderKey)
+#else
+/* The records of the threads that end are not reused */
+static __declspec(thread) struct RCUReader *ThreadReader;
+static volatile LONG RegistryLock;
+#define LOCK_REGISTRY()   while (InterlockedCompareExchange(&RegistryLock,1,0)) Sleep(0)
+#define UNLOCK_REGISTRY() InterlockedExchange(&RegistryLock,0)
+#define GET_READER()      ThreadReader
+#define SET_READER(r)     (ThreadReader = (r))
+#define INIT_READERS()    ((void)0)
+#endif
+
+/* The records live as long as the process, and don't depend on the
+   allocator of any table */
+static struct RCUReader *NewReader(void)
+{
+    struct RCUReader *r;
+
+    LOCK_REGISTRY();
+    for (r = Readers; r; r = r->Next) {
+        if (!r->InUse)
+            break;
+    }
+    if (r == NULL) {
+        r = malloc(sizeof(*r));
+        if (r) {
+            memset(r,0,sizeof(*r));
+            r->Next = Readers;
+            STORE_PTR(&Readers,r);
+        }
+    }
+    if (r)
+        r->InUse = 1;
+    UNLOCK_REGISTRY();
+    if (r)
+        SET_READER(r);
+    return r;
+}
+
+/* Starts a read section: the epoch is published before any pointer of
+   the table is read. Sections can be nested. */
+static struct RCUReader *ReadLock(void)
+{
+    struct RCUReader *r = GET_READER();
+
+    if (r == NULL && (r = NewReader()) == NULL)
+        return NULL;
+    if (r->Nesting++ == 0) {
+        STORE_EPOCH(&r->Epoch,LOAD_EPOCH(&GlobalEpoch));
+        FULL_FENCE();
+    }
+    return r;
+}
+
+static void ReadUnlock(struct RCUReader *r)
+{
+    if (--r->Nesting == 0)
+        STORE_EPOCH(&r->Epoch,0);
+}
+
+/* The oldest epoch of the threads inside a read section */
+static uint64_t OldestReader(void)
+{
+    struct RCUReader *r;
+    uint64_t e,min = (uint64_t)-1;
+
+    for (r = LOAD_PTR(&Readers); r; r = r->Next) {
+        e = LOAD_EPOCH(&r->Epoch);
+        if (e && e < min)
+            min = e;
+    }
+    return min;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                            Writers and retired memory                          */
+/* ------------------------------------------------------------------------------ */
+enum RetiredKind {
+    RETIRED_ENTRY,                 /* Erased: the destructor is called */
+    RETIRED_COPY,                  /* Replaced by a copy */
+    RETIRED_BUCKETS,               /* Array and entries copied to a new array */
+    RETIRED_CLEARED                /* Array and entries, with the destructor */
+};
+
+struct RCURetired {
+    void *p;
+    uint64_t Epoch;
+    enum RetiredKind Kind;
+};
+
+struct RCUWriter {
+    Mutex Lock;
+    struct RCURetired *Retired;
+    size_t nRetired,capacity;
+};
+
+static int doerrorCall(ErrorFunction err,const char *fnName,int code)
+{
+    char buf[256];
+
+    snprintf(buf,sizeof(buf),"iRCUHashTable.%s",fnName);
+    err(buf,code);
+    return code;
+}
+
+static int NullPtrError(const char *fnName)
+{
+    return doerrorCall(iError.RaiseError,fnName,CONTAINER_ERROR_BADARG);
+}
+
+static int ReadOnlyError(const RCUHashTable *ht,const char *fnName)
+{
+    return doerrorCall(ht->RaiseError,fnName,CONTAINER_ERROR_READONLY);
+}
+
+static int NoMemoryError(const RCUHashTable *ht,const char *fnName)
+{
+    return doerrorCall(ht->RaiseError,fnName,CONTAINER_ERROR_NOMEMORY);
+}
+
+static void FreeChains(RCUHashTable *ht,struct RCUBuckets *b,int destroy)
+{
+    HashEntry *he,*nxt;
+    size_t i;
+
+    for (i = 0; i <= b->max; i++) {
+        for (he = b->slot[i]; he; he = nxt) {
+            nxt = he->next;
+            if (destroy && ht->DestructorFn)
+                ht->DestructorFn(he->val);
+            ht->Allocator->free(he);
+        }
+    }
+    ht->Allocator->free(b);
+}
+
+static void FreeRetired(RCUHashTable *ht,struct RCURetired *r)
+{
+    switch (r->Kind) {
+        case RETIRED_ENTRY:
+            if (ht->DestructorFn)
+                ht->DestructorFn(((HashEntry *)r->p)->val);
+            /* fall through */
+        case RETIRED_COPY:
+            ht->Allocator->free(r->p);
+            break;
+        case RETIRED_BUCKETS:
+        case RETIRED_CLEARED:
+            FreeChains(ht,r->p,r->Kind == RETIRED_CLEARED);
+            break;
+    }
+}
+
+/* Frees the retired memory that no reader can see any more */
+static void Reclaim(RCUHashTable *ht)
+{
+    struct RCUWriter *w = ht->Writer;
+    uint64_t oldest = OldestReader();
+    size_t i,j = 0;
+
+    for (i = 0; i < w->nRetired; i++) {
+        if (w->Retired[i].Epoch <= oldest)
+            FreeRetired(ht,&w->Retired[i]);
+        else w->Retired[j++] = w->Retired[i];
+    }
+    w->nRetired = j;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     WriteLock ID:1
+ Purpose:       Starts a change of the table. The list of retired
+                memory gets room for the blocks the change can retire
+                before anything is unlinked, so Retire never fails.
+ Input:         The table
+ Output:        1 with the lock held, or a negative error code
+ Errors:        NOMEMORY. The lock is released.
+------------------------------------------------------------------------*/
+static int WriteLock(RCUHashTable *ht)
+{
+    struct RCUWriter *w = ht->Writer;
+    struct RCURetired *tmp;
+    size_t n;
+
+    LOCK(&w->Lock);
+    if (w->capacity - w->nRetired < MAX_RETIRED) {
+        n = w->capacity ? 2*w->capacity : RECLAIM_BATCH;
+        tmp = ht->Allocator->realloc(w->Retired,n*sizeof(*tmp));
+        if (tmp == NULL) {
+            UNLOCK(&w->Lock);
+            return CONTAINER_ERROR_NOMEMORY;
+        }
+        w->Retired = tmp;
+        w->capacity = n;
+    }
+    return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Retire ID:1
+ Purpose:       Takes note of memory that was unlinked from the table.
+                A reader that started before the new epoch may still
+                hold it; readers that start later can't reach it.
+ Input:         The table, the memory and what it is. WriteLock made
+                room for it in the list.
+ Output:        None
+ Errors:        None
+------------------------------------------------------------------------*/
+static void Retire(RCUHashTable *ht,void *p,enum RetiredKind Kind)
+{
+    struct RCUWriter *w = ht->Writer;
+
+    w->Retired[w->nRetired].p = p;
+    w->Retired[w->nRetired].Kind = Kind;
+    w->Retired[w->nRetired].Epoch = NEXT_EPOCH(&GlobalEpoch);
+    w->nRetired++;
+}
+
+/* Ends a change of the table */
+static void WriteUnlock(RCUHashTable *ht)
+{
+    if (ht->Writer->nRetired >= RECLAIM_BATCH)
+        Reclaim(ht);
+    UNLOCK(&ht->Writer->Lock);
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                              Entries and arrays                                */
+/* ------------------------------------------------------------------------------ */
+/* Same function as iHashTable: times 33 over the bytes of the key */
+static uint64_t DefaultHashFunction(const char *char_key,size_t *klen)
+{
+    uint64_t hash = 0;
+    const unsigned char *p = (const unsigned char *)char_key;
+    size_t i;
+
+    if (*klen == (size_t)-1) {
+        for (; *p; p++)
+            hash = hash * 33 + *p;
+        *klen = p - (const unsigned char *)char_key;
+    }
+    else {
+        for (i = *klen; i; i--, p++)
+            hash = hash * 33 + *p;
+    }
+    return hash;
+}
+
+static uint64_t HashKey(const struct RCUBuckets *b,const void *key,size_t *klen)
+{
+    if (b->Seed) {
+        if (*klen == (size_t)-1)
+            *klen = strlen(key);
+        return iHashFunctions.Hash64(key,*klen,b->Seed);
+    }
+    return b->Hash(key,klen);
+}
+
+/* The smallest mask (number of buckets - 1) with at least n buckets */
+static size_t MaskFor(size_t n)
+{
+    size_t max = INITIAL_MAX;
+
+    while (n && max < n-1)
+        max = 2*max+1;
+    return max;
+}
+
+static struct RCUBuckets *NewBuckets(const RCUHashTable *ht,size_t max,GeneralHashFunction Hash,uint64_t Seed)
+{
+    size_t size = offsetof(struct RCUBuckets,slot) + (max+1)*sizeof(HashEntry *);
+    struct RCUBuckets *b = ht->Allocator->malloc(size);
+
+    if (b) {
+        memset(b,0,size);
+        b->Hash = Hash;
+        b->Seed = Seed;
+        b->max = max;
+    }
+    return b;
+}
+
+/* The key is stored after the value */
+static HashEntry *NewEntry(const RCUHashTable *ht,uint64_t hash,const void *key,size_t klen,const void *val)
+{
+    HashEntry *he = ht->Allocator->malloc(ENTRY_SIZE(ht,klen));
+
+    if (he) {
+        he->next = NULL;
+        he->hash = hash;
+        he->klen = klen;
+        if (val)
+            memcpy(he->val,val,ht->ElementSize);
+        else memset(he->val,0,ht->ElementSize);
+        memcpy(ENTRY_KEY(ht,he),key,klen);
+        he->key = ENTRY_KEY(ht,he);
+    }
+    return he;
+}
+
+/* Looks up a key in a read section or under the lock */
+static HashEntry *FindEntry(const struct RCUBuckets *b,const void *key,size_t klen)
+{
+    HashEntry *he;
+    uint64_t h = HashKey(b,key,&klen);
+
+    for (he = LOAD_PTR(&b->slot[h & b->max]); he; he = LOAD_PTR(&he->next)) {
+        if (he->hash == h && he->klen == klen && memcmp(he->key,key,klen) == 0)
+            break;
+    }
+    return he;
+}
+
+/* The link that points to the entry of a key, under the lock */
+static HashEntry **FindLink(const struct RCUBuckets *b,const void *key,size_t klen)
+{
+    HashEntry **link,*he;
+    uint64_t h = HashKey(b,key,&klen);
+
+    for (link = (HashEntry **)&b->slot[h & b->max]; (he = *link) != NULL; link = &he->next) {
+        if (he->hash == h && he->klen == klen && memcmp(he->key,key,klen) == 0)
+            return link;
+    }
+    return NULL;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Regenerate ID:1
+ Purpose:       Builds a new array with copies of all entries and
+                publishes it. Readers still in the old array see it
+                unchanged until they are done.
+ Input:         The table, the new mask and the hashing of the new
+                array. Called with the lock held.
+ Output:        1 or a negative error code
+ Errors:        NOMEMORY. The table is unchanged.
+------------------------------------------------------------------------*/
+static int Regenerate(RCUHashTable *ht,size_t max,GeneralHashFunction Hash,uint64_t Seed)
+{
+    struct RCUBuckets *old = ht->Buckets,*b;
+    HashEntry *he,*ne;
+    size_t i,j,klen;
+    int rehash = (Hash != old->Hash || Seed != old->Seed);
+
+    b = NewBuckets(ht,max,Hash,Seed);
+    if (b == NULL)
+        return CONTAINER_ERROR_NOMEMORY;
+    for (i = 0; i <= old->max; i++) {
+        for (he = old->slot[i]; he; he = he->next) {
+            ne = ht->Allocator->malloc(ENTRY_SIZE(ht,he->klen));
+            if (ne == NULL) {
+                FreeChains(ht,b,0);
+                return CONTAINER_ERROR_NOMEMORY;
+            }
+            memcpy(ne,he,ENTRY_SIZE(ht,he->klen));
+            ne->key = ENTRY_KEY(ht,ne);
+            if (rehash) {
+                klen = ne->klen;
+                ne->hash = HashKey(b,ne->key,&klen);
+            }
+            j = ne->hash & max;
+            ne->next = b->slot[j];
+            b->slot[j] = ne;
+        }
+    }
+    STORE_PTR(&ht->Buckets,b);
+    ht->timestamp++;
+    if (max != old->max)
+        ht->Resizes++;
+    Retire(ht,old,RETIRED_BUCKETS);
+    return 1;
+}
+
+static void ShrinkIfSparse(RCUHashTable *ht)
+{
+    struct RCUBuckets *b = ht->Buckets;
+    size_t n = 2*ht->count,max;
+
+    if (b->max == INITIAL_MAX || ht->count >= (b->max+1)/SHRINK_RATIO)
+        return;
+    max = MaskFor(n > ht->Reserved ? n : ht->Reserved);
+    if (max < b->max)
+        Regenerate(ht,max,b->Hash,b->Seed);
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                                  Interface                                     */
+/* ------------------------------------------------------------------------------ */
+static size_t Size(const RCUHashTable *ht)
+{
+    if (ht == NULL) {
+        NullPtrError("Size");
+        return 0;
+    }
+    return ht->count;
+}
+
+static unsigned GetFlags(const RCUHashTable *ht)
+{
+    if (ht == NULL) {
+        NullPtrError("GetFlags");
+        return 0;
+    }
+    return ht->Flags;
+}
+
+static unsigned SetFlags(RCUHashTable *ht,unsigned newval)
+{
+    unsigned oldval;
+
+    if (ht == NULL) {
+        NullPtrError("SetFlags");
+        return 0;
+    }
+    oldval = ht->Flags;
+    ht->Flags = newval;
+    return oldval;
+}
+
+static RCUHashTable *Create(size_t ElementSize)
+{
+    const ContainerAllocator *allocator = CurrentAllocator;
+    RCUHashTable *ht;
+
+    INIT_READERS();
+    ht = allocator->malloc(sizeof(RCUHashTable));
+    if (ht == NULL)
+        goto nomem;
+    memset(ht,0,sizeof(*ht));
+    ht->VTable = &iRCUHashTable;
+    ht->ElementSize = ElementSize;
+    ht->Allocator = allocator;
+    ht->RaiseError = iError.RaiseError;
+    ht->Writer = allocator->malloc(sizeof(struct RCUWriter));
+    ht->Buckets = NewBuckets(ht,INITIAL_MAX,DefaultHashFunction,0);
+    if (ht->Writer == NULL || ht->Buckets == NULL) {
+        if (ht->Writer) allocator->free(ht->Writer);
+        if (ht->Buckets) allocator->free(ht->Buckets);
+        allocator->free(ht);
+        goto nomem;
+    }
+    memset(ht->Writer,0,sizeof(struct RCUWriter));
+    MUTEX_INIT(&ht->Writer->Lock);
+    return ht;
+nomem:
+    iError.RaiseError("iRCUHashTable.Create",CONTAINER_ERROR_NOMEMORY);
+    return NULL;
+}
+
+static RCUHashTable *Init(RCUHashTable *ht,size_t ElementSize)
+{
+    iError.RaiseError("iRCUHashTable.Init",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return NULL;
+}
+
+/* The integer keys of iHashTable (CreateIntegerKeys) are not implemented */
+static RCUHashTable *CreateIntegerKeys(size_t ElementSize)
+{
+    iError.RaiseError("iRCUHashTable.CreateIntegerKeys",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return NULL;
+}
+
+static int AddInteger(RCUHashTable *ht,uint64_t key,const void *val)
+{
+    iError.RaiseError("iRCUHashTable.AddInteger",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return CONTAINER_ERROR_NOTIMPLEMENTED;
+}
+
+static void *GetElementInteger(const RCUHashTable *ht,uint64_t key)
+{
+    iError.RaiseError("iRCUHashTable.GetElementInteger",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return NULL;
+}
+
+static int EraseInteger(RCUHashTable *ht,uint64_t key)
+{
+    iError.RaiseError("iRCUHashTable.EraseInteger",CONTAINER_ERROR_NOTIMPLEMENTED);
+    return CONTAINER_ERROR_NOTIMPLEMENTED;
+}
+
+static void *GetElement(const RCUHashTable *ht,const void *key,size_t klen)
+{
+    struct RCUReader *r;
+    HashEntry *he;
+
+    if (ht == NULL || key == NULL || klen == 0) {
+        NullPtrError("GetElement");
+        return NULL;
+    }
+    if ((r = ReadLock()) == NULL) {
+        NoMemoryError(ht,"GetElement");
+        return NULL;
+    }
+    he = FindEntry(LOAD_PTR(&ht->Buckets),key,klen);
+    ReadUnlock(r);
+    return he ? he->val : NULL;
+}
+
+static int Contains(const RCUHashTable *ht,const void *key,size_t klen)
+{
+    struct RCUReader *r;
+    HashEntry *he;
+
+    if (ht == NULL || key == NULL)
+        return NullPtrError("Contains");
+    if ((r = ReadLock()) == NULL)
+        return NoMemoryError(ht,"Contains");
+    he = FindEntry(LOAD_PTR(&ht->Buckets),key,klen);
+    ReadUnlock(r);
+    return he != NULL;
+}
+
+/* Adds the key. Returns 1 if the key was added, zero if it was already
+   there: as in iHashTable its value is not changed. */
+static int Add(RCUHashTable *ht,const void *key,size_t klen,const void *val)
+{
+    struct RCUBuckets *b;
+    HashEntry *he;
+    uint64_t h;
+    size_t i;
+
+    if (ht == NULL || key == NULL || klen == 0)
+        return NullPtrError("Add");
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"Add");
+    if (WriteLock(ht) < 0)
+        return NoMemoryError(ht,"Add");
+    b = ht->Buckets;
+    h = HashKey(b,key,&klen);
+    for (he = b->slot[h & b->max]; he; he = he->next) {
+        if (he->hash == h && he->klen == klen && memcmp(he->key,key,klen) == 0) {
+            UNLOCK(&ht->Writer->Lock);
+            return 0;
+        }
+    }
+    he = NewEntry(ht,h,key,klen,val);
+    if (he == NULL) {
+        UNLOCK(&ht->Writer->Lock);
+        return NoMemoryError(ht,"Add");
+    }
+    i = h & b->max;
+    he->next = b->slot[i];
+    STORE_PTR(&b->slot[i],he);
+    ht->count++;
+    ht->timestamp++;
+    /* check that the collision rate isn't too high */
+    if (ht->count > b->max)
+        Regenerate(ht,2*b->max+1,b->Hash,b->Seed);
+    WriteUnlock(ht);
+    return 1;
+}
+
+/* The new value goes into a copy of the entry, so a reader sees either
+   the old value or the new one, never a mix */
+static int Replace(RCUHashTable *ht,const void *key,size_t klen,const void *val)
+{
+    HashEntry **link,*he,*ne;
+
+    if (ht == NULL || val == NULL || key == NULL || klen == 0)
+        return NullPtrError("Replace");
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"Replace");
+    if (WriteLock(ht) < 0)
+        return NoMemoryError(ht,"Replace");
+    link = FindLink(ht->Buckets,key,klen);
+    if (link == NULL) {
+        UNLOCK(&ht->Writer->Lock);
+        return 0;
+    }
+    he = *link;
+    ne = NewEntry(ht,he->hash,he->key,he->klen,val);
+    if (ne == NULL) {
+        UNLOCK(&ht->Writer->Lock);
+        return NoMemoryError(ht,"Replace");
+    }
+    ne->next = he->next;
+    STORE_PTR(link,ne);
+    ht->timestamp++;
+    Retire(ht,he,RETIRED_COPY);
+    WriteUnlock(ht);
+    return 1;
+}
+
+/* The entry is unlinked; its next pointer is left as it is for the
+   readers that are on it */
+static int EraseEntry(RCUHashTable *ht,const void *key,size_t klen,int shrink)
+{
+    HashEntry **link,*he;
+
+    if (WriteLock(ht) < 0)
+        return NoMemoryError(ht,"Erase");
+    link = FindLink(ht->Buckets,key,klen);
+    if (link == NULL) {
+        UNLOCK(&ht->Writer->Lock);
+        return 0;
+    }
+    he = *link;
+    STORE_PTR(link,he->next);
+    ht->count--;
+    ht->timestamp++;
+    Retire(ht,he,RETIRED_ENTRY);
+    if (shrink)
+        ShrinkIfSparse(ht);
+    WriteUnlock(ht);
+    return 1;
+}
+
+static int Erase(RCUHashTable *ht,const void *key,size_t klen)
+{
+    if (ht == NULL || key == NULL || klen == 0)
+        return NullPtrError("Erase");
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"Erase");
+    return EraseEntry(ht,key,klen,1);
+}
+
+/* An empty array replaces the current one */
+static int Clear(RCUHashTable *ht)
+{
+    struct RCUBuckets *old,*b;
+
+    if (ht == NULL)
+        return NullPtrError("Clear");
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"Clear");
+    if (WriteLock(ht) < 0)
+        return NoMemoryError(ht,"Clear");
+    old = ht->Buckets;
+    b = NewBuckets(ht,MaskFor(ht->Reserved),old->Hash,old->Seed);
+    if (b == NULL) {
+        UNLOCK(&ht->Writer->Lock);
+        return NoMemoryError(ht,"Clear");
+    }
+    STORE_PTR(&ht->Buckets,b);
+    ht->count = 0;
+    ht->timestamp++;
+    Retire(ht,old,RETIRED_CLEARED);
+    Reclaim(ht);
+    UNLOCK(&ht->Writer->Lock);
+    return 1;
+}
+
+/* No other call may run at the same time: everything is freed */
+static int Finalize(RCUHashTable *ht)
+{
+    struct RCUWriter *w;
+    size_t i;
+
+    if (ht == NULL)
+        return NullPtrError("Finalize");
+    w = ht->Writer;
+    for (i = 0; i < w->nRetired; i++)
+        FreeRetired(ht,&w->Retired[i]);
+    if (w->Retired)
+        ht->Allocator->free(w->Retired);
+    FreeChains(ht,ht->Buckets,1);
+    MUTEX_DESTROY(&w->Lock);
+    ht->Allocator->free(w);
+    ht->Allocator->free(ht);
+    return 1;
+}
+
+/* Calls the function for each entry until it returns zero, in a read
+   section. Returns zero if the scan was stopped, 1 otherwise. */
+static int Search(RCUHashTable *ht,int (*comp)(void *rec,const void *key,size_t klen,const void *value),void *rec)
+{
+    struct RCUReader *r;
+    struct RCUBuckets *b;
+    HashEntry *he;
+    size_t i;
+    int result = 1;
+
+    if (ht == NULL || comp == NULL)
+        return NullPtrError("Search");
+    if ((r = ReadLock()) == NULL)
+        return NoMemoryError(ht,"Search");
+    b = LOAD_PTR(&ht->Buckets);
+    for (i = 0; i <= b->max && result; i++) {
+        for (he = LOAD_PTR(&b->slot[i]); he; he = LOAD_PTR(&he->next)) {
+            if ((*comp)(rec,he->key,he->klen,he->val) == 0) {
+                result = 0;
+                break;
+            }
+        }
+    }
+    ReadUnlock(r);
+    return result;
+}
+
+/* The values given to the function must not be changed: other threads
+   may be reading them */
+static int Apply(RCUHashTable *ht,int (*Applyfn)(void *Key,size_t klen,void *data,void *arg),void *arg)
+{
+    struct RCUReader *r;
+    struct RCUBuckets *b;
+    HashEntry *he;
+    size_t i;
+    int result = 1;
+
+    if (ht == NULL || Applyfn == NULL)
+        return NullPtrError("Apply");
+    if ((r = ReadLock()) == NULL)
+        return NoMemoryError(ht,"Apply");
+    b = LOAD_PTR(&ht->Buckets);
+    for (i = 0; i <= b->max && result; i++) {
+        for (he = LOAD_PTR(&b->slot[i]); he; he = LOAD_PTR(&he->next)) {
+            if ((*Applyfn)((void *)he->key,he->klen,he->val,arg) == 0) {
+                result = 0;
+                break;
+            }
+        }
+    }
+    ReadUnlock(r);
+    return result;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     Scan ID:1
+ Purpose:       Visits the table in slices, as iHashTable.Scan. Each
+                slice is a read section on the current array: other
+                threads can change the table during the slice, and
+                every entry that stays in the table during the whole
+                scan is visited at least once even if the array is
+                replaced by one of another size between two slices.
+ Input:         The table, the cursor (zero to start), the number of
+                entries wanted, the callback and its argument. A
+                callback that returns zero ends the slice; the next
+                call visits that bucket again.
+ Output:        1 if the scan goes on, 0 when it is complete (the
+                cursor is back to zero), a negative error code
+ Errors:        BADARG if the table, the cursor or the callback is NULL
+                NOMEMORY if the thread can't be registered as a reader
+------------------------------------------------------------------------*/
+static int Scan(RCUHashTable *ht,size_t *Cursor,size_t Count,int (*Scanfn)(void *Key,size_t klen,void *data,void *arg),void *arg)
+{
+    struct RCUReader *r;
+    struct RCUBuckets *b;
+    HashEntry *he;
+    size_t v,n = 0,buckets = 0;
+
+    if (ht == NULL || Cursor == NULL || Scanfn == NULL)
+        return NullPtrError("Scan");
+    if ((r = ReadLock()) == NULL)
+        return NoMemoryError(ht,"Scan");
+    b = LOAD_PTR(&ht->Buckets);
+    v = *Cursor;
+    do {
+        for (he = LOAD_PTR(&b->slot[v & b->max]); he; he = LOAD_PTR(&he->next)) {
+            if ((*Scanfn)((void *)he->key,he->klen,he->val,arg) == 0) {
+                ReadUnlock(r);
+                *Cursor = v;
+                return 1;
+            }
+            n++;
+        }
+        v = HashScanNext(v,b->max);
+    } while (v && n < Count && ++buckets < HASH_SCAN_BUCKETS*Count);
+    ReadUnlock(r);
+    *Cursor = v;
+    return v != 0;
+}
+
+static ErrorFunction SetErrorFunction(RCUHashTable *ht,ErrorFunction fn)
+{
+    ErrorFunction old;
+
+    if (ht == NULL)
+        return iError.RaiseError;
+    old = ht->RaiseError;
+    ht->RaiseError = (fn) ? fn : iError.EmptyErrorFunction;
+    return old;
+}
+
+/* The keys are not counted */
+static size_t Sizeof(const RCUHashTable *ht)
+{
+    if (ht == NULL)
+        return sizeof(RCUHashTable);
+    return sizeof(RCUHashTable) + sizeof(struct RCUWriter) +
+           sizeof(HashEntry *) * (ht->Buckets->max + 1) +
+           ht->count * (sizeof(HashEntry) + ht->ElementSize);
+}
+
+static size_t GetElementSize(const RCUHashTable *ht)
+{
+    if (ht == NULL) {
+        NullPtrError("GetElementSize");
+        return 0;
+    }
+    return ht->ElementSize;
+}
+
+/* Changes the array to max+1 buckets with the same hashing */
+static int ResizeTo(RCUHashTable *ht,size_t max,const char *fnName)
+{
+    struct RCUBuckets *b;
+    int r = 1;
+
+    if (WriteLock(ht) < 0)
+        return NoMemoryError(ht,fnName);
+    b = ht->Buckets;
+    if (max != b->max)
+        r = Regenerate(ht,max,b->Hash,b->Seed);
+    WriteUnlock(ht);
+    if (r < 0)
+        return NoMemoryError(ht,fnName);
+    return 1;
+}
+
+static int Resize(RCUHashTable *ht,size_t newSize)
+{
+    if (ht == NULL)
+        return NullPtrError("Resize");
+    return ResizeTo(ht,newSize ? MaskFor(newSize) : 2*ht->Buckets->max+1,"Resize");
+}
+
+/* See Reserve in hashtable.c */
+static int Reserve(RCUHashTable *ht,size_t n)
+{
+    if (ht == NULL)
+        return NullPtrError("Reserve");
+    ht->Reserved = n;
+    if (MaskFor(n) <= ht->Buckets->max)
+        return 1;
+    return ResizeTo(ht,MaskFor(n),"Reserve");
+}
+
+/* See BuildFrom in hashtable.c. The slots are allocated once for all
+   the keys, and the keys are added one after the other. */
+static RCUHashTable *BuildFrom(size_t ElementSize,size_t n,const void **Keys,const size_t *klens,const void *Values)
+{
+    RCUHashTable *ht;
+    size_t i;
+
+    if (n && Keys == NULL) {
+        NullPtrError("BuildFrom");
+        return NULL;
+    }
+    ht = Create(ElementSize);
+    if (ht == NULL)
+        return NULL;
+    if (Reserve(ht,n) < 0)
+        goto err;
+    for (i = 0; i < n; i++) {
+        if (Add(ht,Keys[i],klens ? klens[i] : (size_t)-1,
+                Values ? (const char *)Values + i*ElementSize : NULL) < 0)
+            goto err;
+    }
+    ht->Reserved = 0;
+    return ht;
+err:
+    Finalize(ht);
+    return NULL;
+}
+
+/* Rebuilds the table with as many buckets as entries and frees the
+   retired memory that no reader holds */
+static int ShrinkToFit(RCUHashTable *ht)
+{
+    int r;
+
+    if (ht == NULL)
+        return NullPtrError("ShrinkToFit");
+    ht->Reserved = 0;
+    r = ResizeTo(ht,MaskFor(ht->count),"ShrinkToFit");
+    LOCK(&ht->Writer->Lock);
+    Reclaim(ht);
+    UNLOCK(&ht->Writer->Lock);
+    return r;
+}
+
+static int CopyEntry(void *key,size_t klen,void *val,void *arg)
+{
+    return Add(arg,key,klen,val) >= 0;
+}
+
+/* The copy has its own keys; the pool is not used */
+static RCUHashTable *Copy(const RCUHashTable *orig,Pool *pool)
+{
+    RCUHashTable *ht;
+
+    if (orig == NULL) {
+        NullPtrError("Copy");
+        return NULL;
+    }
+    ht = Create(orig->ElementSize);
+    if (ht == NULL)
+        return NULL;
+    ht->Buckets->Hash = orig->Buckets->Hash;
+    ht->Buckets->Seed = orig->Buckets->Seed;
+    ht->Flags = orig->Flags & ~CONTAINER_READONLY;
+    ht->DestructorFn = orig->DestructorFn;
+    if (Reserve(ht,orig->count) < 0 || Apply((RCUHashTable *)orig,CopyEntry,ht) == 0) {
+        Finalize(ht);
+        return NULL;
+    }
+    ht->Reserved = 0;
+    ht->Flags = orig->Flags;
+    return ht;
+}
+
+static int ChangeHashing(RCUHashTable *ht,GeneralHashFunction fn,uint64_t Seed)
+{
+    int r;
+
+    if ((r = WriteLock(ht)) < 0)
+        return r;
+    r = Regenerate(ht,ht->Buckets->max,fn,Seed);
+    WriteUnlock(ht);
+    return r;
+}
+
+static GeneralHashFunction SetHashFunction(RCUHashTable *ht,GeneralHashFunction Hash)
+{
+    GeneralHashFunction old;
+
+    if (ht == NULL)
+        return DefaultHashFunction;
+    old = ht->Buckets->Hash;
+    if (Hash && (Hash != old || ht->Buckets->Seed) && ChangeHashing(ht,Hash,0) < 0)
+        NoMemoryError(ht,"SetHashFunction");
+    return old;
+}
+
+/* See SetSeed in hashtable.c */
+static int SetSeed(RCUHashTable *ht,uint64_t Seed)
+{
+    if (ht == NULL)
+        return NullPtrError("SetSeed");
+    if (ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(ht,"SetSeed");
+    if (ChangeHashing(ht,ht->Buckets->Hash,Seed ? Seed : iHashFunctions.RandomSeed()) < 0)
+        return NoMemoryError(ht,"SetSeed");
+    return 1;
+}
+
+struct MergeInfo {
+    RCUHashTable *res;
+    Pool *p;
+    void *(*merger)(Pool *p,const void *key,size_t klen,const void *h1_val,
+                    const void *h2_val,const void *data);
+    const void *data;
+    int error;
+};
+
+static int MergeBase(void *key,size_t klen,void *val,void *arg)
+{
+    struct MergeInfo *mi = arg;
+
+    if (Add(mi->res,key,klen,val) < 0) {
+        mi->error = 1;
+        return 0;
+    }
+    return 1;
+}
+
+/* The result isn't shared yet: its entries can be changed in place */
+static int MergeOverlay(void *key,size_t klen,void *val,void *arg)
+{
+    struct MergeInfo *mi = arg;
+    HashEntry *he = FindEntry(mi->res->Buckets,key,klen);
+    const void *pvoid = val;
+
+    if (he == NULL)
+        return MergeBase(key,klen,val,arg);
+    if (mi->merger)
+        pvoid = (*mi->merger)(mi->p,key,klen,val,he->val,mi->data);
+    memcpy(he->val,pvoid,mi->res->ElementSize);
+    return 1;
+}
+
+/* See Merge in flathashtable.c. The tables can be of any implementation. */
+static RCUHashTable *Merge(Pool *p,const HashTable *overlay,const HashTable *base,
+                           void *(*merger)(Pool *p,const void *key,size_t klen,
+                                           const void *h1_val,const void *h2_val,
+                                           const void *data),
+                           const void *data)
+{
+    struct MergeInfo mi;
+
+    if (overlay == NULL || base == NULL) {
+        NullPtrError("Merge");
+        return NULL;
+    }
+    mi.res = Create(base->VTable->GetElementSize(base));
+    if (mi.res == NULL)
+        return NULL;
+    if (base->VTable == &iRCUHashTable) {
+        const RCUHashTable *b = (const RCUHashTable *)base;
+        mi.res->Buckets->Hash = b->Buckets->Hash;
+        mi.res->Buckets->Seed = b->Buckets->Seed;
+    }
+    Resize(mi.res,base->VTable->Size(base)+overlay->VTable->Size(overlay));
+    mi.p = p;
+    mi.merger = merger;
+    mi.data = data;
+    mi.error = 0;
+    base->VTable->Apply((HashTable *)base,MergeBase,&mi);
+    if (!mi.error)
+        overlay->VTable->Apply((HashTable *)overlay,MergeOverlay,&mi);
+    if (mi.error) {
+        Finalize(mi.res);
+        return NULL;
+    }
+    return mi.res;
+}
+
+static RCUHashTable *Overlay(Pool *p,const HashTable *overlay,const HashTable *base)
+{
+    return Merge(p,overlay,base,NULL,NULL);
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                                Iterators                                       */
+/* ------------------------------------------------------------------------------ */
+/* The iteration goes through the array that was current at GetFirst.
+   The changes made meanwhile by other threads may be seen or not, but
+   no entry is seen twice and the iteration is never invalidated. */
+static void EndIteration(struct RCUHashTableIterator *d)
+{
+    if (d->Reader) {
+        ReadUnlock(d->Reader);
+        d->Reader = NULL;
+    }
+    d->Current = d->Next = NULL;
+}
+
+static void *GetNext(Iterator *it)
+{
+    struct RCUHashTableIterator *d = (struct RCUHashTableIterator *)it;
+    HashEntry *he;
+
+    if (it == NULL) {
+        NullPtrError("GetNext");
+        return NULL;
+    }
+    if (d->Reader == NULL)
+        return NULL;
+    he = d->Next;
+    while (he == NULL && d->index <= d->Buckets->max)
+        he = LOAD_PTR(&d->Buckets->slot[d->index++]);
+    if (he == NULL) {
+        EndIteration(d);
+        return NULL;
+    }
+    d->Current = he;
+    d->Next = LOAD_PTR(&he->next);
+    return he->val;
+}
+
+static void *GetFirst(Iterator *it)
+{
+    struct RCUHashTableIterator *d = (struct RCUHashTableIterator *)it;
+
+    if (it == NULL) {
+        NullPtrError("GetFirst");
+        return NULL;
+    }
+    EndIteration(d);
+    if ((d->Reader = ReadLock()) == NULL) {
+        NoMemoryError(d->ht,"GetFirst");
+        return NULL;
+    }
+    d->Buckets = LOAD_PTR(&d->ht->Buckets);
+    d->index = 0;
+    return GetNext(it);
+}
+
+static void *GetCurrent(Iterator *it)
+{
+    struct RCUHashTableIterator *d = (struct RCUHashTableIterator *)it;
+
+    if (it == NULL || d->Current == NULL)
+        return NULL;
+    return d->Current->val;
+}
+
+/* Replaces or erases the element returned by the last call to GetNext.
+   The table doesn't shrink, so the iteration goes on in the same array. */
+static int ReplaceWithIterator(Iterator *it,void *data,int direction)
+{
+    struct RCUHashTableIterator *d = (struct RCUHashTableIterator *)it;
+    HashEntry *he;
+
+    if (it == NULL)
+        return NullPtrError("Replace");
+    if (d->ht->Flags & CONTAINER_READONLY)
+        return ReadOnlyError(d->ht,"Replace");
+    he = d->Current;
+    if (he == NULL)
+        return 0;
+    if (data == NULL)
+        return EraseEntry(d->ht,he->key,he->klen,0);
+    return Replace(d->ht,he->key,he->klen,data);
+}
+
+static int InitIterator(RCUHashTable *ht,void *buf)
+{
+    struct RCUHashTableIterator *result = buf;
+
+    if (ht == NULL || buf == NULL)
+        return NullPtrError("InitIterator");
+    memset(result,0,sizeof(*result));
+    result->it.GetNext = GetNext;
+    result->it.GetPrevious = GetNext;
+    result->it.GetFirst = GetFirst;
+    result->it.GetCurrent = GetCurrent;
+    result->it.Replace = ReplaceWithIterator;
+    result->ht = ht;
+    return 1;
+}
+
+static Iterator *NewIterator(RCUHashTable *ht)
+{
+    struct RCUHashTableIterator *result;
+
+    if (ht == NULL) {
+        NullPtrError("NewIterator");
+        return NULL;
+    }
+    result = ht->Allocator->malloc(sizeof(*result));
+    if (result == NULL) {
+        NoMemoryError(ht,"NewIterator");
+        return NULL;
+    }
+    InitIterator(ht,result);
+    return &result->it;
+}
+
+static int DeleteIterator(Iterator *it)
+{
+    struct RCUHashTableIterator *d = (struct RCUHashTableIterator *)it;
+
+    if (it == NULL)
+        return NullPtrError("DeleteIterator");
+    EndIteration(d);
+    d->ht->Allocator->free(it);
+    return 1;
+}
+
+static size_t SizeofIterator(const RCUHashTable *ht)
+{
+    return sizeof(struct RCUHashTableIterator);
+}
+
+/* The destructor is called when the memory of an erased entry is freed,
+   not when it is erased */
+static DestructorFunction SetDestructor(RCUHashTable *ht,DestructorFunction fn)
+{
+    DestructorFunction oldfn;
+
+    if (ht == NULL)
+        return NULL;
+    oldfn = ht->DestructorFn;
+    if (fn)
+        ht->DestructorFn = fn;
+    return oldfn;
+}
+
+/* ------------------------------------------------------------------------------ */
+/*                              Save and Load                                     */
+/* ------------------------------------------------------------------------------ */
+static int DefaultLoadFunction(void *element,void *arg,FILE *Infile)
+{
+    size_t len = *(size_t *)arg;
+
+    return len == fread(element,1,len,Infile);
+}
+
+/* Key lengths are written in ULE128: 7 bits per byte, the high bit set
+   in all bytes but the last */
+static int decode_ule128(FILE *stream,size_t *val)
+{
+    size_t i = 0;
+    int c;
+
+    val[0] = 0;
+    do {
+        c = fgetc(stream);
+        if (c == EOF)
+            return EOF;
+        val[0] += ((size_t)(c & 0x7f) << (i * 7));
+        i++;
+    } while ((0x80 & c) && (i*7 < 8*sizeof(size_t)));
+    return (int)i;
+}
+
+static int encode_ule128(FILE *stream,size_t val)
+{
+    int i = 0;
+
+    do {
+        size_t c = val & 0x7f;
+        val >>= 7;
+        if (val)
+            c |= 0x80;
+        if (fputc((int)c,stream) == EOF)
+            return EOF;
+        i++;
+    } while (val);
+    return i;
+}
+
+/* The file has the format of iHashTable files (see Save in hashtable.c).
+   The table is saved from one read section, so the entries of each chain
+   are seen at one instant. */
+static int Save(const RCUHashTable *ht,FILE *stream,SaveFunction saveFn,void *arg)
+{
+    struct RCUReader *r;
+    struct RCUBuckets *b;
+    struct BlockFile bf;
+    HashEntry *he;
+    uint64_t count = 0,elemsiz,bytes = 0;
+    size_t i;
+    int rv = 1;
+
+    if (ht == NULL || stream == NULL)
+        return NullPtrError("Save");
+    if ((r = ReadLock()) == NULL)
+        return NoMemoryError(ht,"Save");
+    /* The count is taken from the array, not from ht->count, that can
+       change meanwhile */
+    b = LOAD_PTR(&ht->Buckets);
+    for (i = 0; i <= b->max; i++) {
+        for (he = LOAD_PTR(&b->slot[i]); he; he = LOAD_PTR(&he->next)) {
+            count++;
+            bytes += ULE128Size(he->klen) + he->klen + ht->ElementSize;
+        }
+    }
+    if (saveFn)
+        bytes = SAVED_WITH_FUNCTION;
+    elemsiz = ht->ElementSize;
+    if (fwrite(&RCUHashTableGuid,sizeof(guid),1,stream) == 0 ||
+        fwrite(&count,sizeof(count),1,stream) == 0 ||
+        fwrite(&elemsiz,sizeof(elemsiz),1,stream) == 0 ||
+        fwrite(&ht->Flags,sizeof(unsigned),1,stream) == 0 ||
+        fwrite(&bytes,sizeof(bytes),1,stream) == 0) {
+        ReadUnlock(r);
+        return EOF;
+    }
+    if (saveFn == NULL && BlockFileInit(&bf,stream,0,ht->Allocator) < 0) {
+        ReadUnlock(r);
+        return NoMemoryError(ht,"Save");
+    }
+    /* A chain can have lost entries since they were counted: only count
+       entries are written */
+    for (i = 0; i <= b->max && rv > 0 && count; i++) {
+        for (he = LOAD_PTR(&b->slot[i]); he && rv > 0 && count; he = LOAD_PTR(&he->next), count--) {
+            if (saveFn) {
+                if (encode_ule128(stream,he->klen) <= 0 ||
+                    fwrite(he->key,1,he->klen,stream) != he->klen ||
+                    saveFn(he->val,arg,stream) <= 0)
+                    rv = EOF;
+            }
+            else if (BlockFileWriteULE128(&bf,he->klen) < 0 ||
+                     BlockFileWrite(&bf,he->key,he->klen) < 0 ||
+                     BlockFileWrite(&bf,he->val,ht->ElementSize) < 0)
+                rv = EOF;
+        }
+    }
+    ReadUnlock(r);
+    if (saveFn == NULL) {
+        if (rv > 0 && BlockFileFlush(&bf) < 0)
+            rv = EOF;
+        BlockFileFinalize(&bf);
+    }
+    return rv;
+}
+
+static RCUHashTable *Load(FILE *stream,ReadFunction readFn,void *arg)
+{
+    uint64_t count,elemsiz,bytes;
+    size_t i,ElementSize,klen,keylen = 0;
+    unsigned Flags;
+    RCUHashTable *ht;
+    char *key = NULL,*val = NULL;
+    struct BlockFile bf;
+    int blocks;
+    guid Guid;
+
+    if (stream == NULL) {
+        NullPtrError("Load");
+        return NULL;
+    }
+    if (fread(&Guid,sizeof(guid),1,stream) == 0 ||
+        fread(&count,sizeof(count),1,stream) == 0 ||
+        fread(&elemsiz,sizeof(elemsiz),1,stream) == 0 ||
+        fread(&Flags,sizeof(unsigned),1,stream) == 0 ||
+        fread(&bytes,sizeof(bytes),1,stream) == 0) {
+        iError.RaiseError("iRCUHashTable.Load",CONTAINER_ERROR_FILE_READ);
+        return NULL;
+    }
+    if (memcmp(&Guid,&RCUHashTableGuid,sizeof(guid))) {
+        iError.RaiseError("iRCUHashTable.Load",CONTAINER_ERROR_WRONGFILE);
+        return NULL;
+    }
+    ElementSize = (size_t)elemsiz;
+    blocks = (readFn == NULL && bytes != SAVED_WITH_FUNCTION);
+    if (readFn == NULL) {
+        readFn = DefaultLoadFunction;
+        arg = &ElementSize;
+    }
+    ht = Create(ElementSize);
+    if (ht == NULL)
+        return NULL;
+    bf.buf = NULL;
+    if (Resize(ht,(size_t)count) < 0 ||
+        (val = ht->Allocator->malloc(ElementSize+1)) == NULL ||
+        (blocks && BlockFileInit(&bf,stream,bytes,ht->Allocator) < 0))
+        goto nomem;
+    for (i = 0; i < count; i++) {
+        if ((blocks ? BlockFileReadULE128(&bf,&klen) : decode_ule128(stream,&klen)) <= 0 || klen == 0)
+            goto readerr;
+        /* Add copies the key: one buffer is enough */
+        if (klen > keylen) {
+            char *tmp = ht->Allocator->realloc(key,klen);
+            if (tmp == NULL)
+                goto nomem;
+            key = tmp;
+            keylen = klen;
+        }
+        if (blocks) {
+            if (BlockFileRead(&bf,key,klen) < 0 ||
+                BlockFileRead(&bf,val,ElementSize) < 0)
+                goto readerr;
+        }
+        else if (fread(key,1,klen,stream) != klen ||
+                 readFn(val,arg,stream) <= 0)
+            goto readerr;
+        if (Add(ht,key,klen,val) < 0)
+            goto nomem;
+    }
+    if (bf.buf)
+        BlockFileFinalize(&bf);
+    if (key)
+        ht->Allocator->free(key);
+    ht->Allocator->free(val);
+    ht->Flags = Flags;
+    return ht;
+readerr:
+    iError.RaiseError("iRCUHashTable.Load",CONTAINER_ERROR_FILE_READ);
+    goto err;
+nomem:
+    iError.RaiseError("iRCUHashTable.Load",CONTAINER_ERROR_NOMEMORY);
+err:
+    if (bf.buf)
+        BlockFileFinalize(&bf);
+    if (key)
+        ht->Allocator->free(key);
+    if (val)
+        ht->Allocator->free(val);
+    Finalize(ht);
+    return NULL;
+}
+
+/*
+ * Looks up n keys in one read section. Results[i] receives what
+ * GetElement would return for Keys[i]. If klens is NULL all keys are
+ * zero terminated strings. Returns the number of keys found.
+ */
+static int GetElements(const RCUHashTable *ht,size_t n,const void **Keys,const size_t *klens,void **Results)
+{
+    struct RCUReader *r;
+    struct RCUBuckets *b;
+    HashEntry *he;
+    size_t i;
+    int found = 0;
+
+    if (ht == NULL)
+        return NullPtrError("GetElements");
+    if (n && (Keys == NULL || Results == NULL))
+        return doerrorCall(ht->RaiseError,"GetElements",CONTAINER_ERROR_BADARG);
+    if ((r = ReadLock()) == NULL)
+        return NoMemoryError(ht,"GetElements");
+    b = LOAD_PTR(&ht->Buckets);
+    for (i = 0; i < n; i++) {
+        if (Keys[i] == NULL) {
+            ReadUnlock(r);
+            return doerrorCall(ht->RaiseError,"GetElements",CONTAINER_ERROR_BADARG);
+        }
+        he = FindEntry(b,Keys[i],klens ? klens[i] : (size_t)-1);
+        Results[i] = he ? he->val : NULL;
+        found += he != NULL;
+    }
+    ReadUnlock(r);
+    return found;
+}
+
+/* The value is copied inside the read section: unlike the pointer of
+   GetElement the copy stays valid whatever the writers do. Returns 1 if
+   the key was found, 0 if not (outbuf is not changed). */
+static int CopyElement(const RCUHashTable *ht,const void *key,size_t klen,void *outbuf)
+{
+    struct RCUReader *r;
+    HashEntry *he;
+
+    if (ht == NULL || key == NULL || klen == 0)
+        return NullPtrError("CopyElement");
+    if (outbuf == NULL)
+        return doerrorCall(ht->RaiseError,"CopyElement",CONTAINER_ERROR_BADARG);
+    if ((r = ReadLock()) == NULL)
+        return NoMemoryError(ht,"CopyElement");
+    he = FindEntry(LOAD_PTR(&ht->Buckets),key,klen);
+    if (he)
+        memcpy(outbuf,he->val,ht->ElementSize);
+    ReadUnlock(r);
+    return he != NULL;
+}
+
+/* GetElements copying the values of the keys found to outbuf, an array
+   of n elements, in one read section: all the values come from the same
+   version of the table. Found[i], if Found isn't NULL, tells if Keys[i]
+   was found. */
+static int CopyElements(const RCUHashTable *ht,size_t n,const void **Keys,const size_t *klens,void *outbuf,unsigned char *Found)
+{
+    struct RCUReader *r;
+    struct RCUBuckets *b;
+    HashEntry *he;
+    size_t i;
+    int found = 0;
+
+    if (ht == NULL)
+        return NullPtrError("CopyElements");
+    if (n && (Keys == NULL || outbuf == NULL))
+        return doerrorCall(ht->RaiseError,"CopyElements",CONTAINER_ERROR_BADARG);
+    if ((r = ReadLock()) == NULL)
+        return NoMemoryError(ht,"CopyElements");
+    b = LOAD_PTR(&ht->Buckets);
+    for (i = 0; i < n; i++) {
+        if (Keys[i] == NULL) {
+            ReadUnlock(r);
+            return doerrorCall(ht->RaiseError,"CopyElements",CONTAINER_ERROR_BADARG);
+        }
+        he = FindEntry(b,Keys[i],klens ? klens[i] : (size_t)-1);
+        if (he) {
+            memcpy((char *)outbuf + i*ht->ElementSize,he->val,ht->ElementSize);
+            found++;
+        }
+        if (Found)
+            Found[i] = he != NULL;
+    }
+    ReadUnlock(r);
+    return found;
+}
+
+static int ContainsMany(const RCUHashTable *ht,size_t n,const void **Keys,const size_t *klens,unsigned char *Results)
+{
+    struct RCUReader *r;
+    struct RCUBuckets *b;
+    size_t i;
+    int found = 0;
+
+    if (ht == NULL)
+        return NullPtrError("ContainsMany");
+    if (n && (Keys == NULL || Results == NULL))
+        return doerrorCall(ht->RaiseError,"ContainsMany",CONTAINER_ERROR_BADARG);
+    if ((r = ReadLock()) == NULL)
+        return NoMemoryError(ht,"ContainsMany");
+    b = LOAD_PTR(&ht->Buckets);
+    for (i = 0; i < n; i++) {
+        if (Keys[i] == NULL) {
+            ReadUnlock(r);
+            return doerrorCall(ht->RaiseError,"ContainsMany",CONTAINER_ERROR_BADARG);
+        }
+        Results[i] = FindEntry(b,Keys[i],klens ? klens[i] : (size_t)-1) != NULL;
+        found += Results[i];
+    }
+    ReadUnlock(r);
+    return found;
+}
+
+/* Measures the array of one read section */
+static int GetStatistics(const RCUHashTable *ht,HashStatistics *Stats)
+{
+    struct RCUReader *r;
+    struct RCUBuckets *b;
+    HashEntry *he;
+    size_t i,n;
+
+    if (ht == NULL || Stats == NULL)
+        return NullPtrError("GetStatistics");
+    if ((r = ReadLock()) == NULL)
+        return NoMemoryError(ht,"GetStatistics");
+    b = LOAD_PTR(&ht->Buckets);
+    HashStatsInit(Stats,b->max + 1);
+    for (i = 0; i <= b->max; i++) {
+        n = 0;
+        for (he = LOAD_PTR(&b->slot[i]); he; he = LOAD_PTR(&he->next)) {
+            Stats->KeyBytes += he->klen;
+            n++;
+        }
+        HashStatsChain(Stats,n);
+    }
+    ReadUnlock(r);
+    Stats->Resizes = ht->Resizes;
+    HashStatsFinish(Stats,ht->ElementSize,sizeof(RCUHashTable) + sizeof(struct RCUWriter) +
+                    sizeof(HashEntry *)*(Stats->Slots) + Stats->Count*(sizeof(HashEntry)+ht->ElementSize));
+    return 1;
+}
+
+HashTableInterface iRCUHashTable = {
+    (size_t (*)(const HashTable *))Size,
+    (unsigned (*)(const HashTable *))GetFlags,
+    (unsigned (*)(HashTable *,unsigned))SetFlags,
+    (int (*)(HashTable *))Clear,
+    (int (*)(const HashTable *,const void *,size_t))Contains,
+    (HashTable *(*)(size_t))Create,
+    (HashTable *(*)(HashTable *,size_t))Init,
+    (size_t (*)(const HashTable *))Sizeof,
+    (size_t (*)(const HashTable *))GetElementSize,
+    (int (*)(HashTable *,const void *,size_t,const void *))Add,
+    (void *(*)(const HashTable *,const void *,size_t))GetElement,
+    (int (*)(HashTable *,int (*)(void *,const void *,size_t,const void *),void *))Search,
+    (int (*)(HashTable *,const void *,size_t))Erase,
+    (int (*)(HashTable *))Finalize,
+    (int (*)(HashTable *,int (*)(void *,size_t,void *,void *),void *))Apply,
+    (ErrorFunction (*)(HashTable *,ErrorFunction))SetErrorFunction,
+    (int (*)(HashTable *,size_t))Resize,
+    (int (*)(HashTable *,const void *,size_t,const void *))Replace,
+    (HashTable *(*)(const HashTable *,Pool *))Copy,
+    (GeneralHashFunction (*)(HashTable *,GeneralHashFunction))SetHashFunction,
+    (HashTable *(*)(Pool *,const HashTable *,const HashTable *))Overlay,
+    (HashTable *(*)(Pool *,const HashTable *,const HashTable *,void *(*)(Pool *,const void *,size_t,const void *,const void *,const void *),const void *))Merge,
+    (Iterator *(*)(HashTable *))NewIterator,
+    (int (*)(HashTable *,void *))InitIterator,
+    DeleteIterator,
+    (size_t (*)(const HashTable *))SizeofIterator,
+    (int (*)(const HashTable *,FILE *,SaveFunction,void *))Save,
+    (HashTable *(*)(FILE *,ReadFunction,void *))Load,
+    (DestructorFunction (*)(HashTable *,DestructorFunction))SetDestructor,
+    (int (*)(const HashTable *,size_t,const void **,const size_t *,void **))GetElements,
+    (int (*)(const HashTable *,size_t,const void **,const size_t *,unsigned char *))ContainsMany,
+    (int (*)(HashTable *,uint64_t))SetSeed,
+    (int (*)(HashTable *,size_t))Reserve,
+    (int (*)(HashTable *))ShrinkToFit,
+    (int (*)(const HashTable *,HashStatistics *))GetStatistics,
+    (HashTable *(*)(size_t,size_t,const void **,const size_t *,const void *))BuildFrom,
+    (HashTable *(*)(size_t))CreateIntegerKeys,
+    (int (*)(HashTable *,uint64_t,const void *))AddInteger,
+    (void *(*)(const HashTable *,uint64_t))GetElementInteger,
+    (int (*)(HashTable *,uint64_t))EraseInteger,
+    (int (*)(HashTable *,size_t *,size_t,int (*)(void *,size_t,void *,void *),void *))Scan,
+    (int (*)(const HashTable *,const void *,size_t,void *))CopyElement,
+    (int (*)(const HashTable *,size_t,const void **,const size_t *,void *,unsigned char *))CopyElements,
+};
@@ -945,6 +945,50 @@ static int Sort(ElementType *SC)
     return 1;
 }
 
+/* Sort in several threads. The string comparison function must be
+   thread safe. */
+static int SortParallel(ElementType *SC)
+{
+    CompareInfo ci;
+
+    ci.ExtraArgs = NULL;
+    ci.ContainerLeft = SC;
+    ci.ContainerRight = NULL;
+    if (SC == NULL) {
+        return NullPtrError("SortParallel");
+    }
+    if (SC->Flags & CONTAINER_READONLY) {
+        return ReadOnlyError(SC,"SortParallel");
+    }
+    ParallelSort(SC->contents,SC->count,sizeof(CHAR_TYPE *),(CompareFunction)SC->strcompare,&ci,SC->Allocator);
+    SC->timestamp++;
+    return 1;
+}
+
+/* Sort keeping the order of the strings that compare equal, with a
+   comparison function that looks at a part of them only. */
+static int StableSort(ElementType *SC)
+{
+    CompareInfo ci;
+    int r;
+
+    ci.ExtraArgs = NULL;
+    ci.ContainerLeft = SC;
+    ci.ContainerRight = NULL;
+    if (SC == NULL) {
+        return NullPtrError("StableSort");
+    }
+    if (SC->Flags & CONTAINER_READONLY) {
+        return ReadOnlyError(SC,"StableSort");
+    }
+    r = MergeSort(SC->contents,SC->count,sizeof(CHAR_TYPE *),(CompareFunction)SC->strcompare,&ci,SC->Allocator);
+    if (r < 0) {
+        return NoMemoryError(SC,"StableSort");
+    }
+    SC->timestamp++;
+    return 1;
+}
+
 static size_t Sizeof(const ElementType *SC)
 {
     size_t result= sizeof(ElementType);
@@ -1836,4 +1880,6 @@ INTERFACE_TYP INTERFACE_OBJECT = {
     CompareEqualScalar,
     Select,
     SelectCopy,
+    SortParallel,
+    StableSort,
 };
@@ -1,4 +1,6 @@
 #include "containers.h"
+#include "intptrdoublemap.h"
+#include "uint64uint64map.h"
 #include <stdio.h>
 static void ABORT(char *file,int line)
 {
@@ -467,6 +469,2001 @@ static int TestDictionary(void)
 	return 0;
 }
 
+static size_t LengthHash(const char *key)
+{
+	return strlen(key);
+}
+
+static int TestDictionaryGrowth(void)
+{
+	Dictionary *d = iDictionary.Create(sizeof(int),10);
+	Iterator *it;
+	char key[32];
+	int i,*pi,n;
+
+	for (i=0; i<20000;i++) {
+		sprintf(key,"key%d",i);
+		iDictionary.Add(d,key,&i);
+	}
+	if (iDictionary.Size(d) != 20000)
+		Abort();
+	if (iDictionary.GetLoadFactor(d) > 2.0)
+		Abort();
+	for (i=0; i<20000;i++) {
+		sprintf(key,"key%d",i);
+		pi = iDictionary.GetElement(d,key);
+		if (pi == NULL || *pi != i)
+			Abort();
+	}
+	it = iDictionary.NewIterator(d);
+	n = 0;
+	for (pi = it->GetFirst(it); pi != NULL; pi = it->GetNext(it))
+		n++;
+	iDictionary.DeleteIterator(it);
+	if (n != 20000)
+		Abort();
+	for (i=0; i<20000;i += 2) {
+		sprintf(key,"key%d",i);
+		if (iDictionary.Erase(d,key) != 1)
+			Abort();
+	}
+	if (iDictionary.Size(d) != 10000)
+		Abort();
+	sprintf(key,"key%d",1001);
+	if (!iDictionary.Contains(d,key))
+		Abort();
+	/* The stored hashes must follow a change of hash function */
+	iDictionary.SetHashFunction(d,LengthHash);
+	pi = iDictionary.GetElement(d,key);
+	if (pi == NULL || *pi != 1001)
+		Abort();
+	iDictionary.Finalize(d);
+	return 0;
+}
+
+
+static int TestFlatDictionary(void)
+{
+	Dictionary *d = iFlatDictionary.Create(sizeof(int),0),*d1;
+	Iterator *it;
+	char key[32];
+	int i,*pi,n;
+
+	for (i=0; i<20000;i++) {
+		sprintf(key,"key%d",i);
+		if (iFlatDictionary.Add(d,key,&i) != 1)
+			Abort();
+	}
+	if (iFlatDictionary.Size(d) != 20000)
+		Abort();
+	if (iFlatDictionary.GetLoadFactor(d) >= 1.0)
+		Abort();
+	for (i=0; i<20000;i += 2) {
+		sprintf(key,"key%d",i);
+		if (iFlatDictionary.Erase(d,key) != 1)
+			Abort();
+	}
+	for (i=0; i<20000;i++) {
+		sprintf(key,"key%d",i);
+		pi = iFlatDictionary.GetElement(d,key);
+		if ((i&1) == 0 && pi != NULL)
+			Abort();
+		if ((i&1) && (pi == NULL || *pi != i))
+			Abort();
+	}
+	it = iFlatDictionary.NewIterator(d);
+	n = 0;
+	for (pi = it->GetFirst(it); pi != NULL; pi = it->GetNext(it))
+		n++;
+	iFlatDictionary.DeleteIterator(it);
+	if (n != 10000)
+		Abort();
+	d1 = iFlatDictionary.Copy(d);
+	if (!iFlatDictionary.Equal(d,d1))
+		Abort();
+	i = -1;
+	iFlatDictionary.Replace(d1,"key1001",&i);
+	if (iFlatDictionary.Equal(d,d1))
+		Abort();
+	iFlatDictionary.Finalize(d1);
+	iFlatDictionary.Finalize(d);
+	return 0;
+}
+
+
+static int TestBatchLookup(void)
+{
+	Dictionary *d = iDictionary.Create(sizeof(int),0);
+	Dictionary *fd = iFlatDictionary.Create(sizeof(int),0);
+	HashTable *ht = iHashTable.Create(sizeof(int));
+	char keys[40][16];
+	const char *pkeys[40];
+	void *results[40];
+	unsigned char found[40];
+	int i;
+
+	for (i=0; i<40;i++) {
+		sprintf(keys[i],"key%d",i);
+		pkeys[i] = keys[i];
+		/* Only the even keys are stored */
+		if ((i&1) == 0) {
+			iDictionary.Add(d,keys[i],&i);
+			iFlatDictionary.Add(fd,keys[i],&i);
+			iHashTable.Add(ht,keys[i],strlen(keys[i]),&i);
+		}
+	}
+	if (iDictionary.GetElements(d,40,pkeys,results) != 20)
+		Abort();
+	for (i=0; i<40;i++) {
+		if ((i&1) && results[i] != NULL)
+			Abort();
+		if ((i&1) == 0 && (results[i] == NULL || *(int *)results[i] != i))
+			Abort();
+	}
+	if (iFlatDictionary.GetElements(fd,40,pkeys,results) != 20)
+		Abort();
+	for (i=0; i<40;i++) {
+		if ((i&1) == 0 && (results[i] == NULL || *(int *)results[i] != i))
+			Abort();
+	}
+	if (iHashTable.GetElements(ht,40,(const void **)pkeys,NULL,results) != 20)
+		Abort();
+	for (i=0; i<40;i++) {
+		if ((i&1) && results[i] != NULL)
+			Abort();
+		if ((i&1) == 0 && (results[i] == NULL || *(int *)results[i] != i))
+			Abort();
+	}
+	if (iDictionary.ContainsMany(d,40,pkeys,found) != 20)
+		Abort();
+	for (i=0; i<40;i++) {
+		if (found[i] != !(i&1))
+			Abort();
+	}
+	if (iHashTable.ContainsMany(ht,40,(const void **)pkeys,NULL,found) != 20)
+		Abort();
+	iDictionary.Finalize(d);
+	iFlatDictionary.Finalize(fd);
+	iHashTable.Finalize(ht);
+	return 0;
+}
+
+
+static int TestFrozenDictionary(void)
+{
+	Dictionary *d = iDictionary.Create(sizeof(int),0),*fd,*fd1;
+	strCollection *sc;
+	ErrorFunction old;
+	char key[32];
+	int i,*pi,vals[3] = {1,2,3};
+
+	for (i=0; i<5000;i++) {
+		sprintf(key,"route/%d",i);
+		iDictionary.Add(d,key,&i);
+	}
+	fd = iDictionary.Freeze(d);
+	if (fd == NULL || iFrozenDictionary.Size(fd) != 5000)
+		Abort();
+	for (i=0; i<5000;i++) {
+		sprintf(key,"route/%d",i);
+		pi = iFrozenDictionary.GetElement(fd,key);
+		if (pi == NULL || *pi != i)
+			Abort();
+	}
+	if (iFrozenDictionary.Contains(fd,"route/5000"))
+		Abort();
+	if (!iFrozenDictionary.Equal(fd,d))
+		Abort();
+	fd1 = iFrozenDictionary.Copy(fd);
+	if (!iFrozenDictionary.Equal(fd1,d))
+		Abort();
+	iFrozenDictionary.Finalize(fd1);
+	old = iFrozenDictionary.SetErrorFunction(fd,iError.EmptyErrorFunction);
+	if (iFrozenDictionary.Add(fd,"new",&i) != CONTAINER_ERROR_READONLY)
+		Abort();
+	iFrozenDictionary.SetErrorFunction(fd,old);
+	iFrozenDictionary.Finalize(fd);
+	iDictionary.Finalize(d);
+
+	/* Duplicated keys keep the first value */
+	sc = istrCollection.Create(3);
+	istrCollection.Add(sc,"alpha");
+	istrCollection.Add(sc,"beta");
+	istrCollection.Add(sc,"alpha");
+	fd = iDictionary.FreezeKeys(sc,sizeof(int),vals);
+	if (fd == NULL || iFrozenDictionary.Size(fd) != 2)
+		Abort();
+	pi = iFrozenDictionary.GetElement(fd,"alpha");
+	if (pi == NULL || *pi != 1)
+		Abort();
+	iFrozenDictionary.Finalize(fd);
+	istrCollection.Finalize(sc);
+	return 0;
+}
+
+static int TestDictionarySnapshot(void)
+{
+	Dictionary *d = iDictionary.Create(sizeof(int),0),*sd,*cd;
+	Iterator *it;
+	FILE *f;
+	char key[32];
+	int i,n,*pi;
+
+	for (i=0; i<3000;i++) {
+		sprintf(key,"file/%d",i);
+		iDictionary.Add(d,key,&i);
+	}
+	f = fopen("snapshot.bin","wb");
+	if (f == NULL)
+		Abort();
+	if (iDictionary.SaveSnapshot(d,f) < 0)
+		Abort();
+	fclose(f);
+	sd = iDictionary.OpenSnapshot("snapshot.bin",1);
+	if (sd == NULL || iFrozenDictionary.Size(sd) != 3000)
+		Abort();
+	for (i=0; i<3000;i++) {
+		sprintf(key,"file/%d",i);
+		pi = iFrozenDictionary.GetElement(sd,key);
+		if (pi == NULL || *pi != i)
+			Abort();
+	}
+	if (iFrozenDictionary.Contains(sd,"file/3000"))
+		Abort();
+	it = iFrozenDictionary.NewIterator(sd);
+	n = 0;
+	for (pi = it->GetFirst(it); pi; pi = it->GetNext(it))
+		n++;
+	iFrozenDictionary.DeleteIterator(it);
+	if (n != 3000)
+		Abort();
+	cd = iFrozenDictionary.Copy(sd);
+	iFrozenDictionary.Finalize(sd);
+	if (cd == NULL || !iFrozenDictionary.Equal(cd,d))
+		Abort();
+	iFrozenDictionary.Finalize(cd);
+	iDictionary.Finalize(d);
+	remove("snapshot.bin");
+	return 0;
+}
+
+static int TestKeyArena(void)
+{
+	Dictionary *keys = iDictionary.Create(0,0),*d1,*d2,*d3;
+	ErrorFunction old;
+	char key[32];
+	int i,*pi;
+	char *k1,*k2;
+
+	/* Private arena */
+	d3 = iDictionary.Create(sizeof(int),0);
+	if (iDictionary.UseKeyArena(d3,NULL) < 0)
+		Abort();
+	for (i=0; i<20000;i++) {
+		sprintf(key,"user/%d",i);
+		iDictionary.Add(d3,key,&i);
+	}
+	iDictionary.Erase(d3,"user/7");
+	d1 = iDictionary.Copy(d3);
+	iDictionary.Clear(d3);
+	iDictionary.Add(d3,"user/7",&i);
+	if (iDictionary.Size(d3) != 1 || iDictionary.Size(d1) != 19999)
+		Abort();
+	pi = iDictionary.GetElement(d1,"user/19999");
+	if (pi == NULL || *pi != 19999)
+		Abort();
+	old = iDictionary.SetErrorFunction(d3,iError.EmptyErrorFunction);
+	if (iDictionary.UseKeyArena(d3,NULL) != CONTAINER_ERROR_NOT_EMPTY)
+		Abort();
+	iDictionary.SetErrorFunction(d3,old);
+	iDictionary.Finalize(d1);
+	iDictionary.Finalize(d3);
+
+	/* Keys interned in a table shared by two dictionaries */
+	iDictionary.UseKeyArena(keys,NULL);
+	d1 = iDictionary.Create(0,0);
+	d2 = iFlatDictionary.Create(0,0);
+	if (iDictionary.UseKeyArena(d1,keys) < 0 || iFlatDictionary.UseKeyArena(d2,keys) < 0)
+		Abort();
+	for (i=0; i<1000;i++) {
+		sprintf(key,"host/%d",i);
+		iDictionary.Add(d1,key,NULL);
+		iFlatDictionary.Add(d2,key,NULL);
+	}
+	if (iDictionary.Size(keys) != 1000)
+		Abort();
+	k1 = iDictionary.GetElement(d1,"host/500");
+	k2 = iFlatDictionary.GetElement(d2,"host/500");
+	if (k1 == NULL || k1 != k2 || k1 != iDictionary.GetElement(keys,"host/500"))
+		Abort();
+	d3 = iFlatDictionary.Copy(d2);
+	if (iFlatDictionary.GetElement(d3,"host/500") != k1)
+		Abort();
+	iFlatDictionary.Finalize(d3);
+	iFlatDictionary.Finalize(d2);
+	iDictionary.Finalize(d1);
+	iDictionary.Finalize(keys);
+	return 0;
+}
+
+
+#ifdef UNIX
+#include <pthread.h>
+static void *ConcurrentWorker(void *arg)
+{
+	Dictionary *d = arg;
+	char key[32];
+	int i,v;
+	static int base;
+	int me = __sync_fetch_and_add(&base,1);
+
+	for (i=0; i<5000;i++) {
+		sprintf(key,"t%d/%d",me,i);
+		iConcurrentDictionary.Add(d,key,&i);
+		if (!iConcurrentDictionary.CopyElement(d,key,&v) || v != i)
+			Abort();
+		if (i&1)
+			iConcurrentDictionary.Erase(d,key);
+	}
+	return NULL;
+}
+#endif
+
+static int TestConcurrentDictionary(void)
+{
+	Dictionary *d = iConcurrentDictionary.Create(sizeof(int),0),*d1;
+	Iterator *it;
+	char key[32];
+	int i,v,*pi;
+	size_t n;
+
+	for (i=0; i<10000;i++) {
+		sprintf(key,"key/%d",i);
+		if (iConcurrentDictionary.Add(d,key,&i) != 1)
+			Abort();
+	}
+	i = -1;
+	if (iConcurrentDictionary.Add(d,"key/5",&i) != 0 ||
+	    iConcurrentDictionary.Insert(d,"key/6",&i) != 0)
+		Abort();
+	if (!iConcurrentDictionary.CopyElement(d,"key/5",&v) || v != -1)
+		Abort();
+	pi = iConcurrentDictionary.GetElement(d,"key/6");
+	if (pi == NULL || *pi != 6)
+		Abort();
+	if (iConcurrentDictionary.Erase(d,"key/7") != 1 ||
+	    iConcurrentDictionary.Contains(d,"key/7") ||
+	    iConcurrentDictionary.Replace(d,"key/7",&i) != CONTAINER_ERROR_NOTFOUND)
+		Abort();
+	if (iConcurrentDictionary.Size(d) != 9999)
+		Abort();
+	/* The iterator returns copies of the values */
+	n = 0;
+	it = iConcurrentDictionary.NewIterator(d);
+	for (pi = it->GetFirst(it); pi; pi = it->GetNext(it)) {
+		if (*pi == 100)
+			it->Replace(it,NULL,1);
+		n++;
+	}
+	iConcurrentDictionary.DeleteIterator(it);
+	if (n != 9999 || iConcurrentDictionary.Contains(d,"key/100"))
+		Abort();
+	d1 = iConcurrentDictionary.Copy(d);
+	if (!iConcurrentDictionary.Equal(d,d1))
+		Abort();
+	iConcurrentDictionary.Finalize(d1);
+	d1 = iConcurrentDictionary.Freeze(d);
+	if (iFrozenDictionary.Size(d1) != 9998 || !iConcurrentDictionary.Equal(d,d1))
+		Abort();
+	iFrozenDictionary.Finalize(d1);
+	iConcurrentDictionary.Clear(d);
+	if (iConcurrentDictionary.Size(d) != 0)
+		Abort();
+	iConcurrentDictionary.Finalize(d);
+#ifdef UNIX
+	{
+		/* The debug allocator keeps statistics without a lock */
+		static ContainerAllocator plain = { malloc,free,realloc,calloc };
+		pthread_t threads[4];
+
+		d = iConcurrentDictionary.CreateWithAllocator(sizeof(int),0,&plain);
+		for (i=0; i<4;i++)
+			pthread_create(&threads[i],NULL,ConcurrentWorker,d);
+		for (i=0; i<4;i++)
+			pthread_join(threads[i],NULL);
+		if (iConcurrentDictionary.Size(d) != 4*2500)
+			Abort();
+		iConcurrentDictionary.Finalize(d);
+	}
+#endif
+	return 0;
+}
+
+
+static int TestHashFunctions(void)
+{
+	Dictionary *d;
+	WDictionary *wd;
+	HashTable *ht;
+	static char keys[200][40];
+	char key[80];
+	wchar_t wkey[40];
+	uint64_t h[64];
+	size_t klen;
+	int i,j,*pi;
+
+	/* Each length takes a different path through the loads of Hash64 */
+	memset(key,'a',sizeof(key));
+	for (i=0; i<64;i++) {
+		h[i] = iHashFunctions.Hash64(key,i,0);
+		for (j=0; j<i;j++)
+			if (h[j] == h[i])
+				Abort();
+	}
+	if (iHashFunctions.Hash64(key,20,1) == h[20])
+		Abort();
+	klen = (size_t)-1;
+	h[0] = iHashFunctions.GeneralWy("http://example.com/",&klen);
+	if (klen != 19 || (size_t)h[0] != iHashFunctions.Wy("http://example.com/"))
+		Abort();
+	klen = (size_t)-1;
+	h[0] = iHashFunctions.GeneralMurmur("http://example.com/",&klen);
+	if (klen != 19 || (size_t)h[0] != iHashFunctions.Murmur("http://example.com/"))
+		Abort();
+
+	d = iDictionary.Create(sizeof(int),0);
+	iDictionary.SetHashFunction(d,iHashFunctions.Wy);
+	for (i=0; i<5000;i++) {
+		sprintf(key,"http://www.example.com/index/%d.html",i);
+		iDictionary.Add(d,key,&i);
+	}
+	/* Changing the function rehashes all the keys */
+	iDictionary.SetHashFunction(d,iHashFunctions.Murmur);
+	pi = iDictionary.GetElement(d,"http://www.example.com/index/4321.html");
+	if (pi == NULL || *pi != 4321 || iDictionary.Size(d) != 5000)
+		Abort();
+	iDictionary.Finalize(d);
+
+	d = iFlatDictionary.Create(sizeof(int),0);
+	iFlatDictionary.SetHashFunction(d,iHashFunctions.Murmur);
+	for (i=0; i<5000;i++) {
+		sprintf(key,"k%d",i);
+		iFlatDictionary.Add(d,key,&i);
+	}
+	pi = iFlatDictionary.GetElement(d,"k77");
+	if (pi == NULL || *pi != 77)
+		Abort();
+	iFlatDictionary.Finalize(d);
+
+	wd = iWDictionary.Create(sizeof(int),0);
+	iWDictionary.SetHashFunction(wd,iHashFunctions.WWy);
+	for (i=0; i<1000;i++) {
+		swprintf(wkey,40,L"wkey/%d",i);
+		iWDictionary.Add(wd,wkey,&i);
+	}
+	pi = iWDictionary.GetElement(wd,L"wkey/999");
+	if (pi == NULL || *pi != 999)
+		Abort();
+	iWDictionary.Finalize(wd);
+
+	ht = iHashTable.Create(sizeof(int));
+	iHashTable.SetHashFunction(ht,iHashFunctions.GeneralWy);
+	for (i=0; i<200;i++) {
+		sprintf(keys[i],"/usr/share/doc/%d",i);
+		iHashTable.Add(ht,keys[i],strlen(keys[i]),&i);
+	}
+	pi = iHashTable.GetElement(ht,"/usr/share/doc/150",18);
+	if (pi == NULL || *pi != 150)
+		Abort();
+	iHashTable.Finalize(ht);
+	return 0;
+}
+
+
+/* All keys collide: the chains go to the guard tree */
+static size_t ConstantHash(const char *key)
+{
+	return 42;
+}
+
+static size_t WConstantHash(const wchar_t *key)
+{
+	return 42;
+}
+
+static int TestSeededDictionary(void)
+{
+	Dictionary *d,*d1,*d2;
+	WDictionary *wd;
+	HashTable *ht;
+	Iterator *it;
+	strCollection *sc;
+	static char keys[500][24];
+	char key[32];
+	wchar_t wkey[32];
+	int i,*pi;
+	size_t n;
+
+	if (iHashFunctions.RandomSeed() == 0)
+		Abort();
+	d1 = iDictionary.Create(sizeof(int),0);
+	d2 = iDictionary.Create(sizeof(int),0);
+	for (i=0; i<3000;i++) {
+		sprintf(key,"key/%d",i);
+		iDictionary.Add(d1,key,&i);
+		iDictionary.Add(d2,key,&i);
+		if (i == 1000) {
+			/* Existing keys are hashed again */
+			if (iDictionary.SetSeed(d1,0) != 1 || iDictionary.SetSeed(d2,12345) != 1)
+				Abort();
+		}
+	}
+	pi = iDictionary.GetElement(d1,"key/77");
+	if (pi == NULL || *pi != 77 || !iDictionary.Contains(d2,"key/2999"))
+		Abort();
+	/* Equal compares the contents whatever the seeds */
+	if (!iDictionary.Equal(d1,d2))
+		Abort();
+	iDictionary.Finalize(d2);
+
+	d = iDictionary.Create(sizeof(int),0);
+	iDictionary.SetHashFunction(d,ConstantHash);
+	for (i=0; i<2000;i++) {
+		sprintf(key,"key/%d",i);
+		if (iDictionary.Add(d,key,&i) != 1)
+			Abort();
+	}
+	i = -1;
+	if (iDictionary.Add(d,"key/1500",&i) != 0)
+		Abort();
+	pi = iDictionary.GetElement(d,"key/1500");
+	if (pi == NULL || *pi != -1 || iDictionary.Contains(d,"key/2000"))
+		Abort();
+	for (i=0; i<2000;i += 2) {
+		sprintf(key,"key/%d",i);
+		if (iDictionary.Erase(d,key) != 1)
+			Abort();
+	}
+	if (iDictionary.Erase(d,"key/0") != CONTAINER_ERROR_NOTFOUND ||
+	    iDictionary.Size(d) != 1000)
+		Abort();
+	n = 0;
+	it = iDictionary.NewIterator(d);
+	for (pi = it->GetFirst(it); pi; pi = it->GetNext(it))
+		n++;
+	iDictionary.DeleteIterator(it);
+	if (n != 1000)
+		Abort();
+	d2 = iDictionary.Copy(d);
+	if (!iDictionary.Equal(d,d2))
+		Abort();
+	sc = iDictionary.GetKeys(d2);
+	if (sc == NULL || istrCollection.Size(sc) != iDictionary.Size(d2))
+		Abort();
+	istrCollection.Finalize(sc);
+	iDictionary.Finalize(d2);
+	/* A seed spreads the keys again */
+	iDictionary.SetSeed(d,0);
+	pi = iDictionary.GetElement(d,"key/1999");
+	if (pi == NULL || *pi != 1999)
+		Abort();
+	iDictionary.SetHashFunction(d,ConstantHash);
+	iDictionary.Clear(d);
+	for (i=0; i<100;i++) {
+		sprintf(key,"again/%d",i);
+		iDictionary.Add(d,key,&i);
+	}
+	if (!iDictionary.Contains(d,"again/99") || iDictionary.Size(d) != 100)
+		Abort();
+	iDictionary.Finalize(d);
+	iDictionary.Finalize(d1);
+
+	wd = iWDictionary.Create(sizeof(int),0);
+	iWDictionary.SetHashFunction(wd,WConstantHash);
+	for (i=0; i<300;i++) {
+		swprintf(wkey,32,L"wkey/%d",i);
+		iWDictionary.Add(wd,wkey,&i);
+	}
+	iWDictionary.Erase(wd,L"wkey/10");
+	pi = iWDictionary.GetElement(wd,L"wkey/299");
+	if (pi == NULL || *pi != 299 || iWDictionary.Contains(wd,L"wkey/10"))
+		Abort();
+	iWDictionary.SetSeed(wd,0);
+	pi = iWDictionary.GetElement(wd,L"wkey/11");
+	if (pi == NULL || *pi != 11 || iWDictionary.Size(wd) != 299)
+		Abort();
+	iWDictionary.Finalize(wd);
+
+	d = iFlatDictionary.Create(sizeof(int),0);
+	for (i=0; i<1000;i++) {
+		sprintf(key,"k%d",i);
+		iFlatDictionary.Add(d,key,&i);
+	}
+	iFlatDictionary.SetSeed(d,0);
+	pi = iFlatDictionary.GetElement(d,"k500");
+	if (pi == NULL || *pi != 500)
+		Abort();
+	iFlatDictionary.Finalize(d);
+
+	d = iConcurrentDictionary.Create(sizeof(int),0);
+	for (i=0; i<1000;i++) {
+		sprintf(key,"k%d",i);
+		iConcurrentDictionary.Add(d,key,&i);
+	}
+	iConcurrentDictionary.SetSeed(d,0);
+	pi = iConcurrentDictionary.GetElement(d,"k500");
+	if (pi == NULL || *pi != 500)
+		Abort();
+	iConcurrentDictionary.Finalize(d);
+
+	ht = iHashTable.Create(sizeof(int));
+	for (i=0; i<500;i++) {
+		sprintf(keys[i],"/var/lib/%d",i);
+		iHashTable.Add(ht,keys[i],strlen(keys[i]),&i);
+	}
+	iHashTable.SetSeed(ht,0);
+	pi = iHashTable.GetElement(ht,"/var/lib/321",12);
+	if (pi == NULL || *pi != 321)
+		Abort();
+	iHashTable.Finalize(ht);
+	return 0;
+}
+
+
+
+static uint64_t ConstantGeneralHash(const char *key,size_t *klen)
+{
+	if (*klen == (size_t)-1)
+		*klen = strlen(key);
+	return 7;
+}
+
+static void *SumValues(Pool *p,const void *key,size_t klen,const void *v1,const void *v2,const void *data)
+{
+	static int sum;
+	sum = *(const int *)v1 + *(const int *)v2;
+	return &sum;
+}
+
+static int TestFlatHashTable(void)
+{
+	HashTable *ht,*ht1,*ht2;
+	Iterator *it;
+	static unsigned char keys[20000][12];
+	static size_t klens[20000];
+	const void *pkeys[3];
+	void *results[3];
+	FILE *f;
+	int i,*pi;
+	size_t n;
+
+	ht = iFlatHashTable.Create(sizeof(int));
+	/* Binary keys of different lengths, some with zero bytes */
+	for (i=0; i<20000;i++) {
+		klens[i] = 4 + i%8;
+		memset(keys[i],0,sizeof(keys[0]));
+		memcpy(keys[i]+(i&1),&i,sizeof(int));
+		keys[i][klens[i]-1] = (unsigned char)klens[i];
+		if (iFlatHashTable.Add(ht,keys[i],klens[i],&i) != 1)
+			Abort();
+	}
+	i = -1;
+	if (iFlatHashTable.Add(ht,keys[5],klens[5],&i) != 0 ||
+	    iFlatHashTable.Size(ht) != 20000)
+		Abort();
+	pi = iFlatHashTable.GetElement(ht,keys[4],klens[4]);
+	if (pi == NULL || *pi != 4 || iFlatHashTable.Replace(ht,keys[4],klens[4],&i) != 1 || *pi != -1)
+		Abort();
+	/* Erasing shifts back the following entries */
+	for (i=0; i<20000;i += 2) {
+		if (iFlatHashTable.Erase(ht,keys[i],klens[i]) != 1)
+			Abort();
+	}
+	for (i=1; i<20000;i += 2) {
+		pi = iFlatHashTable.GetElement(ht,keys[i],klens[i]);
+		if (pi == NULL || *pi != i || iFlatHashTable.Contains(ht,keys[i-1],klens[i-1]))
+			Abort();
+	}
+	pkeys[0] = keys[1]; pkeys[1] = keys[2]; pkeys[2] = keys[3];
+	if (iFlatHashTable.GetElements(ht,3,pkeys,klens+1,results) != 2 ||
+	    results[1] != NULL || *(int *)results[2] != 3)
+		Abort();
+	/* Erasing with the iterator sees every entry once */
+	n = 0;
+	it = iFlatHashTable.NewIterator(ht);
+	for (pi = it->GetFirst(it); pi; pi = it->GetNext(it)) {
+		if (*pi % 4 == 1)
+			it->Replace(it,NULL,1);
+		n++;
+	}
+	iFlatHashTable.DeleteIterator(it);
+	if (n != 10000 || iFlatHashTable.Size(ht) != 5000 ||
+	    iFlatHashTable.Contains(ht,keys[1],klens[1]) || !iFlatHashTable.Contains(ht,keys[3],klens[3]))
+		Abort();
+
+	/* Merge with a chained table: values of common keys are added */
+	ht1 = iHashTable.Create(sizeof(int));
+	for (i=3; i<100;i += 4)
+		iHashTable.Add(ht1,keys[i],klens[i],&i);
+	iHashTable.Add(ht1,keys[0],klens[0],&i);
+	ht2 = iFlatHashTable.Merge(NULL,ht1,ht,SumValues,NULL);
+	pi = iFlatHashTable.GetElement(ht2,keys[7],klens[7]);
+	if (ht2 == NULL || iFlatHashTable.Size(ht2) != 5001 || pi == NULL || *pi != 14 ||
+	    !iFlatHashTable.Contains(ht2,keys[0],klens[0]))
+		Abort();
+	iFlatHashTable.Finalize(ht2);
+	iHashTable.Finalize(ht1);
+	ht2 = iFlatHashTable.Copy(ht,NULL);
+	if (iFlatHashTable.Size(ht2) != 5000 || *(int *)iFlatHashTable.GetElement(ht2,keys[11],klens[11]) != 11)
+		Abort();
+	iFlatHashTable.Finalize(ht2);
+
+	f = tmpfile();
+	if (f == NULL || iFlatHashTable.Save(ht,f,NULL,NULL) < 0)
+		Abort();
+	rewind(f);
+	ht2 = iFlatHashTable.Load(f,NULL,NULL);
+	fclose(f);
+	if (ht2 == NULL || iFlatHashTable.Size(ht2) != 5000 ||
+	    *(int *)iFlatHashTable.GetElement(ht2,keys[19999],klens[19999]) != 19999)
+		Abort();
+	iFlatHashTable.Finalize(ht2);
+	iFlatHashTable.Finalize(ht);
+
+	/* All keys collide: the probes are long but everything is found */
+	ht = iFlatHashTable.Create(sizeof(int));
+	iFlatHashTable.SetHashFunction(ht,ConstantGeneralHash);
+	for (i=0; i<300;i++)
+		iFlatHashTable.Add(ht,keys[i],klens[i],&i);
+	iFlatHashTable.Erase(ht,keys[0],klens[0]);
+	pi = iFlatHashTable.GetElement(ht,keys[299],klens[299]);
+	if (pi == NULL || *pi != 299 || iFlatHashTable.Size(ht) != 299)
+		Abort();
+	iFlatHashTable.SetSeed(ht,0);
+	pi = iFlatHashTable.GetElement(ht,keys[150],klens[150]);
+	if (pi == NULL || *pi != 150)
+		Abort();
+	iFlatHashTable.Clear(ht);
+	if (iFlatHashTable.Size(ht) != 0 || iFlatHashTable.Contains(ht,keys[1],klens[1]))
+		Abort();
+	iFlatHashTable.Finalize(ht);
+	return 0;
+}
+
+/* Reserve, ShrinkToFit and the automatic shrinking of Erase, with both
+   implementations of the hash table */
+static int TestHashTableCapacity(HashTableInterface *intf)
+{
+	HashTable *ht;
+	static int keys[20000];
+	int i,*pi;
+	size_t peak,reserved;
+
+	for (i=0; i<20000;i++)
+		keys[i] = i*7;
+	ht = intf->Create(sizeof(int));
+	if (intf->Reserve(ht,20000) != 1)
+		Abort();
+	reserved = intf->Sizeof(ht);
+	for (i=0; i<20000;i++)
+		intf->Add(ht,&keys[i],sizeof(int),&i);
+	peak = intf->Sizeof(ht);
+	if (intf->Size(ht) != 20000)
+		Abort();
+	/* Erase doesn't shrink a reserved table */
+	for (i=0; i<19900;i++)
+		intf->Erase(ht,&keys[i],sizeof(int));
+	if (intf->Sizeof(ht) < reserved)
+		Abort();
+	if (intf->ShrinkToFit(ht) != 1 || intf->Sizeof(ht) > peak/20)
+		Abort();
+	for (i=0; i<20000;i++) {
+		pi = intf->GetElement(ht,&keys[i],sizeof(int));
+		if ((i < 19900) != (pi == NULL) || (pi && *pi != i))
+			Abort();
+	}
+	intf->Finalize(ht);
+
+	/* Without Reserve erasing most entries shrinks the table, and it
+	   grows back */
+	ht = intf->Create(sizeof(int));
+	for (i=0; i<20000;i++)
+		intf->Add(ht,&keys[i],sizeof(int),&i);
+	peak = intf->Sizeof(ht);
+	pi = intf->GetElement(ht,&keys[19999],sizeof(int));
+	for (i=0; i<19900;i++)
+		if (intf->Erase(ht,&keys[i],sizeof(int)) != 1)
+			Abort();
+	if (intf->Erase(ht,&keys[0],sizeof(int)) != 0 || intf->Sizeof(ht) > peak/10)
+		Abort();
+	/* The entries of iHashTable don't move when it shrinks */
+	if (intf == &iHashTable && intf->GetElement(ht,&keys[19999],sizeof(int)) != pi)
+		Abort();
+	for (i=0; i<19900;i++)
+		intf->Add(ht,&keys[i],sizeof(int),&i);
+	for (i=0; i<20000;i++) {
+		pi = intf->GetElement(ht,&keys[i],sizeof(int));
+		if (pi == NULL || *pi != i)
+			Abort();
+	}
+	if (intf->Clear(ht) != 1 || intf->Size(ht) != 0 || intf->Sizeof(ht) > peak/10)
+		Abort();
+	intf->Finalize(ht);
+	return 1;
+}
+
+static int SaveInt(const void *element,void *arg,FILE *f)
+{
+	return fprintf(f,"%d;",*(const int *)element) > 0;
+}
+
+static int ReadInt(void *element,void *arg,FILE *f)
+{
+	return fscanf(f,"%d;",(int *)element) == 1;
+}
+
+/* Two tables saved one after the other in the same file: the first one
+   is larger than the blocks of Save and Load */
+static int TestHashTableSaveLoad(HashTableInterface *intf)
+{
+	HashTable *ht,*small,*ht1,*ht2;
+	unsigned char *keys = malloc(70000*16);
+	size_t klen;
+	int i,*pi;
+	FILE *f;
+
+	ht = intf->Create(sizeof(int));
+	small = intf->Create(sizeof(int));
+	for (i=0; i<70000;i++) {
+		memset(keys+i*16,0xA5,16);
+		memcpy(keys+i*16,&i,sizeof(int));
+		intf->Add(ht,keys+i*16,5+i%11,&i);
+		if (i < 10)
+			intf->Add(small,keys+i*16,5+i%11,&i);
+	}
+	f = tmpfile();
+	if (f == NULL || intf->Save(ht,f,NULL,NULL) < 0 || intf->Save(small,f,NULL,NULL) < 0 ||
+	    intf->Save(small,f,SaveInt,NULL) < 0)
+		Abort();
+	rewind(f);
+	ht1 = intf->Load(f,NULL,NULL);
+	ht2 = intf->Load(f,NULL,NULL);
+	if (ht1 == NULL || ht2 == NULL || intf->Size(ht1) != 70000 || intf->Size(ht2) != 10)
+		Abort();
+	intf->Finalize(ht2);
+	ht2 = intf->Load(f,ReadInt,NULL);
+	fclose(f);
+	if (ht2 == NULL || intf->Size(ht2) != 10 ||
+	    *(int *)intf->GetElement(ht2,keys+9*16,5+9%11) != 9)
+		Abort();
+	intf->Finalize(ht2);
+	intf->Finalize(small);
+	intf->Finalize(ht);
+	/* The loaded keys belong to the table */
+	memset(keys,0,70000*16);
+	for (i=0; i<70000;i++) {
+		unsigned char key[16];
+		memset(key,0xA5,16);
+		memcpy(key,&i,sizeof(int));
+		klen = 5+i%11;
+		pi = intf->GetElement(ht1,key,klen);
+		if (pi == NULL || *pi != i)
+			Abort();
+	}
+	free(keys);
+	intf->Finalize(ht1);
+	return 1;
+}
+
+#ifdef UNIX
+static int RCUWriterDone;
+
+static int CheckRCUEntry(void *key,size_t klen,void *val,void *arg)
+{
+	if (klen != sizeof(int) || memcmp(key,val,sizeof(int)))
+		Abort();
+	(*(size_t *)arg)++;
+	return 1;
+}
+
+/* Keys 0 to 999 are always in the table, and every value is its key:
+   the readers check them while the writer changes the table. The values
+   are copied by CopyElement and CopyElements, or read in Apply and in an
+   iteration, since the pointers returned by GetElement are freed once
+   the writer replaces them. */
+static void *RCUReaderThread(void *arg)
+{
+	HashTable *ht = arg;
+	Iterator *it;
+	int i,v,*pi,n = 0;
+	int keys[100],values[100];
+	const void *pkeys[100];
+	size_t count,klens[100];
+
+	for (i=0; i<100;i++) {
+		keys[i] = 10*i;
+		pkeys[i] = &keys[i];
+		klens[i] = sizeof(int);
+	}
+	while (!__atomic_load_n(&RCUWriterDone,__ATOMIC_ACQUIRE) || n < 10) {
+		for (i=0; i<1000;i++)
+			if (iRCUHashTable.CopyElement(ht,&i,sizeof(int),&v) != 1 || v != i)
+				Abort();
+		memset(values,-1,sizeof(values));
+		if (iRCUHashTable.CopyElements(ht,100,pkeys,klens,values,NULL) != 100)
+			Abort();
+		for (i=0; i<100;i++)
+			if (values[i] != keys[i])
+				Abort();
+		count = 0;
+		iRCUHashTable.Apply(ht,CheckRCUEntry,&count);
+		if (count < 1000)
+			Abort();
+		count = 0;
+		it = iRCUHashTable.NewIterator(ht);
+		for (pi = it->GetFirst(it); pi; pi = it->GetNext(it))
+			if (*pi >= 0 && *pi < 1000)
+				count++;
+		iRCUHashTable.DeleteIterator(it);
+		if (count != 1000)
+			Abort();
+		n++;
+	}
+	return NULL;
+}
+#endif
+
+static int TestRCUHashTable(void)
+{
+	HashTable *ht,*ht1;
+	Iterator *it;
+	int i,*pi,n;
+	const char *keys[3] = {"one","two","three"};
+	void *results[3];
+
+	ht = iRCUHashTable.Create(sizeof(int));
+	for (i=0; i<5000;i++)
+		if (iRCUHashTable.Add(ht,&i,sizeof(int),&i) != 1)
+			Abort();
+	n = -1;
+	i = 4999;
+	if (iRCUHashTable.Add(ht,&i,sizeof(int),&n) != 0 ||
+	    iRCUHashTable.Add(ht,&n,sizeof(int),&n) != 1 ||
+	    iRCUHashTable.Replace(ht,&n,sizeof(int),&i) != 1 ||
+	    *(int *)iRCUHashTable.GetElement(ht,&n,sizeof(int)) != 4999 ||
+	    iRCUHashTable.Erase(ht,&n,sizeof(int)) != 1 ||
+	    iRCUHashTable.Contains(ht,&n,sizeof(int)) ||
+	    iRCUHashTable.Size(ht) != 5000)
+		Abort();
+	/* Erasing from an iteration */
+	n = 0;
+	it = iRCUHashTable.NewIterator(ht);
+	for (pi = it->GetFirst(it); pi; pi = it->GetNext(it)) {
+		if (*pi & 1)
+			it->Replace(it,NULL,1);
+		n++;
+	}
+	iRCUHashTable.DeleteIterator(it);
+	if (n != 5000 || iRCUHashTable.Size(ht) != 2500)
+		Abort();
+	for (i=0; i<5000;i++) {
+		pi = iRCUHashTable.GetElement(ht,&i,sizeof(int));
+		if ((i & 1) != (pi == NULL) || (pi && *pi != i))
+			Abort();
+	}
+	i = 4998;
+	if (iRCUHashTable.SetSeed(ht,0) != 1 || iRCUHashTable.Size(ht) != 2500 ||
+	    !iRCUHashTable.Contains(ht,&i,sizeof(int)))
+		Abort();
+	ht1 = iRCUHashTable.Copy(ht,NULL);
+	if (ht1 == NULL || iRCUHashTable.Size(ht1) != 2500)
+		Abort();
+	iRCUHashTable.Finalize(ht1);
+	iRCUHashTable.Finalize(ht);
+
+	/* The keys are copied */
+	ht = iRCUHashTable.Create(sizeof(int));
+	for (i=0; i<3;i++) {
+		char *k = strdup(keys[i]);
+		iRCUHashTable.Add(ht,k,(size_t)-1,&i);
+		free(k);
+	}
+	if (iRCUHashTable.GetElements(ht,3,(const void **)keys,NULL,results) != 3 ||
+	    *(int *)results[2] != 2)
+		Abort();
+	iRCUHashTable.Finalize(ht);
+#ifdef UNIX
+	{
+		/* The debug allocator keeps statistics without a lock */
+		static ContainerAllocator plain = { malloc,free,realloc,calloc };
+		ContainerAllocator *save = CurrentAllocator;
+		pthread_t threads[4];
+		int round;
+
+		CurrentAllocator = &plain;
+		ht = iRCUHashTable.Create(sizeof(int));
+		CurrentAllocator = save;
+		for (i=0; i<1000;i++)
+			iRCUHashTable.Add(ht,&i,sizeof(int),&i);
+		RCUWriterDone = 0;
+		for (i=0; i<4;i++)
+			pthread_create(&threads[i],NULL,RCUReaderThread,ht);
+		/* Growth, shrinking, rehashing and replaced values */
+		for (round=0; round<5;round++) {
+			for (i=1000; i<5000;i++)
+				iRCUHashTable.Add(ht,&i,sizeof(int),&i);
+			for (i=0; i<1000;i+=3)
+				iRCUHashTable.Replace(ht,&i,sizeof(int),&i);
+			for (i=1000; i<5000;i++)
+				iRCUHashTable.Erase(ht,&i,sizeof(int));
+			if (round & 1)
+				iRCUHashTable.SetSeed(ht,0);
+		}
+		__atomic_store_n(&RCUWriterDone,1,__ATOMIC_RELEASE);
+		for (i=0; i<4;i++)
+			pthread_join(threads[i],NULL);
+		if (iRCUHashTable.Size(ht) != 1000)
+			Abort();
+		iRCUHashTable.Finalize(ht);
+	}
+#endif
+	return 1;
+}
+
+static void *MaxValue(Pool *p,const void *key,size_t klen,const void *v1,const void *v2,const void *data)
+{
+	return *(const int *)v1 > *(const int *)v2 ? (void *)v1 : (void *)v2;
+}
+
+/* Merges large enough to be split among threads, compared with the
+   expected values. Without a seed both tables hash alike; with a seed
+   in the overlay its keys are hashed again. */
+static int TestParallelMerge(void)
+{
+	static int keys[300000];
+	HashTable *base,*overlay,*res;
+	Pool *pool;
+	int i,seeded,*pi;
+
+#ifdef UNIX
+	setenv("CCL_THREADS","4",1);
+#endif
+	for (i=0; i<300000;i++)
+		keys[i] = i;
+	for (seeded=0; seeded<2;seeded++) {
+		base = iHashTable.Create(sizeof(int));
+		overlay = iHashTable.Create(sizeof(int));
+		if (seeded)
+			iHashTable.SetSeed(overlay,0);
+		for (i=0; i<200000;i++)
+			iHashTable.Add(base,&keys[i],sizeof(int),&i);
+		for (i=100000; i<300000;i++) {
+			int v = (i & 1) ? 1 : 3*i;
+			iHashTable.Add(overlay,&keys[i],sizeof(int),&v);
+		}
+		pool = iPool.Create(NULL);
+		res = iHashTable.Merge(pool,overlay,base,SumValues,NULL);
+		if (res == NULL || iHashTable.Size(res) != 300000)
+			Abort();
+		for (i=0; i<300000;i++) {
+			int v = (i & 1) ? 1 : 3*i;
+			pi = iHashTable.GetElement(res,&keys[i],sizeof(int));
+			if (pi == NULL || *pi != (i < 100000 ? i : i < 200000 ? i+v : v))
+				Abort();
+		}
+		iHashTable.SetFlags(base,HASHTABLE_THREADSAFE_MERGER);
+		res = iHashTable.Merge(pool,overlay,base,MaxValue,NULL);
+		if (res == NULL || iHashTable.Size(res) != 300000)
+			Abort();
+		for (i=0; i<300000;i++) {
+			int v = (i & 1) ? 1 : 3*i;
+			pi = iHashTable.GetElement(res,&keys[i],sizeof(int));
+			if (pi == NULL || *pi != (i < 100000 ? i : i < 200000 && i > v ? i : v))
+				Abort();
+		}
+		res = iHashTable.Overlay(pool,overlay,base);
+		pi = iHashTable.GetElement(res,&keys[150001],sizeof(int));
+		if (res == NULL || iHashTable.Size(res) != 300000 || pi == NULL || *pi != 1)
+			Abort();
+		iPool.Finalize(pool);
+		iHashTable.Finalize(overlay);
+		iHashTable.Finalize(base);
+	}
+#ifdef UNIX
+	unsetenv("CCL_THREADS");
+#endif
+	return 1;
+}
+
+/* The histograms add up to the entries and to the slots */
+static void CheckStatistics(const HashStatistics *st,size_t count,size_t keyBytes)
+{
+	size_t i,entries = 0,slots = 0;
+
+	for (i=0; i<HASH_STATISTICS_HISTOGRAM;i++) {
+		entries += st->ProbeLength[i];
+		slots += st->Occupancy[i];
+	}
+	if (st->Count != count || entries != count || slots != st->Slots ||
+	    st->KeyBytes != keyBytes || st->ValueBytes != count*sizeof(int) ||
+	    st->MetadataBytes == 0 || (count && (st->MaxProbeLength < 1 || st->MeanProbeLength < 1.0 ||
+	    st->MeanProbeLength > (double)st->MaxProbeLength)))
+		Abort();
+}
+
+static int TestHashStatistics(void)
+{
+	DictionaryInterface *dicts[3] = {&iDictionary,&iFlatDictionary,&iConcurrentDictionary};
+	HashTableInterface *tables[3] = {&iHashTable,&iFlatHashTable,&iRCUHashTable};
+	static int keys[5000];
+	HashStatistics st;
+	Dictionary *d,*frozen;
+	WDictionary *wd;
+	HashTable *ht;
+	char key[32];
+	wchar_t wkey[32];
+	size_t keyBytes = 0;
+	int i,j;
+
+	for (j=0; j<3;j++) {
+		d = dicts[j]->Create(sizeof(int),0);
+		keyBytes = 0;
+		for (i=0; i<5000;i++) {
+			sprintf(key,"key%d",i);
+			dicts[j]->Add(d,key,&i);
+			keyBytes += strlen(key)+1;
+		}
+		if (dicts[j]->GetStatistics(d,&st) != 1 || st.Resizes == 0)
+			Abort();
+		CheckStatistics(&st,5000,keyBytes);
+		if (j == 0) {
+			frozen = iDictionary.Freeze(d);
+			if (iFrozenDictionary.GetStatistics(frozen,&st) != 1 ||
+			    st.MaxProbeLength != 1 || st.ProbeLength[0] != 5000)
+				Abort();
+			CheckStatistics(&st,5000,keyBytes);
+			iFrozenDictionary.Finalize(frozen);
+		}
+		dicts[j]->Finalize(d);
+	}
+	wd = iWDictionary.Create(sizeof(int),0);
+	keyBytes = 0;
+	for (i=0; i<1000;i++) {
+		swprintf(wkey,32,L"key%d",i);
+		iWDictionary.Add(wd,wkey,&i);
+		keyBytes += (wcslen(wkey)+1)*sizeof(wchar_t);
+	}
+	if (iWDictionary.GetStatistics(wd,&st) != 1)
+		Abort();
+	CheckStatistics(&st,1000,keyBytes);
+	iWDictionary.Finalize(wd);
+
+	for (j=0; j<3;j++) {
+		ht = tables[j]->Create(sizeof(int));
+		for (i=0; i<5000;i++) {
+			keys[i] = i;
+			tables[j]->Add(ht,&keys[i],sizeof(int),&i);
+		}
+		if (tables[j]->GetStatistics(ht,&st) != 1 || st.Resizes == 0 ||
+		    st.LoadFactor <= 0 || st.LoadFactor > 1.0)
+			Abort();
+		CheckStatistics(&st,5000,5000*sizeof(int));
+		tables[j]->Clear(ht);
+		if (tables[j]->GetStatistics(ht,&st) != 1 || st.UsedSlots != 0)
+			Abort();
+		CheckStatistics(&st,0,0);
+		tables[j]->Finalize(ht);
+	}
+	return 1;
+}
+
+static int SumMapValues(intptr_t *key,double *data,void *arg)
+{
+	*(double *)arg += *data;
+	return 1;
+}
+
+static int TestHashMap(void)
+{
+	intptrdoubleMap *m,*copy;
+	uint64uint64Map *u;
+	HashStatistics st;
+	Iterator *it;
+	double *pd,d,sum = 0;
+	intptr_t i;
+	uint64_t v;
+	size_t n = 0;
+
+	m = iintptrdoubleMap.Create(0);
+	for (i=-50000; i<50000;i++) {
+		if (iintptrdoubleMap.Add(m,i*3,(double)i) != 1)
+			Abort();
+	}
+	if (iintptrdoubleMap.Size(m) != 100000 || iintptrdoubleMap.Add(m,0,1.5) != 0)
+		Abort();
+	for (i=-50000; i<50000;i++) {
+		pd = iintptrdoubleMap.GetElement(m,i*3);
+		if (pd == NULL || *pd != (double)i || iintptrdoubleMap.Contains(m,i*3+1))
+			Abort();
+	}
+	if (iintptrdoubleMap.Insert(m,3,7.0) != 0 || iintptrdoubleMap.Replace(m,4,1.0) != 0 ||
+	    iintptrdoubleMap.Insert(m,4,8.0) != 1 || iintptrdoubleMap.CopyElement(m,3,&d) != 1 || d != 7.0)
+		Abort();
+	iintptrdoubleMap.Erase(m,4);
+	iintptrdoubleMap.Replace(m,3,1.0);
+	/* Erase every other key: the entries that follow are moved back */
+	for (i=-50000; i<50000;i += 2) {
+		if (iintptrdoubleMap.Erase(m,i*3) != 1)
+			Abort();
+	}
+	if (iintptrdoubleMap.Size(m) != 50000 || iintptrdoubleMap.Erase(m,0) != 0)
+		Abort();
+	for (i=-50000; i<50000;i++) {
+		if (iintptrdoubleMap.Contains(m,i*3) != (i & 1))
+			Abort();
+	}
+	it = iintptrdoubleMap.NewIterator(m);
+	for (pd = it->GetFirst(it); pd; pd = it->GetNext(it)) {
+		if (*pd != (double)*iintptrdoubleMap.GetKey(it)/3)
+			Abort();
+		n++;
+	}
+	iintptrdoubleMap.DeleteIterator(it);
+	iintptrdoubleMap.Apply(m,SumMapValues,&sum);
+	if (n != 50000 || sum != 0.0)
+		Abort();
+	copy = iintptrdoubleMap.Copy(m);
+	iintptrdoubleMap.Clear(m);
+	if (iintptrdoubleMap.Size(m) != 0 || iintptrdoubleMap.GetElement(copy,-2997) == NULL)
+		Abort();
+	if (iintptrdoubleMap.GetStatistics(copy,&st) != 1 || st.Count != 50000 ||
+	    st.KeyBytes != 50000*sizeof(intptr_t) || st.ValueBytes != 50000*sizeof(double) ||
+	    st.Resizes == 0 || st.MaxProbeLength < 1)
+		Abort();
+	iintptrdoubleMap.Finalize(copy);
+	iintptrdoubleMap.Finalize(m);
+
+	/* Keys that differ only in their high bits */
+	u = iuint64uint64Map.Create(1000);
+	iuint64uint64Map.Reserve(u,20000);
+	for (v=0; v<20000;v++)
+		iuint64uint64Map.Insert(u,v << 40,v);
+	if (iuint64uint64Map.GetStatistics(u,&st) != 1 || st.Resizes != 1 || st.MeanProbeLength > 2.0)
+		Abort();
+	for (v=0; v<19990;v++)
+		iuint64uint64Map.Erase(u,v << 40);
+	iuint64uint64Map.ShrinkToFit(u);
+	if (iuint64uint64Map.Sizeof(u) > 1000 || *iuint64uint64Map.GetElement(u,19995ULL << 40) != 19995)
+		Abort();
+	iuint64uint64Map.SetFlags(u,CONTAINER_READONLY);
+	iuint64uint64Map.SetErrorFunction(u,iError.EmptyErrorFunction);
+	if (iuint64uint64Map.Add(u,1,1) != CONTAINER_ERROR_READONLY)
+		Abort();
+	iuint64uint64Map.SetFlags(u,0);
+	iuint64uint64Map.Finalize(u);
+	return 1;
+}
+
+static int TestHashTableBuildFrom(HashTableInterface *intf)
+{
+	static int keys[300000],values[300000];
+	static const void *pkeys[300000];
+	static size_t klens[300000];
+	const char *names[4] = {"one","two","three","two"};
+	ErrorFunction old;
+	HashTable *ht;
+	int i,*pi,extra = 300000;
+
+#ifdef UNIX
+	setenv("CCL_THREADS","4",1);
+#endif
+	/* The last 50000 keys repeat the first ones: the first value stays */
+	for (i=0; i<300000;i++) {
+		keys[i] = i % 250000;
+		values[i] = i;
+		pkeys[i] = &keys[i];
+		klens[i] = sizeof(int);
+	}
+	ht = intf->BuildFrom(sizeof(int),300000,pkeys,klens,values);
+	if (ht == NULL || intf->Size(ht) != 250000)
+		Abort();
+	for (i=0; i<250000;i++) {
+		pi = intf->GetElement(ht,&i,sizeof(int));
+		if (pi == NULL || *pi != i)
+			Abort();
+	}
+	if (intf->Add(ht,&extra,sizeof(int),&extra) != 1 || intf->Size(ht) != 250001)
+		Abort();
+	intf->Finalize(ht);
+	/* Zero terminated keys and no values */
+	ht = intf->BuildFrom(sizeof(int),4,(const void **)names,NULL,NULL);
+	pi = intf->GetElement(ht,"three",(size_t)-1);
+	if (ht == NULL || intf->Size(ht) != 3 || pi == NULL || *pi != 0)
+		Abort();
+	intf->Finalize(ht);
+	pkeys[10] = NULL;
+	old = iError.SetErrorFunction(iError.EmptyErrorFunction);
+	if (intf->BuildFrom(sizeof(int),300000,pkeys,klens,values) != NULL)
+		Abort();
+	iError.SetErrorFunction(old);
+#ifdef UNIX
+	unsetenv("CCL_THREADS");
+#endif
+	return 1;
+}
+
+static int SumIntegerKeys(void *key,size_t klen,void *data,void *arg)
+{
+	uint64_t k;
+
+	memcpy(&k,key,sizeof(k));
+	if (klen != sizeof(k) || (int)(k & 0xffffff) != *(int *)data)
+		return 0;
+	(*(size_t *)arg)++;
+	return 1;
+}
+
+static int TestHashTableIntegerKeys(void)
+{
+	HashTable *ht,*copy,*other,*res;
+	HashStatistics st;
+	ErrorFunction old;
+	Pool *pool;
+	FILE *f;
+	uint64_t k;
+	size_t n = 0;
+	int i,*pi;
+
+	ht = iHashTable.CreateIntegerKeys(sizeof(int));
+	/* IDs that differ only in their high bits. The keys are copied. */
+	for (i=0; i<100000;i++) {
+		k = ((uint64_t)i << 40) | (uint64_t)i;
+		if (iHashTable.AddInteger(ht,k,&i) != 1)
+			Abort();
+	}
+	k = 5;
+	old = iError.SetErrorFunction(iError.EmptyErrorFunction);
+	if (iHashTable.AddInteger(ht,(5ULL << 40) | 5,&i) != 0 || iHashTable.Add(ht,&k,4,&i) >= 0)
+		Abort();
+	iError.SetErrorFunction(old);
+	for (i=0; i<100000;i++) {
+		k = ((uint64_t)i << 40) | (uint64_t)i;
+		pi = iHashTable.GetElementInteger(ht,k);
+		if (pi == NULL || *pi != i || iHashTable.GetElement(ht,&k,sizeof(k)) != pi ||
+		    (i && iHashTable.GetElementInteger(ht,(uint64_t)i << 40) != NULL))
+			Abort();
+	}
+	if (iHashTable.Apply(ht,SumIntegerKeys,&n) != 1 || n != 100000)
+		Abort();
+	for (i=0; i<100000;i += 2) {
+		k = ((uint64_t)i << 40) | (uint64_t)i;
+		if ((i & 2 ? iHashTable.EraseInteger(ht,k) : iHashTable.Erase(ht,&k,sizeof(k))) != 1)
+			Abort();
+	}
+	iHashTable.SetSeed(ht,0);
+	copy = iHashTable.Copy(ht,NULL);
+	iHashTable.ShrinkToFit(ht);
+	other = iHashTable.CreateIntegerKeys(sizeof(int));
+	for (i=0; i<100000;i += 2)
+		iHashTable.AddInteger(other,((uint64_t)i << 40) | (uint64_t)i,&i);
+	pool = iPool.Create(NULL);
+	res = iHashTable.Overlay(pool,other,ht);
+	if (iHashTable.Size(ht) != 50000 || iHashTable.Size(copy) != 50000 || iHashTable.Size(res) != 100000)
+		Abort();
+	for (i=0; i<100000;i++) {
+		k = ((uint64_t)i << 40) | (uint64_t)i;
+		pi = iHashTable.GetElementInteger(res,k);
+		if (pi == NULL || *pi != i ||
+		    (iHashTable.GetElementInteger(ht,k) != NULL) != (i & 1) ||
+		    (iHashTable.GetElementInteger(copy,k) != NULL) != (i & 1))
+			Abort();
+	}
+	if (iHashTable.GetStatistics(copy,&st) != 1 || st.KeyBytes != 50000*sizeof(uint64_t) ||
+	    st.MetadataBytes + st.KeyBytes + st.ValueBytes != iHashTable.Sizeof(copy))
+		Abort();
+	/* The loaded table has integer keys too */
+	f = tmpfile();
+	if (f == NULL || iHashTable.Save(copy,f,NULL,NULL) < 0)
+		Abort();
+	rewind(f);
+	iHashTable.Finalize(other);
+	other = iHashTable.Load(f,NULL,NULL);
+	fclose(f);
+	if (other == NULL || iHashTable.Size(other) != 50000 || iHashTable.GetFlags(other) != iHashTable.GetFlags(copy) ||
+	    iHashTable.AddInteger(other,0,&i) != 1)
+		Abort();
+	for (i=1; i<100000;i += 2) {
+		k = ((uint64_t)i << 40) | (uint64_t)i;
+		pi = iHashTable.GetElementInteger(other,k);
+		if (pi == NULL || *pi != i)
+			Abort();
+	}
+	iPool.Finalize(pool);
+	iHashTable.Finalize(other);
+	iHashTable.Finalize(copy);
+	iHashTable.Finalize(ht);
+	old = iError.SetErrorFunction(iError.EmptyErrorFunction);
+	ht = iHashTable.Create(sizeof(int));
+	if (iFlatHashTable.CreateIntegerKeys(sizeof(int)) != NULL ||
+	    iHashTable.AddInteger(ht,1,&i) != CONTAINER_ERROR_BADARG)
+		Abort();
+	iHashTable.Finalize(ht);
+	iError.SetErrorFunction(old);
+	return 1;
+}
+
+/* Counts the visits of the keys below 10000, the ones that stay in
+   the table during the whole scan */
+static int CountScanned(void *key,size_t klen,void *data,void *arg)
+{
+	int k = *(int *)key;
+
+	if (klen != sizeof(int) || *(int *)data != k)
+		return 0;
+	if (k < 10000)
+		((int *)arg)[k]++;
+	return 1;
+}
+
+static int StopScan(void *key,size_t klen,void *data,void *arg)
+{
+	return 0;
+}
+
+static int TestHashTableScan(HashTableInterface *intf)
+{
+	static int keys[20000],seen[10000];
+	HashTable *ht = intf->Create(sizeof(int));
+	size_t cursor = 0;
+	int i,r,slice = 0;
+
+	for (i=0; i<20000;i++)
+		keys[i] = i;
+	for (i=0; i<10000;i++) {
+		intf->Add(ht,&keys[i],sizeof(int),&keys[i]);
+		seen[i] = 0;
+	}
+	if (intf->Scan(ht,&cursor,16,StopScan,NULL) != 1 || cursor != 0)
+		Abort();
+	/* The table grows, is reserved and shrinks between the slices */
+	while ((r = intf->Scan(ht,&cursor,16,CountScanned,seen)) == 1) {
+		slice++;
+		if (slice <= 200) {
+			for (i=10000+50*(slice-1); i<10000+50*slice;i++)
+				intf->Add(ht,&keys[i],sizeof(int),&keys[i]);
+		}
+		else if (slice <= 400) {
+			for (i=10000+50*(slice-201); i<10000+50*(slice-200);i++)
+				intf->Erase(ht,&keys[i],sizeof(int));
+		}
+		if (slice == 250)
+			intf->Reserve(ht,200000);
+		else if (slice == 300)
+			intf->ShrinkToFit(ht);
+	}
+	if (r != 0 || cursor != 0 || slice < 400 || intf->Size(ht) != 10000)
+		Abort();
+	for (i=0; i<10000;i++) {
+		if (seen[i] == 0)
+			Abort();
+	}
+	/* Without changes each key is visited once */
+	for (i=0; i<10000;i++)
+		seen[i] = 0;
+	while (intf->Scan(ht,&cursor,1000,CountScanned,seen) == 1)
+		;
+	for (i=0; i<10000;i++) {
+		if (seen[i] != 1)
+			Abort();
+	}
+	intf->Finalize(ht);
+	return 1;
+}
+
+static int TestHashTableCopyElements(HashTableInterface *intf)
+{
+	HashTable *ht = intf->Create(sizeof(int));
+	int keys[40],values[40],i,v;
+	const void *pkeys[40];
+	size_t klens[40];
+	unsigned char found[40];
+
+	for (i=0; i<40;i++) {
+		keys[i] = i;
+		pkeys[i] = &keys[i];
+		klens[i] = sizeof(int);
+		values[i] = -1;
+		if (i & 1) {
+			v = 100*i;
+			intf->Add(ht,&keys[i],sizeof(int),&v);
+		}
+	}
+	v = -1;
+	if (intf->CopyElement(ht,&keys[3],sizeof(int),&v) != 1 || v != 300 ||
+	    intf->CopyElement(ht,&keys[4],sizeof(int),&v) != 0 || v != 300)
+		Abort();
+	if (intf->CopyElements(ht,40,pkeys,klens,values,found) != 20)
+		Abort();
+	for (i=0; i<40;i++) {
+		if (found[i] != (i & 1) || values[i] != ((i & 1) ? 100*i : -1))
+			Abort();
+	}
+	intf->Finalize(ht);
+	return 1;
+}
+
+static int CompareSortKeys(const void *a,const void *b,CompareInfo *ci)
+{
+	int x,y;
+
+	memcpy(&x,a,sizeof(int));
+	memcpy(&y,b,sizeof(int));
+	return (x > y) - (x < y);
+}
+
+/* Sorts elements of the given width made of an int key followed by
+   bytes that depend on the key, in several orders */
+static int TestQsortExWidth(size_t w)
+{
+	static char buf[5000*24];
+	CompareInfo ci;
+	size_t n,i,j,sizes[4] = {5000,130,23,2};
+	long long sum,check;
+	int pattern,key,prev;
+	unsigned r = 1;
+
+	memset(&ci,0,sizeof(ci));
+	for (j = 0; j < 4; j++) {
+		n = sizes[j];
+		for (pattern = 0; pattern < 7; pattern++) {
+			sum = 0;
+			for (i = 0; i < n; i++) {
+				r = r*1103515245 + 12345;
+				switch (pattern) {
+				case 0: key = (int)(r >> 8); break;         /* Random */
+				case 1: key = (int)i; break;                /* Sorted */
+				case 2: key = (int)(n-i); break;            /* Reversed */
+				case 3: key = (int)(r >> 8) % 4; break;     /* Many duplicates */
+				case 4: key = (int)(i < n/2 ? i : n-i); break; /* Organ pipe */
+				case 5: key = (int)(i % 7 ? i : n-i); break;   /* Almost sorted */
+				default: key = 42; break;
+				}
+				memcpy(buf+i*w,&key,sizeof(int));
+				memset(buf+i*w+sizeof(int),(char)key,w-sizeof(int));
+				sum += key;
+			}
+			qsortEx(buf,n,w,CompareSortKeys,&ci);
+			check = 0;
+			for (i = 0; i < n; i++) {
+				memcpy(&key,buf+i*w,sizeof(int));
+				if ((i && key < prev) || (w > sizeof(int) && buf[i*w+w-1] != (char)key))
+					Abort();
+				check += key;
+				prev = key;
+			}
+			if (check != sum)
+				Abort();
+		}
+	}
+	return 1;
+}
+
+static int TestQsortEx(void)
+{
+	size_t widths[5] = {4,5,8,12,24};
+	int i;
+
+	for (i = 0; i < 5; i++)
+		TestQsortExWidth(widths[i]);
+	return 1;
+}
+
+/* Arrays of 300000 elements are sorted by 4 threads */
+static int TestSortParallel(void)
+{
+	Vector *v,*copy;
+	strCollection *sc;
+	ValArrayDouble *va;
+	double *pd;
+	int i,k,*p,*q;
+	unsigned r = 1;
+	char buf[32];
+
+#ifdef UNIX
+	setenv("CCL_THREADS","4",1);
+#endif
+	v = iVector.Create(sizeof(int),300000);
+	iVector.SetCompareFunction(v,CompareSortKeys);
+	for (i = 0; i < 300000; i++) {
+		r = r*1103515245 + 12345;
+		k = (int)(r >> 8) % 100000;
+		iVector.Add(v,&k);
+	}
+	copy = iVector.Copy(v);
+	if (iVector.SortParallel(v) != 1 || iVector.Sort(copy) != 1)
+		Abort();
+	p = (int *)iVector.GetData(v);
+	q = (int *)iVector.GetData(copy);
+	if (iVector.Size(v) != 300000 || memcmp(p,q,300000*sizeof(int)))
+		Abort();
+	iVector.Finalize(copy);
+	iVector.Finalize(v);
+
+	sc = istrCollection.Create(200000);
+	for (i = 0; i < 200000; i++) {
+		r = r*1103515245 + 12345;
+		sprintf(buf,"%u",r >> 4);
+		istrCollection.Add(sc,buf);
+	}
+	if (istrCollection.SortParallel(sc) != 1)
+		Abort();
+	for (i = 1; i < 200000; i++) {
+		if (strcmp(istrCollection.GetElement(sc,i-1),istrCollection.GetElement(sc,i)) > 0)
+			Abort();
+	}
+	istrCollection.Finalize(sc);
+
+	va = iValArrayDouble.Create(300000);
+	for (i = 0; i < 300000; i++) {
+		r = r*1103515245 + 12345;
+		iValArrayDouble.Add(va,(double)(r >> 8));
+	}
+	if (iValArrayDouble.SortParallel(va) != 1)
+		Abort();
+	pd = iValArrayDouble.GetData(va);
+	for (i = 1; i < 300000; i++) {
+		if (pd[i-1] > pd[i])
+			Abort();
+	}
+	iValArrayDouble.Finalize(va);
+	return 1;
+}
+
+typedef struct {
+	int id;
+	long long ll;
+	double d;
+	int seq;
+} KeyRecord;
+
+static int TestSortByKey(void)
+{
+	ValArrayInt *vi;
+	ValArrayDouble *vd;
+	ValArrayUInt *vu;
+	Vector *v;
+	KeyRecord rec,*pr;
+	int *pi,*ref,i,n;
+	double *pd;
+	unsigned *pu;
+	unsigned r = 7;
+	ErrorFunction old;
+
+	vi = iValArrayInt.Create(5000);
+	ref = malloc(5000*sizeof(int));
+	for (i = 0; i < 5000; i++) {
+		r = r*1103515245 + 12345;
+		ref[i] = (int)r;
+		iValArrayInt.Add(vi,ref[i]);
+	}
+	qsortEx(ref,5000,sizeof(int),CompareSortKeys,NULL);
+	if (iValArrayInt.Sort(vi) != 1)
+		Abort();
+	pi = iValArrayInt.GetData(vi);
+	if (memcmp(pi,ref,5000*sizeof(int)))
+		Abort();
+	/* Only the elements of the slice are sorted */
+	for (i = 0; i < 5000; i++)
+		pi[i] = 5000-i;
+	iValArrayInt.SetSlice(vi,1,2000,2);
+	iValArrayInt.Sort(vi);
+	iValArrayInt.ResetSlice(vi);
+	for (i = 0; i < 5000; i++) {
+		if (i&1 && i < 4000) {
+			if (pi[i] != 1000+i)
+				Abort();
+		}
+		else if (pi[i] != 5000-i)
+			Abort();
+	}
+	iValArrayInt.Finalize(vi);
+	free(ref);
+
+	vd = iValArrayDouble.Create(3000);
+	for (i = 0; i < 3000; i++) {
+		r = r*1103515245 + 12345;
+		iValArrayDouble.Add(vd,((int)r)/1000.0);
+	}
+	iValArrayDouble.Sort(vd);
+	pd = iValArrayDouble.GetData(vd);
+	for (i = 1; i < 3000; i++) {
+		if (pd[i-1] > pd[i])
+			Abort();
+	}
+	iValArrayDouble.Finalize(vd);
+
+	vu = iValArrayUInt.Create(3000);
+	for (i = 0; i < 3000; i++) {
+		r = r*1103515245 + 12345;
+		iValArrayUInt.Add(vu,r);
+	}
+	iValArrayUInt.Sort(vu);
+	pu = iValArrayUInt.GetData(vu);
+	for (i = 1; i < 3000; i++) {
+		if (pu[i-1] > pu[i])
+			Abort();
+	}
+	iValArrayUInt.Finalize(vu);
+
+	/* Records sorted by each key field, above and below RADIX_SORT_MIN */
+	for (n = 10; n <= 10000; n *= 1000) {
+		v = iVector.Create(sizeof(KeyRecord),n);
+		for (i = 0; i < n; i++) {
+			r = r*1103515245 + 12345;
+			rec.id = (int)(r >> 20) - 2048;
+			rec.ll = (long long)(int)r * 1000003LL;
+			rec.d = -rec.id / 3.0;
+			rec.seq = i;
+			iVector.Add(v,&rec);
+		}
+		if (iVector.SortByKey(v,offsetof(KeyRecord,id),sizeof(int),CCL_KEY_SIGNED) != 1)
+			Abort();
+		pr = (KeyRecord *)iVector.GetData(v);
+		for (i = 1; i < n; i++) {
+			if (pr[i-1].id > pr[i].id ||
+			    (pr[i-1].id == pr[i].id && pr[i-1].seq > pr[i].seq))
+				Abort();
+		}
+		iVector.SortByKey(v,offsetof(KeyRecord,ll),sizeof(long long),CCL_KEY_SIGNED);
+		for (i = 1; i < n; i++) {
+			if (pr[i-1].ll > pr[i].ll)
+				Abort();
+		}
+		iVector.SortByKey(v,offsetof(KeyRecord,d),sizeof(double),CCL_KEY_FLOAT);
+		for (i = 1; i < n; i++) {
+			if (pr[i-1].d > pr[i].d || pr[i-1].id < pr[i].id)
+				Abort();
+		}
+		iVector.Finalize(v);
+	}
+	v = iVector.Create(sizeof(KeyRecord),10);
+	old = iVector.SetErrorFunction(v,iError.EmptyErrorFunction);
+	if (iVector.SortByKey(v,sizeof(KeyRecord)-2,4,CCL_KEY_SIGNED) != CONTAINER_ERROR_BADARG ||
+	    iVector.SortByKey(v,0,2,CCL_KEY_FLOAT) != CONTAINER_ERROR_BADARG ||
+	    iVector.SortByKey(v,0,3,CCL_KEY_UNSIGNED) != CONTAINER_ERROR_BADARG)
+		Abort();
+	iVector.SetErrorFunction(v,old);
+	iVector.Finalize(v);
+	return 1;
+}
+
+typedef struct {
+	int key;
+	int seq;
+} StableRecord;
+
+static int CompareStableKeys(const void *a,const void *b,CompareInfo *ci)
+{
+	const StableRecord *x = a,*y = b;
+
+	return (x->key > y->key) - (x->key < y->key);
+}
+
+/* Sorted by key, and in their original order for equal keys */
+static int CheckStable(const StableRecord *r,size_t n)
+{
+	size_t i;
+
+	for (i = 1; i < n; i++) {
+		if (r[i-1].key > r[i].key ||
+		    (r[i-1].key == r[i].key && r[i-1].seq > r[i].seq))
+			return 0;
+	}
+	return 1;
+}
+
+static int StableKey(int pattern,int i,int n,unsigned *r)
+{
+	*r = *r*1103515245 + 12345;
+	switch (pattern) {
+	case 0: return (int)(*r >> 16) % 50;
+	case 1: return i/3;
+	case 2: return n-i;
+	case 3: return (n-i)/4;
+	default: return i < n/2 ? i : n-i;
+	}
+}
+
+/* Compares the first character only */
+static int CompareFirstChar(const void **a,const void **b,CompareInfo *ci)
+{
+	return **(const unsigned char **)a - **(const unsigned char **)b;
+}
+
+static int TestStableSort(void)
+{
+	static const int sizes[] = {1,5,70,3000};
+	StableRecord rec,*tab,*p;
+	Vector *v;
+	List *l;
+	Dlist *d;
+	ListElement *le;
+	DlistElement *de;
+	strCollection *sc;
+	unsigned r = 3;
+	int s,pattern,n,i;
+	char buf[16];
+
+	for (s = 0; s < 4; s++) {
+		n = sizes[s];
+		tab = malloc(n*sizeof(StableRecord));
+		for (pattern = 0; pattern < 5; pattern++) {
+			v = iVector.Create(sizeof(StableRecord),n);
+			l = iList.Create(sizeof(StableRecord));
+			d = iDlist.Create(sizeof(StableRecord));
+			iVector.SetCompareFunction(v,CompareStableKeys);
+			iList.SetCompareFunction(l,CompareStableKeys);
+			iDlist.SetCompareFunction(d,CompareStableKeys);
+			for (i = 0; i < n; i++) {
+				rec.key = StableKey(pattern,i,n,&r);
+				rec.seq = i;
+				iVector.Add(v,&rec);
+				iList.Add(l,&rec);
+				iDlist.Add(d,&rec);
+			}
+			if (iVector.StableSort(v) != 1 || iList.StableSort(l) != 1 ||
+			    iDlist.StableSort(d) != 1)
+				Abort();
+			if (!CheckStable((StableRecord *)iVector.GetData(v),n))
+				Abort();
+			for (i = 0, le = iList.FirstElement(l); le; le = iList.NextElement(le))
+				tab[i++] = *(StableRecord *)iList.GetElementData(le);
+			if (i != n || !CheckStable(tab,n) ||
+			    memcmp(tab,iVector.GetData(v),n*sizeof(StableRecord)))
+				Abort();
+			p = iList.Back(l);
+			if (p->seq != tab[n-1].seq)
+				Abort();
+			/* The Previous links are rebuilt */
+			for (i = n, de = iDlist.LastElement(d); de; de = iDlist.PreviousElement(de))
+				tab[--i] = *(StableRecord *)iDlist.GetElementData(de);
+			if (i != 0 || memcmp(tab,iVector.GetData(v),n*sizeof(StableRecord)))
+				Abort();
+			iVector.Finalize(v);
+			iList.Finalize(l);
+			iDlist.Finalize(d);
+		}
+		free(tab);
+	}
+
+	sc = istrCollection.Create(1000);
+	for (i = 0; i < 1000; i++) {
+		r = r*1103515245 + 12345;
+		sprintf(buf,"%c%d",'a' + (int)(r >> 16) % 26,i);
+		istrCollection.Add(sc,buf);
+	}
+	istrCollection.SetCompareFunction(sc,CompareFirstChar);
+	if (istrCollection.StableSort(sc) != 1)
+		Abort();
+	for (i = 1; i < 1000; i++) {
+		const char *a = istrCollection.GetElement(sc,i-1),*b = istrCollection.GetElement(sc,i);
+		if (a[0] > b[0] || (a[0] == b[0] && atoi(a+1) > atoi(b+1)))
+			Abort();
+	}
+	istrCollection.Finalize(sc);
+	return 1;
+}
+
+/* Number of occurrences of each value below 40 in an int vector */
+static void CountInts(const Vector *v,int *counts)
+{
+	const int *p = (const int *)iVector.GetData(v);
+	size_t i;
+
+	memset(counts,0,40*sizeof(int));
+	for (i = 0; i < iVector.Size(v); i++)
+		counts[p[i]]++;
+}
+
+static int IsSortedInts(const Vector *v)
+{
+	const int *p = (const int *)iVector.GetData(v);
+	size_t i;
+
+	for (i = 1; i < iVector.Size(v); i++) {
+		if (p[i-1] > p[i])
+			return 0;
+	}
+	return 1;
+}
+
+static int TestSortedVector(void)
+{
+	Vector *a,*b,*r;
+	int ca[40],cb[40],cr[40];
+	int i,k,*p,expected;
+	size_t n,lo,hi,first,last,idx;
+	unsigned rnd = 11;
+	ErrorFunction old;
+
+	a = iVector.Create(sizeof(int),100);
+	b = iVector.Create(sizeof(int),100);
+	iVector.SetCompareFunction(a,CompareSortKeys);
+	iVector.SetCompareFunction(b,CompareSortKeys);
+	for (i = 0; i < 300; i++) {
+		rnd = rnd*1103515245 + 12345;
+		k = 1 + (int)(rnd >> 16) % 30;
+		iVector.Add(i&1 ? b : a,&k);
+	}
+	iVector.Sort(a);
+	iVector.Sort(b);
+	p = (int *)iVector.GetData(a);
+	n = iVector.Size(a);
+	for (k = 0; k <= 32; k++) {
+		if (iVector.LowerBound(a,&k,&lo) != 1 || iVector.UpperBound(a,&k,&hi) != 1)
+			Abort();
+		if ((lo < n && p[lo] < k) || (lo > 0 && p[lo-1] >= k) ||
+		    (hi < n && p[hi] <= k) || (hi > 0 && p[hi-1] > k))
+			Abort();
+		i = iVector.EqualRange(a,&k,&first,&last);
+		if (first != lo || last != hi || (i == 1) != (lo < hi))
+			Abort();
+		i = iVector.BinarySearch(a,&k,&idx);
+		if (i == 1 ? idx != lo : (i != CONTAINER_ERROR_NOTFOUND || lo != hi))
+			Abort();
+	}
+
+	CountInts(a,ca);
+	CountInts(b,cb);
+	for (k = 0; k < 4; k++) {
+		switch (k) {
+		case 0: r = iVector.MergeSorted(a,b); break;
+		case 1: r = iVector.SetUnion(a,b); break;
+		case 2: r = iVector.SetIntersection(a,b); break;
+		default: r = iVector.SetDifference(a,b); break;
+		}
+		if (r == NULL || !IsSortedInts(r))
+			Abort();
+		CountInts(r,cr);
+		for (i = 0; i < 40; i++) {
+			switch (k) {
+			case 0: expected = ca[i] + cb[i]; break;
+			case 1: expected = ca[i] > cb[i] ? ca[i] : cb[i]; break;
+			case 2: expected = ca[i] < cb[i] ? ca[i] : cb[i]; break;
+			default: expected = ca[i] > cb[i] ? ca[i] - cb[i] : 0; break;
+			}
+			if (cr[i] != expected)
+				Abort();
+		}
+		iVector.Finalize(r);
+	}
+
+	/* An empty vector and different element sizes */
+	iVector.Clear(b);
+	r = iVector.SetUnion(b,a);
+	if (r == NULL || iVector.Size(r) != n ||
+	    memcmp(iVector.GetData(r),iVector.GetData(a),n*sizeof(int)))
+		Abort();
+	iVector.Finalize(r);
+	r = iVector.SetIntersection(a,b);
+	if (r == NULL || iVector.Size(r) != 0)
+		Abort();
+	iVector.Finalize(r);
+	k = 5;
+	if (iVector.BinarySearch(b,&k,&idx) != CONTAINER_ERROR_NOTFOUND)
+		Abort();
+	iVector.Finalize(b);
+	b = iVector.Create(sizeof(double),10);
+	old = iError.SetErrorFunction(iError.EmptyErrorFunction);
+	iVector.SetErrorFunction(a,iError.EmptyErrorFunction);
+	if (iVector.MergeSorted(a,b) != NULL ||
+	    iVector.LowerBound(a,NULL,&idx) != CONTAINER_ERROR_BADARG)
+		Abort();
+	iError.SetErrorFunction(old);
+	iVector.Finalize(b);
+	iVector.Finalize(a);
+	return 1;
+}
 
 static int compareDoubles(const void *d1,const void *d2,CompareInfo *arg)
 {
@@ -635,6 +2632,41 @@ int main(void)
 	testBinarySearchTree();
 	teststrCollection();
 	TestDictionary();
+	TestDictionaryGrowth();
+	TestFlatDictionary();
+	TestBatchLookup();
+	TestFrozenDictionary();
+	TestDictionarySnapshot();
+	TestKeyArena();
+	TestConcurrentDictionary();
+	TestHashFunctions();
+	TestSeededDictionary();
+	TestFlatHashTable();
+	TestHashTableCapacity(&iHashTable);
+	TestHashTableCapacity(&iFlatHashTable);
+	TestHashTableSaveLoad(&iHashTable);
+	TestHashTableSaveLoad(&iFlatHashTable);
+	TestRCUHashTable();
+	TestHashTableCapacity(&iRCUHashTable);
+	TestHashTableSaveLoad(&iRCUHashTable);
+	TestParallelMerge();
+	TestHashStatistics();
+	TestHashMap();
+	TestHashTableBuildFrom(&iHashTable);
+	TestHashTableBuildFrom(&iFlatHashTable);
+	TestHashTableBuildFrom(&iRCUHashTable);
+	TestHashTableIntegerKeys();
+	TestHashTableScan(&iHashTable);
+	TestHashTableScan(&iFlatHashTable);
+	TestHashTableScan(&iRCUHashTable);
+	TestHashTableCopyElements(&iHashTable);
+	TestHashTableCopyElements(&iFlatHashTable);
+	TestHashTableCopyElements(&iRCUHashTable);
+	TestQsortEx();
+	TestSortParallel();
+	TestSortByKey();
+	TestStableSort();
+	TestSortedVector();
 	TestBitstring();
 	testScapegoatTree();
 	testStreamBuffers();
@@ -0,0 +1,63 @@
+/* Compares one by one and batched dictionary lookups on a table much
+   larger than the cache.
+   gcc -O2 -o batchlookup batchlookup.c ../libccl.a */
+#include <time.h>
+#include "../containers.h"
+
+#define NKEYS   2000000
+#define NQUERY  4000000
+#define BATCH   128
+
+static double Seconds(clock_t t)
+{
+    return (double)(clock()-t)/CLOCKS_PER_SEC;
+}
+
+static void Run(const char *name,DictionaryInterface *intf)
+{
+    Dictionary *dict = intf->Create(sizeof(int),NKEYS);
+    char **keys = malloc(NKEYS*sizeof(char *));
+    const char *query[BATCH];
+    void *results[BATCH];
+    char buf[32];
+    size_t i,j,found;
+    unsigned r = 12345;
+    clock_t t;
+
+    for (i=0; i<NKEYS; i++) {
+        int v = (int)i;
+        sprintf(buf,"key-%zu",i);
+        keys[i] = strdup(buf);
+        intf->Add(dict,keys[i],&v);
+    }
+    t = clock();
+    found = 0;
+    for (i=0; i<NQUERY; i++) {
+        r = r*1103515245+12345;
+        if (intf->GetElement(dict,keys[r % NKEYS]))
+            found++;
+    }
+    printf("%-16s GetElement  %6.3fs (%zu found)\n",name,Seconds(t),found);
+    r = 12345;
+    t = clock();
+    found = 0;
+    for (i=0; i<NQUERY; i += BATCH) {
+        for (j=0; j<BATCH; j++) {
+            r = r*1103515245+12345;
+            query[j] = keys[r % NKEYS];
+        }
+        found += intf->GetElements(dict,BATCH,query,results);
+    }
+    printf("%-16s GetElements %6.3fs (%zu found)\n",name,Seconds(t),found);
+    intf->Finalize(dict);
+    for (i=0; i<NKEYS; i++)
+        free(keys[i]);
+    free(keys);
+}
+
+int main(void)
+{
+    Run("iDictionary",&iDictionary);
+    Run("iFlatDictionary",&iFlatDictionary);
+    return 0;
+}
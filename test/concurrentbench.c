@@ -0,0 +1,98 @@
+/* Measures how a mixed workload (80% CopyElement, 10% Add, 10% Erase)
+   scales from 1 to MAXTHREADS threads with the striped concurrent
+   dictionary and with the chained dictionary behind one global mutex.
+   gcc -O2 -DUNIX -o concurrentbench concurrentbench.c ../libccl.a -lpthread */
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+#include "../containers.h"
+
+#define NKEYS       500000
+#define NOPS        4000000     /* Total, divided among the threads */
+#define MAXTHREADS  16
+
+static char **keys;
+static Dictionary *dict;
+static DictionaryInterface *intf;
+static pthread_mutex_t global = PTHREAD_MUTEX_INITIALIZER;
+static int useGlobalLock;
+static int nthreads;
+
+static double Now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv,NULL);
+    return tv.tv_sec + tv.tv_usec/1e6;
+}
+
+static void *Worker(void *arg)
+{
+    unsigned r = 12345 + 7919*(unsigned)(size_t)arg;
+    size_t i,n = NOPS/nthreads;
+    int v;
+
+    for (i=0; i<n; i++) {
+        const char *key;
+        unsigned op;
+
+        r = r*1103515245+12345;
+        key = keys[(r >> 8) % NKEYS];
+        op = r % 10;
+        if (useGlobalLock) pthread_mutex_lock(&global);
+        if (op == 0)
+            intf->Add(dict,key,&v);
+        else if (op == 1)
+            intf->Erase(dict,key);
+        else
+            intf->CopyElement(dict,key,&v);
+        if (useGlobalLock) pthread_mutex_unlock(&global);
+    }
+    return NULL;
+}
+
+static void Run(const char *name,DictionaryInterface *i,int locked)
+{
+    pthread_t threads[MAXTHREADS];
+    double t,base = 0;
+    size_t k;
+    int n;
+
+    intf = i;
+    useGlobalLock = locked;
+    for (nthreads = 1; nthreads <= MAXTHREADS; nthreads *= 2) {
+        dict = intf->Create(sizeof(int),NKEYS);
+        for (k=0; k<NKEYS; k += 2) {
+            int v = (int)k;
+            intf->Add(dict,keys[k],&v);
+        }
+        t = Now();
+        for (n=0; n<nthreads; n++)
+            pthread_create(&threads[n],NULL,Worker,(void *)(size_t)n);
+        for (n=0; n<nthreads; n++)
+            pthread_join(threads[n],NULL);
+        t = Now()-t;
+        if (nthreads == 1)
+            base = t;
+        printf("%-24s %2d threads %7.3fs  %6.2f Mops/s  speedup %5.2f\n",
+               name,nthreads,t,NOPS/t/1e6,base/t);
+        intf->Finalize(dict);
+    }
+}
+
+int main(void)
+{
+    char buf[32];
+    size_t k;
+
+    keys = malloc(NKEYS*sizeof(char *));
+    for (k=0; k<NKEYS; k++) {
+        sprintf(buf,"key-%zu",k);
+        keys[k] = strdup(buf);
+    }
+    Run("iConcurrentDictionary",&iConcurrentDictionary,0);
+    Run("iDictionary + mutex",&iDictionary,1);
+    for (k=0; k<NKEYS; k++)
+        free(keys[k]);
+    free(keys);
+    return 0;
+}
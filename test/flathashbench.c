@@ -0,0 +1,80 @@
+/* Compares the chained iHashTable with the Robin Hood iFlatHashTable:
+   insertion time, lookups of present and absent keys, erasure and the
+   memory left once all keys are erased, with binary keys of 8 to 40 bytes. The tables are larger than the caches,
+   so the time of a lookup is mostly cache misses.
+   gcc -O2 -o flathashbench flathashbench.c ../libccl.a
+   ./flathashbench [number of keys] */
+#include <time.h>
+#include "../containers.h"
+
+#define NPASSES 5
+
+static unsigned char *keys;
+static size_t *klens,nkeys;
+
+static double Seconds(clock_t t)
+{
+    return (double)(clock()-t)/CLOCKS_PER_SEC;
+}
+
+static void GenerateKeys(void)
+{
+    size_t i,j;
+    unsigned r = 12345;
+
+    keys = malloc(nkeys*40);
+    klens = malloc(nkeys*sizeof(size_t));
+    for (i=0; i<nkeys; i++) {
+        unsigned char *k = keys + i*40;
+        r = r*1103515245+12345;
+        klens[i] = 8 + (r >> 8) % 33;
+        for (j=0; j<klens[i]; j++) {
+            r = r*1103515245+12345;
+            k[j] = (unsigned char)(r >> 16);
+        }
+        memcpy(k,&i,sizeof(i));
+    }
+}
+
+static void Run(const char *name,HashTableInterface *intf)
+{
+    HashTable *ht = intf->Create(sizeof(size_t));
+    volatile size_t sink = 0;
+    size_t i,pass,half = nkeys/2;
+    clock_t start;
+
+    start = clock();
+    for (i=0; i<half; i++)
+        intf->Add(ht,keys + i*40,klens[i],&i);
+    printf("%-14s add    %7.3fs\n",name,Seconds(start));
+    start = clock();
+    for (pass=0; pass<NPASSES; pass++)
+        for (i=0; i<half; i++)
+            sink += intf->GetElement(ht,keys + i*40,klens[i]) != NULL;
+    printf("%-14s hits   %7.3fs\n",name,Seconds(start));
+    start = clock();
+    for (pass=0; pass<NPASSES; pass++)
+        for (i=half; i<nkeys; i++)
+            sink += intf->GetElement(ht,keys + i*40,klens[i]) != NULL;
+    printf("%-14s misses %7.3fs\n",name,Seconds(start));
+    start = clock();
+    for (i=0; i<half; i += 2)
+        intf->Erase(ht,keys + i*40,klens[i]);
+    printf("%-14s erase  %7.3fs  Sizeof %zu\n",name,Seconds(start),intf->Sizeof(ht));
+    for (i=1; i<half; i += 2)
+        intf->Erase(ht,keys + i*40,klens[i]);
+    printf("%-14s empty          Sizeof %zu\n",name,intf->Sizeof(ht));
+    intf->Finalize(ht);
+}
+
+int main(int argc,char *argv[])
+{
+    nkeys = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    GenerateKeys();
+    printf("%zu keys, half of them in the table\n",nkeys);
+    Run("iHashTable",&iHashTable);
+    Run("iFlatHashTable",&iFlatHashTable);
+    free(keys);
+    free(klens);
+    return 0;
+}
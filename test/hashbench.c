@@ -0,0 +1,133 @@
+/* Compares the string hash functions of iHashFunctions: hashing
+   throughput, the distribution of chain lengths in a table with as many
+   buckets as keys, and the lookup time of a dictionary using each one.
+   The keys are read from a file, one per line, or generated as URLs.
+   gcc -O2 -o hashbench hashbench.c ../libccl.a
+   ./hashbench [keyfile] */
+#include <time.h>
+#include "../containers.h"
+
+#define NGENERATED  1000000
+#define NPASSES     10
+#define MAXCHAIN    8
+
+static char **keys;
+static size_t nkeys,totalBytes;
+
+static double Seconds(clock_t t)
+{
+    return (double)(clock()-t)/CLOCKS_PER_SEC;
+}
+
+static void AddKey(const char *key)
+{
+    static size_t capacity;
+
+    if (nkeys == capacity) {
+        capacity = capacity ? 2*capacity : 1024;
+        keys = realloc(keys,capacity*sizeof(char *));
+    }
+    keys[nkeys++] = strdup(key);
+    totalBytes += strlen(key);
+}
+
+static void ReadKeys(const char *fname)
+{
+    char buf[4096],*p;
+    FILE *f = fopen(fname,"r");
+
+    if (f == NULL) {
+        perror(fname);
+        exit(EXIT_FAILURE);
+    }
+    while (fgets(buf,sizeof(buf),f)) {
+        if ((p = strchr(buf,'\n')) != NULL)
+            *p = 0;
+        if (*buf)
+            AddKey(buf);
+    }
+    fclose(f);
+}
+
+static void GenerateKeys(void)
+{
+    static const char *hosts[] = {"www.example.com","static.example.org",
+                                  "api.example.net","images.example.com"};
+    char buf[256];
+    size_t i;
+    unsigned r = 12345;
+
+    for (i=0; i<NGENERATED; i++) {
+        r = r*1103515245+12345;
+        sprintf(buf,"https://%s/catalog/%u/item-%zu.html?ref=%u",
+                hosts[r>>30],(r>>8)%1000,i,(r>>4)%97);
+        AddKey(buf);
+    }
+}
+
+static void Run(const char *name,HashFunction fn)
+{
+    size_t i,pass,nbuckets,*chains,hist[MAXCHAIN+1],longest = 0;
+    double probes = 0,t;
+    volatile size_t sink = 0;
+    Dictionary *d;
+    clock_t start;
+
+    start = clock();
+    for (pass=0; pass<NPASSES; pass++)
+        for (i=0; i<nkeys; i++)
+            sink += fn(keys[i]);
+    t = Seconds(start);
+    printf("%-8s %8.1f MB/s  %7.1f Mkeys/s\n",name,
+           NPASSES*totalBytes/t/1e6,NPASSES*nkeys/t/1e6);
+
+    /* Power of two table indexed with the low bits, the worst case for
+       a weak function */
+    for (nbuckets = 1; nbuckets < nkeys; nbuckets *= 2)
+        ;
+    chains = calloc(nbuckets,sizeof(size_t));
+    for (i=0; i<nkeys; i++)
+        chains[fn(keys[i]) & (nbuckets-1)]++;
+    memset(hist,0,sizeof(hist));
+    for (i=0; i<nbuckets; i++) {
+        hist[chains[i] < MAXCHAIN ? chains[i] : MAXCHAIN]++;
+        if (chains[i] > longest)
+            longest = chains[i];
+        probes += chains[i]*(chains[i]+1)/2.0;
+    }
+    printf("         chains:");
+    for (i=0; i<=MAXCHAIN; i++)
+        printf(" %s%zu:%zu",i == MAXCHAIN ? ">=" : "",i,hist[i]);
+    printf("\n         longest %zu, %.3f probes per hit (ideal %.3f)\n",
+           longest,probes/nkeys,1+nkeys/(2.0*nbuckets));
+    free(chains);
+
+    d = iDictionary.Create(sizeof(size_t),nkeys);
+    iDictionary.SetHashFunction(d,fn);
+    for (i=0; i<nkeys; i++)
+        iDictionary.Add(d,keys[i],&i);
+    start = clock();
+    for (pass=0; pass<NPASSES; pass++)
+        for (i=0; i<nkeys; i++)
+            sink += iDictionary.GetElement(d,keys[i]) != NULL;
+    printf("         iDictionary lookups %.3fs\n",Seconds(start));
+    iDictionary.Finalize(d);
+}
+
+int main(int argc,char *argv[])
+{
+    size_t i;
+
+    if (argc > 1)
+        ReadKeys(argv[1]);
+    else
+        GenerateKeys();
+    printf("%zu keys, average length %.1f\n",nkeys,(double)totalBytes/nkeys);
+    Run("Times33",iHashFunctions.Times33);
+    Run("Murmur",iHashFunctions.Murmur);
+    Run("Wy",iHashFunctions.Wy);
+    for (i=0; i<nkeys; i++)
+        free(keys[i]);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,134 @@
+/* Compares the generic hash tables with the typed maps of hashmapgen.c
+   on integer keys: iHashTable and iFlatHashTable hash the 8 bytes of the
+   key through a function pointer and copy the values with memcpy, while
+   iintptrdoubleMap inlines the hash and the comparison. The last map is
+   instantiated here, from 64 bit keys to a structure.
+   gcc -O2 -I.. -o hashmapbench hashmapbench.c ../libccl.a
+   ./hashmapbench [number of keys] */
+#include <time.h>
+#include "../containers.h"
+#include "../intptrdoublemap.h"
+
+typedef struct { double x,y; int id; } Point;
+
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
+#define KEY_TYPE uint64_t
+#define DATA_TYPE Point
+#define MAP_NAME uint64Point
+#include "../hashmapgen.c"
+
+#define NPASSES 5
+
+static intptr_t *keys;
+static size_t nkeys;
+
+static double Seconds(clock_t t)
+{
+    return (double)(clock()-t)/CLOCKS_PER_SEC;
+}
+
+static void GenerateKeys(void)
+{
+    size_t i;
+    uint64_t r = 12345;
+
+    keys = malloc(nkeys*sizeof(intptr_t));
+    for (i=0; i<nkeys; i++) {
+        r = r*6364136223846793005ULL+1442695040888963407ULL;
+        keys[i] = (intptr_t)(r >> 16);
+    }
+}
+
+static void RunTable(const char *name,HashTableInterface *intf)
+{
+    HashTable *ht = intf->Create(sizeof(double));
+    volatile double sink = 0;
+    size_t i,pass,half = nkeys/2;
+    double d,*pd;
+    clock_t start;
+
+    start = clock();
+    for (i=0; i<half; i++) {
+        d = (double)i;
+        intf->Add(ht,&keys[i],sizeof(intptr_t),&d);
+    }
+    printf("%-18s add    %7.3fs\n",name,Seconds(start));
+    start = clock();
+    for (pass=0; pass<NPASSES; pass++)
+        for (i=0; i<nkeys; i++) {
+            pd = intf->GetElement(ht,&keys[i],sizeof(intptr_t));
+            if (pd) sink += *pd;
+        }
+    printf("%-18s lookup %7.3fs\n",name,Seconds(start));
+    start = clock();
+    for (i=0; i<half; i++)
+        intf->Erase(ht,&keys[i],sizeof(intptr_t));
+    printf("%-18s erase  %7.3fs\n",name,Seconds(start));
+    intf->Finalize(ht);
+}
+
+static void RunMap(void)
+{
+    intptrdoubleMap *m = iintptrdoubleMap.Create(0);
+    volatile double sink = 0;
+    size_t i,pass,half = nkeys/2;
+    double *pd;
+    clock_t start;
+
+    start = clock();
+    for (i=0; i<half; i++)
+        iintptrdoubleMap.Add(m,keys[i],(double)i);
+    printf("%-18s add    %7.3fs\n","iintptrdoubleMap",Seconds(start));
+    start = clock();
+    for (pass=0; pass<NPASSES; pass++)
+        for (i=0; i<nkeys; i++) {
+            pd = iintptrdoubleMap.GetElement(m,keys[i]);
+            if (pd) sink += *pd;
+        }
+    printf("%-18s lookup %7.3fs\n","iintptrdoubleMap",Seconds(start));
+    start = clock();
+    for (i=0; i<half; i++)
+        iintptrdoubleMap.Erase(m,keys[i]);
+    printf("%-18s erase  %7.3fs\n","iintptrdoubleMap",Seconds(start));
+    iintptrdoubleMap.Finalize(m);
+}
+
+static void RunPointMap(void)
+{
+    uint64PointMap *m = iuint64PointMap.Create(0);
+    volatile double sink = 0;
+    size_t i,pass,half = nkeys/2;
+    Point p,*pp;
+    clock_t start;
+
+    start = clock();
+    for (i=0; i<half; i++) {
+        p.x = p.y = (double)i;
+        p.id = (int)i;
+        iuint64PointMap.Add(m,(uint64_t)keys[i],p);
+    }
+    printf("%-18s add    %7.3fs\n","iuint64PointMap",Seconds(start));
+    start = clock();
+    for (pass=0; pass<NPASSES; pass++)
+        for (i=0; i<nkeys; i++) {
+            pp = iuint64PointMap.GetElement(m,(uint64_t)keys[i]);
+            if (pp) sink += pp->x;
+        }
+    printf("%-18s lookup %7.3fs\n","iuint64PointMap",Seconds(start));
+    iuint64PointMap.Finalize(m);
+}
+
+int main(int argc,char *argv[])
+{
+    nkeys = argc > 1 ? (size_t)atol(argv[1]) : 2000000;
+    GenerateKeys();
+    printf("%zu keys, half of them in the table, %d lookup passes\n",nkeys,NPASSES);
+    RunTable("iHashTable",&iHashTable);
+    RunTable("iFlatHashTable",&iFlatHashTable);
+    RunMap();
+    RunPointMap();
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,236 @@
+/* Times qsortEx, the sort behind all the Sort functions of the library,
+   and the qsort of the C library on random, sorted, reversed, organ pipe
+   and many-duplicates inputs, with elements of 4, 8 and 24 bytes. The
+   number of comparisons is printed too: with a comparison function
+   called through a pointer it is most of the time of a sort. The last
+   lines give the elapsed time of iVector.StableSort and SortByKey
+   against Sort, and of iVector.SortParallel on random ints with 1 to
+   MAXTHREADS threads.
+   gcc -O2 -DUNIX -o sortbench sortbench.c ../libccl.a -lpthread
+   ./sortbench [number of elements] */
+#include <time.h>
+#include <sys/time.h>
+#include "../containers.h"
+
+#define MAXTHREADS 16
+
+typedef struct { double x,y; int id; } Record;
+
+static size_t nelems,comparisons;
+
+static int CompareInts(const void *a,const void *b,CompareInfo *ci)
+{
+    int x = *(const int *)a,y = *(const int *)b;
+
+    comparisons++;
+    return (x > y) - (x < y);
+}
+
+static int CompareDoubles(const void *a,const void *b,CompareInfo *ci)
+{
+    double x = *(const double *)a,y = *(const double *)b;
+
+    comparisons++;
+    return (x > y) - (x < y);
+}
+
+static int CompareRecords(const void *a,const void *b,CompareInfo *ci)
+{
+    const Record *x = a,*y = b;
+
+    comparisons++;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static CompareFunction CurrentCompare;
+
+static int LibCompare(const void *a,const void *b)
+{
+    return CurrentCompare(a,b,NULL);
+}
+
+static const char *Patterns[] = {"random","sorted","reversed","organ pipe","16 values"};
+#define NPATTERNS (sizeof(Patterns)/sizeof(Patterns[0]))
+
+static int Key(int pattern,size_t i,uint64_t *r)
+{
+    *r = *r*6364136223846793005ULL+1442695040888963407ULL;
+    switch (pattern) {
+    case 0: return (int)(*r >> 33);
+    case 1: return (int)i;
+    case 2: return (int)(nelems-i);
+    case 3: return (int)(i < nelems/2 ? i : nelems-i);
+    default: return (int)(*r >> 60);
+    }
+}
+
+static void Fill(void *data,size_t width,int pattern)
+{
+    uint64_t r = 12345;
+    size_t i;
+    int k;
+
+    for (i = 0; i < nelems; i++) {
+        k = Key(pattern,i,&r);
+        if (width == sizeof(int))
+            ((int *)data)[i] = k;
+        else if (width == sizeof(double))
+            ((double *)data)[i] = k;
+        else {
+            ((Record *)data)[i].x = ((Record *)data)[i].y = k;
+            ((Record *)data)[i].id = k;
+        }
+    }
+}
+
+static void Run(const char *name,size_t width,CompareFunction cmp)
+{
+    void *data = malloc(nelems*width);
+    CompareInfo ci;
+    size_t p,n;
+    clock_t start;
+    double t1,t2;
+
+    memset(&ci,0,sizeof(ci));
+    CurrentCompare = cmp;
+    for (p = 0; p < NPATTERNS; p++) {
+        Fill(data,width,(int)p);
+        comparisons = 0;
+        start = clock();
+        qsortEx(data,nelems,width,cmp,&ci);
+        t1 = (double)(clock()-start)/CLOCKS_PER_SEC;
+        n = comparisons;
+        Fill(data,width,(int)p);
+        comparisons = 0;
+        start = clock();
+        qsort(data,nelems,width,LibCompare);
+        t2 = (double)(clock()-start)/CLOCKS_PER_SEC;
+        printf("%-8s %-11s qsortEx %7.3fs %11zu cmp   qsort %7.3fs %11zu cmp\n",
+               name,Patterns[p],t1,n,t2,comparisons);
+    }
+    free(data);
+}
+
+static int CompareIntsQuiet(const void *a,const void *b,CompareInfo *ci)
+{
+    int x = *(const int *)a,y = *(const int *)b;
+
+    return (x > y) - (x < y);
+}
+
+static int CompareDoublesQuiet(const void *a,const void *b,CompareInfo *ci)
+{
+    double x = *(const double *)a,y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static int CompareRecordsQuiet(const void *a,const void *b,CompareInfo *ci)
+{
+    const Record *x = a,*y = b;
+
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static double Now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv,NULL);
+    return tv.tv_sec + tv.tv_usec/1e6;
+}
+
+static void RunVector(void)
+{
+    Vector *v = iVector.Create(sizeof(int),nelems),*copy;
+    uint64_t r = 12345;
+    size_t i;
+    double start,one = 0;
+    char buf[16];
+    int k,n;
+
+    iVector.SetCompareFunction(v,CompareIntsQuiet);
+    for (i = 0; i < nelems; i++) {
+        k = Key(0,i,&r);
+        iVector.Add(v,&k);
+    }
+    for (n = 1; n <= MAXTHREADS; n *= 2) {
+        sprintf(buf,"%d",n);
+        setenv("CCL_THREADS",buf,1);
+        copy = iVector.Copy(v);
+        start = Now();
+        iVector.SortParallel(copy);
+        start = Now() - start;
+        if (n == 1)
+            one = start;
+        printf("SortParallel %2d threads %7.3fs speedup %5.2f\n",n,start,one/start);
+        iVector.Finalize(copy);
+    }
+    iVector.Finalize(v);
+}
+
+static void RunStable(void)
+{
+    Vector *v,*copy;
+    void *data = malloc(nelems*sizeof(Record));
+    size_t p;
+    double t1,t2;
+
+    for (p = 0; p < NPATTERNS; p++) {
+        v = iVector.Create(sizeof(Record),nelems);
+        iVector.SetCompareFunction(v,CompareRecordsQuiet);
+        Fill(data,sizeof(Record),(int)p);
+        iVector.AddRange(v,nelems,data);
+        copy = iVector.Copy(v);
+        t1 = Now();
+        iVector.Sort(copy);
+        t1 = Now() - t1;
+        iVector.Finalize(copy);
+        copy = iVector.Copy(v);
+        t2 = Now();
+        iVector.StableSort(copy);
+        t2 = Now() - t2;
+        printf("record   %-11s Sort    %7.3fs   StableSort %7.3fs\n",Patterns[p],t1,t2);
+        iVector.Finalize(copy);
+        iVector.Finalize(v);
+    }
+    free(data);
+}
+
+static void RunKey(const char *name,size_t width,CompareFunction cmp,size_t offset,size_t KeyWidth,int KeyType)
+{
+    Vector *v = iVector.Create(width,nelems),*copy;
+    void *data = malloc(nelems*width);
+    double t1,t2;
+
+    iVector.SetCompareFunction(v,cmp);
+    Fill(data,width,0);
+    iVector.AddRange(v,nelems,data);
+    free(data);
+    copy = iVector.Copy(v);
+    t1 = Now();
+    iVector.Sort(copy);
+    t1 = Now() - t1;
+    iVector.Finalize(copy);
+    copy = iVector.Copy(v);
+    t2 = Now();
+    iVector.SortByKey(copy,offset,KeyWidth,KeyType);
+    t2 = Now() - t2;
+    printf("%-8s random      Sort    %7.3fs   SortByKey %7.3fs\n",name,t1,t2);
+    iVector.Finalize(copy);
+    iVector.Finalize(v);
+}
+
+int main(int argc,char *argv[])
+{
+    nelems = argc > 1 ? (size_t)atol(argv[1]) : 2000000;
+    printf("%zu elements\n",nelems);
+    Run("int",sizeof(int),CompareInts);
+    Run("double",sizeof(double),CompareDoubles);
+    Run("record",sizeof(Record),CompareRecords);
+    RunStable();
+    RunKey("int",sizeof(int),CompareIntsQuiet,0,sizeof(int),CCL_KEY_SIGNED);
+    RunKey("double",sizeof(double),CompareDoublesQuiet,0,sizeof(double),CCL_KEY_FLOAT);
+    RunKey("record",sizeof(Record),CompareRecordsQuiet,offsetof(Record,id),sizeof(int),CCL_KEY_SIGNED);
+    RunVector();
+    return 0;
+}
@@ -0,0 +1,11 @@
+#include "containers.h"
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
+#define KEY_TYPE uint64_t
+#define DATA_TYPE uint64_t
+#define MAP_NAME uint64uint64
+#include "hashmapgen.c"
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
@@ -0,0 +1,14 @@
+#ifndef __uint64uint64Map_h__
+#define __uint64uint64Map_h__
+#include "containers.h"
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
+#define KEY_TYPE uint64_t
+#define DATA_TYPE uint64_t
+#define MAP_NAME uint64uint64
+#include "hashmapgen.h"
+#undef KEY_TYPE
+#undef DATA_TYPE
+#undef MAP_NAME
+#endif
@@ -815,23 +815,73 @@ static CompareFunction SetCompareFunction(ValArray *l,CompareFunction fn)
 	return NULL;
 }
 
+#if defined(__IS_UNSIGNED__)
+#define RADIX_KEY_TYPE CCL_KEY_UNSIGNED
+#elif defined(__IS_INTEGER__)
+#define RADIX_KEY_TYPE CCL_KEY_SIGNED
+#else
+#define RADIX_KEY_TYPE CCL_KEY_FLOAT
+#endif
+
+/* The integers, floats and doubles are radix sorted by KeySort. A long
+   double, whose size includes padding, is compared. */
+static void SortTable(ValArray *AL,ElementType *tab,size_t n)
+{
+	if (KeySort(tab,n,sizeof(ElementType),0,sizeof(ElementType),RADIX_KEY_TYPE,AL->Allocator) < 0)
+		qsort(tab,n,sizeof(ElementType),ValArrayDefaultCompareFn);
+}
+
 static int Sort(ValArray *AL)
 {
 	if (AL->Slice) {
-		size_t i,j=0;
-		ElementType *sliceTab = AL->Allocator->calloc(sizeof(ElementType),AL->Slice->length);
+		size_t i,j;
+		ElementType *sliceTab = AL->Allocator->malloc(sizeof(ElementType)*AL->Slice->length);
 		if (sliceTab == NULL) return NoMemory("Sort");
-		for (i=AL->Slice->start;i<AL->Slice->length;i += AL->Slice->increment) {
+		for (i=AL->Slice->start,j=0; j<AL->Slice->length; i += AL->Slice->increment)
 			sliceTab[j++] = AL->contents[i];
-		}
-		qsort(sliceTab,AL->Slice->length,sizeof(ElementType),ValArrayDefaultCompareFn);
-		j=0;
-		for (i=AL->Slice->start; i<AL->Slice->length; i += AL->Slice->increment) {
+		SortTable(AL,sliceTab,AL->Slice->length);
+		for (i=AL->Slice->start,j=0; j<AL->Slice->length; i += AL->Slice->increment)
 			AL->contents[i] = sliceTab[j++];
-		}
 		AL->Allocator->free(sliceTab);
 	}
-	else qsort(AL->contents,AL->count,sizeof(ElementType),ValArrayDefaultCompareFn);
+	else SortTable(AL,AL->contents,AL->count);
+	return 1;
+}
+
+static int ValArrayCompare(const void *pleft,const void *pright,CompareInfo *ci)
+{
+	return ValArrayDefaultCompareFn(pleft,pright);
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     SortParallel ID:1
+ Purpose:       Sorts the array or its slice in several threads (the
+                number of processors or CCL_THREADS)
+ Input:         The array
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        NOMEMORY if the elements of a slice can't be copied
+------------------------------------------------------------------------*/
+static int SortParallel(ValArray *AL)
+{
+	size_t i,j;
+	ElementType *sliceTab;
+	CompareInfo ci;
+
+	ci.ContainerLeft = AL;
+	ci.ContainerRight = NULL;
+	ci.ExtraArgs = NULL;
+	if (AL->Slice) {
+		sliceTab = AL->Allocator->malloc(sizeof(ElementType)*AL->Slice->length);
+		if (sliceTab == NULL) return NoMemory("SortParallel");
+		for (i=AL->Slice->start,j=0; j<AL->Slice->length; i += AL->Slice->increment)
+			sliceTab[j++] = AL->contents[i];
+		ParallelSort(sliceTab,AL->Slice->length,sizeof(ElementType),ValArrayCompare,&ci,AL->Allocator);
+		for (i=AL->Slice->start,j=0; j<AL->Slice->length; i += AL->Slice->increment)
+			AL->contents[i] = sliceTab[j++];
+		AL->Allocator->free(sliceTab);
+	}
+	else ParallelSort(AL->contents,AL->count,sizeof(ElementType),ValArrayCompare,&ci,AL->Allocator);
+	AL->timestamp++;
 	return 1;
 }
 
@@ -2312,4 +2362,5 @@ ValArrayInterface iValArrayInterface = {
 	Front,
 	RemoveRange,
 	Resize,
+	SortParallel,
 };
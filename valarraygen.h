@@ -118,4 +118,5 @@ typedef struct {
 	ElementType (*Front)(const ValArray *src);	
     int (*RemoveRange)(ValArray *src,size_t start,size_t end);
     int (*Resize)(ValArray *src, size_t newSize);
+    int (*SortParallel)(ValArray *AL);
 } ValArrayInterface;
@@ -1065,6 +1065,84 @@ static int Sort(Vector *AL)
 	return 1;
 }
 
+/*------------------------------------------------------------------------
+ Procedure:     SortParallel ID:1
+ Purpose:       Sorts the vector like Sort, in several threads (the
+                number of processors or CCL_THREADS). The comparison
+                function must be thread safe.
+ Input:         The vector
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG if the vector is NULL
+------------------------------------------------------------------------*/
+static int SortParallel(Vector *AL)
+{
+	CompareInfo ci;
+
+	if (AL == NULL) {
+		return NullPtrError("SortParallel");
+	}
+	ci.ContainerLeft = AL;
+	ci.ContainerRight = NULL;
+	ci.ExtraArgs = NULL;
+	ParallelSort(AL->contents,AL->count,AL->ElementSize,AL->CompareFn,&ci,AL->Allocator);
+	return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     SortByKey ID:1
+ Purpose:       Sorts the vector by an integer or floating point key
+                stored in each element, without a comparison function.
+                Large vectors are radix sorted. Elements with equal
+                keys keep their order.
+ Input:         The vector, the offset and width of the key in the
+                element, and its type: CCL_KEY_UNSIGNED, CCL_KEY_SIGNED
+                or CCL_KEY_FLOAT.
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG if the vector is NULL, if the key isn't within
+                the element or has a width other than 1, 2, 4 or 8 (4
+                or 8 for a float)
+------------------------------------------------------------------------*/
+static int SortByKey(Vector *AL,size_t offset,size_t width,int KeyType)
+{
+	int r;
+
+	if (AL == NULL) {
+		return NullPtrError("SortByKey");
+	}
+	r = KeySort(AL->contents,AL->count,AL->ElementSize,offset,width,KeyType,AL->Allocator);
+	if (r < 0)
+		AL->RaiseError("iVector.SortByKey",r);
+	return r;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     StableSort ID:1
+ Purpose:       Sorts the vector like Sort, keeping the order of the
+                elements that compare equal, so that it can be sorted
+                by a secondary key and then by the primary one. Sorted
+                or nearly sorted vectors take linear time.
+ Input:         The vector
+ Output:        1 if OK, a negative error code otherwise
+ Errors:        BADARG if the vector is NULL, NOMEMORY if the buffer
+                of half the vector can't be allocated
+------------------------------------------------------------------------*/
+static int StableSort(Vector *AL)
+{
+	CompareInfo ci;
+	int r;
+
+	if (AL == NULL) {
+		return NullPtrError("StableSort");
+	}
+	ci.ContainerLeft = AL;
+	ci.ContainerRight = NULL;
+	ci.ExtraArgs = NULL;
+	r = MergeSort(AL->contents,AL->count,AL->ElementSize,AL->CompareFn,&ci,AL->Allocator);
+	if (r < 0)
+		AL->RaiseError("iVector.StableSort",r);
+	return r;
+}
+
 /* Proposed by PWO
 */
 static int Append(Vector *AL1, Vector *AL2)
@@ -1983,6 +2061,240 @@ static int Select(Vector *src,const Mask *m)
 	return 1;
 }
 
+/* ------------------------------------------------------------------------------ */
+/*                              Sorted vectors                                    */
+/* ------------------------------------------------------------------------------ */
+/* The functions below suppose the vector sorted with its comparison
+   function, by Sort or StableSort. They don't check it. */
+
+/* Index of the first element not less than key, or if upper is set of
+   the first element greater than key: AL->count if there is none. */
+static size_t Bound(const Vector *AL,const void *key,int upper)
+{
+	size_t lo = 0,hi = AL->count,mid;
+	CompareInfo ci;
+	int c;
+
+	ci.ContainerLeft = (Vector *)AL;
+	ci.ContainerRight = NULL;
+	ci.ExtraArgs = NULL;
+	while (lo < hi) {
+		mid = lo + (hi - lo)/2;
+		c = AL->CompareFn((char *)AL->contents + mid*AL->ElementSize,key,&ci);
+		if (c < 0 || (upper && c == 0))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static int CheckBoundArgs(const Vector *AL,const void *key,const void *result,const char *fnName)
+{
+	if (AL == NULL)
+		return NullPtrError(fnName);
+	if (key == NULL || result == NULL)
+		return doerror(AL,fnName,CONTAINER_ERROR_BADARG);
+	return 1;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     LowerBound ID:1
+ Purpose:       Finds in a sorted vector the first element not less
+                than the key: the position where the key would be
+                inserted before its equals.
+ Input:         The vector, the key, and where to store the index
+ Output:        1, and the index (the size of the vector if all its
+                elements are less than the key), or a negative error
+ Errors:        BADARG if an argument is NULL
+------------------------------------------------------------------------*/
+static int LowerBound(const Vector *AL,const void *key,size_t *result)
+{
+	int r = CheckBoundArgs(AL,key,result,"LowerBound");
+
+	if (r > 0)
+		*result = Bound(AL,key,0);
+	return r;
+}
+
+/* Like LowerBound, for the first element greater than the key */
+static int UpperBound(const Vector *AL,const void *key,size_t *result)
+{
+	int r = CheckBoundArgs(AL,key,result,"UpperBound");
+
+	if (r > 0)
+		*result = Bound(AL,key,1);
+	return r;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     EqualRange ID:1
+ Purpose:       Finds in a sorted vector the elements equal to the key.
+                They go from *first to *last excluded.
+ Input:         The vector, the key, and where to store the bounds
+ Output:        1 if there is such an element, NOTFOUND if not (*first
+                and *last are then the position of the key), or a
+                negative error code
+ Errors:        BADARG if an argument is NULL
+------------------------------------------------------------------------*/
+static int EqualRange(const Vector *AL,const void *key,size_t *first,size_t *last)
+{
+	int r = CheckBoundArgs(AL,key,first,"EqualRange");
+
+	if (r < 0)
+		return r;
+	if (last == NULL)
+		return doerror(AL,"EqualRange",CONTAINER_ERROR_BADARG);
+	*first = Bound(AL,key,0);
+	*last = Bound(AL,key,1);
+	return *first < *last ? 1 : CONTAINER_ERROR_NOTFOUND;
+}
+
+/* IndexOf in O(log n) for a sorted vector: the index of the first
+   element equal to the key. */
+static int BinarySearch(const Vector *AL,const void *key,size_t *result)
+{
+	CompareInfo ci;
+	size_t i;
+	int r = CheckBoundArgs(AL,key,result,"BinarySearch");
+
+	if (r < 0)
+		return r;
+	i = Bound(AL,key,0);
+	ci.ContainerLeft = (Vector *)AL;
+	ci.ContainerRight = NULL;
+	ci.ExtraArgs = NULL;
+	if (i == AL->count ||
+	    AL->CompareFn((char *)AL->contents + i*AL->ElementSize,key,&ci))
+		return CONTAINER_ERROR_NOTFOUND;
+	*result = i;
+	return 1;
+}
+
+#define SORTED_MERGE        0
+#define SORTED_UNION        1
+#define SORTED_INTERSECTION 2
+#define SORTED_DIFFERENCE   3
+
+/* Builds in one pass over two sorted vectors a new sorted vector with
+   the comparison function, error function and allocator of the first.
+   As in the C++ library, of n equal elements in a and m in b the merge
+   keeps n+m, the union max(n,m), the intersection min(n,m) and the
+   difference n-m, taking first the elements of a. */
+static Vector *SortedOperation(const Vector *a,const Vector *b,int op,const char *fnName)
+{
+	Vector *result;
+	const char *pa,*pb,*ea,*eb;
+	char *dst;
+	size_t es,n;
+	CompareInfo ci;
+	int c;
+
+	if (a == NULL || b == NULL) {
+		NullPtrError(fnName);
+		return NULL;
+	}
+	if (a->ElementSize != b->ElementSize) {
+		ErrorIncompatible(a,fnName);
+		return NULL;
+	}
+	es = a->ElementSize;
+	switch (op) {
+	case SORTED_INTERSECTION:
+		n = a->count < b->count ? a->count : b->count;
+		break;
+	case SORTED_DIFFERENCE:
+		n = a->count;
+		break;
+	default:
+		n = a->count + b->count;
+		break;
+	}
+	result = CreateWithAllocator(es,n,a->Allocator);
+	if (result == NULL)
+		return NULL;
+	result->CompareFn = a->CompareFn;
+	result->RaiseError = a->RaiseError;
+	result->VTable = a->VTable;
+	ci.ContainerLeft = (Vector *)a;
+	ci.ContainerRight = (Vector *)b;
+	ci.ExtraArgs = NULL;
+	dst = result->contents;
+	pa = a->contents;
+	ea = pa + a->count*es;
+	pb = b->contents;
+	eb = pb + b->count*es;
+	while (pa < ea && pb < eb) {
+		c = a->CompareFn(pa,pb,&ci);
+		if (c < 0) {
+			if (op != SORTED_INTERSECTION) {
+				memcpy(dst,pa,es);
+				dst += es;
+			}
+			pa += es;
+		}
+		else if (c > 0) {
+			if (op == SORTED_MERGE || op == SORTED_UNION) {
+				memcpy(dst,pb,es);
+				dst += es;
+			}
+			pb += es;
+		}
+		else {
+			if (op != SORTED_DIFFERENCE) {
+				memcpy(dst,pa,es);
+				dst += es;
+			}
+			pa += es;
+			/* The merge keeps the element of b for later */
+			if (op != SORTED_MERGE)
+				pb += es;
+		}
+	}
+	if (op != SORTED_INTERSECTION && pa < ea) {
+		memcpy(dst,pa,ea - pa);
+		dst += ea - pa;
+	}
+	if ((op == SORTED_MERGE || op == SORTED_UNION) && pb < eb) {
+		memcpy(dst,pb,eb - pb);
+		dst += eb - pb;
+	}
+	result->count = (dst - (char *)result->contents)/es;
+	return result;
+}
+
+/*------------------------------------------------------------------------
+ Procedure:     MergeSorted ID:1
+ Purpose:       Merges two sorted vectors into a new sorted vector. On
+                equal elements those of a come first.
+ Input:         The two vectors
+ Output:        The new vector, or NULL
+ Errors:        BADARG if a vector is NULL, INCOMPATIBLE if their
+                elements have different sizes, NOMEMORY
+------------------------------------------------------------------------*/
+static Vector *MergeSorted(const Vector *a,const Vector *b)
+{
+	return SortedOperation(a,b,SORTED_MERGE,"MergeSorted");
+}
+
+/* The elements of a or of b, in a new sorted vector */
+static Vector *SetUnion(const Vector *a,const Vector *b)
+{
+	return SortedOperation(a,b,SORTED_UNION,"SetUnion");
+}
+
+/* The elements of a that are in b */
+static Vector *SetIntersection(const Vector *a,const Vector *b)
+{
+	return SortedOperation(a,b,SORTED_INTERSECTION,"SetIntersection");
+}
+
+/* The elements of a that aren't in b */
+static Vector *SetDifference(const Vector *a,const Vector *b)
+{
+	return SortedOperation(a,b,SORTED_DIFFERENCE,"SetDifference");
+}
+
 VectorInterface iVector = {
 	Size,
 	GetFlags,
@@ -2047,4 +2359,15 @@ VectorInterface iVector = {
 	CompareEqual,
 	CompareEqualScalar,
 	ResizeTo, /* Reserve */
+	SortParallel,
+	SortByKey,
+	StableSort,
+	LowerBound,
+	UpperBound,
+	EqualRange,
+	BinarySearch,
+	MergeSorted,
+	SetUnion,
+	SetIntersection,
+	SetDifference,
 };
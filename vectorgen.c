@@ -50,6 +50,26 @@ static int IndexOf(const VECTOR_TYPE *AL,const DATA_TYPE data,void *ExtraArgs,si
 	return iVector.IndexOf((Vector *)AL,&data,ExtraArgs,result);
 }
 
+static int LowerBound(const VECTOR_TYPE *AL,const DATA_TYPE key,size_t *result)
+{
+	return iVector.LowerBound((const Vector *)AL,&key,result);
+}
+
+static int UpperBound(const VECTOR_TYPE *AL,const DATA_TYPE key,size_t *result)
+{
+	return iVector.UpperBound((const Vector *)AL,&key,result);
+}
+
+static int EqualRange(const VECTOR_TYPE *AL,const DATA_TYPE key,size_t *first,size_t *last)
+{
+	return iVector.EqualRange((const Vector *)AL,&key,first,last);
+}
+
+static int BinarySearch(const VECTOR_TYPE *AL,const DATA_TYPE key,size_t *result)
+{
+	return iVector.BinarySearch((const Vector *)AL,&key,result);
+}
+
 static int InsertAt(VECTOR_TYPE *AL,size_t idx,DATA_TYPE newval)
 {
 	return iVector.InsertAt((Vector *)AL, idx,&newval);;
@@ -194,6 +214,13 @@ static VECTOR_TYPE *SetVTable(VECTOR_TYPE *result)
 	intface->GetElement = (DATA_TYPE *(*)(const VECTOR_TYPE *,size_t))iVector.GetElement;
 	intface->Back = (DATA_TYPE *(*)(const VECTOR_TYPE *))iVector.Back;
 	intface->Front = (DATA_TYPE *(*)(const VECTOR_TYPE *))iVector.Front;
+	intface->SortParallel = (int (*)(VECTOR_TYPE *))iVector.SortParallel;
+	intface->SortByKey = (int (*)(VECTOR_TYPE *,size_t,size_t,int))iVector.SortByKey;
+	intface->StableSort = (int (*)(VECTOR_TYPE *))iVector.StableSort;
+	intface->MergeSorted = (VECTOR_TYPE *(*)(const VECTOR_TYPE *,const VECTOR_TYPE *))iVector.MergeSorted;
+	intface->SetUnion = (VECTOR_TYPE *(*)(const VECTOR_TYPE *,const VECTOR_TYPE *))iVector.SetUnion;
+	intface->SetIntersection = (VECTOR_TYPE *(*)(const VECTOR_TYPE *,const VECTOR_TYPE *))iVector.SetIntersection;
+	intface->SetDifference = (VECTOR_TYPE *(*)(const VECTOR_TYPE *,const VECTOR_TYPE *))iVector.SetDifference;
 
 	return result;
 }
@@ -306,4 +333,15 @@ INTERFACE(DATA_TYPE)   INTERFACE_NAME(DATA_TYPE) = {
 	NULL,       /* CompareEqual, */
 	CompareEqualScalar,
 	NULL,       /* Reserve */
+	NULL,       /* SortParallel */
+	NULL,       /* SortByKey */
+	NULL,       /* StableSort */
+	LowerBound,
+	UpperBound,
+	EqualRange,
+	BinarySearch,
+	NULL,       /* MergeSorted */
+	NULL,       /* SetUnion */
+	NULL,       /* SetIntersection */
+	NULL,       /* SetDifference */
 };
@@ -127,5 +127,16 @@ struct INTERFACE_STRUCT_INTERNAL_NAME(DATA_TYPE) {
     Mask *(*CompareEqual)(const VECTOR_TYPE *left,const VECTOR_TYPE *right,Mask *m);
     Mask *(*CompareEqualScalar)(const VECTOR_TYPE *left, const DATA_TYPE right,Mask *m);
     int (*Reserve)(VECTOR_TYPE *src,size_t newCapacity);
+    int (*SortParallel)(VECTOR_TYPE *AL);
+    int (*SortByKey)(VECTOR_TYPE *AL,size_t offset,size_t width,int KeyType);
+    int (*StableSort)(VECTOR_TYPE *AL);
+    int (*LowerBound)(const VECTOR_TYPE *AL,const DATA_TYPE key,size_t *result);
+    int (*UpperBound)(const VECTOR_TYPE *AL,const DATA_TYPE key,size_t *result);
+    int (*EqualRange)(const VECTOR_TYPE *AL,const DATA_TYPE key,size_t *first,size_t *last);
+    int (*BinarySearch)(const VECTOR_TYPE *AL,const DATA_TYPE key,size_t *result);
+    VECTOR_TYPE *(*MergeSorted)(const VECTOR_TYPE *a,const VECTOR_TYPE *b);
+    VECTOR_TYPE *(*SetUnion)(const VECTOR_TYPE *a,const VECTOR_TYPE *b);
+    VECTOR_TYPE *(*SetIntersection)(const VECTOR_TYPE *a,const VECTOR_TYPE *b);
+    VECTOR_TYPE *(*SetDifference)(const VECTOR_TYPE *a,const VECTOR_TYPE *b);
 };
 #endif